@@ -108,8 +108,20 @@ SOURCES +=./src/main.cpp\
     ./src/workspace/libcontent.cpp \
     ./src/utils/filecompare.cpp \
     ./src/player/player.cpp \
+    ./src/player/offlineRenderer.cpp \
+    ./src/player/audioSink.cpp \
+    ./src/player/playerStats.cpp \
+    ./src/player/realTime.cpp \
+    ./src/player/resampler.cpp \
+    ./src/player/engineContext.cpp \
+    ./src/player/mappedFile.cpp \
+    ./src/player/engineCache.cpp \
+    ./src/player/drumsetPreloader.cpp \
+    ./src/player/songPreparer.cpp \
+    ./src/player/batchRenderer.cpp \
     ./src/player/soundManager.c \
     ./src/player/mixer.c \
+    ./src/player/mixerKernels.c \
     ./src/player/songPlayer.cpp \
     ./src/model/tree/project/paramsfoldertreemodel.cpp \
     ./src/workspace/settings.cpp \
@@ -141,6 +153,7 @@ SOURCES +=./src/main.cpp\
     ./src/vm/vmscreen.cpp \
     ./src/vm/virtualmachinepanel.cpp \
     ./src/dialogs/optionsdialog.cpp \
+    ./src/dialogs/playerstatsdialog.cpp \
     ./src/bbmanagerapplication.cpp \
     ./src/utils/midifilewriter.cpp \
     ./src/utils/filedownloader.cpp \
@@ -230,7 +243,21 @@ HEADERS  += \
     ./src/utils/filecompare.h \
     ./src/player/settings.h \
     ./src/player/player.h \
+    ./src/player/offlineRenderer.h \
+    ./src/player/audioSink.h \
+    ./src/player/playerStats.h \
+    ./src/player/realTime.h \
+    ./src/player/resampler.h \
+    ./src/player/engineContext.h \
+    ./src/player/mappedFile.h \
+    ./src/player/engineCache.h \
+    ./src/player/drumsetPreloader.h \
+    ./src/player/songPreparer.h \
+    ./src/player/spscQueue.h \
+    ./src/player/batchRenderer.h \
+    ./src/player/threadLocal.h \
     ./src/player/mixer.h \
+    ./src/player/mixerKernels.h \
     ./src/player/songPlayer.h \
     ./src/player/button.h \
     ./src/player/soundManager.h \
@@ -271,6 +298,7 @@ HEADERS  += \
     ./src/model/tree/song/portablesongfile.h \
     ./src/pragmapack.h \
     ./src/dialogs/optionsdialog.h \
+    ./src/dialogs/playerstatsdialog.h \
     ./src/bbmanagerapplication.h \
     ./src/model/filegraph/trackfile.h \
     ./src/utils/filedownloader.h \
@@ -45,6 +45,7 @@ BeatsPanel::BeatsPanel(QWidget *parent) :
    p_MainContainer->layout()->addWidget(mp_SongFolderView);
    connect(mp_SongFolderView, SIGNAL(rootIndexChanged(QModelIndex)), this, SLOT(slotOnRootIndexChanged(QModelIndex)));
    connect(mp_SongFolderView, &SongFolderView::sigSelectTrack, this, &BeatsPanel::slotSelectTrack);
+   connect(mp_SongFolderView, &SongFolderView::sigRenderSong, this, &BeatsPanel::slotRenderSong);
    connect(mp_SongFolderView, SIGNAL(sigSetTitle(QString)), this, SLOT(setTitle(QString)));
 }
 
@@ -65,6 +66,11 @@ void BeatsPanel::slotSelectTrack(const QByteArray &trackData, int trackIndex, in
    emit sigSelectTrack(trackData, trackIndex, typeId, partIndex);
 }
 
+void BeatsPanel::slotRenderSong(const QModelIndex &songIndex)
+{
+   emit sigRenderSong(songIndex);
+}
+
 void BeatsPanel::slotOnRootIndexChanged(const QModelIndex &index)
 {
    if(!index.isValid() || !mp_SongFolderView->model()){
@@ -31,6 +31,7 @@ public:
 
 signals:
    void sigSelectTrack(const QByteArray &trackData, int trackIndex, int typeId, int partIndex);
+   void sigRenderSong(const QModelIndex &songIndex);
 
 public slots:
    void setTitle(const QString &text);
@@ -39,6 +40,7 @@ public slots:
 private slots:
    void slotOnRootIndexChanged(const QModelIndex &root);
    void slotSelectTrack(const QByteArray &trackData, int trackIndex, int typeId, int partIndex);
+   void slotRenderSong(const QModelIndex &songIndex);
    void slotSetPlayerEnabled(bool enabled);
 
 protected:
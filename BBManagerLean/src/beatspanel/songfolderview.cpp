@@ -493,6 +493,7 @@ void SongFolderView::insertRowsInternal(int start, int end, bool modal)
          mp_ChildrenItems->insert(i, p_SongWidget);
          connect(p_SongWidget, SIGNAL(sigSubWidgetClicked(QModelIndex)), this, SLOT(slotSubWidgetClicked(QModelIndex)));
          connect(p_SongWidget, &SongWidget::sigSelectTrack, this, &SongFolderView::slotSelectTrack);
+         connect(p_SongWidget, &SongWidget::sigRenderSong, this, &SongFolderView::slotRenderSong);
 
          p_SongWidget->show(); // need to call show when widget created at runtime
 
@@ -1106,6 +1107,11 @@ void SongFolderView::slotSelectTrack(const QByteArray &trackData, int trackIndex
   emit sigSelectTrack(trackData, trackIndex, typeId, partIndex);
 }
 
+void SongFolderView::slotRenderSong(const QModelIndex &songIndex)
+{
+  emit sigRenderSong(songIndex);
+}
+
 void SongFolderView::slotSetPlayerEnabled(bool enabled)
 {
    for(int i = 0; i < mp_ChildrenItems->count(); i++){
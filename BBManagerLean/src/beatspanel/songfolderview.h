@@ -46,6 +46,7 @@ signals:
    void rootIndexChanged(const QModelIndex & index);
    void sigSelectTrack(const QByteArray &trackData, int trackIndex, int typeId, int partIndex);
    void sigSetTitle(const QString &title);
+   void sigRenderSong(const QModelIndex &songIndex);
 
 public slots:
    virtual void setRootIndex(const QModelIndex & index);
@@ -67,6 +68,7 @@ protected slots:
    void slotLayoutChanged(const QList<QPersistentModelIndex> & parents = QList<QPersistentModelIndex> (), QAbstractItemModel::LayoutChangeHint hint = QAbstractItemModel::NoLayoutChangeHint);
    void slotRowsMoved(const QModelIndex & sourceParent, int sourceStart, int sourceEnd, const QModelIndex & destinationParent, int destinationRow);
    void slotSelectTrack(const QByteArray &trackData, int trackIndex, int typeId, int partIndex);
+   void slotRenderSong(const QModelIndex &songIndex);
 
 private:
    // Custom method for custom behavior
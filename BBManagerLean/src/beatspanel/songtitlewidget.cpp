@@ -17,6 +17,7 @@
 #include <QEvent>
 #include <QList>
 #include <QTimer>
+#include <QMenu>
 
 #include "songtitlewidget.h"
 #include "../model/filegraph/songmodel.h"
@@ -195,6 +196,9 @@ SongTitleWidget::SongTitleWidget(QAbstractItemModel *p_Model, QWidget *parent) :
    if (Settings::midiIdEnabled()) {
         connect(mp_Number    , SIGNAL(editingFinished      (  )), this,         SLOT(slotNumberChangeByUI ()));
    }
+
+   setContextMenuPolicy(Qt::CustomContextMenu);
+   connect(this, &SongTitleWidget::customContextMenuRequested, this, &SongTitleWidget::slotContextMenu);
 }
 
 void SongTitleWidget::slotTempoChangeByModel(int tempo)
@@ -274,6 +278,17 @@ void SongTitleWidget::slotAPBoxClicked(bool checked)
     emit sigSubWidgetClicked();
 }
 
+void SongTitleWidget::slotContextMenu(const QPoint &pos)
+{
+    QMenu contextMenu(this);
+    QAction *p_RenderAction = contextMenu.addAction(tr("Render to WAV..."));
+
+    emit sigSubWidgetClicked();
+    if (contextMenu.exec(mapToGlobal(pos)) == p_RenderAction) {
+        emit sigRenderToWav();
+    }
+}
+
 void SongTitleWidget::slotTitleChangeByUI()
 {
    emit sigTitleChangeByUI(mp_Title->text());
@@ -38,6 +38,7 @@ signals:
    void sigDefaultDrmChangeByUI(const QString &drmName, const QString &drmFileName);
    void sigAPEnableChangeByUI(bool state);
    void sigGetAPState();
+   void sigRenderToWav();
 
 public slots:
    void slotAutoPilotChangeByModel(bool state);
@@ -53,6 +54,7 @@ public slots:
    void slotDefaultDrmChangeByUI(int index);
    void slotBlankSaved();
    void slotAPBoxClicked ( bool checked );
+   void slotContextMenu(const QPoint &pos);
 
 private:
    void insertNewDrm(int row);
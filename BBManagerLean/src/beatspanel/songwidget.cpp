@@ -65,6 +65,7 @@ SongWidget::SongWidget(BeatsProjectModel *p_Model, QWidget *parent) :
    connect(mp_SongTitleWidget, SIGNAL(sigSubWidgetClicked()), this, SLOT(slotSubWidgetClicked()));
    connect(mp_SongTitleWidget, SIGNAL(sigAPEnableChangeByUI (bool)), this, SLOT(slotAPEnableChangeByUI (bool)));
    connect(mp_SongTitleWidget, SIGNAL(sigGetAPState()), this, SLOT(slotAPStateRequested ()));
+   connect(mp_SongTitleWidget, &SongTitleWidget::sigRenderToWav, this, &SongWidget::slotRenderToWav);
    connect(this, SIGNAL(sigAPUpdate(bool)), mp_SongTitleWidget, SLOT(slotAutoPilotChangeByModel(bool)));
 
    connect(mp_SongTitleWidget, SIGNAL(sigSubWidgetClicked()), this, SLOT(slotSubWidgetClicked()));
@@ -627,6 +628,11 @@ void SongWidget::slotSelectTrack(const QByteArray &trackData, int trackIndex, in
   emit sigSelectTrack(trackData, trackIndex, typeId, partIndex);
 }
 
+void SongWidget::slotRenderToWav()
+{
+  emit sigRenderSong(modelIndex());
+}
+
 void SongWidget::UpdateAP()
 {
     auto size = mp_SongPartItems->size()-1;
@@ -40,6 +40,7 @@ signals:
    void sigDefaultAutoPilotEnabledChangedByModel(bool state);
    void sigSelectTrack(const QByteArray &trackData, int trackIndex, int typeId, int partIndex);
    void sigAPUpdate(bool state);
+   void sigRenderSong(const QModelIndex &songIndex);
 
 public slots:
    void slotIsFirst(bool first);
@@ -61,6 +62,7 @@ public slots:
    void slotAPStateRequested();
    void slotAPUpdate();
    void slotSawapPart(int start, int end);
+   void slotRenderToWav();
 
 protected:
    virtual void paintEvent(QPaintEvent * event);
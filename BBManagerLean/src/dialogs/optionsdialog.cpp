@@ -29,6 +29,10 @@ OptionsDialog::OptionsDialog(int bufferingTime_ms, QWidget *parent) :
    ui->bufferingTimeSlider->setValue(bufferingTime_ms);
 
    ui->bufferingTimeLabel->setText(tr("Buffering Time : %1 ms").arg(m_bufferingTime_ms, 3, 10, QChar(' ')));
+
+   ui->bufferingMinTimeSpinBox->setRange(MIXER_MIN_BUFFERRING_TIME_MS, MIXER_MAX_BUFFERRING_TIME_MS);
+   ui->bufferingMaxTimeSpinBox->setRange(MIXER_MIN_BUFFERRING_TIME_MS, MIXER_MAX_BUFFERRING_TIME_MS);
+   setAdaptiveBuffering(false, MIXER_MIN_BUFFERRING_TIME_MS, MIXER_MAX_BUFFERRING_TIME_MS);
 }
 
 OptionsDialog::~OptionsDialog()
@@ -48,3 +52,57 @@ void OptionsDialog::on_bufferingTimeSlider_valueChanged(int value)
 
    ui->bufferingTimeLabel->setText(tr("Buffering Time : %1 ms").arg(m_bufferingTime_ms, 3, 10, QChar(' ')));
 }
+
+void OptionsDialog::setAdaptiveBuffering(bool enabled, int minTime_ms, int maxTime_ms)
+{
+   ui->adaptiveBufferingCheckBox->setChecked(enabled);
+   ui->bufferingMinTimeSpinBox->setValue(minTime_ms);
+   ui->bufferingMaxTimeSpinBox->setValue(maxTime_ms);
+   on_adaptiveBufferingCheckBox_toggled(enabled);
+}
+
+bool OptionsDialog::adaptiveBuffering()
+{
+   return ui->adaptiveBufferingCheckBox->isChecked();
+}
+
+int OptionsDialog::bufferingMinTime_ms()
+{
+   return ui->bufferingMinTimeSpinBox->value();
+}
+
+int OptionsDialog::bufferingMaxTime_ms()
+{
+   return ui->bufferingMaxTimeSpinBox->value();
+}
+
+void OptionsDialog::setRealTimeAudio(bool enabled)
+{
+   ui->realTimeAudioCheckBox->setChecked(enabled);
+}
+
+bool OptionsDialog::realTimeAudio()
+{
+   return ui->realTimeAudioCheckBox->isChecked();
+}
+
+void OptionsDialog::on_adaptiveBufferingCheckBox_toggled(bool checked)
+{
+   ui->bufferingMinTimeSpinBox->setEnabled(checked);
+   ui->bufferingMaxTimeSpinBox->setEnabled(checked);
+}
+
+void OptionsDialog::on_bufferingMinTimeSpinBox_valueChanged(int value)
+{
+   // The minimum never exceeds the maximum
+   if(ui->bufferingMaxTimeSpinBox->value() < value){
+      ui->bufferingMaxTimeSpinBox->setValue(value);
+   }
+}
+
+void OptionsDialog::on_bufferingMaxTimeSpinBox_valueChanged(int value)
+{
+   if(ui->bufferingMinTimeSpinBox->value() > value){
+      ui->bufferingMinTimeSpinBox->setValue(value);
+   }
+}
@@ -16,9 +16,20 @@ public:
    ~OptionsDialog();
    inline int bufferingTime_ms(){return m_bufferingTime_ms; }
 
+   void setAdaptiveBuffering(bool enabled, int minTime_ms, int maxTime_ms);
+   bool adaptiveBuffering();
+   int bufferingMinTime_ms();
+   int bufferingMaxTime_ms();
+
+   void setRealTimeAudio(bool enabled);
+   bool realTimeAudio();
+
 private slots:
 
    void on_bufferingTimeSlider_valueChanged(int value);
+   void on_adaptiveBufferingCheckBox_toggled(bool checked);
+   void on_bufferingMinTimeSpinBox_valueChanged(int value);
+   void on_bufferingMaxTimeSpinBox_valueChanged(int value);
 
 private:
    Ui::OptionsDialog *ui;
@@ -0,0 +1,72 @@
+/*
+  	This software and the content provided for use with it is Copyright © 2014-2020 Singular Sound 
+ 	BeatBuddy Manager is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2 as published by
+    the Free Software Foundation.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QtWidgets>
+
+#include "playerstatsdialog.h"
+#include "../player/player.h"
+#include "../workspace/settings.h"
+
+PlayerStatsDialog::PlayerStatsDialog(Player *p_player, QWidget *parent)
+    : QDialog(parent)
+    , mp_player(p_player)
+{
+    setWindowTitle(tr("Playback Statistics"));
+    setMinimumSize(QSize(600, 400));
+
+    mp_text = new QPlainTextEdit(this);
+    mp_text->setReadOnly(true);
+    mp_text->setLineWrapMode(QPlainTextEdit::NoWrap);
+    mp_text->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+
+    mp_logOnStop = new QCheckBox(tr("Log the statistics when the player stops"), this);
+    mp_logOnStop->setChecked(Settings::getPlayerStatsLog());
+    connect(mp_logOnStop, &QCheckBox::toggled, [](bool checked) { Settings::setPlayerStatsLog(checked); });
+
+    QPushButton *copyButton = new QPushButton(tr("Copy"), this);
+    connect(copyButton, &QPushButton::clicked, this, &PlayerStatsDialog::slotCopy);
+    QPushButton *closeButton = new QPushButton(tr("Close"), this);
+    connect(closeButton, &QPushButton::clicked, this, &QDialog::close);
+
+    QHBoxLayout *buttonLayout = new QHBoxLayout();
+    buttonLayout->addWidget(mp_logOnStop);
+    buttonLayout->addStretch();
+    buttonLayout->addWidget(copyButton);
+    buttonLayout->addWidget(closeButton);
+
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+    mainLayout->addWidget(mp_text);
+    mainLayout->addLayout(buttonLayout);
+
+    connect(mp_player, &Player::sigStatsUpdated, this, &PlayerStatsDialog::slotRefresh);
+    slotRefresh();
+}
+
+void PlayerStatsDialog::slotRefresh()
+{
+    // Keep the scroll position while playing
+    int position = mp_text->verticalScrollBar()->value();
+    mp_text->setPlainText(mp_player->stats().toString());
+    mp_text->verticalScrollBar()->setValue(position);
+}
+
+/**
+ * @brief PlayerStatsDialog::slotCopy
+ *        Copy the statistics with the song played, to paste them in a problem report
+ */
+void PlayerStatsDialog::slotCopy()
+{
+    QApplication::clipboard()->setText(mp_player->song() + "\n\n" + mp_text->toPlainText());
+}
@@ -0,0 +1,33 @@
+#ifndef PLAYERSTATSDIALOG_H
+#define PLAYERSTATSDIALOG_H
+
+#include <QDialog>
+
+class Player;
+class QPlainTextEdit;
+class QCheckBox;
+
+/**
+ * @brief The PlayerStatsDialog class
+ *
+ * Timings of the audio thread and use of the voices while playing, refreshed as the
+ * player publishes them. Kept open next to the main window while reproducing a problem.
+ */
+class PlayerStatsDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit PlayerStatsDialog(Player *p_player, QWidget *parent = nullptr);
+
+private slots:
+    void slotRefresh();
+    void slotCopy();
+
+private:
+    Player *mp_player;
+    QPlainTextEdit *mp_text;
+    QCheckBox *mp_logOnStop;
+};
+
+#endif // PLAYERSTATSDIALOG_H
@@ -28,6 +28,7 @@
 #include "../utils/dircleanupmodal.h"
 #include "../model/index.h"
 #include "workspace/workspace.h"
+#include "player/engineCache.h"
 
 
 
@@ -359,7 +360,8 @@ bool DrumsetPanel::saveCurrentDrumset(){
                 return false;
             }
 
-            // Write to file
+            // Write to file, not mapped by the player meanwhile
+            EngineCache::instance()->remove(mp_drmMakerModel->drmPath());
             mDrumSetMaker->writeToFile(mp_drmMakerModel->drmPath());
             return true;
         }
@@ -416,7 +418,8 @@ bool DrumsetPanel::saveCurrentDrumsetAs(){
             QFileInfo fileInfo(filePath);
             w.userLibrary()->libDrumSets()->setCurrentPath(fileInfo.absolutePath());
 
-            // Write to file
+            // Write to file, not mapped by the player meanwhile
+            EngineCache::instance()->remove(filePath);
             mDrumSetMaker->writeToFile(filePath);
 
             if(fileInfo.absoluteFilePath().toUpper() != mp_drmMakerModel->drmPath().toUpper()){
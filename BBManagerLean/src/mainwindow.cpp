@@ -31,6 +31,7 @@
 #include "debug.h"
 #include "dialogs/aboutdialog.h"
 #include "dialogs/optionsdialog.h"
+#include "dialogs/playerstatsdialog.h"
 #include "dialogs/supportdialog.h"
 #include "drmmaker/DrumsetPanel.h"
 #include "mainwindow.h"
@@ -50,6 +51,8 @@
 #include "pexpanel/projectexplorerpanel.h"
 #include "platform/platform.h"
 #include "playbackpanel.h"
+#include "player/engineCache.h"
+#include "player/mappedFile.h"
 #include "quazip.h"
 #include "quazipdir.h"
 #include "quazipfile.h"
@@ -79,6 +82,7 @@ MainWindow::MainWindow(QString default_path, QWidget *parent)
     , m_drag_all(QString("^.*\\.(")+BMFILES_PROJECT_EXTENSION+"|"+BMFILES_SINGLE_FILE_EXTENSION+"|"+BMFILES_PORTABLE_SONG_EXTENSION+"|"+BMFILES_PORTABLE_FOLDER_EXTENSION+"|"+BMFILES_DRUMSET_EXTENSION+")$")
     , m_drag_project(QString("^.*\\.(")+BMFILES_PROJECT_EXTENSION+"|"+BMFILES_SINGLE_FILE_EXTENSION+")$")
     , mp_CheatShitDialog(nullptr)
+    , mp_PlayerStatsDialog(nullptr)
     , m_done(true)
     , update(this)
 {
@@ -221,6 +225,7 @@ void MainWindow::createBeatsModels(const QString &projectFilePath, bool create)
    connect(mp_PlaybackPanel, SIGNAL(signalIsPlaying(bool)),this,SLOT(slotActivePlayer(bool)));
 
    connect(mp_BeatsPanel, &BeatsPanel::sigSelectTrack, mp_PlaybackPanel, &PlaybackPanel::slotSelectTrack);
+   connect(mp_BeatsPanel, &BeatsPanel::sigRenderSong, mp_PlaybackPanel, &PlaybackPanel::slotRenderSong);
    connect(mp_PlaybackPanel, SIGNAL(sigPlayerEnabled(bool)), mp_BeatsPanel, SLOT(slotSetPlayerEnabled(bool)));
 
    mp_beatsModel->songsFolder()->manageParsingErrors(this);
@@ -293,6 +298,7 @@ void MainWindow::deleteModel()
       disconnect(mp_PlaybackPanel, SIGNAL(signalIsPlaying(bool)),this,SLOT(slotActivePlayer(bool)));
 
       disconnect(mp_BeatsPanel, &BeatsPanel::sigSelectTrack, mp_PlaybackPanel, &PlaybackPanel::slotSelectTrack);
+      disconnect(mp_BeatsPanel, &BeatsPanel::sigRenderSong, mp_PlaybackPanel, &PlaybackPanel::slotRenderSong);
       disconnect(mp_PlaybackPanel, SIGNAL(sigPlayerEnabled(bool)), mp_BeatsPanel, SLOT(slotSetPlayerEnabled(bool)));
    }
 
@@ -309,6 +315,9 @@ void MainWindow::deleteModel()
    mp_PlaybackPanel->setModel(mp_beatsModel);
    mp_drmListModel->setBeatsModel(mp_beatsModel);
 
+   // 3 - Release the files of the former project kept by the engine, the player is stopped
+   EngineCache::instance()->clear();
+
    // Delete former model if it is not null
    if(p_oldModel){
       delete p_oldModel;
@@ -401,6 +410,9 @@ void MainWindow::createActions()
     mp_exportPrj = this->buildAction(tr("&Project to SD card"), tr("Export the whole local project to a Pedal / SD card"), tr("Export the whole local project to a Pedal / SD card"));
     connect(mp_exportPrj, SIGNAL(triggered()), this, SLOT(slotExportPrj()));
 
+    mp_renderAllSongs = this->buildAction(tr("All Songs to &WAV..."), tr("Render every song of the project in WAV files"), tr("Render every song of the project in WAV files"));
+    connect(mp_renderAllSongs, &QAction::triggered, [this]() { mp_PlaybackPanel->slotRenderAllSongs(); });
+
     mp_moveFolderUp = this->buildAction(tr("Move Folder Up"), tr("Move current Folder Up one position"), tr("Move current Folder Up one position"), QKeySequence(Qt::ControlModifier | Qt::ShiftModifier | Qt::Key_Up));
     connect(mp_moveFolderUp, SIGNAL(triggered()), this, SLOT(slotMoveFolderUp()));
 
@@ -474,6 +486,14 @@ void MainWindow::createActions()
     mp_ShowOptionsDialog = this->buildAction(tr("Buffering time"), tr("Show Options Dialog"), tr("Show Options Dialog"), QKeySequence(Qt::AltModifier | Qt::Key_F3));
     connect(mp_ShowOptionsDialog, SIGNAL(triggered()), this, SLOT(slotShowOptionsDialog()));
 
+    mp_ShowPlayerStats = this->buildAction(tr("Playback statistics"), tr("Show the timings of the player"), tr("Show the timings of the player"));
+    connect(mp_ShowPlayerStats, SIGNAL(triggered()), this, SLOT(slotShowPlayerStats()));
+
+    mp_SetlistMode = this->buildAction(tr("Setlist mode"), tr("Play the next selected song on the next bar"), tr("Play the next selected song on the next bar instead of stopping"));
+    mp_SetlistMode->setCheckable(true);
+    mp_SetlistMode->setChecked(Settings::getSetlistMode());
+    connect(mp_SetlistMode, SIGNAL(toggled(bool)), this, SLOT(slotSetSetlistMode(bool)));
+
     mp_ShowAboutDialog = this->buildAction(tr("&About BBManager"), tr("Show About Dialog"), tr("Show About Dialog"), QKeySequence(Qt::AltModifier | Qt::Key_F1));
     connect(mp_ShowAboutDialog, SIGNAL(triggered()), this, SLOT(slotShowAboutDialog()));
 
@@ -548,6 +568,7 @@ void MainWindow::createMenus()
     mp_export->addAction(mp_exportFolder);
     mp_export->addSeparator();
     mp_export->addAction(mp_exportPrj);
+    mp_export->addAction(mp_renderAllSongs);
     mp_fileMenu->addSeparator();
     mp_fileMenu->addAction(mp_syncPrj);
     mp_fileMenu->addSeparator();
@@ -604,6 +625,8 @@ void MainWindow::createMenus()
     //mp_toolsMenu->addSeparator();
     mp_toolsMenu->addAction(mp_ChangeWorkspaceLocation);
     mp_toolsMenu->addAction(mp_ShowOptionsDialog);
+    mp_toolsMenu->addAction(mp_ShowPlayerStats);
+    mp_toolsMenu->addAction(mp_SetlistMode);
     mp_toolsMenu->addAction(mp_ShowUpdateDialog);
     //TODO: check this easter egg created by Daefecator.
     if (QFileInfo(QDir(QApplication::applicationDirPath()).absoluteFilePath("Daefecator")).exists()) {
@@ -637,6 +660,7 @@ void MainWindow::createMenus()
     mp_savePrjAs->setEnabled(false);
     mp_syncPrj->setEnabled(false);
     mp_exportPrj->setEnabled(false);
+    mp_renderAllSongs->setEnabled(false);
     mp_moveFolderUp->setEnabled(false);
     mp_moveFolderDown->setEnabled(false);
     mp_moveUp->setEnabled(false);
@@ -693,6 +717,7 @@ void MainWindow::refreshMenus()
     mp_importDrm->setDisabled(editor);
     mp_syncPrj->setDisabled(editor);
     mp_exportPrj->setDisabled(editor);
+    mp_renderAllSongs->setDisabled(editor);
     mp_Copy->setDisabled(editor);
     mp_Paste->setDisabled(editor);
     mp_newSong->setDisabled(editor);
@@ -734,6 +759,7 @@ void MainWindow::refreshMenus()
         mp_savePrjAs->setEnabled(false);
         mp_syncPrj->setEnabled(false);
         mp_exportPrj->setEnabled(false);
+        mp_renderAllSongs->setEnabled(false);
         mp_moveFolderUp->setEnabled(false);
         mp_moveFolderDown->setEnabled(false);
         mp_moveUp->setEnabled(false);
@@ -751,6 +777,7 @@ void MainWindow::refreshMenus()
         mp_exportSong->setEnabled(true);
         mp_exportFolder->setEnabled(true);
         mp_exportPrj->setEnabled(true);
+        mp_renderAllSongs->setEnabled(true);
         mp_savePrj->setEnabled(true);
 
         mp_syncPrj->setEnabled(mp_beatsModel->isProject2WayLinked());
@@ -956,13 +983,12 @@ void MainWindow::slotDrumsetChanged(const QString& drm_path)
         return;
     QString name;
     QMap<int, QString> notes; {
-        QByteArray drm; {
-            QFile file(drm_path);
-            if (!file.open(QIODevice::ReadOnly))
-                return;
-            drm = file.readAll();
-        }
-        auto data = drm.data();
+        // Mapped, only the instruments table and the names are read from the disk
+        MappedFile file;
+        if (!file.open(drm_path) || file.size() < (qint64)(sizeof(DRUMSETFILE_HeaderStruct) + MIDIPARSER_NUMBER_OF_INSTRUMENTS * sizeof(Instrument_t) + sizeof(int)))
+            return;
+        auto drm = QByteArray::fromRawData(file.data(), (int)file.size());
+        auto data = drm.constData();
         auto hdr = (DRUMSETFILE_HeaderStruct*)data; hdr;
         auto inst = (Instrument_t*)(data + sizeof(DRUMSETFILE_HeaderStruct));
         for (int i = 0; i < MIDIPARSER_NUMBER_OF_INSTRUMENTS; ++i)
@@ -1382,6 +1408,8 @@ MainWindow::~MainWindow(){
    if (mp_CheatShitDialog) {
       delete mp_CheatShitDialog;
    }
+   // Before the player it shows
+   delete mp_PlayerStatsDialog;
    //selection model deleted by model
    //delete mp_SelectionModel;
 }
@@ -2679,12 +2707,37 @@ void MainWindow::slotOrderChanged()
 void MainWindow::slotShowOptionsDialog()
 {
    OptionsDialog options(mp_PlaybackPanel->bufferTime_ms(), this);
+   options.setAdaptiveBuffering(Settings::getAdaptiveBuffering(), Settings::getBufferingMinTime_ms(), Settings::getBufferingMaxTime_ms());
+   options.setRealTimeAudio(Settings::getRealTimeAudio());
    int ret = options.exec();
    if(ret == QDialog::Accepted){
       mp_PlaybackPanel->slotSetBufferTime_ms(options.bufferingTime_ms());
       // Save the setting by using the value actually stored in player
       Settings::setBufferingTime_ms(mp_PlaybackPanel->bufferTime_ms());
+
+      mp_PlaybackPanel->slotSetAdaptiveBuffering(options.adaptiveBuffering(), options.bufferingMinTime_ms(), options.bufferingMaxTime_ms());
+      Settings::setAdaptiveBuffering(options.adaptiveBuffering());
+      Settings::setBufferingMinTime_ms(options.bufferingMinTime_ms());
+      Settings::setBufferingMaxTime_ms(options.bufferingMaxTime_ms());
+
+      mp_PlaybackPanel->slotSetRealTimeAudio(options.realTimeAudio());
+      Settings::setRealTimeAudio(options.realTimeAudio());
+   }
+}
+
+void MainWindow::slotShowPlayerStats()
+{
+   if (!mp_PlayerStatsDialog) {
+      mp_PlayerStatsDialog = new PlayerStatsDialog(mp_PlaybackPanel->mp_Player, this);
    }
+   mp_PlayerStatsDialog->show();
+   mp_PlayerStatsDialog->raise();
+}
+
+void MainWindow::slotSetSetlistMode(bool enabled)
+{
+   Settings::setSetlistMode(enabled);
+   mp_PlaybackPanel->slotSetSetlistMode(enabled);
 }
 
 void MainWindow::slotChangeWorkspaceLocation()
@@ -77,6 +77,8 @@ private slots:
     void slotOnDrmClosed();
 
     void slotShowOptionsDialog();
+    void slotShowPlayerStats();
+    void slotSetSetlistMode(bool enabled);
     void slotChangeWorkspaceLocation();
     void slotShowAboutDialog();
     void slotOpenUrlManual();
@@ -171,6 +173,7 @@ public:
     QAction* mp_importDrm;
     QAction* mp_syncPrj;
     QAction* mp_exportPrj;
+    QAction* mp_renderAllSongs;
 
     QAction* mp_prev;
     QAction* mp_next;
@@ -188,6 +191,8 @@ public:
     QAction* mp_ColorOptions;
     QAction* mp_ListUsb;
     QAction* mp_ShowOptionsDialog;
+    QAction* mp_ShowPlayerStats;
+    QAction* mp_SetlistMode;
     QAction* mp_ChangeWorkspaceLocation;
 
     QMenu* mp_helpMenu;
@@ -234,6 +239,7 @@ public:
     Workspace* mp_MasterWorkspace;
 
     QDialog* mp_CheatShitDialog;
+    QDialog* mp_PlayerStatsDialog;
     bool m_done;
 
 private:
@@ -23,8 +23,19 @@
 #include <QDebug>
 #include <QMessageBox>
 #include <QMenu>
+#include <QFileDialog>
+#include <QInputDialog>
+#include <QFileInfo>
+#include <QDir>
+#include <QApplication>
+#include <QProgressDialog>
+#include <QEventLoop>
+#include <QRegularExpression>
 
 #include "playbackpanel.h"
+#include "player/offlineRenderer.h"
+#include "player/batchRenderer.h"
+#include "workspace/settings.h"
 
 #include "model/tree/abstracttreeitem.h"
 #include "model/tree/project/beatsprojectmodel.h"
@@ -34,6 +45,7 @@
 PlaybackPanel::PlaybackPanel(QWidget *parent)
     : QWidget(parent)
     , m_editorMode(false)
+    , m_setlistMode(Settings::getSetlistMode())
 {
     QVBoxLayout *p_VBoxLayout = new QVBoxLayout(this);
     mp_Title = new QLabel(this);
@@ -53,6 +65,8 @@ PlaybackPanel::PlaybackPanel(QWidget *parent)
     QHBoxLayout *p_LayoutDrumset = new QHBoxLayout(p_MainContainer);
     QLabel *p_LabelDrumset = new QLabel(p_MainContainer);
     mp_ComboBoxDrumset = new QComboBox(p_MainContainer);
+    mp_DrumsetProgress = new QProgressBar(p_MainContainer);
+    mp_DrumsetPreloader = new DrumsetPreloader(this);
 
     QHBoxLayout *p_LayoutPlayer = new QHBoxLayout(p_MainContainer);
     QLabel *p_LabelPlayer = new QLabel(p_MainContainer);
@@ -72,8 +86,18 @@ PlaybackPanel::PlaybackPanel(QWidget *parent)
     mp_ComboBoxDrumset->setToolTip(tr("Select a drumset from project"));
     mp_ComboBoxDrumset->setSizeAdjustPolicy(QComboBox::AdjustToContents);
     connect(mp_ComboBoxDrumset, SIGNAL(currentIndexChanged(QString)), this, SLOT(onDrumsetChanged(QString)));
+    // preloader signals are emited in a different thread
+    connect(mp_DrumsetPreloader, SIGNAL(sigProgress(int)), this, SLOT(slotDrumsetPreloadProgress(int)), Qt::QueuedConnection);
+    connect(mp_DrumsetPreloader, SIGNAL(sigFinished(QString,bool)), this, SLOT(slotDrumsetPreloadFinished(QString,bool)), Qt::QueuedConnection);
     p_LayoutDrumset->addWidget(mp_ComboBoxDrumset);
 
+    mp_DrumsetProgress->setRange(0, 100);
+    mp_DrumsetProgress->setTextVisible(false);
+    mp_DrumsetProgress->setFixedWidth(40);
+    mp_DrumsetProgress->setToolTip(tr("Loading the drumset"));
+    mp_DrumsetProgress->setVisible(false);
+    p_LayoutDrumset->addWidget(mp_DrumsetProgress);
+
     p_LabelPlayer->setText(tr("Player:"));
     p_LayoutPlayer->addWidget(p_LabelPlayer);
 
@@ -116,6 +140,8 @@ PlaybackPanel::PlaybackPanel(QWidget *parent)
     connect(mp_Player, SIGNAL(sigPlayerStarted()), this, SLOT(playerStarted()), Qt::QueuedConnection);
     connect(mp_Player, SIGNAL(sigPlayerStopped()), this, SLOT(playerStopped()), Qt::QueuedConnection);
     connect(mp_Player, SIGNAL(sigPlayerError(QString)), this, SLOT(slotPlayerError(QString)), Qt::QueuedConnection);
+    connect(mp_Player, SIGNAL(sigSongSwitched(QString)), this, SLOT(slotSongSwitched(QString)), Qt::QueuedConnection);
+    connect(mp_Player, SIGNAL(sigNextSongFailed(QString)), this, SLOT(slotNextSongFailed(QString)), Qt::QueuedConnection);
 
     connect(mp_Player, SIGNAL(sigPlayingIntro()), this, SLOT(playingIntro()), Qt::QueuedConnection);
     connect(mp_Player, SIGNAL(sigPlayingMainTrack(unsigned int)), this, SLOT(playingMainTrack(unsigned int)), Qt::QueuedConnection);
@@ -487,14 +513,21 @@ void PlaybackPanel::play(void)
         return mp_Player->play();
     }
 
+    /* In setlist mode, the song selected while playing is the next one */
+    bool nextSong = mp_Player->isRunning();
+    if (nextSong && (!m_setlistMode || !m_NextSongIndex.isValid() || m_NextSongIndex == m_SongIndex || m_SwitchingSongIndex.isValid())) {
+        return;
+    }
+    QPersistentModelIndex songIndex = nextSong ? m_NextSongIndex : m_SongIndex;
+
     /* Verify the selection */
-    if (!m_SongIndex.isValid()) {
+    if (!songIndex.isValid()) {
         QMessageBox::warning(this, tr("Playback"), tr("No song selected"));
         return;
     }
 
     /* Verify the validity */
-    QModelIndex validityIndex = m_SongIndex.sibling(m_SongIndex.row(), AbstractTreeItem::INVALID);
+    QModelIndex validityIndex = songIndex.sibling(songIndex.row(), AbstractTreeItem::INVALID);
     auto invalid = validityIndex.data(Qt::DisplayRole).toString();
     if (validityIndex.isValid() && !invalid.isEmpty()) {
         MainWindow* w = nullptr;
@@ -504,20 +537,29 @@ void PlaybackPanel::play(void)
             "\tAdd missing song parts\n"
             "\tUse %2 > %3 to make sure it was not deleted by mistake\n"
             "\tRemove song part without a Main Drum Loop\n\tRemove the invalid song altogether")
-                .arg(m_SongIndex.data(Qt::DisplayRole).toString())
+                .arg(songIndex.data(Qt::DisplayRole).toString())
                 .arg(w->mp_edit->title().replace("&", "")).arg(w->mp_Undo->text().replace("&", "")));
         return;
     }
 
     /* Save the current song */
-    QModelIndex saveIndex = m_SongIndex.sibling(m_SongIndex.row(), AbstractTreeItem::SAVE);
+    QModelIndex saveIndex = songIndex.sibling(songIndex.row(), AbstractTreeItem::SAVE);
 
     if (saveIndex.isValid() && saveIndex.data(Qt::DisplayRole).toBool()) {
         if (QMessageBox::Cancel == QMessageBox::question(this, tr("Playback"), tr("There are unsaved modifications in the current song.\n\nDo you want to save it now?"), QMessageBox::Save | QMessageBox::Cancel, QMessageBox::Save)) {
             return;
         }
         // saving the song
-        mp_beatsModel->setData(mp_beatsModel->index(m_SongIndex.row(), AbstractTreeItem::SAVE, m_SongIndex.parent()), QVariant(false));
+        mp_beatsModel->setData(mp_beatsModel->index(songIndex.row(), AbstractTreeItem::SAVE, songIndex.parent()), QVariant(false));
+    }
+
+    /* Switch to the next song on the next bar, once prepared */
+    if (nextSong) {
+        if (mp_Player->playNextSong()) {
+            m_SwitchingSongIndex = songIndex;
+        }
+        mp_ButtonPlay->setEnabled(false);
+        return;
     }
 
     /* Start the playback */
@@ -532,6 +574,166 @@ void PlaybackPanel::slotSelectTrack(const QByteArray &trackData, int trackIndex,
    mp_Player->play();
 }
 
+/**
+ * @brief PlaybackPanel::renderDrumsetPath
+ *        Drumset used to render a song: its default drumset, or the selected one
+ * @return empty if none is available
+ */
+QString PlaybackPanel::renderDrumsetPath(const QModelIndex &songIndex)
+{
+    // CSV: "FILE_NAME, NAME", same lookup as onBeatsCurOrSelChange
+    QString drmName = mp_ComboBoxDrumset->currentText();
+    QStringList drmData = songIndex.sibling(songIndex.row(), AbstractTreeItem::DEFAULT_DRM).data().toString().split(",");
+    if (drmData.count() == 2 && m_hashDrumset.contains(drmData.at(1))) {
+        drmName = drmData.at(1);
+    }
+    return m_hashDrumset.value(drmName);
+}
+
+/**
+ * @brief PlaybackPanel::slotRenderSong
+ *        Render a song offline in a WAV file, with its default drumset (or the selected one)
+ *        and the pedal script of OfflineRenderer::defaultScript
+ */
+void PlaybackPanel::slotRenderSong(const QModelIndex &songIndex)
+{
+    if (!mp_beatsModel || !songIndex.isValid()) {
+        return;
+    }
+
+    QString songName = songIndex.sibling(songIndex.row(), AbstractTreeItem::NAME).data().toString();
+    QString songPath = songIndex.sibling(songIndex.row(), AbstractTreeItem::ABSOLUTE_PATH).data().toString();
+
+    QString drmPath = renderDrumsetPath(songIndex);
+    if (drmPath.isEmpty()) {
+        QMessageBox::warning(this, tr("Render to WAV"), tr("No drumset available to render \"%1\"").arg(songName));
+        return;
+    }
+
+    // The bit depth is picked with the file type, the last one picked is offered first
+    QString filter16 = tr("16-bit WAV files (*.wav)");
+    QString filter24 = tr("24-bit WAV files (*.wav)");
+    QString selectedFilter = (Settings::getRenderBitsPerSample() == 24) ? filter24 : filter16;
+    QString wavPath = QFileDialog::getSaveFileName(
+             this,
+             tr("Render to WAV"),
+             QFileInfo(songPath).dir().absoluteFilePath(songName + ".wav"),
+             filter16 + ";;" + filter24,
+             &selectedFilter);
+    if (wavPath.isEmpty()) {
+        return;
+    }
+    int bitsPerSample = (selectedFilter == filter24) ? 24 : 16;
+    Settings::setRenderBitsPerSample(bitsPerSample);
+
+    QModelIndex efxIndex = mp_beatsModel->effectFolderIndex();
+
+    OfflineRenderer renderer;
+    renderer.setDrumset(drmPath);
+    renderer.setSong(songPath);
+    renderer.setEffectsPath(efxIndex.sibling(efxIndex.row(), AbstractTreeItem::ABSOLUTE_PATH).data().toString());
+    renderer.setTempo(songIndex.sibling(songIndex.row(), AbstractTreeItem::TEMPO).data().toInt());
+    renderer.setBitsPerSample(bitsPerSample);
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    bool success = renderer.render(wavPath);
+    QApplication::restoreOverrideCursor();
+
+    if (!success) {
+        QMessageBox::critical(this, tr("Render to WAV"), renderer.errorString());
+    }
+}
+
+/**
+ * @brief PlaybackPanel::slotRenderAllSongs
+ *        Render every song of the project in a folder, one WAV per song named after its position,
+ *        plus summary.csv with the duration and peak level of each song.
+ *        The songs are rendered in parallel, the player can keep playing meanwhile.
+ */
+void PlaybackPanel::slotRenderAllSongs()
+{
+    if (!mp_beatsModel) {
+        return;
+    }
+
+    QString outputDir = QFileDialog::getExistingDirectory(this, tr("Render All Songs to WAV"));
+    if (outputDir.isEmpty()) {
+        return;
+    }
+
+    // No file type to pick in a folder dialog, the bit depth is asked apart
+    QStringList depths;
+    depths << tr("16-bit") << tr("24-bit");
+    bool ok = false;
+    QString depth = QInputDialog::getItem(this, tr("Render All Songs to WAV"), tr("Bit depth of the WAV files:"),
+                                          depths, (Settings::getRenderBitsPerSample() == 24) ? 1 : 0, false, &ok);
+    if (!ok) {
+        return;
+    }
+    int bitsPerSample = (depth == depths.at(1)) ? 24 : 16;
+    Settings::setRenderBitsPerSample(bitsPerSample);
+
+    QDir dir(outputDir);
+    QRegularExpression invalidChars(QStringLiteral("[\\\\/:*?\"<>|]"));
+
+    QList<BatchRenderer::Job> jobs;
+    QModelIndex songsFolderIndex = mp_beatsModel->songsFolderIndex();
+    for (int folderRow = 0; folderRow < mp_beatsModel->rowCount(songsFolderIndex); folderRow++) {
+        QModelIndex folderIndex = mp_beatsModel->index(folderRow, 0, songsFolderIndex);
+        QString folderName = folderIndex.sibling(folderRow, AbstractTreeItem::NAME).data().toString();
+
+        for (int songRow = 0; songRow < mp_beatsModel->rowCount(folderIndex); songRow++) {
+            QModelIndex songIndex = mp_beatsModel->index(songRow, 0, folderIndex);
+            BatchRenderer::Job job;
+
+            job.folder = folderName;
+            job.name = songIndex.sibling(songRow, AbstractTreeItem::NAME).data().toString();
+            job.songPath = songIndex.sibling(songRow, AbstractTreeItem::ABSOLUTE_PATH).data().toString();
+            job.drumsetPath = renderDrumsetPath(songIndex);
+            job.tempo = songIndex.sibling(songRow, AbstractTreeItem::TEMPO).data().toInt();
+            job.wavPath = dir.absoluteFilePath(QString("%1-%2 %3.wav")
+                                               .arg(folderRow + 1, 3, 10, QChar('0'))
+                                               .arg(songRow + 1, 3, 10, QChar('0'))
+                                               .arg(QString(job.name).replace(invalidChars, "_")));
+            if (job.drumsetPath.isEmpty()) {
+                QMessageBox::warning(this, tr("Render All Songs to WAV"), tr("No drumset available to render \"%1\"").arg(job.name));
+                return;
+            }
+            jobs.append(job);
+        }
+    }
+
+    QModelIndex efxIndex = mp_beatsModel->effectFolderIndex();
+
+    BatchRenderer batch;
+    batch.setEffectsPath(efxIndex.sibling(efxIndex.row(), AbstractTreeItem::ABSOLUTE_PATH).data().toString());
+    batch.setBitsPerSample(bitsPerSample);
+    if (!batch.start(jobs)) {
+        return;
+    }
+
+    QProgressDialog progress(tr("Rendering Songs..."), tr("Abort"), 0, jobs.size(), this);
+    progress.setWindowModality(Qt::WindowModal);
+    progress.setMinimumDuration(0);
+    progress.setValue(0);
+
+    QEventLoop loop;
+    connect(&batch, &BatchRenderer::sigProgress, &progress, &QProgressDialog::setValue);
+    connect(&batch, &BatchRenderer::sigFinished, &loop, &QEventLoop::quit);
+    connect(&progress, &QProgressDialog::canceled, &batch, &BatchRenderer::cancel);
+    if (batch.isRunning()) {
+        loop.exec();
+    }
+    progress.setValue(jobs.size());
+
+    QString summaryPath = dir.absoluteFilePath("summary.csv");
+    if (!batch.writeSummary(summaryPath)) {
+        QMessageBox::critical(this, tr("Render All Songs to WAV"), tr("Unable to write %1").arg(summaryPath));
+    } else if (batch.failedCount() > 0) {
+        QMessageBox::warning(this, tr("Render All Songs to WAV"), tr("%1 song(s) could not be rendered, see %2").arg(batch.failedCount()).arg(summaryPath));
+    }
+}
+
 void PlaybackPanel::slotOnStartEditing(const QString& name, const QByteArray& data)
 {
     name; // currently unused
@@ -590,6 +792,7 @@ void PlaybackPanel::playerStopped(void)
     }
 
     m_drmToRemove.clear();
+    m_SwitchingSongIndex = QPersistentModelIndex();
 
     // apply memorized song
     bool songChanged = false;
@@ -622,6 +825,44 @@ void PlaybackPanel::slotPlayerError(QString errorMessage)
    QMessageBox::critical(this, tr("Playback"), errorMessage);
 }
 
+/**
+ * @brief PlaybackPanel::slotSongSwitched
+ *        The player went on with the next song of the setlist without stopping
+ */
+void PlaybackPanel::slotSongSwitched(const QString &songPath)
+{
+    Q_UNUSED(songPath)
+
+    // deselect the parts of the previous song
+    setPlayingPart(STOPPED);
+
+    m_SongIndex = m_SwitchingSongIndex;
+    m_SwitchingSongIndex = QPersistentModelIndex();
+    m_LastPlayingPart = STOPPED;
+    if (!m_SongIndex.isValid()) {
+        return;
+    }
+
+    if(m_enabled){
+        int tempo = mp_beatsModel->index(m_SongIndex.row(), AbstractTreeItem::TEMPO, m_SongIndex.parent()).data().toInt();
+        mp_Title->setText(tr("Playback - %1").arg(mp_beatsModel->index(m_SongIndex.row(), AbstractTreeItem::NAME, m_SongIndex.parent()).data().toString()));
+        mp_LabelTempo->setText(tr("%1 BPM").arg(tempo));
+        mp_SliderTempo->setValue(tempo);
+    }
+
+    // Another song may have been selected in the meantime
+    prepareNextSong();
+}
+
+void PlaybackPanel::slotNextSongFailed(const QString &songPath)
+{
+    m_SwitchingSongIndex = QPersistentModelIndex();
+    if (mp_Player->isRunning()) {
+        mp_ButtonPlay->setEnabled(false);
+    }
+    QMessageBox::warning(this, tr("Playback"), tr("Unable to load the next song\n%1").arg(songPath));
+}
+
 void PlaybackPanel::addDrumset(const QString &name, const QString &path)
 {
     if(m_drmToRemove.contains(name)){
@@ -639,6 +880,9 @@ void PlaybackPanel::addDrumset(const QString &name, const QString &path)
 
 void PlaybackPanel::removeDrumset(const QString &name)
 {
+    // Not kept mapped, the file is deleted or replaced
+    EngineCache::instance()->remove(m_hashDrumset.value(name));
+
     if (mp_Player->isRunning()) {
         // While player is playing, memorize the drumsets to remove
         m_drmToRemove.insert(name);
@@ -660,6 +904,8 @@ void PlaybackPanel::removeDrumset(const QString &name)
 
 void PlaybackPanel::clearDrumsets(void)
 {
+    mp_DrumsetPreloader->cancel();
+    mp_DrumsetProgress->setVisible(false);
     m_hashDrumset.clear();
     mp_ComboBoxDrumset->clear();
     disable();
@@ -670,10 +916,26 @@ void PlaybackPanel::onDrumsetChanged(const QString &name)
     if (m_hashDrumset.contains(name)) {
         auto x = m_hashDrumset[name];
         mp_Player->setDrumset(x);
+        // Ready in the cache before play is pressed
+        mp_DrumsetPreloader->preload(x, Settings::getDrumsetPrefault());
         emit drumsetChanged(x);
     }
 }
 
+void PlaybackPanel::slotDrumsetPreloadProgress(int percent)
+{
+    mp_DrumsetProgress->setValue(percent);
+    mp_DrumsetProgress->setVisible(percent < 100);
+}
+
+void PlaybackPanel::slotDrumsetPreloadFinished(const QString &filepath, bool success)
+{
+    mp_DrumsetProgress->setVisible(false);
+    if (!success) {
+        qWarning() << "PlaybackPanel::slotDrumsetPreloadFinished - unable to load" << filepath;
+    }
+}
+
 void PlaybackPanel::setSong(const QModelIndex &modelIndex)
 {
     if (mp_beatsModel) {
@@ -684,10 +946,35 @@ void PlaybackPanel::setSong(const QModelIndex &modelIndex)
             if(m_enabled){
                 mp_Title->setText(tr("Playback - %1").arg(mp_beatsModel->index(m_SongIndex.row(), AbstractTreeItem::NAME, m_SongIndex.parent()).data().toString()));
             }
+        } else if (m_setlistMode) {
+            prepareNextSong();
         }
     }
 }
 
+/**
+ * @brief PlaybackPanel::prepareNextSong
+ *        While playing in setlist mode, load the selected song in the background and let
+ *        Play switch to it
+ */
+void PlaybackPanel::prepareNextSong(void)
+{
+    if (!mp_Player->isRunning() || m_SwitchingSongIndex.isValid()) {
+        return;
+    }
+
+    QString drumsetName = mp_ComboBoxDrumset->currentText();
+    if (m_setlistMode && m_enabled && !m_editorMode && m_NextSongIndex.isValid() && m_NextSongIndex != m_SongIndex && m_hashDrumset.contains(drumsetName)) {
+        mp_Player->prepareNextSong(mp_beatsModel->index(m_NextSongIndex.row(), AbstractTreeItem::ABSOLUTE_PATH, m_NextSongIndex.parent()).data().toString(),
+                                   m_hashDrumset[drumsetName],
+                                   mp_beatsModel->index(m_NextSongIndex.row(), AbstractTreeItem::TEMPO, m_NextSongIndex.parent()).data().toInt());
+        mp_ButtonPlay->setEnabled(true);
+    } else {
+        mp_Player->cancelNextSong();
+        mp_ButtonPlay->setEnabled(false);
+    }
+}
+
 void PlaybackPanel::setEffectsPath(const QString &path)
 {
     mp_Player->setEffectsPath(path);
@@ -703,7 +990,8 @@ void PlaybackPanel::slotPedalPress(void)
 
 void PlaybackPanel::slotPedalRelease(void)
 {
-   if (mp_ButtonPlay->isEnabled()){
+   // While playing, the pedal is for the song even if Play can switch to the next one
+   if (mp_ButtonPlay->isEnabled() && !mp_Player->isRunning()){
       play();
    }else{
       mp_Player->pedalRelease();
@@ -829,6 +1117,23 @@ void PlaybackPanel::slotSetBufferTime_ms(int time_ms){
    }
    mp_Player->slotSetBufferTime_ms(time_ms);
 }
+void PlaybackPanel::slotSetAdaptiveBuffering(bool enabled, int minTime_ms, int maxTime_ms){
+   // NOTE: validation is performed in player
+   if(!mp_Player){
+      return;
+   }
+   mp_Player->slotSetAdaptiveBuffering(enabled, minTime_ms, maxTime_ms);
+}
+void PlaybackPanel::slotSetRealTimeAudio(bool enabled){
+   if(!mp_Player){
+      return;
+   }
+   mp_Player->slotSetRealTimeAudio(enabled);
+}
+void PlaybackPanel::slotSetSetlistMode(bool enabled){
+   m_setlistMode = enabled;
+   prepareNextSong();
+}
 int PlaybackPanel::bufferTime_ms(){
    // NOTE: validation is performed in player
    if(!mp_Player){
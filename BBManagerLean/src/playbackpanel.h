@@ -10,8 +10,10 @@
 #include <QHash>
 #include <QModelIndex>
 #include <QItemSelectionModel>
+#include <QProgressBar>
 
 #include "player/player.h"
+#include "player/drumsetPreloader.h"
 #include "model/tree/project/beatsprojectmodel.h"
 
 class PlaybackPanel : public QWidget
@@ -41,6 +43,7 @@ public:
 
    QLabel *mp_Title;
    QComboBox *mp_ComboBoxDrumset;
+   QProgressBar *mp_DrumsetProgress;
    QLabel *mp_LabelTempo;
    QSlider *mp_SliderTempo;
    QPushButton *mp_ButtonPlay;
@@ -55,10 +58,14 @@ signals:
 private slots:
    void slotChangeTempo(int tempo);
    void onDrumsetChanged(const QString &name);
+   void slotDrumsetPreloadProgress(int percent);
+   void slotDrumsetPreloadFinished(const QString &filepath, bool success);
 
    void playerStarted(void);
    void playerStopped(void);
    void slotPlayerError(QString errorMessage);
+   void slotSongSwitched(const QString &songPath);
+   void slotNextSongFailed(const QString &songPath);
 
    void playingIntro(void);
    void playingMainTrack(unsigned int PartIndex);
@@ -75,6 +82,8 @@ public slots:
    void play(void);
    void stop(void);
    void slotSelectTrack(const QByteArray &trackData, int trackIndex, int typeId, int partIndex);
+   void slotRenderSong(const QModelIndex &songIndex);
+   void slotRenderAllSongs();
    void slotOnStartEditing(const QString& name, const QByteArray& data);
    void slotOnTrackEditing(const QByteArray& data);
    void slotOnTrackEdited(const QByteArray& data);
@@ -85,16 +94,23 @@ public slots:
    void slotPedalLongPress(void);
    void slotEffect(void);
    void slotSetBufferTime_ms(int time_ms);
+   void slotSetAdaptiveBuffering(bool enabled, int minTime_ms, int maxTime_ms);
+   void slotSetRealTimeAudio(bool enabled);
+   void slotSetSetlistMode(bool enabled);
 
 protected:
    virtual void paintEvent(QPaintEvent * event);
    void setPlayingPart(int part, unsigned int partNumber, unsigned int drumfillNumber);
+   QString renderDrumsetPath(const QModelIndex &songIndex);
+   void prepareNextSong(void);
 
    QSet<QString> m_drmToRemove;
    QHash<QString, QString>  m_hashDrumset;
    QPersistentModelIndex m_SongIndex;
    QPersistentModelIndex m_NextSongIndex;
+   QPersistentModelIndex m_SwitchingSongIndex;  // Setlist, requested and not playing yet
    BeatsProjectModel *mp_beatsModel;
+   DrumsetPreloader *mp_DrumsetPreloader;
 
    int m_LastPlayingPart;
    unsigned int m_LastPlayingPartNumber;
@@ -103,6 +119,7 @@ protected:
 
    bool m_enabled;
    bool m_editorMode;
+   bool m_setlistMode;
 
 };
 
@@ -0,0 +1,303 @@
+/*
+  	This software and the content provided for use with it is Copyright © 2014-2020 Singular Sound
+ 	BeatBuddy Manager is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2 as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDebug>
+
+#include "audioSink.h"
+
+#define AUDIO_SINK_SAMPLE_RATE          (44100)
+
+// The sample formats the mixer can write, listed from the one that keeps most of its resolution
+static const struct {
+    MIXER_outputFormat_t mixerFormat;
+    int sampleSize;
+    QAudioFormat::SampleType sampleType;
+} OutputFormats[] = {
+    { MIXER_OUTPUT_FLOAT, 32, QAudioFormat::Float     },
+    { MIXER_OUTPUT_PCM24, 24, QAudioFormat::SignedInt },
+    { MIXER_OUTPUT_PCM16, 16, QAudioFormat::SignedInt },
+};
+
+/**
+ * @brief AudioSink::create
+ * @param filepath Output file of the File sink
+ * @return New sink, owned by the caller
+ */
+AudioSink *AudioSink::create(Type type, const QString &filepath)
+{
+    switch (type) {
+    case Null:
+        return new NullAudioSink();
+    case File:
+        return new FileAudioSink(filepath);
+    case Device:
+    default:
+        return new DeviceAudioSink();
+    }
+}
+
+AudioSink::AudioSink()
+    : m_outputFormat(MIXER_OUTPUT_PCM16)
+    , m_underrunCount(0)
+{
+    // NOTE: There are defines related to setChannelCount(2) and setSampleRate(44100) in player.h
+    m_format.setSampleRate(AUDIO_SINK_SAMPLE_RATE);
+    m_format.setChannelCount(2);
+    m_format.setCodec("audio/pcm");
+    m_format.setByteOrder(QAudioFormat::LittleEndian);
+    setFormat(MIXER_OUTPUT_PCM16);
+}
+
+AudioSink::~AudioSink()
+{
+}
+
+void AudioSink::setFormat(MIXER_outputFormat_t outputFormat)
+{
+    for (const auto &format : OutputFormats) {
+        if (format.mixerFormat == outputFormat) {
+            m_format.setSampleSize(format.sampleSize);
+            m_format.setSampleType(format.sampleType);
+            m_outputFormat = outputFormat;
+            return;
+        }
+    }
+}
+
+DeviceAudioSink::DeviceAudioSink()
+    : m_device(QAudioDeviceInfo::defaultOutputDevice())
+    , mp_audioOutput(nullptr)
+{
+}
+
+DeviceAudioSink::~DeviceAudioSink()
+{
+    delete mp_audioOutput;
+}
+
+bool DeviceAudioSink::open(int bufferTime_ms)
+{
+    // The sample format is the best one supported by the device, the mixer can write any of them.
+    bool found = false;
+    for (const auto &format : OutputFormats) {
+        setFormat(format.mixerFormat);
+        if (m_device.isFormatSupported(m_format)) {
+            found = true;
+            break;
+        }
+    }
+    if (!found) {
+        // Keep the historical format, the device may still accept it
+        setFormat(MIXER_OUTPUT_PCM16);
+    }
+    qDebug() << "DeviceAudioSink::open - output format" << m_format;
+
+    mp_audioOutput = new QAudioOutput(m_device, m_format, nullptr);
+    mp_audioOutput->setBufferSize(MIXER_BUFFERRING_TIME_MS_TO_SMAPLES(bufferTime_ms) * m_format.bytesPerFrame());
+
+    // Reported by the backends that detect it
+    QObject::connect(mp_audioOutput, &QAudioOutput::stateChanged, [this](QAudio::State state) {
+        if (state == QAudio::IdleState && mp_audioOutput->error() == QAudio::UnderrunError) {
+            m_underrunCount++;
+        }
+    });
+    return true;
+}
+
+void DeviceAudioSink::start(QIODevice *p_source)
+{
+    mp_audioOutput->start(p_source);
+}
+
+void DeviceAudioSink::stop(void)
+{
+    if (mp_audioOutput) {
+        mp_audioOutput->stop();
+    }
+}
+
+int DeviceAudioSink::bufferSize(void) const
+{
+    return mp_audioOutput->bufferSize();
+}
+
+int DeviceAudioSink::periodSize(void) const
+{
+    return mp_audioOutput->periodSize();
+}
+
+int DeviceAudioSink::bytesFree(void) const
+{
+    return mp_audioOutput->bytesFree();
+}
+
+NullAudioSink::NullAudioSink(bool realTime, MIXER_outputFormat_t outputFormat)
+    : m_realTime(realTime)
+    , m_bufferFrames(0)
+    , m_periodFrames(0)
+    , mp_source(nullptr)
+    , m_pulledFrames(0)
+{
+    setFormat(outputFormat);
+    QObject::connect(&m_timer, &QTimer::timeout, [this] { pull(); });
+}
+
+bool NullAudioSink::open(int bufferTime_ms)
+{
+    m_bufferFrames = MIXER_BUFFERRING_TIME_MS_TO_SMAPLES(bufferTime_ms);
+    m_periodFrames = MIXER_BUFFERRING_TIME_MS_TO_SMAPLES(AUDIO_SINK_PERIOD_MS);
+    m_period.resize(m_periodFrames * m_format.bytesPerFrame());
+    return true;
+}
+
+void NullAudioSink::start(QIODevice *p_source)
+{
+    mp_source = p_source;
+    m_pulledFrames = 0;
+    m_clock.start();
+    m_timer.start(m_realTime ? AUDIO_SINK_PERIOD_MS : 0);
+    // Like a device, the buffer is filled as soon as started
+    pull();
+}
+
+void NullAudioSink::stop(void)
+{
+    m_timer.stop();
+    mp_source = nullptr;
+}
+
+int NullAudioSink::bufferSize(void) const
+{
+    return m_bufferFrames * m_format.bytesPerFrame();
+}
+
+int NullAudioSink::periodSize(void) const
+{
+    return m_period.size();
+}
+
+int NullAudioSink::bytesFree(void) const
+{
+    if (!m_realTime) {
+        // Nothing is played, what was pulled is gone
+        return bufferSize();
+    }
+    qint64 played = m_clock.nsecsElapsed() * AUDIO_SINK_SAMPLE_RATE / 1000000000LL;
+    qint64 buffered = qBound((qint64)0, m_pulledFrames - played, (qint64)m_bufferFrames);
+    return (int)(m_bufferFrames - buffered) * m_format.bytesPerFrame();
+}
+
+void NullAudioSink::consume(const char *data, qint64 len)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(len);
+}
+
+/**
+ * @brief NullAudioSink::pull
+ *        Pull from the source by periods, like a device does
+ */
+void NullAudioSink::pull(void)
+{
+    int bytesPerFrame = m_format.bytesPerFrame();
+    qint64 framesToPull = m_periodFrames;
+
+    if (m_realTime) {
+        // Frames played by the simulated clock, the buffer is kept full ahead of them
+        qint64 played = m_clock.nsecsElapsed() * AUDIO_SINK_SAMPLE_RATE / 1000000000LL;
+        if (played > m_pulledFrames) {
+            // The buffer ran out, like on a device the missed time is lost
+            m_underrunCount++;
+            m_pulledFrames = played;
+        }
+        framesToPull = played + m_bufferFrames - m_pulledFrames;
+    }
+
+    while (mp_source && framesToPull >= m_periodFrames) {
+        qint64 len = mp_source->read(m_period.data(), m_period.size());
+        if (len <= 0) {
+            // Player is stopping
+            m_timer.stop();
+            return;
+        }
+        consume(m_period.constData(), len);
+        m_pulledFrames += len / bytesPerFrame;
+        framesToPull -= len / bytesPerFrame;
+    }
+}
+
+FileAudioSink::FileAudioSink(const QString &filepath, bool realTime)
+    : NullAudioSink(realTime, MIXER_OUTPUT_PCM16)
+    , m_file(filepath)
+    , m_dataSize(0)
+{
+}
+
+bool FileAudioSink::open(int bufferTime_ms)
+{
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        m_errorString = QCoreApplication::translate("AudioSink", "Unable to write %1").arg(m_file.fileName());
+        return false;
+    }
+    // Header is written once the length is known
+    m_file.write(QByteArray(AUDIO_SINK_WAV_HEADER_SIZE, '\0'));
+    m_dataSize = 0;
+    return NullAudioSink::open(bufferTime_ms);
+}
+
+void FileAudioSink::stop(void)
+{
+    NullAudioSink::stop();
+    if (m_file.isOpen()) {
+        m_file.seek(0);
+        writeWavHeader(&m_file, m_format.sampleSize(), m_dataSize);
+        m_file.close();
+    }
+}
+
+void FileAudioSink::consume(const char *data, qint64 len)
+{
+    if (m_file.write(data, len) == len) {
+        m_dataSize += (quint32)len;
+    } else {
+        qWarning() << "FileAudioSink::consume - unable to write" << m_file.fileName();
+    }
+}
+
+/**
+ * @brief FileAudioSink::writeWavHeader
+ *        RIFF header of a 44.1 kHz PCM file, written at the current position
+ * @param dataSize Size of the frames following the header, in bytes
+ */
+void FileAudioSink::writeWavHeader(QIODevice *p_device, int bitsPerSample, quint32 dataSize, int channels)
+{
+    quint16 bytesPerFrame = (quint16)(channels * bitsPerSample / 8);
+    QDataStream stream(p_device);
+
+    stream.setByteOrder(QDataStream::LittleEndian);
+    stream.writeRawData("RIFF", 4);
+    stream << (quint32)(AUDIO_SINK_WAV_HEADER_SIZE - 8 + dataSize);
+    stream.writeRawData("WAVEfmt ", 8);
+    stream << (quint32)16;                                          // Size of the fmt chunk
+    stream << (quint16)1;                                           // PCM
+    stream << (quint16)channels;
+    stream << (quint32)AUDIO_SINK_SAMPLE_RATE;
+    stream << (quint32)(AUDIO_SINK_SAMPLE_RATE * bytesPerFrame);    // Bytes per second
+    stream << bytesPerFrame;
+    stream << (quint16)bitsPerSample;
+    stream.writeRawData("data", 4);
+    stream << dataSize;
+}
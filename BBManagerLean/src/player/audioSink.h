@@ -0,0 +1,154 @@
+#ifndef AUDIOSINK_H
+#define AUDIOSINK_H
+
+#include <QAudioDeviceInfo>
+#include <QAudioFormat>
+#include <QAudioOutput>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QIODevice>
+#include <QString>
+#include <QTimer>
+
+#include "mixer.h"
+
+// Units: ms, amount of audio pulled at once by the sinks that have no device
+#define AUDIO_SINK_PERIOD_MS            (10)
+#define AUDIO_SINK_WAV_HEADER_SIZE      (44)
+
+/**
+ * @brief The AudioSink class
+ *
+ * Destination of the frames rendered by Player. Once started, the sink pulls the frames
+ * from the source device until stopped. A sink is created, used and deleted by the audio
+ * thread, it pulls the frames from the event loop of that thread.
+ */
+class AudioSink
+{
+    Q_DISABLE_COPY(AudioSink)
+
+public:
+    enum Type {
+        Device,     // Default output device of the system
+        Null,       // Frames are dropped at the pace of a device
+        File,       // Frames are written in a WAV file as fast as they are rendered
+    };
+
+    static AudioSink *create(Type type, const QString &filepath = QString());
+
+    AudioSink();
+    virtual ~AudioSink();
+
+    virtual bool open(int bufferTime_ms) = 0;
+    virtual void start(QIODevice *p_source) = 0;
+    virtual void stop(void) = 0;
+
+    // Units: bytes
+    virtual int bufferSize(void) const = 0;
+    virtual int periodSize(void) const = 0;
+    // Room left in the buffer, what was not pulled yet of the next buffer time
+    virtual int bytesFree(void) const = 0;
+
+    inline const QAudioFormat &format(void) const { return m_format; }
+    inline MIXER_outputFormat_t outputFormat(void) const { return m_outputFormat; }
+    inline QString errorString(void) const { return m_errorString; }
+
+    // Times the sink ran out of frames since it was opened, as far as it can tell
+    inline int underrunCount(void) const { return m_underrunCount; }
+
+protected:
+    void setFormat(MIXER_outputFormat_t outputFormat);
+
+    QAudioFormat m_format;
+    MIXER_outputFormat_t m_outputFormat;
+    QString m_errorString;
+    int m_underrunCount;
+};
+
+/**
+ * @brief The DeviceAudioSink class
+ *
+ * Plays the frames on the default output device, in the best format it supports.
+ */
+class DeviceAudioSink : public AudioSink
+{
+public:
+    DeviceAudioSink();
+    ~DeviceAudioSink();
+
+    bool open(int bufferTime_ms);
+    void start(QIODevice *p_source);
+    void stop(void);
+
+    int bufferSize(void) const;
+    int periodSize(void) const;
+    int bytesFree(void) const;
+
+private:
+    QAudioDeviceInfo m_device;
+    QAudioOutput *mp_audioOutput;
+};
+
+/**
+ * @brief The NullAudioSink class
+ *
+ * Pulls the frames like a device would and drops them. In real time, the buffer is
+ * refilled every period from a simulated clock, otherwise one period is pulled each time
+ * the event loop is idle. Lets the player run on machines without a sound card.
+ */
+class NullAudioSink : public AudioSink
+{
+public:
+    explicit NullAudioSink(bool realTime = true, MIXER_outputFormat_t outputFormat = MIXER_OUTPUT_FLOAT);
+
+    bool open(int bufferTime_ms);
+    void start(QIODevice *p_source);
+    void stop(void);
+
+    int bufferSize(void) const;
+    int periodSize(void) const;
+    int bytesFree(void) const;
+
+    inline qint64 pulledFrames(void) const { return m_pulledFrames; }
+
+protected:
+    virtual void consume(const char *data, qint64 len);
+
+private:
+    void pull(void);
+
+    bool m_realTime;
+    int m_bufferFrames;
+    int m_periodFrames;
+    QByteArray m_period;
+    QIODevice *mp_source;
+    QTimer m_timer;
+    QElapsedTimer m_clock;
+    qint64 m_pulledFrames;
+};
+
+/**
+ * @brief The FileAudioSink class
+ *
+ * Writes the frames in a 16 bits stereo WAV file, as fast as the player renders them.
+ */
+class FileAudioSink : public NullAudioSink
+{
+public:
+    explicit FileAudioSink(const QString &filepath, bool realTime = false);
+
+    bool open(int bufferTime_ms);
+    void stop(void);
+
+    static void writeWavHeader(QIODevice *p_device, int bitsPerSample, quint32 dataSize, int channels = 2);
+
+protected:
+    void consume(const char *data, qint64 len);
+
+private:
+    QFile m_file;
+    quint32 m_dataSize;
+};
+
+#endif // AUDIOSINK_H
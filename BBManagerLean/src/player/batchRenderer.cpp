@@ -0,0 +1,196 @@
+/*
+  	This software and the content provided for use with it is Copyright © 2014-2020 Singular Sound
+ 	BeatBuddy Manager is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2 as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include <QElapsedTimer>
+#include <QFile>
+#include <QRunnable>
+#include <QScopedPointer>
+#include <QTextStream>
+#include <QDebug>
+#include <QtCore/qmath.h>
+
+#include "batchRenderer.h"
+#include "offlineRenderer.h"
+#include "player.h"
+
+class BatchRenderer::Task : public QRunnable
+{
+public:
+    Task(BatchRenderer *p_batch, int index) : mp_batch(p_batch), m_index(index) {}
+    void run() { mp_batch->renderJob(m_index); }
+
+private:
+    BatchRenderer *mp_batch;
+    int m_index;
+};
+
+BatchRenderer::BatchRenderer(QObject *parent)
+    : QObject(parent)
+    , m_bitsPerSample(16)
+{
+}
+
+BatchRenderer::~BatchRenderer()
+{
+    cancel();
+    m_pool.waitForDone();
+}
+
+void BatchRenderer::setEffectsPath(const QString &path)
+{
+    m_effectsPath = path;
+}
+
+void BatchRenderer::setBitsPerSample(int bits)
+{
+    m_bitsPerSample = bits;
+}
+
+/**
+ * @brief BatchRenderer::setMaxThreadCount
+ * @param count Number of songs rendered at the same time, QThread::idealThreadCount() by default
+ */
+void BatchRenderer::setMaxThreadCount(int count)
+{
+    m_pool.setMaxThreadCount(count);
+}
+
+/**
+ * @brief BatchRenderer::start
+ *        Queue all the jobs and return immediately. sigFinished is emitted once every job is done.
+ * @return false if a batch is already running or there is nothing to render
+ */
+bool BatchRenderer::start(const QList<Job> &jobs)
+{
+    if (isRunning() || jobs.isEmpty()) {
+        return false;
+    }
+
+    m_jobs = jobs;
+    m_results.fill(Result{ false, false, 0, 0.0f, 0, QString() }, jobs.size());
+    m_doneCount.storeRelease(0);
+    m_canceled.storeRelease(0);
+
+    qDebug() << "BatchRenderer::start -" << jobs.size() << "songs on" << m_pool.maxThreadCount() << "threads";
+
+    // Longest first would balance better, but the order of the project is easier to follow
+    for (int i = 0; i < m_jobs.size(); i++) {
+        m_pool.start(new Task(this, i));
+    }
+    return true;
+}
+
+/**
+ * @brief BatchRenderer::cancel
+ *        Songs already being rendered are finished, the others are skipped
+ */
+void BatchRenderer::cancel(void)
+{
+    m_canceled.storeRelease(1);
+}
+
+bool BatchRenderer::isRunning(void) const
+{
+    return m_pool.activeThreadCount() > 0 || m_doneCount.loadAcquire() < m_jobs.size();
+}
+
+int BatchRenderer::failedCount(void) const
+{
+    int count = 0;
+    for (const Result &result : m_results) {
+        if (result.done && !result.success) {
+            count++;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief BatchRenderer::renderJob
+ *        Called by the workers. The OfflineRenderer owns the engine instance used by this worker for the song.
+ */
+void BatchRenderer::renderJob(int index)
+{
+    const Job &job = m_jobs.at(index);
+    Result &result = m_results[index];
+
+    if (!m_canceled.loadAcquire()) {
+        QScopedPointer<OfflineRenderer> p_renderer(new OfflineRenderer());
+        QElapsedTimer timer;
+
+        p_renderer->setDrumset(job.drumsetPath);
+        p_renderer->setSong(job.songPath);
+        p_renderer->setEffectsPath(m_effectsPath);
+        p_renderer->setTempo(job.tempo);
+        p_renderer->setBitsPerSample(m_bitsPerSample);
+
+        timer.start();
+        result.success = p_renderer->render(job.wavPath);
+        result.renderTime_ms = timer.elapsed();
+        result.frames = p_renderer->renderedFrames();
+        result.peak = p_renderer->peak();
+        result.errorString = p_renderer->errorString();
+        result.done = true;
+    }
+
+    int done = m_doneCount.fetchAndAddOrdered(1) + 1;
+    emit sigProgress(done, m_jobs.size());
+    if (done == m_jobs.size()) {
+        emit sigFinished(m_canceled.loadAcquire() != 0);
+    }
+}
+
+/**
+ * @brief BatchRenderer::writeSummary
+ *        Write one line per song with its duration and peak level, to be opened with a spreadsheet
+ */
+bool BatchRenderer::writeSummary(const QString &csvPath) const
+{
+    QFile file(csvPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        return false;
+    }
+
+    QTextStream stream(&file);
+    stream << "Folder,Song,File,Duration (s),Peak (dBFS),Render time (ms),Status\n";
+
+    for (int i = 0; i < m_jobs.size(); i++) {
+        const Job &job = m_jobs.at(i);
+        const Result &result = m_results.at(i);
+        QString status;
+
+        if (!result.done) {
+            status = tr("Canceled");
+        } else if (!result.success) {
+            status = result.errorString;
+        } else {
+            status = tr("OK");
+        }
+
+        stream << "\"" << QString(job.folder).replace("\"", "\"\"") << "\","
+               << "\"" << QString(job.name).replace("\"", "\"\"") << "\","
+               << "\"" << QString(job.wavPath).replace("\"", "\"\"") << "\",";
+        if (result.done && result.success) {
+            stream << QString::number(result.frames / SAMPLE_PER_SECOND, 'f', 2) << ","
+                   << ((result.peak > 0.0f) ? QString::number(20.0 * log10(result.peak), 'f', 1) : QStringLiteral("-inf")) << ","
+                   << result.renderTime_ms << ",";
+        } else {
+            stream << ",,,";
+        }
+        stream << "\"" << status.replace("\"", "\"\"") << "\"\n";
+    }
+
+    file.close();
+    return file.error() == QFile::NoError;
+}
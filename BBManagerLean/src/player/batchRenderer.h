@@ -0,0 +1,75 @@
+#ifndef BATCHRENDERER_H
+#define BATCHRENDERER_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QList>
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+
+/**
+ * @brief The BatchRenderer class
+ *
+ * Renders a list of songs in WAV files with OfflineRenderer, spread across a pool of worker threads.
+ * Each worker renders one song at a time with its own instance of the engine.
+ * Progress and completion are signaled from the workers, receivers get them queued.
+ */
+class BatchRenderer : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Job {
+        QString folder;         // Only used for the summary
+        QString name;           // Only used for the summary
+        QString songPath;
+        QString drumsetPath;
+        int tempo;
+        QString wavPath;
+    };
+
+    struct Result {
+        bool done;              // False when canceled before the song was rendered
+        bool success;
+        qint64 frames;
+        float peak;             // Full scale is 1.0
+        qint64 renderTime_ms;
+        QString errorString;
+    };
+
+    explicit BatchRenderer(QObject *parent = nullptr);
+    ~BatchRenderer();
+
+    void setEffectsPath(const QString &path);
+    void setBitsPerSample(int bits);
+    void setMaxThreadCount(int count);
+
+    bool start(const QList<Job> &jobs);
+    void cancel(void);
+    bool isRunning(void) const;
+
+    inline const QList<Job> &jobs() const { return m_jobs; }
+    inline const QVector<Result> &results() const { return m_results; }
+    int failedCount(void) const;
+    bool writeSummary(const QString &csvPath) const;
+
+signals:
+    void sigProgress(int done, int total);
+    void sigFinished(bool canceled);
+
+private:
+    class Task;
+    void renderJob(int index);
+
+    QThreadPool m_pool;
+    QString m_effectsPath;
+    int m_bitsPerSample;
+
+    QList<Job> m_jobs;
+    QVector<Result> m_results;      // One per job, each written by a single worker
+    QAtomicInt m_doneCount;
+    QAtomicInt m_canceled;
+};
+
+#endif // BATCHRENDERER_H
@@ -0,0 +1,116 @@
+/*
+  	This software and the content provided for use with it is Copyright © 2014-2020 Singular Sound
+ 	BeatBuddy Manager is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2 as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include <QElapsedTimer>
+#include <QRunnable>
+#include <QDebug>
+
+#include "drumsetPreloader.h"
+#include "engineCache.h"
+
+class DrumsetPreloader::Task : public QRunnable
+{
+public:
+    Task(DrumsetPreloader *p_preloader, const QString &filepath, bool prefault, int generation)
+        : mp_preloader(p_preloader), m_filepath(filepath), m_prefault(prefault), m_generation(generation) {}
+    void run() { mp_preloader->run(m_filepath, m_prefault, m_generation); }
+
+private:
+    DrumsetPreloader *mp_preloader;
+    QString m_filepath;
+    bool m_prefault;
+    int m_generation;
+};
+
+DrumsetPreloader::DrumsetPreloader(QObject *parent)
+    : QObject(parent)
+{
+    // One at a time, a new preload only starts once the previous one noticed it is outdated
+    m_pool.setMaxThreadCount(1);
+}
+
+DrumsetPreloader::~DrumsetPreloader()
+{
+    cancel();
+}
+
+/**
+ * @brief DrumsetPreloader::preload
+ * @param filepath Drumset to load in EngineCache
+ * @param prefault Also read all the samples in memory
+ */
+void DrumsetPreloader::preload(const QString &filepath, bool prefault)
+{
+    int generation = m_generation.fetchAndAddOrdered(1) + 1;
+    m_pool.start(new Task(this, filepath, prefault, generation));
+}
+
+/**
+ * @brief DrumsetPreloader::cancel
+ *        Stop the preload and wait for the worker, the drumset may still have been added to EngineCache
+ */
+void DrumsetPreloader::cancel(void)
+{
+    m_generation.fetchAndAddOrdered(1);
+    m_pool.waitForDone();
+}
+
+void DrumsetPreloader::run(const QString &filepath, bool prefault, int generation)
+{
+    QElapsedTimer timer;
+    int lastPercent = -1;
+
+    if (m_generation.loadAcquire() != generation) {
+        return;
+    }
+
+    timer.start();
+    emit sigProgress(0);
+
+    // Mapping, validation and instruments table
+    QSharedPointer<const EngineCache::Drumset> p_drumset = EngineCache::instance()->drumset(filepath);
+    if (!p_drumset) {
+        qWarning() << "DrumsetPreloader::run - unable to load" << filepath;
+        emit sigFinished(filepath, false);
+        return;
+    }
+
+    if (prefault) {
+        const volatile char *data = p_drumset->data();
+        qint64 size = p_drumset->size();
+        char sum = 0;
+
+        for (qint64 chunk = 0; chunk < size; chunk += DRUMSET_PRELOAD_CHUNK_BYTES) {
+            if (m_generation.loadAcquire() != generation) {
+                qDebug() << "DrumsetPreloader::run -" << filepath << "preload stopped by a newer one";
+                return;
+            }
+            qint64 end = qMin(size, chunk + DRUMSET_PRELOAD_CHUNK_BYTES);
+            for (qint64 i = chunk; i < end; i += DRUMSET_PRELOAD_PAGE_BYTES) {
+                sum += data[i];
+            }
+
+            int percent = (int)(end * 100 / size);
+            if (percent != lastPercent) {
+                emit sigProgress(percent);
+                lastPercent = percent;
+            }
+        }
+        (void)sum;
+    }
+
+    qDebug() << "DrumsetPreloader::run -" << filepath << "ready in" << timer.elapsed() << "ms";
+    emit sigProgress(100);
+    emit sigFinished(filepath, true);
+}
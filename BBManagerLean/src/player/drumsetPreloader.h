@@ -0,0 +1,44 @@
+#ifndef DRUMSETPRELOADER_H
+#define DRUMSETPRELOADER_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QString>
+#include <QThreadPool>
+
+// Amount of the drumset read between two checks for a newer preload
+#define DRUMSET_PRELOAD_CHUNK_BYTES     (1024 * 1024)
+#define DRUMSET_PRELOAD_PAGE_BYTES      (4096)
+
+/**
+ * @brief The DrumsetPreloader class
+ *
+ * Loads a drumset in EngineCache on a worker thread as soon as it is selected, so that
+ * Player::run finds it ready. Optionally reads every page of the samples, so that the first
+ * notes are not played from the disk.
+ * A new preload stops the previous one, progress and completion are signaled queued.
+ */
+class DrumsetPreloader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DrumsetPreloader(QObject *parent = nullptr);
+    ~DrumsetPreloader();
+
+    void preload(const QString &filepath, bool prefault);
+    void cancel(void);
+
+signals:
+    void sigProgress(int percent);
+    void sigFinished(const QString &filepath, bool success);
+
+private:
+    class Task;
+    void run(const QString &filepath, bool prefault, int generation);
+
+    QThreadPool m_pool;
+    QAtomicInt m_generation;
+};
+
+#endif // DRUMSETPRELOADER_H
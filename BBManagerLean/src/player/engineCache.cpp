@@ -0,0 +1,260 @@
+/*
+  	This software and the content provided for use with it is Copyright © 2014-2020 Singular Sound
+ 	BeatBuddy Manager is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2 as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QDebug>
+
+#include "engineCache.h"
+#include "resampler.h"
+
+EngineCache::Drumset::Drumset()
+    : mp_parsed(nullptr)
+{
+}
+
+EngineCache::Drumset::~Drumset()
+{
+    SoundManager_freeDrumset(mp_parsed);
+}
+
+bool EngineCache::Drumset::load(const QString &filepath)
+{
+    if (!m_file.open(filepath)) {
+        return false;
+    }
+    mp_parsed = SoundManager_parseDrumset(m_file.data(), (uint32_t)m_file.size());
+    if (!mp_parsed) {
+        return false;
+    }
+    resample();
+    return true;
+}
+
+/**
+ * @brief EngineCache::Drumset::resample
+ *        Convert the velocity layers recorded at another rate than the mixer
+ */
+void EngineCache::Drumset::resample(void)
+{
+    for (int note = 0; note < MIDIPARSER_NUMBER_OF_INSTRUMENTS; note++) {
+        unsigned int layerCount = SoundManager_getLayerCount(mp_parsed, (unsigned char)note);
+        for (unsigned int layer = 0; layer < layerCount; layer++) {
+            SoundManager_sample_t sample;
+            SoundManager_getSample(mp_parsed, (unsigned char)note, layer, &sample);
+            if (!Resampler::isNeeded((int)sample.fs)) {
+                continue;
+            }
+
+            // The layer must be inside the file
+            qint64 offset = (const char *)sample.data - m_file.data();
+            qint64 size = (qint64)sample.nSample * (sample.bps / 8);
+            if (offset < 0 || offset + size > m_file.size()) {
+                continue;
+            }
+
+            int channels = (sample.nChannel == 2) ? 2 : 1;
+            QByteArray converted = ResampleCache::instance()->resample((const char *)sample.data, (int)sample.nSample, sample.bps, channels, (int)sample.fs);
+            if (converted.isEmpty()) {
+                qWarning() << "EngineCache::Drumset::resample - unsupported layer" << layer << "of note" << note << "in" << m_file.fileName();
+                continue;
+            }
+            m_resampled.append(converted);
+
+            sample.data = (const unsigned char *)converted.constData();
+            sample.nSample = (unsigned int)(converted.size() / 3);
+            sample.bps = 24;
+            sample.fs = RESAMPLER_OUTPUT_RATE;
+            SoundManager_setSample(mp_parsed, (unsigned char)note, layer, &sample);
+        }
+    }
+    if (!m_resampled.isEmpty()) {
+        qDebug() << "EngineCache::Drumset::resample -" << m_resampled.size() << "layers converted to" << RESAMPLER_OUTPUT_RATE << "Hz in" << m_file.fileName();
+    }
+}
+
+EngineCache::EngineCache()
+    : m_useCount(0)
+    , m_filesSize(0)
+{
+}
+
+EngineCache *EngineCache::instance()
+{
+    static EngineCache cache;
+    return &cache;
+}
+
+bool EngineCache::fileStamp(const QString &filepath, qint64 &size, QDateTime &lastModified)
+{
+    QFileInfo info(filepath);
+    if (!info.exists()) {
+        return false;
+    }
+    size = info.size();
+    lastModified = info.lastModified();
+    return true;
+}
+
+template<typename T> typename QHash<QString, EngineCache::Entry<T> >::iterator EngineCache::leastRecentlyUsed(QHash<QString, Entry<T> > &hash)
+{
+    auto oldest = hash.begin();
+    for (auto it = hash.begin(); it != hash.end(); ++it) {
+        if (it->lastUse < oldest->lastUse) {
+            oldest = it;
+        }
+    }
+    return oldest;
+}
+
+/**
+ * @brief EngineCache::drumset
+ *        Drumset mapped and parsed, ready for SoundManager_setDrumset()
+ * @return null if the file can't be loaded
+ */
+QSharedPointer<const EngineCache::Drumset> EngineCache::drumset(const QString &filepath)
+{
+    QString key = QFileInfo(filepath).absoluteFilePath();
+    qint64 size;
+    QDateTime lastModified;
+
+    if (!fileStamp(key, size, lastModified)) {
+        return QSharedPointer<const Drumset>();
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_drumsets.find(key);
+        if (it != m_drumsets.end() && it->size == size && it->lastModified == lastModified) {
+            it->lastUse = ++m_useCount;
+            return it->value;
+        }
+    }
+
+    // Loaded without the lock, the other threads can use the cache meanwhile
+    QSharedPointer<Drumset> p_drumset(new Drumset());
+    if (!p_drumset->load(key)) {
+        return QSharedPointer<const Drumset>();
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_drumsets.remove(key);
+    while (m_drumsets.size() >= ENGINE_CACHE_MAX_DRUMSETS) {
+        m_drumsets.erase(leastRecentlyUsed(m_drumsets));
+    }
+    m_drumsets.insert(key, Entry<QSharedPointer<const Drumset> >{ size, lastModified, ++m_useCount, p_drumset });
+    return p_drumset;
+}
+
+/**
+ * @brief EngineCache::file
+ *        Content of a song or an effect. The data is shared with the cache, use constData() to read it.
+ * @return false if the file can't be read
+ */
+bool EngineCache::file(const QString &filepath, QByteArray &data)
+{
+    QString key = QFileInfo(filepath).absoluteFilePath();
+    qint64 size;
+    QDateTime lastModified;
+
+    if (!fileStamp(key, size, lastModified)) {
+        return false;
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_files.find(key);
+        if (it != m_files.end() && it->size == size && it->lastModified == lastModified) {
+            it->lastUse = ++m_useCount;
+            data = it->value;
+            return true;
+        }
+    }
+
+    QFile file(key);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    data = file.readAll();
+    file.close();
+
+    if (data.size() > ENGINE_CACHE_MAX_FILE_BYTES) {
+        return true;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    auto it = m_files.find(key);
+    if (it != m_files.end()) {
+        m_filesSize -= it->value.size();
+        m_files.erase(it);
+    }
+    while (!m_files.isEmpty() && m_filesSize + data.size() > ENGINE_CACHE_MAX_FILE_BYTES) {
+        it = leastRecentlyUsed(m_files);
+        m_filesSize -= it->value.size();
+        m_files.erase(it);
+    }
+    m_files.insert(key, Entry<QByteArray>{ size, lastModified, ++m_useCount, data });
+    m_filesSize += data.size();
+    return true;
+}
+
+/**
+ * @brief EngineCache::effect
+ *        Content of an accent hit, converted to the rate of the mixer if needed. The data is
+ *        shared with the caches, use constData() to read it.
+ * @return false if the file can't be read
+ */
+bool EngineCache::effect(const QString &filepath, QByteArray &data)
+{
+    if (!file(filepath, data)) {
+        return false;
+    }
+
+    QByteArray converted;
+    if (ResampleCache::instance()->convertWav(data, converted)) {
+        data = converted;
+    }
+    return true;
+}
+
+/**
+ * @brief EngineCache::remove
+ *        Drop the entries of a file about to be deleted or written over, so that it is not
+ *        kept mapped. A player still using it releases it when it stops.
+ */
+void EngineCache::remove(const QString &filepath)
+{
+    QString key = QFileInfo(filepath).absoluteFilePath();
+
+    QMutexLocker locker(&m_mutex);
+    m_drumsets.remove(key);
+    auto it = m_files.find(key);
+    if (it != m_files.end()) {
+        m_filesSize -= it->value.size();
+        m_files.erase(it);
+    }
+}
+
+/**
+ * @brief EngineCache::clear
+ *        Drop every entry. The drumsets still used by a player are released when it stops.
+ */
+void EngineCache::clear(void)
+{
+    QMutexLocker locker(&m_mutex);
+    m_drumsets.clear();
+    m_files.clear();
+    m_filesSize = 0;
+}
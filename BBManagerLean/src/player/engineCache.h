@@ -0,0 +1,84 @@
+#ifndef ENGINECACHE_H
+#define ENGINECACHE_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+#include "mappedFile.h"
+#include "soundManager.h"
+
+// Number of drumsets kept mapped and parsed
+#define ENGINE_CACHE_MAX_DRUMSETS       (4)
+// Total size of the songs and effects kept in memory, bigger files are never kept
+#define ENGINE_CACHE_MAX_FILE_BYTES     (64 * 1024 * 1024)
+
+/**
+ * @brief The EngineCache class
+ *
+ * Process wide cache of the files loaded by the engine, shared by Player and the offline renderers.
+ * Drumsets are kept mapped and parsed, songs and effects are kept in memory.
+ * Samples at another rate than the mixer are converted when loaded, see ResampleCache.
+ * An entry is used again as long as the size and modification time of its file did not change,
+ * the least recently used entries are dropped first. All the functions are thread safe.
+ *
+ * NOTE: drumsets are still mapped while they are in the cache, clear() releases them.
+ */
+class EngineCache
+{
+public:
+    class Drumset
+    {
+        Q_DISABLE_COPY(Drumset)
+
+    public:
+        Drumset();
+        ~Drumset();
+
+        bool load(const QString &filepath);
+        inline const SoundManager_drumset_t *parsed() const { return mp_parsed; }
+        inline const char *data() const { return m_file.data(); }
+        inline qint64 size() const { return m_file.size(); }
+        // Converted samples played instead of the ones of the file
+        inline const QVector<QByteArray> &resampled() const { return m_resampled; }
+
+    private:
+        void resample(void);
+
+        MappedFile m_file;
+        SoundManager_drumset_t *mp_parsed;
+        QVector<QByteArray> m_resampled;
+    };
+
+    static EngineCache *instance();
+
+    QSharedPointer<const Drumset> drumset(const QString &filepath);
+    bool file(const QString &filepath, QByteArray &data);
+    bool effect(const QString &filepath, QByteArray &data);
+    void remove(const QString &filepath);
+    void clear(void);
+
+private:
+    template<typename T> struct Entry {
+        qint64 size;
+        QDateTime lastModified;
+        quint64 lastUse;
+        T value;
+    };
+
+    EngineCache();
+    static bool fileStamp(const QString &filepath, qint64 &size, QDateTime &lastModified);
+    template<typename T> static typename QHash<QString, Entry<T> >::iterator leastRecentlyUsed(QHash<QString, Entry<T> > &hash);
+
+    QMutex m_mutex;
+    quint64 m_useCount;
+    QHash<QString, Entry<QSharedPointer<const Drumset> > > m_drumsets;
+    QHash<QString, Entry<QByteArray> > m_files;
+    qint64 m_filesSize;
+};
+
+#endif // ENGINECACHE_H
@@ -0,0 +1,55 @@
+/*
+  	This software and the content provided for use with it is Copyright © 2014-2020 Singular Sound
+ 	BeatBuddy Manager is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2 as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "engineContext.h"
+
+EngineContext::EngineContext()
+    : mp_songPlayer(SongPlayer_createContext())
+    , mp_soundManager(SoundManager_createContext())
+    , mp_mixer(mixer_createContext())
+{
+}
+
+/**
+ * @brief EngineContext::~EngineContext
+ *        The context must not be current in another thread anymore
+ */
+EngineContext::~EngineContext()
+{
+    SongPlayer_destroyContext(mp_songPlayer);
+    SoundManager_destroyContext(mp_soundManager);
+    mixer_destroyContext(mp_mixer);
+}
+
+/**
+ * @brief EngineContext::makeCurrent
+ *        Select this instance of the engine for the calling thread
+ */
+void EngineContext::makeCurrent(void)
+{
+    SongPlayer_setContext(mp_songPlayer);
+    SoundManager_setContext(mp_soundManager);
+    mixer_setContext(mp_mixer);
+}
+
+/**
+ * @brief EngineContext::doneCurrent
+ *        Go back to the default instance of the engine in the calling thread
+ */
+void EngineContext::doneCurrent(void)
+{
+    SongPlayer_setContext(nullptr);
+    SoundManager_setContext(nullptr);
+    mixer_setContext(nullptr);
+}
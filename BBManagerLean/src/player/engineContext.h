@@ -0,0 +1,35 @@
+#ifndef ENGINECONTEXT_H
+#define ENGINECONTEXT_H
+
+#include <QtGlobal>
+
+#include "songPlayer.h"
+#include "soundManager.h"
+#include "mixer.h"
+
+/**
+ * @brief The EngineContext class
+ *
+ * Owns one instance of the song player, the sound manager and the mixer.
+ * The engine functions work on the instance selected in the calling thread with makeCurrent(),
+ * so that several songs can be played by different threads at the same time.
+ * Threads that never call makeCurrent() share a default instance.
+ */
+class EngineContext
+{
+    Q_DISABLE_COPY(EngineContext)
+
+public:
+    EngineContext();
+    ~EngineContext();
+
+    void makeCurrent(void);
+    static void doneCurrent(void);
+
+private:
+    SongPlayer_context_t *mp_songPlayer;
+    SoundManager_context_t *mp_soundManager;
+    MIXER_context_t *mp_mixer;
+};
+
+#endif // ENGINECONTEXT_H
@@ -0,0 +1,74 @@
+/*
+  	This software and the content provided for use with it is Copyright © 2014-2020 Singular Sound
+ 	BeatBuddy Manager is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2 as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include <QDebug>
+
+#include "mappedFile.h"
+
+MappedFile::MappedFile()
+    : mp_data(nullptr)
+    , m_size(0)
+{
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+/**
+ * @brief MappedFile::open
+ *        Map the whole file, the previous one is closed
+ * @return false if the file can't be read or is empty
+ */
+bool MappedFile::open(const QString &filepath)
+{
+    close();
+
+    m_file.setFileName(filepath);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    m_size = m_file.size();
+    if (m_size <= 0) {
+        close();
+        return false;
+    }
+
+    mp_data = (const char *)m_file.map(0, m_size);
+    if (!mp_data) {
+        qWarning() << "MappedFile::open - unable to map" << filepath << "-" << m_file.errorString() << "- reading it instead";
+        m_copy = m_file.readAll();
+        if (m_copy.size() != m_size) {
+            close();
+            return false;
+        }
+        mp_data = m_copy.constData();
+    }
+    return true;
+}
+
+void MappedFile::close(void)
+{
+    if (mp_data && m_copy.isEmpty()) {
+        m_file.unmap((uchar *)mp_data);
+    }
+    mp_data = nullptr;
+    m_size = 0;
+    m_copy.clear();
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+/**
+ * @brief The MappedFile class
+ *
+ * Read-only view of a whole file, memory-mapped so that only the pages actually read are loaded.
+ * Falls back to a copy in memory when the file system does not support mapping.
+ *
+ * NOTE: the file must not be modified while it is mapped.
+ */
+class MappedFile
+{
+    Q_DISABLE_COPY(MappedFile)
+
+public:
+    MappedFile();
+    ~MappedFile();
+
+    bool open(const QString &filepath);
+    void close(void);
+
+    inline bool isOpen() const { return mp_data != nullptr; }
+    inline const char *data() const { return mp_data; }
+    inline qint64 size() const { return m_size; }
+    inline QString fileName() const { return m_file.fileName(); }
+
+private:
+    QFile m_file;
+    const char *mp_data;
+    qint64 m_size;
+    QByteArray m_copy;
+};
+
+#endif // MAPPEDFILE_H
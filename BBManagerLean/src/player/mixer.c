@@ -13,14 +13,17 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 #include "mixer.h"
+#include "mixerKernels.h"
 #include "settings.h"
 #include "pragmapack.h"
+#include "threadLocal.h"
 #include <string.h>
 #include <math.h>
 #include <time.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stddef.h>
 
 
 
@@ -38,17 +41,29 @@ extern "C" {
 #define RELEASE_GAIN_LENGTH         ((RELEASE_TIME_MAX * 44100) / 1000)
 //#define RELEASE_GAIN_LENGTH         (2)
 
+// Length of the linear fade applied when a voice is choked or stolen.
+// A choked voice is silent after the fade but keeps its slot until RELEASE_GAIN_LENGTH.
+#define RELEASE_RAMP_FRAMES         (100)
+
 #define MASTER_DIVIDER               (100000LL * 100LL * 100LL)
 
 
 
 
 
-#define MIXER_MAX_CHANNEL_ARRAY      (64u) // Number max of stereo channel
 
-// MIXER_BUFFER_LENGTH_SAMPLES DEFINED in .h so that it can be accessed by player.cpp
-#    define MIXER_BUFFER_LENGTH          (70560u)//(MIXER_BUFFER_LENGTH_SAMPLES)
-#define BUFFER_LENGTH               (MIXER_BUFFER_LENGTH)
+// Size of the L/R accumulators. Requests from the player are rendered by blocks of this size
+#define MIXER_RENDER_BLOCK_FRAMES    (256u)
+
+// Number of voice lists indexed by note, choke group and fill choke group.
+// Ids above the number of lists share a list, voices are still compared with the exact id.
+#define MIXER_NOTE_LISTS             (129u) // 128 MIDI notes + special effects (note 128)
+#define MIXER_CHOKE_LISTS            (16u)
+#define MIXER_FILL_CHOKE_LISTS       (16u)
+
+// Number of events waiting for their frame (see mixer_ReadOutputStream).
+// A full queue applies the new events right away.
+#define MIXER_MAX_EVENTS             (1024u)
 
 
 #define MIXER_TIME_SAMPLE_US_RATIO  (1.0f/(1000000.0f/44100.0f))
@@ -60,6 +75,11 @@ extern "C" {
 #define FIXED_POINT_OFF             (1000)
 #define MAX_VALUE                   (8388607)
 #define MIN_VALUE                   (-8388607)
+
+// Float engine : a sample of 24 bits at full scale is 1.0
+#define FLOAT_FULL_SCALE            (8388608.0f)
+#define FLOAT_MAX_VALUE             (8388607.0f / FLOAT_FULL_SCALE)
+#define FLOAT_MIN_VALUE             (-8388607.0f / FLOAT_FULL_SCALE)
 #ifndef true
 #define true 1
 #endif
@@ -72,57 +92,163 @@ extern "C" {
 #define NULL ((void*) 0)
 #endif
 
-#define GET_SAMPLE_VALUE(c)         ((int64_t)(c->velocity)) * ((int64_t)((((*(int32_t*) & c->add[c->byteIndex]) & (c->dataMask)) << c->leftShift) >> c->rightShift))
-#define NEXT_RIGHT_SAMPLE(c)        (c->byteIndex += c->offsetStereo)
-#define NEXT_LEFT_SAMPLE(c)         (c->byteIndex += c->offsetNext)
+// Voice that holds the list link
+#define VOICE_OF(link, member)      ((MIXER_channel_t *)((char *)(link) - offsetof(MIXER_channel_t, member)))
 
 /******************************************************************************
                           INTERNAL TYPEDEF
  ******************************************************************************/
 
-typedef struct {
+struct MIXER_format_s {
+    MIXER_decodeFunc_t decode;   // Format specific decoder
+    unsigned int nChannel;       // Number of channel (mono/stereo)
+    unsigned int bytesPerSample; // Number of byte of a single sample (left or right)
+    unsigned int offsetSample;   // Number of byte to skip for a frame ( L + R )
+};
+
+typedef enum {
+    MIXER_VOICE_PLAYING,         // Full gain
+    MIXER_VOICE_RELEASING,       // Choked: fade out, still counted until the end of the release time
+    MIXER_VOICE_STOLEN           // Replaced by a new voice: fade out, out of the note/choke lists
+} MIXER_voiceState_t;
+
+// Link of an intrusive circular list, the head of a list is a sentinel link
+typedef struct MIXER_link_s {
+    struct MIXER_link_s *prev;
+    struct MIXER_link_s *next;
+} MIXER_link_t;
+
+typedef struct MIXER_channel_s {
     unsigned char * add;         // Starting address of the audio samples
+    const MIXER_format_t *format;// Format of the audio samples
     unsigned int offsetSample;   // Number of byte to skip for a frame ( L + R )
-    unsigned int offsetStereo;   // Number of offset bytes to apply betwwen left and right channel
-    unsigned int offsetNext;     // Numver of offser bytes to apply afeter the right channel
-    unsigned int leftShift;      // Number of byte to move the sound so that the MSB reache the MSB of an integer
-    unsigned int rightShift;     // RIght shift to replace the sample as a 24 bits
-    int dataMask;                // Mask to apply to the array of sound to retreive a unique sample left or right
+    MIXER_decodeFunc_t decode;   // Format specific decoder, selected when the sound is added
+    unsigned int nChannel;       // Number of channel (mono/stereo)
 
     signed int nByte;            // Length of the array of the sound
     signed int byteIndex;        // Current Play index of the sample
 
     signed int velocity;              // Gain given to the track
+    float gain;                       // Float engine: velocity, unity release and master scale in one factor
     unsigned int timeiD;              // Unique ID given to the track (choke option)
     unsigned int chokeGroup;          // choke group of the sample
     unsigned int noteID;              // Note id of the sound
     unsigned int fillChokeGroup;      // Ending Fills choke group
     int fillChokeDelay;               // Fill choke delay
     unsigned int fillChokePartId;     // Group associated to the fill (part of the song)
-    unsigned int release_position;
-    unsigned int release_delay;
+    MIXER_voiceState_t state;
+    unsigned int release_position;    // Position in the release ramp
+    uint64_t startFrame;              // Mixer clock at which the voice was started
+
+    // Every list is ordered by start time (oldest first)
+    MIXER_link_t ageLink;             // All the playing voices
+    MIXER_link_t noteLink;            // Voices of the same note
+    MIXER_link_t chokeLink;           // Voices of the same choke group
+    MIXER_link_t fillChokeLink;       // Voices of the same fill choke group
+    struct MIXER_channel_s *nextFree; // Next voice in the free list
 } MIXER_channel_t;
 
+typedef enum {
+    MIXER_EVENT_START,           // Start a voice
+    MIXER_EVENT_CHOKE_GROUP,     // Release the voices of a choke group
+    MIXER_EVENT_CHOKE_NOTE,      // Release the voices of a note
+    MIXER_EVENT_POLYPHONY        // Release the oldest voice of a note above its polyphony
+} MIXER_eventType_t;
+
+typedef struct {
+    uint64_t frame;              // Mixer clock at which the event is applied
+    unsigned int seq;            // Post order, events of the same frame are applied in that order
+    MIXER_eventType_t type;
+    unsigned char * add;         // START: parameters of the voice (see mixer_addVoice)
+    const MIXER_format_t *format;
+    unsigned int nSample;
+    unsigned int vol;
+    unsigned int timeiD;
+    unsigned int chokeGroup;     // START and CHOKE_GROUP
+    unsigned int noteID;         // START, CHOKE_NOTE and POLYPHONY
+    unsigned int fillChokeGroup;
+    unsigned int fillChokeDelay;
+    unsigned int fillChokePartId;
+    unsigned int limit;          // POLYPHONY: number of voices allowed for the note
+} MIXER_event_t;
+
+// Stolen voices fade out in their own slot, a few extra slots are kept for them
+#define MIXER_FADING_VOICES          (16u)
+
+// State of a mixer instance. Every function of the mixer works on the context of the calling thread.
+struct MIXER_context_s {
+    MIXER_channel_t Channel[MIXER_MAX_POLYPHONY + MIXER_FADING_VOICES];
+
+    // Voice pool: unused voices are kept in a free list, playing voices in a
+    // list ordered by start time. Since a new voice is always the youngest, it
+    // is appended at the tail and the oldest one is always at the head.
+    // Playing voices are also indexed by note, choke group and fill choke group
+    // so that those operations only walk the voices involved.
+    MIXER_channel_t *FreeVoices;
+    MIXER_link_t ActiveVoices;
+    MIXER_link_t NoteVoices[MIXER_NOTE_LISTS];
+    MIXER_link_t ChokeVoices[MIXER_CHOKE_LISTS];
+    MIXER_link_t FillChokeVoices[MIXER_FILL_CHOKE_LISTS];
+    MIXER_link_t FadingVoices;          // Stolen voices, not counted in the polyphony
+    unsigned int ActiveCount;
+    unsigned int Polyphony;
+    unsigned int PeakCount;             // Statistics, see mixer_getVoiceStats()
+    unsigned int StolenCount;
+    unsigned int CutCount;
+
+    unsigned int UniqueId;
+
+    // Pending events, a binary min-heap ordered by frame then post order.
+    // The delays given to the mixer are relative to EventOrigin, the voices start
+    // at the exact frame inside a block and cost nothing until then.
+    MIXER_event_t Events[MIXER_MAX_EVENTS];
+    unsigned int EventCount;
+    unsigned int EventSeq;
+    uint64_t Clock;                     // Number of frames rendered since mixer_init()
+    uint64_t EventOrigin;
+
+    int64_t R_Buffer[MIXER_RENDER_BLOCK_FRAMES];
+    int64_t L_Buffer[MIXER_RENDER_BLOCK_FRAMES];
+
+    int ReleaseCoeff[RELEASE_RAMP_FRAMES];
+
+    // Float engine accumulators and release coefficients relative to the unity gain
+    float R_BufferF[MIXER_RENDER_BLOCK_FRAMES];
+    float L_BufferF[MIXER_RENDER_BLOCK_FRAMES];
+    float ReleaseGain[RELEASE_RAMP_FRAMES];
+    float VoiceGainScale;
+
+    float g_level;
+    float g_peak;
+
+    MIXER_engine_t Engine;
+    MIXER_outputFormat_t OutputFormat;
+
+    unsigned int tt;                    // Phase of the test tones
+};
+
 
 
 /******************************************************************************
  **                     INTERNAL GLOBAL VARIABLE 
  ********************************************** *******************************/
 
-static MIXER_channel_t Channel[MIXER_MAX_CHANNEL_ARRAY];
-
-static unsigned int UniqueId = 0;
+static const MIXER_format_t Formats[] = {
+    // decode                          nCh  bps  frame
+    { mixerKernel_decodePCM16Stereo,   2,   2,   4 },
+    { mixerKernel_decodePCM16Mono,     1,   2,   2 },
+    { mixerKernel_decodePCM24Stereo,   2,   3,   6 },
+    { mixerKernel_decodePCM24Mono,     1,   3,   3 },
+};
 
-static signed long long R_Buffer[MIXER_BUFFER_LENGTH];
-static signed long long L_Buffer[MIXER_BUFFER_LENGTH];
-static volatile unsigned int numEmptyValues;
+static MIXER_context_t DefaultContext = {
+    .Polyphony = MIXER_DEFAULT_POLYPHONY,
+    .Engine = MIXER_ENGINE_INT64,
+    .OutputFormat = MIXER_OUTPUT_PCM16,
+};
 
-static unsigned long counter = 180;
-
-static int ReleaseCoeff[RELEASE_GAIN_LENGTH];
-static int ReleaseLength = RELEASE_GAIN_LENGTH;
-
-static float g_level;
+// Context of the calling thread, see mixer_setContext()
+static THREAD_LOCAL MIXER_context_t *Ctx = &DefaultContext;
 
 /******************************************************************************
  **                     INTERNAL FUNCTION PROTOTYPE
@@ -133,7 +259,17 @@ void IntEnable(char status){(void) status;}
 
 static void calculateReleaseTimeCoeff(int *array, int length);
 static void settingsCallback(SETTINGS_main_key_enum key, int value);
-static inline void quickRelease(MIXER_channel_t *channel);
+static MIXER_channel_t *allocVoice(void);
+static void linkVoice(MIXER_channel_t *chanPtr);
+static void unlinkVoice(MIXER_channel_t *chanPtr);
+static void stealVoice(MIXER_channel_t *chanPtr);
+static void freeVoice(MIXER_channel_t *chanPtr);
+static void postEvent(const MIXER_event_t *event);
+static void applyEvent(const MIXER_event_t *event);
+static void applyDueEvents(void);
+static void mixChannel(MIXER_channel_t *chanPtr, unsigned int nFrame);
+static void writeOutput(unsigned char *buff, unsigned int nFrame);
+static void writeOutputFloat(unsigned char *buff, unsigned int nFrame);
 
 /******************************************************************************
  **              FUNCTION DEFINITIONS
@@ -150,26 +286,119 @@ void mixer_setRightFreq(unsigned int freq){
     gRightFreq = freq;
 }
 
+static inline void listInit(MIXER_link_t *head)
+{
+    head->prev = head;
+    head->next = head;
+}
+
+static inline void listAppend(MIXER_link_t *head, MIXER_link_t *link)
+{
+    link->prev = head->prev;
+    link->next = head;
+    head->prev->next = link;
+    head->prev = link;
+}
+
+static inline void listRemove(MIXER_link_t *link)
+{
+    link->prev->next = link->next;
+    link->next->prev = link->prev;
+}
+
 /*
  * \brief Init the mixer object by freeing all the channels
  */
 void mixer_init(void)
 {
+    MIXER_context_t *ctx = Ctx;
     unsigned int i;
-    //Free all channel (active state is defined by byteIndex < nByte)
-    for( i = 0; i < MIXER_MAX_CHANNEL_ARRAY; i++ ) {
-        Channel[i].nByte = 0u;
-        Channel[i].timeiD = 0u;
-        Channel[i].byteIndex = 0u;
+    //Free all channel
+    listInit(&ctx->ActiveVoices);
+    listInit(&ctx->FadingVoices);
+    for( i = 0; i < MIXER_NOTE_LISTS; i++ ) listInit(&ctx->NoteVoices[i]);
+    for( i = 0; i < MIXER_CHOKE_LISTS; i++ ) listInit(&ctx->ChokeVoices[i]);
+    for( i = 0; i < MIXER_FILL_CHOKE_LISTS; i++ ) listInit(&ctx->FillChokeVoices[i]);
+    ctx->ActiveCount = 0;
+    ctx->PeakCount = 0;
+    ctx->StolenCount = 0;
+    ctx->CutCount = 0;
+    ctx->FreeVoices = NULL;
+    ctx->EventCount = 0;
+    ctx->EventSeq = 0;
+    ctx->Clock = 0;
+    ctx->EventOrigin = 0;
+    for( i = MIXER_MAX_POLYPHONY + MIXER_FADING_VOICES; i > 0; i-- ) {
+        ctx->Channel[i - 1].nByte = 0u;
+        ctx->Channel[i - 1].timeiD = 0u;
+        ctx->Channel[i - 1].byteIndex = 0u;
+        ctx->Channel[i - 1].nextFree = ctx->FreeVoices;
+        ctx->FreeVoices = &ctx->Channel[i - 1];
+    }
+
+    calculateReleaseTimeCoeff(ctx->ReleaseCoeff, RELEASE_RAMP_FRAMES);
+
+    // Gain of a sample in the float engine so that the full scale is 1.0
+    ctx->VoiceGainScale = (float)(ctx->ReleaseCoeff[0] / ((double)MASTER_DIVIDER * FLOAT_FULL_SCALE));
+    for( i = 0; i < RELEASE_RAMP_FRAMES; i++ ) {
+        ctx->ReleaseGain[i] = (float)ctx->ReleaseCoeff[i] / (float)ctx->ReleaseCoeff[0];
     }
 
+    mixerKernel_init();
+}
+
+/**
+ * \brief  Create an instance of the mixer, initialized like mixer_init()
+ *
+ * \return the new context, NULL if there is not enough memory
+ **/
+MIXER_context_t *mixer_createContext(void)
+{
+    MIXER_context_t *context = (MIXER_context_t *)calloc(1, sizeof(MIXER_context_t));
+    MIXER_context_t *previous;
 
+    if (context == NULL) return NULL;
 
+    context->Polyphony = MIXER_DEFAULT_POLYPHONY;
+    context->Engine = MIXER_ENGINE_INT64;
+    context->OutputFormat = MIXER_OUTPUT_PCM16;
+
+    previous = mixer_setContext(context);
+    mixer_init();
+    mixer_setContext(previous);
+
+    return context;
+}
+
+/**
+ * \brief  Free a context created by mixer_createContext().
+ *         It must not be the context of another thread.
+ **/
+void mixer_destroyContext(MIXER_context_t *context)
+{
+    if (context == NULL || context == &DefaultContext) return;
+    if (Ctx == context) Ctx = &DefaultContext;
+    free(context);
+}
 
-    // Initialise the mixer circular buffer
-    numEmptyValues = MIXER_BUFFER_LENGTH;
+/**
+ * \brief  Select the instance the mixer functions work on in the calling thread
+ *
+ * \param  context  Context to use, NULL for the default context shared by the
+ *                  threads that never select one.\n
+ *
+ * \return the previous context of the thread
+ **/
+MIXER_context_t *mixer_setContext(MIXER_context_t *context)
+{
+    MIXER_context_t *previous = Ctx;
+    Ctx = (context != NULL) ? context : &DefaultContext;
+    return previous;
+}
 
-    calculateReleaseTimeCoeff(ReleaseCoeff,100);
+MIXER_context_t *mixer_getContext(void)
+{
+    return Ctx;
 }
 
 
@@ -181,299 +410,354 @@ static void calculateReleaseTimeCoeff(int *array, int length){
 }
 
 /**
- * \brief  This function tries to add activate a ADD/Activate a channel in the mixer,
- *          remove the oldest if no empty channel was found \n
+ * \brief  Get the descriptor of a sample format
  *
- * \param  startAddress   Start address of the channel.\n
- * \param  length         Length of the audio sample .\n
- * \param  vol            Volume of the track : 0 @ 200;
+ * \param  bitsPerSample  16 or 24.\n
+ * \param  nChannel       1 (mono) or 2 (stereo).\n
  *
- * \ return the unique ID of the sample
+ * \return the format descriptor, NULL if the format is not supported
  **/
-#if !(defined(__x86_64__) || defined(_M_X64))
-unsigned int mixer_addPCM16Stereo(unsigned int startAddress,
-#else
-unsigned int mixer_addPCM16Stereo(uint64_t  startAddress,
-#endif
-        unsigned int nSample,
-        unsigned int vol,
-        unsigned int nDelay,
-        unsigned int chokeGroup,
-        unsigned int noteID,
-        unsigned int fillChokeGroup,
-        unsigned int fillChokeDelay,
-        unsigned int fillChokeId)
+const MIXER_format_t *mixer_getFormat(unsigned int bitsPerSample, unsigned int nChannel)
 {
-    unsigned char status = IntDisable();
-    unsigned int i;
-    unsigned int oldestIndex = 0;
-
-    //Find the first empty channel and initialize it
-    //Search also for the oldest sample (e.g. smallest unique ID)
-    for( i = 0; i < MIXER_MAX_CHANNEL_ARRAY; i++ ) {
-
-
-        if( Channel[i].byteIndex >= Channel[i].nByte ) {
-
-            Channel[i].add = (unsigned char*) startAddress;
-            Channel[i].nByte = nSample * 2;
-            Channel[i].byteIndex = 0 - (4 * nDelay);
-            Channel[i].velocity = vol;
-            Channel[i].timeiD = ++UniqueId;
-            Channel[i].chokeGroup =  chokeGroup;
-            Channel[i].offsetSample = 4;
-            Channel[i].offsetStereo = 2;
-            Channel[i].offsetNext = 2;
-            Channel[i].leftShift = 16;
-            Channel[i].rightShift = 8;
-            Channel[i].dataMask = 0x0000FFFF;
-            Channel[i].noteID = noteID;
-            Channel[i].fillChokeGroup = fillChokeGroup;
-            Channel[i].fillChokeDelay = fillChokeDelay * 4; // Convert value delay in sample to number of byte
-            Channel[i].fillChokePartId = fillChokeId;
-            Channel[i].release_position = 0;
-            Channel[i].release_delay = 0;
-            IntEnable(status);
-            return UniqueId;
-        } else {
+    switch (bitsPerSample) {
+    case 16:
+        if (nChannel == 2) return &Formats[0];
+        if (nChannel == 1) return &Formats[1];
+        break;
+    case 24:
+        if (nChannel == 2) return &Formats[2];
+        if (nChannel == 1) return &Formats[3];
+        break;
+    default:
+        break;
+    }
+    return NULL;
+}
 
-            /* Look for the smaller */
-            if ( Channel[i].timeiD < Channel[oldestIndex].timeiD ){
-                oldestIndex = i;
-            }
-        }
+/**
+ * \brief  Take a voice from the pool, steal the oldest one if the polyphony is reached.
+ *         The voice is not in any list, see linkVoice().
+ **/
+static MIXER_channel_t *allocVoice(void)
+{
+    MIXER_context_t *ctx = Ctx;
+    MIXER_channel_t *chanPtr;
+
+    /* Fade out the oldest if the polyphony is reached */
+    if (ctx->ActiveCount >= ctx->Polyphony) {
+        stealVoice(VOICE_OF(ctx->ActiveVoices.next, ageLink));
+        ctx->StolenCount++;
     }
 
-    /* Replace the oldest with the new if no channel were found */
-    quickRelease(&Channel[oldestIndex]);
-    Channel[oldestIndex].add = (unsigned char*)startAddress;
-    Channel[oldestIndex].nByte = nSample * 2;
-    Channel[oldestIndex].byteIndex = 0 - (4 * nDelay);
-    Channel[oldestIndex].velocity = vol;
-    Channel[oldestIndex].timeiD = ++UniqueId;
-    Channel[oldestIndex].chokeGroup = chokeGroup;
-    Channel[oldestIndex].offsetSample = 4;
-    Channel[oldestIndex].offsetStereo = 2;
-    Channel[oldestIndex].offsetNext = 2;
-    Channel[oldestIndex].leftShift = 16;
-    Channel[oldestIndex].rightShift = 8;
-    Channel[oldestIndex].dataMask = 0x0000FFFF;
-    Channel[oldestIndex].noteID = noteID;
-    Channel[oldestIndex].fillChokeGroup = fillChokeGroup;
-    Channel[oldestIndex].fillChokeDelay = fillChokeDelay * 4;
-    Channel[oldestIndex].fillChokePartId = fillChokeId;
-    Channel[oldestIndex].release_position = 0;
-    Channel[oldestIndex].release_delay = 0;
+    /* All the extra slots are fading, cut the oldest */
+    if (ctx->FreeVoices == NULL) {
+        freeVoice(VOICE_OF(ctx->FadingVoices.next, ageLink));
+        ctx->CutCount++;
+    }
 
-    IntEnable(status);
-    return UniqueId;
-}
+    chanPtr = ctx->FreeVoices;
+    ctx->FreeVoices = chanPtr->nextFree;
+    ctx->ActiveCount++;
+    if (ctx->ActiveCount > ctx->PeakCount) {
+        ctx->PeakCount = ctx->ActiveCount;
+    }
 
+    return chanPtr;
+}
 
+/**
+ * \brief  Append a voice to the lists of its note and choke groups (as the youngest)
+ **/
+static void linkVoice(MIXER_channel_t *chanPtr)
+{
+    MIXER_context_t *ctx = Ctx;
+    listAppend(&ctx->ActiveVoices, &chanPtr->ageLink);
+    listAppend(&ctx->NoteVoices[chanPtr->noteID % MIXER_NOTE_LISTS], &chanPtr->noteLink);
+    listAppend(&ctx->ChokeVoices[chanPtr->chokeGroup % MIXER_CHOKE_LISTS], &chanPtr->chokeLink);
+    listAppend(&ctx->FillChokeVoices[chanPtr->fillChokeGroup % MIXER_FILL_CHOKE_LISTS], &chanPtr->fillChokeLink);
+}
 
+static void unlinkVoice(MIXER_channel_t *chanPtr)
+{
+    listRemove(&chanPtr->ageLink);
+    listRemove(&chanPtr->noteLink);
+    listRemove(&chanPtr->chokeLink);
+    listRemove(&chanPtr->fillChokeLink);
+}
 
 /**
- * \brief  This function tries to add activate a ADD/Activate a channel in the mixer,
- *          remove the oldest if no empty channel was found \n
+ * \brief  Remove a voice from the playing voices and let it fade out
  *
- * \param  startAddress   Start address of the channel.\n
- * \param  length         Length of the audio sample .\n
- * \param  vol            Volume of the track : 0 @ 200;
- *
- * \ return the unique ID of the sample
+ *  A voice already silent after its release ramp has nothing left to fade, it is
+ *  freed right away instead of taking a fading slot.
  **/
-#if !(defined(__x86_64__) || defined(_M_X64))
-unsigned int mixer_addPCM16Mono(unsigned int startAddress,
-#else
-unsigned int mixer_addPCM16Mono(uint64_t  startAddress,
-#endif
-        unsigned int nSample,
-        unsigned int vol,
-        unsigned int nDelay,
-        unsigned int chokeGroup,
-        unsigned int noteID,
-        unsigned int fillChokeGroup,
-        unsigned int fillChokeDelay,
-        unsigned int fillChokeId)
+static void stealVoice(MIXER_channel_t *chanPtr)
 {
-    unsigned int i;
-    unsigned int oldestIndex;
-    unsigned char status = IntDisable();
-    // Get the first sound to initialise the minimum seeker */
-    oldestIndex =  0;
-
-    //Find the first empty channel and initialize it
-    //Search also for the oldest sample (e.g. smallest unique ID)
-    for( i = 0; i < MIXER_MAX_CHANNEL_ARRAY; i++ ) {
-
-
-        if( Channel[i].byteIndex >= Channel[i].nByte ) {
-
-            Channel[i].add = (unsigned char*) startAddress;
-            Channel[i].nByte = nSample * 2;
-            Channel[i].byteIndex = 0 - (2 * nDelay);
-            Channel[i].velocity = vol;
-            Channel[i].timeiD = ++UniqueId;
-            Channel[i].chokeGroup =  chokeGroup;
-            Channel[i].offsetSample = 2;
-            Channel[i].offsetStereo = 0;
-            Channel[i].offsetNext = 2;
-            Channel[i].leftShift = 16;
-            Channel[i].rightShift = 8;
-            Channel[i].dataMask = 0x0000FFFF;
-            Channel[i].noteID = noteID;
-            Channel[i].fillChokeGroup = fillChokeGroup;
-            Channel[i].fillChokeDelay = fillChokeDelay * 2;
-            Channel[i].fillChokePartId = fillChokeId;
-            Channel[i].release_position = 0;
-            Channel[i].release_delay = 0;
-            IntEnable(status);
-            return UniqueId;
-        } else {
+    MIXER_context_t *ctx = Ctx;
+    if (chanPtr->release_position >= RELEASE_RAMP_FRAMES) {
+        freeVoice(chanPtr);
+        return;
+    }
+    unlinkVoice(chanPtr);
+    ctx->ActiveCount--;
 
-            /* Look for the smaller */
-            if ( Channel[i].timeiD < Channel[oldestIndex].timeiD ){
-                oldestIndex = i;
-            }
-        }
+    chanPtr->state = MIXER_VOICE_STOLEN;
+    if (chanPtr->release_position == 0) {
+        chanPtr->release_position = 1;
     }
+    listAppend(&ctx->FadingVoices, &chanPtr->ageLink);
+}
 
-    /* Replace the oldest with the new if no channel were found */
-    quickRelease(&Channel[oldestIndex]);
-    Channel[oldestIndex].add = (unsigned char*)startAddress;
-    Channel[oldestIndex].nByte = nSample * 2;
-    Channel[oldestIndex].byteIndex = 0 - (2 * nDelay);
-    Channel[oldestIndex].velocity = vol;
-    Channel[oldestIndex].timeiD = ++UniqueId;
-    Channel[oldestIndex].chokeGroup = chokeGroup;
-    Channel[oldestIndex].offsetSample = 2;
-    Channel[oldestIndex].offsetStereo = 0;
-    Channel[oldestIndex].offsetNext = 2;
-    Channel[oldestIndex].leftShift = 16;
-    Channel[oldestIndex].rightShift = 8;
-    Channel[oldestIndex].dataMask = 0x0000FFFF;
-    Channel[oldestIndex].noteID = noteID;
-    Channel[oldestIndex].fillChokeGroup = fillChokeGroup;
-    Channel[oldestIndex].fillChokeDelay = fillChokeDelay * 2;
-    Channel[oldestIndex].fillChokePartId = fillChokeId;
-    Channel[oldestIndex].release_position = 0;
-    Channel[oldestIndex].release_delay = 0;
+/**
+ * \brief  Stop a voice and give it back to the pool
+ **/
+static void freeVoice(MIXER_channel_t *chanPtr)
+{
+    MIXER_context_t *ctx = Ctx;
+    if (chanPtr->state == MIXER_VOICE_STOLEN) {
+        listRemove(&chanPtr->ageLink);
+    } else {
+        unlinkVoice(chanPtr);
+        ctx->ActiveCount--;
+    }
 
-    IntEnable(status);
-    return UniqueId;
+    chanPtr->nByte = 0;
+    chanPtr->byteIndex = 0;
+    chanPtr->nextFree = ctx->FreeVoices;
+    ctx->FreeVoices = chanPtr;
 }
 
+static inline int eventBefore(const MIXER_event_t *a, const MIXER_event_t *b)
+{
+    if (a->frame != b->frame) return a->frame < b->frame;
+    return (int)(a->seq - b->seq) < 0;
+}
+
+static void siftDown(unsigned int i)
+{
+    MIXER_context_t *ctx = Ctx;
+    MIXER_event_t tmp;
+    unsigned int child;
+
+    while ((child = 2 * i + 1) < ctx->EventCount) {
+        if (child + 1 < ctx->EventCount && eventBefore(&ctx->Events[child + 1], &ctx->Events[child])) {
+            child++;
+        }
+        if (!eventBefore(&ctx->Events[child], &ctx->Events[i])) {
+            break;
+        }
+        tmp = ctx->Events[i];
+        ctx->Events[i] = ctx->Events[child];
+        ctx->Events[child] = tmp;
+        i = child;
+    }
+}
 
 /**
- * \brief  This function tries to add activate a ADD/Activate a channel in the mixer,
- *          remove the oldest if no empty channel was found \n
- *
- * \param  startAddress   Start address of the channel .\n
- * \param  nSample         Number of sample (sum of 24bit sample) .\n
- * \param  vol            Volume of the track : 0 @ 200;
- *
- * \ return the unique ID of the sample
+ * \brief  Restore the heap order after events were removed from the array
  **/
- 
-#if !(defined(__x86_64__) || defined(_M_X64))
-unsigned int mixer_addPCM24Stereo(unsigned int  startAddress,
-#else
-unsigned int mixer_addPCM24Stereo(uint64_t  startAddress,
-#endif
-        unsigned int nSample,
-        unsigned int vol,
-        unsigned int nDelay,
-        unsigned int chokeGroup,
-        unsigned int noteID,
-        unsigned int fillChokeGroup,
-        unsigned int fillChokeDelay,
-        unsigned int fillChokeId){
+static void rebuildEvents(void)
+{
+    MIXER_context_t *ctx = Ctx;
+    unsigned int i;
 
+    for (i = ctx->EventCount / 2; i > 0; i--) {
+        siftDown(i - 1);
+    }
+}
 
+/**
+ * \brief  Queue an event for its frame. The event is applied right away if the queue is full.
+ **/
+static void postEvent(const MIXER_event_t *event)
+{
+    MIXER_context_t *ctx = Ctx;
+    MIXER_event_t tmp;
     unsigned int i;
-    unsigned int oldestIndex;
-    unsigned char status = IntDisable();
+    unsigned int parent;
+
+    if (ctx->EventCount >= MIXER_MAX_EVENTS) {
+        applyEvent(event);
+        return;
+    }
 
+    i = ctx->EventCount++;
+    ctx->Events[i] = *event;
+    ctx->Events[i].seq = ctx->EventSeq++;
 
-    // Get the first sound to initialise the minimum seeker */
-    oldestIndex =  0;
-
-    //Find the first empty channel and initialize it
-    //Search also for the oldest sample (e.g. smallest unique ID)
-    for( i = 0; i < MIXER_MAX_CHANNEL_ARRAY; i++ ) {
-
-
-        if( Channel[i].byteIndex >= Channel[i].nByte ) {
-
-            Channel[i].add = (unsigned char*) startAddress;
-            Channel[i].nByte = nSample * 3;
-            Channel[i].byteIndex = 0 - (6 * nDelay);
-            Channel[i].velocity = vol;
-            Channel[i].timeiD = ++UniqueId;
-            Channel[i].chokeGroup =  chokeGroup;
-            Channel[i].offsetSample = 6;
-            Channel[i].offsetStereo = 3;
-            Channel[i].offsetNext = 3;
-            Channel[i].leftShift = 8;
-            Channel[i].rightShift = 8;
-            Channel[i].dataMask = 0x00FFFFFF;
-            Channel[i].noteID = noteID;
-            Channel[i].fillChokeGroup = fillChokeGroup;
-            Channel[i].fillChokeDelay = fillChokeDelay * 6;
-            Channel[i].fillChokePartId = fillChokeId;
-            Channel[i].release_position = 0;
-            Channel[i].release_delay = 0;
-            IntEnable(status);
-            return UniqueId;
-        } else {
+    while (i > 0) {
+        parent = (i - 1) / 2;
+        if (!eventBefore(&ctx->Events[i], &ctx->Events[parent])) {
+            break;
+        }
+        tmp = ctx->Events[i];
+        ctx->Events[i] = ctx->Events[parent];
+        ctx->Events[parent] = tmp;
+        i = parent;
+    }
+}
+
+/**
+ * \brief  Apply the events of the frames that were reached by the clock
+ **/
+static void applyDueEvents(void)
+{
+    MIXER_context_t *ctx = Ctx;
+    MIXER_event_t event;
+
+    while (ctx->EventCount > 0 && ctx->Events[0].frame <= ctx->Clock) {
+        event = ctx->Events[0];
+        ctx->Events[0] = ctx->Events[--ctx->EventCount];
+        siftDown(0);
+        applyEvent(&event);
+    }
+}
+
+static void startVoice(const MIXER_event_t *event)
+{
+    MIXER_context_t *ctx = Ctx;
+    MIXER_channel_t *chanPtr = allocVoice();
+    const MIXER_format_t *format = event->format;
+
+    chanPtr->add = event->add;
+    chanPtr->format = format;
+    chanPtr->offsetSample = format->offsetSample;
+    chanPtr->decode = format->decode;
+    chanPtr->nChannel = format->nChannel;
+    chanPtr->nByte = event->nSample * format->bytesPerSample;
+    chanPtr->byteIndex = 0;
+    chanPtr->velocity = event->vol;
+    chanPtr->gain = (float)event->vol * ctx->VoiceGainScale;
+    chanPtr->timeiD = event->timeiD;
+    chanPtr->chokeGroup = event->chokeGroup;
+    chanPtr->noteID = event->noteID;
+    chanPtr->fillChokeGroup = event->fillChokeGroup;
+    chanPtr->fillChokeDelay = event->fillChokeDelay * format->offsetSample; // Convert value delay in sample to number of byte
+    chanPtr->fillChokePartId = event->fillChokePartId;
+    chanPtr->state = MIXER_VOICE_PLAYING;
+    chanPtr->release_position = 0;
+    chanPtr->startFrame = event->frame;
+
+    linkVoice(chanPtr);
+}
+
+static void releaseVoice(MIXER_channel_t *chanPtr)
+{
+    if (chanPtr->byteIndex <= chanPtr->nByte && chanPtr->state == MIXER_VOICE_PLAYING){
+        chanPtr->state = MIXER_VOICE_RELEASING;
+        chanPtr->release_position = 1;
+    }
+}
+
+static void releaseChokeGroup(unsigned int chokeGroup)
+{
+    MIXER_context_t *ctx = Ctx;
+    MIXER_link_t *head = &ctx->ChokeVoices[chokeGroup % MIXER_CHOKE_LISTS];
+    MIXER_link_t *link;
+    MIXER_channel_t *chanPtr;
+
+    for (link = head->next; link != head; link = link->next){
+        chanPtr = VOICE_OF(link, chokeLink);
+        if (chanPtr->chokeGroup == chokeGroup){
+            releaseVoice(chanPtr);
+        }
+    }
+}
 
-            /* Look for the smaller */
-            if ( Channel[i].timeiD < Channel[oldestIndex].timeiD ){
-                oldestIndex = i;
+static void releaseNote(unsigned int note)
+{
+    MIXER_context_t *ctx = Ctx;
+    MIXER_link_t *head = &ctx->NoteVoices[note % MIXER_NOTE_LISTS];
+    MIXER_link_t *link;
+    MIXER_channel_t *chanPtr;
+
+    for (link = head->next; link != head; link = link->next) {
+        chanPtr = VOICE_OF(link, noteLink);
+        if (chanPtr->noteID == note) {
+            releaseVoice(chanPtr);
+        }
+    }
+}
+
+static void releaseAbovePolyphony(unsigned int note, unsigned int nLimit)
+{
+    MIXER_context_t *ctx = Ctx;
+    MIXER_link_t *head = &ctx->NoteVoices[note % MIXER_NOTE_LISTS];
+    MIXER_link_t *link;
+    MIXER_channel_t *chanPtr;
+    MIXER_channel_t *oldest = NULL;
+    unsigned int activeCnt = 0;
+
+    // For all the voices of the note, the first one found is the oldest
+    for (link = head->next; link != head; link = link->next){
+        chanPtr = VOICE_OF(link, noteLink);
+
+        // Scan for any active channel with the corresponding note
+        if (chanPtr->noteID == note){
+            if (chanPtr->byteIndex < chanPtr->nByte){
+                activeCnt++;
+                if (oldest == NULL){
+                    oldest = chanPtr;
+                }
             }
         }
     }
-    /* Replace the oldest with the new if no channel were found */
-    quickRelease(&Channel[oldestIndex]);
-    Channel[oldestIndex].add = (unsigned char*) startAddress;
-    Channel[oldestIndex].nByte = nSample * 3;
-    Channel[oldestIndex].byteIndex = 0 - (6 * nDelay);
-    Channel[oldestIndex].velocity = vol;
-    Channel[oldestIndex].timeiD = ++UniqueId;
-    Channel[oldestIndex].chokeGroup = chokeGroup;
-    Channel[oldestIndex].offsetSample = 6;
-    Channel[oldestIndex].offsetStereo = 3;
-    Channel[oldestIndex].offsetNext = 3;
-    Channel[oldestIndex].leftShift = 8;
-    Channel[oldestIndex].rightShift = 8;
-    Channel[oldestIndex].dataMask = 0x00FFFFFF;
-    Channel[oldestIndex].noteID = noteID;
-    Channel[oldestIndex].fillChokeGroup = fillChokeGroup;
-    Channel[oldestIndex].fillChokeDelay = fillChokeDelay * 6;
-    Channel[oldestIndex].fillChokePartId = fillChokeId;
-    Channel[oldestIndex].release_position = 0;
-    Channel[oldestIndex].release_delay = 0;
 
-    IntEnable(status);
-    return UniqueId;
+    if (activeCnt > nLimit){
+        releaseVoice(oldest);
+    }
 }
 
+static void applyEvent(const MIXER_event_t *event)
+{
+    switch (event->type) {
+    case MIXER_EVENT_START:         startVoice(event);                                      break;
+    case MIXER_EVENT_CHOKE_GROUP:   releaseChokeGroup(event->chokeGroup);                   break;
+    case MIXER_EVENT_CHOKE_NOTE:    releaseNote(event->noteID);                             break;
+    case MIXER_EVENT_POLYPHONY:     releaseAbovePolyphony(event->noteID, event->limit);     break;
+    default:                                                                                break;
+    }
+}
 
+/**
+ * \brief  Set the frame the delays given to the mixer are relative to.
+ *         The player sets it to the position of the song it is about to process,
+ *         which is ahead of the clock by the audio that is not rendered yet.
+ **/
+void mixer_setEventOrigin(uint64_t frame)
+{
+    MIXER_context_t *ctx = Ctx;
+    unsigned char status = IntDisable();
+    ctx->EventOrigin = frame;
+    IntEnable(status);
+}
+
+/**
+ * \brief  Number of frames rendered since mixer_init()
+ **/
+uint64_t mixer_getClock(void)
+{
+    return Ctx->Clock;
+}
 
 /**
- * \brief  This function tries to add activate a ADD/Activate a channel in the mixer,
- *          remove the oldest if no empty channel was found \n
+ * \brief  This function adds/activates a voice in the mixer,
+ *          the oldest is replaced if the polyphony is reached \n
  *
- * \param  startAddress   Start address of the channel .\n
- * \param  nSample         Number of sample (sum of 24bit sample) .\n
+ * \param  format         Format of the samples (see mixer_getFormat).\n
+ * \param  startAddress   Start address of the channel.\n
+ * \param  nSample        Number of sample (sum of left and right samples).\n
  * \param  vol            Volume of the track : 0 @ 200;
+ * \param  nDelay         Delay in frames from the event origin before the sound starts.\n
  *
  * \return the unique ID of the sample
  **/
 #if !(defined(__x86_64__) || defined(_M_X64))
-unsigned int mixer_addPCM24Mono(unsigned int startAddress,
+unsigned int mixer_addVoice(const MIXER_format_t *format,
+        unsigned int startAddress,
 #else
-unsigned int mixer_addPCM24Mono(uint64_t  startAddress,
+unsigned int mixer_addVoice(const MIXER_format_t *format,
+        uint64_t startAddress,
 #endif
         unsigned int nSample,
         unsigned int vol,
@@ -484,73 +768,95 @@ unsigned int mixer_addPCM24Mono(uint64_t  startAddress,
         unsigned int fillChokeDelay,
         unsigned int fillChokeId)
 {
+    MIXER_context_t *ctx = Ctx;
+    unsigned char status = IntDisable();
+    MIXER_event_t event;
 
-    unsigned int i;
-    unsigned int oldestIndex;
+    // Nothing to play
+    if (format == NULL || nSample == 0) {
+        IntEnable(status);
+        return ++ctx->UniqueId;
+    }
+
+    event.frame = ctx->EventOrigin + nDelay;
+    event.type = MIXER_EVENT_START;
+    event.add = (unsigned char*) startAddress;
+    event.format = format;
+    event.nSample = nSample;
+    event.vol = vol;
+    event.timeiD = ++ctx->UniqueId;
+    event.chokeGroup = chokeGroup;
+    event.noteID = noteID;
+    event.fillChokeGroup = fillChokeGroup;
+    event.fillChokeDelay = fillChokeDelay;
+    event.fillChokePartId = fillChokeId;
+    postEvent(&event);
+
+    IntEnable(status);
+    return event.timeiD;
+}
+
+/**
+ * \brief  Set the maximum number of voices played at once.
+ *         The oldest voices fade out if more are playing.
+ **/
+void mixer_setPolyphony(unsigned int nVoice)
+{
+    MIXER_context_t *ctx = Ctx;
     unsigned char status = IntDisable();
 
+    if (nVoice < 1) nVoice = 1;
+    if (nVoice > MIXER_MAX_POLYPHONY) nVoice = MIXER_MAX_POLYPHONY;
+    ctx->Polyphony = nVoice;
 
-    // Get the first sound to initialise the minimum seeker */
-    oldestIndex =  0;
-
-    //Find the first empty channel and initialize it
-    //Search also for the oldest sample (e.g. smallest unique ID)
-    for( i = 0; i < MIXER_MAX_CHANNEL_ARRAY; i++ ) {
-
-
-        if( Channel[i].byteIndex >= Channel[i].nByte ) {
-
-            Channel[i].add = (unsigned char*) startAddress;
-            Channel[i].nByte = nSample * 3;
-            Channel[i].byteIndex = 0 - (3 * nDelay);
-            Channel[i].velocity = vol;
-            Channel[i].timeiD = ++UniqueId;
-            Channel[i].chokeGroup =  chokeGroup;
-            Channel[i].offsetSample = 3;
-            Channel[i].offsetStereo = 0;
-            Channel[i].offsetNext = 3;
-            Channel[i].leftShift = 8;
-            Channel[i].rightShift = 8;
-            Channel[i].dataMask = 0x00FFFFFF;
-            Channel[i].noteID = noteID;
-            Channel[i].fillChokeGroup = fillChokeGroup;
-            Channel[i].fillChokeDelay = fillChokeDelay * 3;
-            Channel[i].fillChokePartId = fillChokeId;
-            Channel[i].release_position = 0;
-            Channel[i].release_delay = 0;
-            IntEnable(status);
-            return UniqueId;
-        } else {
+    while (ctx->ActiveCount > ctx->Polyphony) {
+        stealVoice(VOICE_OF(ctx->ActiveVoices.next, ageLink));
+    }
 
-            /* Look for the smaller */
-            if ( Channel[i].timeiD < Channel[oldestIndex].timeiD ){
-                oldestIndex = i;
-            }
-        }
+    IntEnable(status);
+}
+
+unsigned int mixer_getPolyphony(void)
+{
+    return Ctx->Polyphony;
+}
+
+/**
+ * \brief  Tell whether a sound started before a frame of the mixer clock is still playing,
+ *         or still has to start. The data of such a sound must be kept until it is not.
+ **/
+int mixer_isPlayingBefore(uint64_t frame)
+{
+    MIXER_context_t *ctx = Ctx;
+    MIXER_link_t *link;
+    unsigned int i;
+    int playing = 0;
+    unsigned char status = IntDisable();
+
+    for (i = 0; !playing && i < ctx->EventCount; i++) {
+        playing = ctx->Events[i].type == MIXER_EVENT_START && ctx->Events[i].frame < frame;
+    }
+    for (link = ctx->ActiveVoices.next; !playing && link != &ctx->ActiveVoices; link = link->next) {
+        playing = VOICE_OF(link, ageLink)->startFrame < frame;
+    }
+    for (link = ctx->FadingVoices.next; !playing && link != &ctx->FadingVoices; link = link->next) {
+        playing = VOICE_OF(link, ageLink)->startFrame < frame;
     }
-    /* Replace the oldest with the new if no channel were found */
-    quickRelease(&Channel[oldestIndex]);
-    Channel[oldestIndex].add = (unsigned char*)startAddress;
-    Channel[oldestIndex].nByte = nSample * 3;
-    Channel[oldestIndex].byteIndex = 0 - (3 * nDelay);
-    Channel[oldestIndex].velocity = vol;
-    Channel[oldestIndex].timeiD = ++UniqueId;
-    Channel[oldestIndex].chokeGroup = chokeGroup;
-    Channel[oldestIndex].offsetSample = 3;
-    Channel[oldestIndex].offsetStereo = 0;
-    Channel[oldestIndex].offsetNext = 3;
-    Channel[oldestIndex].leftShift = 8;
-    Channel[oldestIndex].rightShift = 8;
-    Channel[oldestIndex].dataMask = 0x00FFFFFF;
-    Channel[oldestIndex].noteID = noteID;
-    Channel[oldestIndex].fillChokeGroup = fillChokeGroup;
-    Channel[oldestIndex].fillChokeDelay = fillChokeDelay * 3;
-    Channel[oldestIndex].fillChokePartId = fillChokeId;
-    Channel[oldestIndex].release_position = 0;
-    Channel[oldestIndex].release_delay = 0;
 
     IntEnable(status);
-    return UniqueId;
+    return playing;
+}
+
+/**
+ * \brief  Use of the voices since mixer_init(), only counted when a voice starts
+ **/
+void mixer_getVoiceStats(MIXER_voiceStats_t *stats)
+{
+    MIXER_context_t *ctx = Ctx;
+    stats->active = ctx->ActiveCount;
+    stats->peak = ctx->PeakCount;
+    stats->stolen = ctx->StolenCount;
+    stats->cut = ctx->CutCount;
 }
 
 
@@ -558,46 +864,31 @@ unsigned int mixer_addPCM24Mono(uint64_t  startAddress,
  * \brief  This function removes every sound of the same choke group in the mixer \n
  *
  * \param  chokeGroup   Choke group number.\n
- * \param  nDelay       Delay in sample before the sound should be choked .\n
- *
- * \ return the unique ID of the sample
+ * \param  nDelay       Delay in sample from the event origin before the sound should be choked .\n
  **/
 void mixer_chokeChannel(unsigned int chokeGroup,unsigned int nDelay)
 {
-    unsigned int i, tmp;
+    MIXER_context_t *ctx = Ctx;
+    MIXER_event_t event;
     unsigned char status = IntDisable();
 
-    for (i=0; i<MIXER_MAX_CHANNEL_ARRAY; i++){
+    event.frame = ctx->EventOrigin + nDelay;
+    event.type = MIXER_EVENT_CHOKE_GROUP;
+    event.chokeGroup = chokeGroup;
+    postEvent(&event);
 
-        // Adjust the delay to stop the sound at the right time
-        if (Channel[i].chokeGroup == chokeGroup){
-
-            tmp = Channel[i].byteIndex + (nDelay * (Channel[i].offsetSample));
-
-            if (tmp <= Channel[i].nByte && Channel[i].release_position == 0){
-                //Channel[i].release_ = tmp;
-                Channel[i].release_delay = nDelay;
-                Channel[i].release_position = 1;
-            }
-        }
-    }
     IntEnable(status);
 }
 
-void mixer_chokeNote(uint32_t note) {
-    uint32_t i;
-    uint8_t status = IntDisable();
+void mixer_chokeNote(unsigned int note, unsigned int nDelay) {
+    MIXER_context_t *ctx = Ctx;
+    MIXER_event_t event;
+    unsigned char status = IntDisable();
 
-    for (i = 0; i < MIXER_MAX_CHANNEL_ARRAY; i++) {
-        if (Channel[i].noteID == note) {
-
-            if (Channel[i].byteIndex <= Channel[i].nByte && Channel[i].release_position == 0){
-                Channel[i].release_delay = 0;
-                Channel[i].release_position = 1;
-                // TODO add nDelay just like mixer_chokeChannel
-            }
-        }
-    }
+    event.frame = ctx->EventOrigin + nDelay;
+    event.type = MIXER_EVENT_CHOKE_NOTE;
+    event.noteID = note;
+    postEvent(&event);
 
     IntEnable(status);
 }
@@ -605,45 +896,22 @@ void mixer_chokeNote(uint32_t note) {
 
 // Polyphony Manager
 void mixer_polyphonyRemove(unsigned int note, unsigned int nLimit, unsigned nDelay){
-    unsigned int i;
-    unsigned int oldestId = 0xFFFFFFFFu;
-    unsigned int oldestIndex = 0;
-    unsigned int activeCnt = 0;
-    unsigned int tmp;
-
-
-    unsigned char status = IntDisable();
+    MIXER_context_t *ctx = Ctx;
+    MIXER_event_t event;
+    unsigned char status;
 
     // A polyphoniy of zero if unlimited power!
-    if (nLimit){
-        // For all the channel in the mixer
-        for (i=0; i<MIXER_MAX_CHANNEL_ARRAY; i++){
-
-            // Scan for any active channel with the corresponding note
-            if (Channel[i].noteID == note){
-                if (Channel[i].byteIndex < Channel[i].nByte){
-                    activeCnt++;
-                    if (Channel[i].timeiD < oldestId){
-                        oldestId = Channel[i].timeiD;
-                        oldestIndex = i;
-                    }
-                }
-
-            }
-        }
-
-        if (activeCnt > nLimit){
-
-            tmp = Channel[oldestIndex].byteIndex + (nDelay * (Channel[oldestIndex].offsetSample));
-
-            if (tmp <= Channel[oldestIndex].nByte && Channel[i].release_position == 0){
-
-                Channel[oldestIndex].release_delay = nDelay;
-                Channel[oldestIndex].release_position = 1;
-            }
-        }
+    if (nLimit == 0){
+        return;
     }
 
+    status = IntDisable();
+
+    event.frame = ctx->EventOrigin + nDelay;
+    event.type = MIXER_EVENT_POLYPHONY;
+    event.noteID = note;
+    event.limit = nLimit;
+    postEvent(&event);
 
     IntEnable(status);
 }
@@ -651,22 +919,27 @@ void mixer_polyphonyRemove(unsigned int note, unsigned int nLimit, unsigned nDel
 
 unsigned int mixer_shouldNoteBeExcluded(unsigned int fillChokeGroup, unsigned int fillChokeId){
 
+    MIXER_context_t *ctx = Ctx;
+    MIXER_link_t *head = &ctx->FillChokeVoices[fillChokeGroup % MIXER_FILL_CHOKE_LISTS];
+    MIXER_link_t *link;
+    MIXER_channel_t *chanPtr;
     unsigned int i;
     unsigned char status = IntDisable();
-    // Scan the mixer channel array
-    for (i = 0 ; i < MIXER_MAX_CHANNEL_ARRAY; i++){
+    // Scan the voices of the fill choke group
+    for (link = head->next; link != head; link = link->next){
+        chanPtr = VOICE_OF(link, fillChokeLink);
 
         // if channel is active
-        if (Channel[i].byteIndex < Channel[i].nByte){
+        if (chanPtr->byteIndex < chanPtr->nByte){
 
             // if same fill choke group note
-            if (Channel[i].fillChokeGroup == fillChokeGroup){
+            if (chanPtr->fillChokeGroup == fillChokeGroup){
 
                 // if not the same choke id
-                if (Channel[i].fillChokePartId != fillChokeId){
+                if (chanPtr->fillChokePartId != fillChokeId){
 
                     // if the fill choke delay is not finished
-                    if (Channel[i].byteIndex < Channel[i].fillChokeDelay){
+                    if (chanPtr->byteIndex < chanPtr->fillChokeDelay){
                         IntEnable(status);
                         return 1;
                     }
@@ -674,6 +947,16 @@ unsigned int mixer_shouldNoteBeExcluded(unsigned int fillChokeGroup, unsigned in
             }
         }
     }
+
+    // A sound of another part that did not start yet is still in its fill choke delay
+    for (i = 0; i < ctx->EventCount; i++){
+        if (ctx->Events[i].type == MIXER_EVENT_START
+                && ctx->Events[i].fillChokeGroup == fillChokeGroup
+                && ctx->Events[i].fillChokePartId != fillChokeId){
+            IntEnable(status);
+            return 1;
+        }
+    }
     IntEnable(status);
     return 0;
 }
@@ -686,31 +969,53 @@ unsigned int mixer_shouldNoteBeExcluded(unsigned int fillChokeGroup, unsigned in
  **/
 void mixer_removeAll(void)
 {
-    unsigned char i;
+    MIXER_context_t *ctx = Ctx;
     unsigned char status = IntDisable();
 
-    for( i = 0; i < MIXER_MAX_CHANNEL_ARRAY; i++ ) {
-        Channel[i].nByte = 0;
+    while (ctx->ActiveVoices.next != &ctx->ActiveVoices) {
+        freeVoice(VOICE_OF(ctx->ActiveVoices.next, ageLink));
     }
+    while (ctx->FadingVoices.next != &ctx->FadingVoices) {
+        freeVoice(VOICE_OF(ctx->FadingVoices.next, ageLink));
+    }
+    ctx->EventCount = 0;
 
     /* Restart the unique id */
-    UniqueId = 0;
+    ctx->UniqueId = 0;
     IntEnable(status);
 }
 
 
 
 void mixer_removeSoundWithNote(unsigned int note){
-    int i;
+    MIXER_context_t *ctx = Ctx;
+    MIXER_link_t *head = &ctx->NoteVoices[note % MIXER_NOTE_LISTS];
+    MIXER_link_t *link;
+    MIXER_link_t *next;
+    MIXER_channel_t *chanPtr;
+    unsigned int i;
+    unsigned int n = 0;
     unsigned char status = IntDisable();
 
-    for(i = 0 ; i < MIXER_MAX_CHANNEL_ARRAY; i++){
+    for (link = head->next; link != head; link = next){
+        next = link->next;
+        chanPtr = VOICE_OF(link, noteLink);
         // Of note of the instrument is the requested note, remove the instrument
-        if (Channel[i].noteID == note){
-            quickRelease(&Channel[i]);
-            Channel[i].nByte = 0;
+        if (chanPtr->noteID == note){
+            stealVoice(chanPtr);
+        }
+    }
+
+    // The sounds of the note that did not start yet are dropped
+    for (i = 0; i < ctx->EventCount; i++){
+        if (ctx->Events[i].type != MIXER_EVENT_START || ctx->Events[i].noteID != note){
+            ctx->Events[n++] = ctx->Events[i];
         }
     }
+    if (n != ctx->EventCount){
+        ctx->EventCount = n;
+        rebuildEvents();
+    }
 
     IntEnable(status);
 }
@@ -720,46 +1025,52 @@ void mixer_removeSoundWithNote(unsigned int note){
  */
 #if !(defined(__x86_64__) || defined(_M_X64))
 void mixer_removeSoundWithAddress(unsigned int addr, unsigned int range){
-    unsigned int numOfRemovedChan = 0;
+    MIXER_context_t *ctx = Ctx;
     unsigned int lowerAddress = (unsigned int) addr;
     unsigned int upperAddress = ((unsigned int) addr) + range;
-    unsigned int i;
-
-    unsigned char status = IntDisable();
-
-    // For all the channel of the mixer
-    for (i = 0; i < MIXER_MAX_CHANNEL_ARRAY; i++){
-        if (((unsigned int)Channel[i].add >= lowerAddress) && ((unsigned int)Channel[i].add < upperAddress)) {
-            quickRelease(&Channel[i]);
-            // This action wil remove the sound from the player.
-            Channel[i].nByte = 0;
-            numOfRemovedChan++;
-
-        }
-    }
-    IntEnable(status);
-}
 #else
 void mixer_removeSoundWithAddress(uint64_t addr, unsigned int range){
-    unsigned int numOfRemovedChan = 0;
+    MIXER_context_t *ctx = Ctx;
     uint64_t lowerAddress = (uint64_t) addr;
     uint64_t upperAddress = ((uint64_t) addr) + range;
+#endif
+    MIXER_link_t *heads[2];
+    MIXER_link_t *link;
+    MIXER_link_t *next;
+    MIXER_channel_t *chanPtr;
     unsigned int i;
+    unsigned int n = 0;
 
     unsigned char status = IntDisable();
 
-    // For all the channel of the mixer
-    for (i = 0; i < MIXER_MAX_CHANNEL_ARRAY; i++){
-        if (((uint64_t)Channel[i].add >= lowerAddress) && ((uint64_t)Channel[i].add < upperAddress)) {
-            quickRelease(&Channel[i]);
-            // This action wil remove the sound from the player.
-            Channel[i].nByte = 0;
-            numOfRemovedChan++;
+    // For all the voices of the mixer, fading ones included since the samples are going away
+    heads[0] = &ctx->ActiveVoices;
+    heads[1] = &ctx->FadingVoices;
+    for (i = 0; i < 2; i++){
+        for (link = heads[i]->next; link != heads[i]; link = next){
+            next = link->next;
+            chanPtr = VOICE_OF(link, ageLink);
+            if (((uintptr_t)chanPtr->add >= lowerAddress) && ((uintptr_t)chanPtr->add < upperAddress)) {
+                // This action wil remove the sound from the player.
+                freeVoice(chanPtr);
+            }
+        }
+    }
+
+    // Same for the sounds that did not start yet
+    for (i = 0; i < ctx->EventCount; i++){
+        if (ctx->Events[i].type != MIXER_EVENT_START
+                || (uintptr_t)ctx->Events[i].add < lowerAddress
+                || (uintptr_t)ctx->Events[i].add >= upperAddress){
+            ctx->Events[n++] = ctx->Events[i];
         }
     }
+    if (n != ctx->EventCount){
+        ctx->EventCount = n;
+        rebuildEvents();
+    }
     IntEnable(status);
 }
-#endif
 
 /**
  * @brief mixer_setOutputLevel
@@ -768,7 +1079,7 @@ void mixer_removeSoundWithAddress(uint64_t addr, unsigned int range){
  * @param level Level from 0 to 1
  */
 void mixer_setOutputLevel(float level){
-    g_level = level;
+    Ctx->g_level = level;
 }
 
 /**
@@ -776,7 +1087,7 @@ void mixer_setOutputLevel(float level){
  * @return The output level of the mixer (range from 0 - 1)
  */
 float mixer_getOutputLevel(void){
-    return g_level;
+    return Ctx->g_level;
 }
 
 
@@ -784,155 +1095,356 @@ float mixer_getOutputLevel(void){
 #define PI  (3.1415926535897932384626433832795)
 
 
-static unsigned int tt = 0;
-/* Function handler of the EMPTY DMA
- */
-void mixer_ReadOutputStream(signed short * buff, unsigned int length)
+/**
+ * \brief  Mix nFrame frames of a channel in the L/R accumulators
+ *
+ *  The samples are decoded by blocks with the decoder selected when the sound
+ *  was added, then accumulated with the vectorized kernel of the selected
+ *  engine while the gain is constant (playing). The release ramp is a sample per sample loop since its gain
+ *  changes on every frame; it continues on the next blocks if needed.
+ **/
+static void mixChannel(MIXER_channel_t *chanPtr, unsigned int nFrame)
 {
+    MIXER_context_t *ctx = Ctx;
+    int32_t left[MIXER_KERNEL_BLOCK_FRAMES];
+    int32_t right[MIXER_KERNEL_BLOCK_FRAMES];
+    int32_t *rightPtr;
+    unsigned int k = 0;
+    unsigned int j;
+    unsigned int n;
+    unsigned int nConst;
+    float gain;
+
+    while (k < nFrame && chanPtr->byteIndex < chanPtr->nByte) {
+
+        // Number of frames left in the sound, limited to the block size
+        n = (unsigned int)(chanPtr->nByte - chanPtr->byteIndex + chanPtr->offsetSample - 1) / chanPtr->offsetSample;
+        if (n > nFrame - k) n = nFrame - k;
+        if (n > MIXER_KERNEL_BLOCK_FRAMES) n = MIXER_KERNEL_BLOCK_FRAMES;
+
+        // End of the ramp: the voice is silent but still counted by the polyphony,
+        // choke and fill choke operations until the end of the release time, its
+        // frames are skipped without being decoded
+        if (chanPtr->release_position >= RELEASE_RAMP_FRAMES) {
+            n = (unsigned int)(chanPtr->nByte - chanPtr->byteIndex + chanPtr->offsetSample - 1) / chanPtr->offsetSample;
+            if (n > nFrame - k) n = nFrame - k;
+            if (n > RELEASE_GAIN_LENGTH - chanPtr->release_position) n = RELEASE_GAIN_LENGTH - chanPtr->release_position;
+            chanPtr->release_position += n;
+            chanPtr->byteIndex += n * chanPtr->offsetSample;
+            k += n;
+            if (chanPtr->release_position >= RELEASE_GAIN_LENGTH) {
+                chanPtr->nByte = 0;
+            }
+            continue;
+        }
 
-    // NOTE: length is in absolute sample count (regardless of stereo/mono)
+        // Only the frames left in the release ramp are decoded
+        if (chanPtr->state != MIXER_VOICE_PLAYING && n > RELEASE_RAMP_FRAMES - chanPtr->release_position) {
+            n = RELEASE_RAMP_FRAMES - chanPtr->release_position;
+        }
+        chanPtr->decode(&chanPtr->add[chanPtr->byteIndex], left, right, n);
+        rightPtr = (chanPtr->nChannel == 2) ? right : left;
+
+        // Frames at constant gain: all of them while playing, the choke events
+        // are applied at their frame so the release starts right away
+        nConst = (chanPtr->state == MIXER_VOICE_PLAYING) ? n : 0;
+
+        if (nConst > 0) {
+            // ReleaseCoeff[0] is the unity gain
+            if (ctx->Engine == MIXER_ENGINE_FLOAT) {
+                gain = chanPtr->gain * ctx->ReleaseGain[chanPtr->release_position];
+                mixerKernel_macFloat(&ctx->L_BufferF[k], left, gain, nConst);
+                mixerKernel_macFloat(&ctx->R_BufferF[k], rightPtr, gain, nConst);
+            } else {
+                mixerKernel_mac(&ctx->L_Buffer[k], left, chanPtr->velocity * ctx->ReleaseCoeff[chanPtr->release_position], nConst);
+                mixerKernel_mac(&ctx->R_Buffer[k], rightPtr, chanPtr->velocity * ctx->ReleaseCoeff[chanPtr->release_position], nConst);
+            }
+        }
 
-    unsigned int k;
+        // Release ramp
+        for (j = nConst; j < n; j++) {
+            if (ctx->Engine == MIXER_ENGINE_FLOAT) {
+                gain = chanPtr->gain * ctx->ReleaseGain[chanPtr->release_position];
+                ctx->L_BufferF[k + j] += gain * (float)left[j];
+                ctx->R_BufferF[k + j] += gain * (float)rightPtr[j];
+            } else {
+                ctx->L_Buffer[k + j] += (int64_t)ctx->ReleaseCoeff[chanPtr->release_position] * (int64_t)chanPtr->velocity * (int64_t)left[j];
+                ctx->R_Buffer[k + j] += (int64_t)ctx->ReleaseCoeff[chanPtr->release_position] * (int64_t)chanPtr->velocity * (int64_t)rightPtr[j];
+            }
+
+            chanPtr->release_position++;
+            if (chanPtr->release_position >= RELEASE_RAMP_FRAMES){
+                j++;
+                break;
+            }
+        }
+
+        chanPtr->byteIndex += j * chanPtr->offsetSample;
+        k += j;
+
+        // A stolen voice ends with its ramp, it is freed at the end of the block
+        if (chanPtr->state == MIXER_VOICE_STOLEN && chanPtr->release_position >= RELEASE_RAMP_FRAMES) {
+            chanPtr->nByte = 0;
+        }
+    }
+}
+
+
+/**
+ * \brief  Render one block of at most MIXER_RENDER_BLOCK_FRAMES frames
+ *         in the L/R accumulators and write it in the output buffer
+ **/
+static void renderBlock(unsigned char * buff, unsigned int nFrame)
+{
+    MIXER_context_t *ctx = Ctx;
     unsigned int i;
+    MIXER_link_t *link;
+    MIXER_link_t *next;
     MIXER_channel_t *chanPtr;
-    long tmp;
-
-    memset(R_Buffer,0,sizeof(R_Buffer));
-    memset(L_Buffer,0,sizeof(L_Buffer));
 
-    unsigned char status = IntDisable();
+    // Only clear the part of the accumulators that is used by this block
+    if (ctx->Engine == MIXER_ENGINE_FLOAT) {
+        memset(ctx->R_BufferF, 0, nFrame * sizeof(ctx->R_BufferF[0]));
+        memset(ctx->L_BufferF, 0, nFrame * sizeof(ctx->L_BufferF[0]));
+    } else {
+        memset(ctx->R_Buffer, 0, nFrame * sizeof(ctx->R_Buffer[0]));
+        memset(ctx->L_Buffer, 0, nFrame * sizeof(ctx->L_Buffer[0]));
+    }
 
     /* For production only  ( the inversion is normal) */
     if (gLeftFreq | gRightFreq){
-        for ( i = 0; i < MIXER_BUFFER_LENGTH; i++ ) {
+        for ( i = 0; i < nFrame; i++ ) {
             if (gLeftFreq){
-                R_Buffer[i] =   (signed long long) (800000000.0 * cos( 2.0 * PI *  gLeftFreq *(double)tt/44100.0));
-            } else {
-                R_Buffer[i] = 0;
+                ctx->R_Buffer[i] =   (signed long long) (800000000.0 * cos( 2.0 * PI *  gLeftFreq *(double)ctx->tt/44100.0));
+                ctx->R_BufferF[i] =  (float)(ctx->R_Buffer[i] / ((double)MASTER_DIVIDER * FLOAT_FULL_SCALE));
             }
             if (gRightFreq){
-                L_Buffer[i] =   (signed long long) (800000000.0 * cos( 2.0 * PI * gRightFreq *(double)tt/44100.0));
-            } else {
-                L_Buffer[i] = 0;
+                ctx->L_Buffer[i] =   (signed long long) (800000000.0 * cos( 2.0 * PI * gRightFreq *(double)ctx->tt/44100.0));
+                ctx->L_BufferF[i] =  (float)(ctx->L_Buffer[i] / ((double)MASTER_DIVIDER * FLOAT_FULL_SCALE));
             }
-            tt = (tt + 1) % 44100;
+            ctx->tt = (ctx->tt + 1) % 44100;
         }
     } else {
-        /* For each channel present in the mixer */
-        for ( i = 0; i < MIXER_MAX_CHANNEL_ARRAY; i++ ) {
-            chanPtr = &Channel[i];
-            k = 0;
-
-            while(k<(length/2)){
-                if (chanPtr->byteIndex < chanPtr->nByte){
-                    if (chanPtr->byteIndex >= 0){
-
-                        /* The calculation id based on 4 step:
-                         * #1 - Read 4 byte ( they can be unaligned since the increment between sample is not  always 4)
-                         * #2 - Type cast those byte into an integer
-                         * #3 - Mask the integer to get the important values
-                         * #4 - Bit shift left and bit shift right for sign extension. Typecast the result into a 64 bits
-                         * #5 - Multiply the result with the gain
-						 * #6 - Multiply with the release gain value
-                         */
-						 
-                        L_Buffer[k]  +=  (int64_t)ReleaseCoeff[chanPtr->release_position] * (int64_t)GET_SAMPLE_VALUE(chanPtr);
-                        NEXT_RIGHT_SAMPLE(chanPtr);
-
-                        R_Buffer[k]  +=  (int64_t)ReleaseCoeff[chanPtr->release_position] * (int64_t)GET_SAMPLE_VALUE(chanPtr);
-                        NEXT_LEFT_SAMPLE(chanPtr);
-
-                        // Decrement release delay if it is set
-                        if (chanPtr->release_position) {
-                            if (chanPtr->release_delay){
-                                chanPtr->release_delay--;
-                            } else {
-                                chanPtr->release_position++;
-                                if (chanPtr->release_position >= ReleaseLength){
-                                    chanPtr->nByte = 0;
-                                }
-                            }
-                        }
-
-                    } else {
-                        chanPtr->byteIndex += chanPtr->offsetSample;
-                    }
-                    k++;
-                } else {
-                    break;
-                }
+        /* For each voice playing or fading in the mixer, finished voices go back to the pool */
+        for ( link = ctx->ActiveVoices.next; link != &ctx->ActiveVoices; link = next ) {
+            next = link->next;
+            chanPtr = VOICE_OF(link, ageLink);
+            mixChannel(chanPtr, nFrame);
+            if (chanPtr->byteIndex >= chanPtr->nByte) {
+                freeVoice(chanPtr);
             }
         }
+        for ( link = ctx->FadingVoices.next; link != &ctx->FadingVoices; link = next ) {
+            next = link->next;
+            chanPtr = VOICE_OF(link, ageLink);
+            mixChannel(chanPtr, nFrame);
+            if (chanPtr->byteIndex >= chanPtr->nByte) {
+                freeVoice(chanPtr);
+            }
+        }
+    }
+
+    if (ctx->Engine == MIXER_ENGINE_FLOAT) {
+        writeOutputFloat(buff, nFrame);
+    } else {
+        writeOutput(buff, nFrame);
+    }
+}
+
+/**
+ * \brief  Store one integer output sample given at the 24 bits scale
+ *         and return the address of the next one
+ **/
+static inline unsigned char *storePCM(unsigned char *buff, int value, MIXER_outputFormat_t format)
+{
+    if (format == MIXER_OUTPUT_PCM24) {
+        buff[0] = (unsigned char)value;
+        buff[1] = (unsigned char)(value >> 8);
+        buff[2] = (unsigned char)(value >> 16);
+        return buff + 3;
     }
 
-    k = 0;
-    i = 0;
+    value >>= 8;
+    buff[0] = (unsigned char)value;
+    buff[1] = (unsigned char)(value >> 8);
+    return buff + 2;
+}
 
-    while(k < length){
-        // LEFT HARD CLIP
-        tmp = (L_Buffer[i]/MASTER_DIVIDER);
+static inline unsigned char *storeFloat(unsigned char *buff, float value)
+{
+    memcpy(buff, &value, sizeof(float));
+    return buff + sizeof(float);
+}
 
-        tmp = tmp > MAX_VALUE ? MAX_VALUE : tmp;
-        tmp = tmp < MIN_VALUE ? MIN_VALUE : tmp;
-        buff[k++] = ((int)(g_level * (float)tmp)) >> 8;
+/**
+ * \brief  Output stage of the int64 engine : hard clip at 24 bits then apply the output level
+ **/
+static void writeOutput(unsigned char *buff, unsigned int nFrame)
+{
+    MIXER_context_t *ctx = Ctx;
+    unsigned int i;
+    unsigned int k;
+    long tmp;
+    float value;
+    int64_t *acc[2];
 
-        // RIGHT HARD CLIP
-        tmp = (R_Buffer[i++]/MASTER_DIVIDER);
+    acc[0] = ctx->L_Buffer;
+    acc[1] = ctx->R_Buffer;
 
-        tmp = tmp > MAX_VALUE ? MAX_VALUE : tmp;
-        tmp = tmp < MIN_VALUE ? MIN_VALUE : tmp;
-        buff[k++] = ((int)(g_level * (float)tmp)) >> 8;
-    }
-    IntEnable(status);
+    for ( i = 0; i < nFrame; i++ ) {
+        for ( k = 0; k < 2; k++ ) {
+            // HARD CLIP (left then right)
+            tmp = (acc[k][i]/MASTER_DIVIDER);
 
+            tmp = tmp > MAX_VALUE ? MAX_VALUE : tmp;
+            tmp = tmp < MIN_VALUE ? MIN_VALUE : tmp;
+            value = ctx->g_level * (float)tmp;
+            if (fabsf(value) > ctx->g_peak) ctx->g_peak = fabsf(value);
+
+            if (ctx->OutputFormat == MIXER_OUTPUT_FLOAT) {
+                buff = storeFloat(buff, value / FLOAT_FULL_SCALE);
+            } else {
+                buff = storePCM(buff, (int)value, ctx->OutputFormat);
+            }
+        }
+    }
 }
 
-static inline void quickRelease(MIXER_channel_t *chanPtr) {
+/**
+ * \brief  Output stage of the float engine
+ *
+ *  The output level is applied before clipping so that the headroom of the
+ *  accumulators is used. Float output is not clipped at all, integer outputs
+ *  are rounded and clipped at their own full scale.
+ **/
+static void writeOutputFloat(unsigned char *buff, unsigned int nFrame)
+{
+    MIXER_context_t *ctx = Ctx;
+    unsigned int i;
+    unsigned int k;
+    float value;
+    float *acc[2];
 
-    int k = 0;
+    acc[0] = ctx->L_BufferF;
+    acc[1] = ctx->R_BufferF;
 
-    while(k<(BUFFER_LENGTH/2)){
-        if (chanPtr->byteIndex < chanPtr->nByte){
-            if (chanPtr->byteIndex >= 0){
-
-                /* The calculation id based on 4 step:
-                 * #1 - Read 4 byte ( they can be unaligned since the increment between sample is not  always 4)
-                 * #2 - Type cast those byte into an integer
-                 * #3 - Mask the integer to get the important values
-                 * #4 - Bit shift left and bit shift right for sign extension. Typecast the result into a 64 bits
-                 * #5 - Multiply the result with the gain
-                 * #6 - Multiply with the release gain value
-                 */
-                L_Buffer[k]  +=  ((int64_t)((BUFFER_LENGTH/2) - k)) * (int64_t)ReleaseCoeff[chanPtr->release_position] * (int64_t) GET_SAMPLE_VALUE(chanPtr) / (int64_t)(BUFFER_LENGTH/2);
-                NEXT_RIGHT_SAMPLE(chanPtr);
-
-                R_Buffer[k]  +=  ((int64_t)((BUFFER_LENGTH/2) - k)) * (int64_t)ReleaseCoeff[chanPtr->release_position] * (int64_t) GET_SAMPLE_VALUE(chanPtr) / (int64_t)(BUFFER_LENGTH/2);
-                NEXT_LEFT_SAMPLE(chanPtr);
-
-
-                // Decrement release delay if it is set
-                if (!chanPtr->release_delay){
-                    chanPtr->release_delay--;
-                } else {
-
-                    // when the release delay equal 0, if the release position exist, advance in the release array
-                    if (chanPtr->release_position){
-                        chanPtr->release_position++;
-                        if (chanPtr->release_position >= ReleaseLength){
-                            chanPtr->nByte = 0;
-                        }
-                    }
-                }
+    for ( i = 0; i < nFrame; i++ ) {
+        for ( k = 0; k < 2; k++ ) {
+            value = ctx->g_level * acc[k][i];
+            if (fabsf(value) > ctx->g_peak) ctx->g_peak = fabsf(value);
+
+            if (ctx->OutputFormat == MIXER_OUTPUT_FLOAT) {
+                buff = storeFloat(buff, value);
+                continue;
+            }
+
+            value = value > FLOAT_MAX_VALUE ? FLOAT_MAX_VALUE : value;
+            value = value < FLOAT_MIN_VALUE ? FLOAT_MIN_VALUE : value;
+
+            if (ctx->OutputFormat == MIXER_OUTPUT_PCM24) {
+                buff = storePCM(buff, (int)lrintf(value * 8388607.0f), MIXER_OUTPUT_PCM24);
             } else {
-                chanPtr->byteIndex += chanPtr->offsetSample;
+                buff = storePCM(buff, (int)lrintf(value * 32767.0f) * 256, MIXER_OUTPUT_PCM16);
             }
-            k++;
-        } else {
-            break;
         }
     }
 }
 
+/* Function handler of the EMPTY DMA
+ */
+void mixer_ReadOutputStream(void * buff, unsigned int length)
+{
+
+    // NOTE: length is in absolute sample count (regardless of stereo/mono)
+
+    MIXER_context_t *ctx = Ctx;
+    unsigned int nFrame = length / 2;
+    unsigned int n;
+    unsigned int frameSize = mixer_getBytesPerFrame();
+    unsigned char *out = (unsigned char *)buff;
+
+    unsigned char status = IntDisable();
+
+    ctx->g_peak = 0.0f;
+
+    // Long requests are rendered by blocks so that the accumulators stay in cache.
+    // A block also ends at the frame of the next event so that voices start on time.
+    while (nFrame > 0) {
+        applyDueEvents();
+
+        n = (nFrame > MIXER_RENDER_BLOCK_FRAMES) ? MIXER_RENDER_BLOCK_FRAMES : nFrame;
+        if (ctx->EventCount > 0 && ctx->Events[0].frame - ctx->Clock < n) {
+            n = (unsigned int)(ctx->Events[0].frame - ctx->Clock);
+        }
+
+        renderBlock(out, n);
+        ctx->Clock += n;
+        out += frameSize * n;
+        nFrame -= n;
+    }
+
+    // Peak was measured at the 24 bits scale in the int64 engine
+    if (ctx->Engine == MIXER_ENGINE_INT64) {
+        ctx->g_peak /= FLOAT_FULL_SCALE;
+    }
+
+    IntEnable(status);
+
+}
+
+/**
+ * @brief mixer_getOutputPeak
+ * @return Peak absolute value of the last call to mixer_ReadOutputStream, 1.0 being the full scale
+ *         (independent of the output format)
+ */
+float mixer_getOutputPeak(void){
+    return Ctx->g_peak;
+}
+
+/**
+ * @brief mixer_setEngine
+ *       Select the accumulation of the mixer. Sounds that are playing keep playing
+ *       since every channel holds the gain of both engines.
+ */
+void mixer_setEngine(MIXER_engine_t engine){
+    MIXER_context_t *ctx = Ctx;
+    unsigned char status = IntDisable();
+    ctx->Engine = engine;
+    IntEnable(status);
+}
+
+MIXER_engine_t mixer_getEngine(void){
+    return Ctx->Engine;
+}
+
+/**
+ * @brief mixer_setOutputFormat
+ *       Select the format of the samples written by mixer_ReadOutputStream. The output is always stereo.
+ */
+void mixer_setOutputFormat(MIXER_outputFormat_t format){
+    MIXER_context_t *ctx = Ctx;
+    unsigned char status = IntDisable();
+    ctx->OutputFormat = format;
+    IntEnable(status);
+}
+
+MIXER_outputFormat_t mixer_getOutputFormat(void){
+    return Ctx->OutputFormat;
+}
+
+/**
+ * @brief mixer_getBytesPerFrame
+ * @return Number of bytes of a stereo frame in the selected output format
+ */
+unsigned int mixer_getBytesPerFrame(void){
+    MIXER_context_t *ctx = Ctx;
+    switch (ctx->OutputFormat) {
+    case MIXER_OUTPUT_FLOAT: return 8;
+    case MIXER_OUTPUT_PCM24: return 6;
+    case MIXER_OUTPUT_PCM16:
+    default:                 return 4;
+    }
+}
 
 #ifdef __cplusplus
 }
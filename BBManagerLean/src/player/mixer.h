@@ -25,6 +25,42 @@ extern "C" {
 #    define MIXER_BUFFERRING_TIME_MS_TO_BYTES_STEREO(time)  (MIXER_BUFFERRING_TIME_MS_TO_SMAPLES(time) * MIXER_BYTES_PER_SAMPLE_STEREO)
 #    define MIXER_BUFFER_LENGTH_BYTES_MONO                  (MIXER_BUFFER_LENGTH_SAMPLES * MIXER_BYTES_PER_SAMPLE_MONO)
 #    define MIXER_BUFFER_LENGTH_BYTES_STEREO                (MIXER_BUFFER_LENGTH_SAMPLES * MIXER_BYTES_PER_SAMPLE_STEREO)
+// Largest stereo frame of the supported output formats (2 x 32 bits float)
+#    define MIXER_MAX_BYTES_PER_FRAME                       (8)
+#    define MIXER_BUFFER_LENGTH_BYTES_MAX                   (MIXER_BUFFER_LENGTH_SAMPLES * MIXER_MAX_BYTES_PER_FRAME)
+
+// Number of voices played at once before the oldest is stolen (see mixer_setPolyphony)
+#    define MIXER_DEFAULT_POLYPHONY                         (128)
+#    define MIXER_MAX_POLYPHONY                             (256)
+
+
+/*****************************************************************************
+ **                     TYPEDEF
+ *****************************************************************************/
+typedef enum {
+    MIXER_ENGINE_INT64,         // 64 bits integer accumulation, hard clip at 24 bits
+    MIXER_ENGINE_FLOAT          // 32 bits float accumulation, clipped by the output stage only
+} MIXER_engine_t;
+
+typedef enum {
+    MIXER_OUTPUT_PCM16,         // Signed 16 bits, little endian
+    MIXER_OUTPUT_PCM24,         // Signed 24 bits packed on 3 bytes, little endian
+    MIXER_OUTPUT_FLOAT          // 32 bits float, full scale at 1.0
+} MIXER_outputFormat_t;
+
+// Format of the samples of a voice, obtained with mixer_getFormat()
+typedef struct MIXER_format_s MIXER_format_t;
+
+// Instance of the mixer, see mixer_setContext()
+typedef struct MIXER_context_s MIXER_context_t;
+
+// Use of the voices since mixer_init(), see mixer_getVoiceStats()
+typedef struct {
+    unsigned int active;        // Voices playing now, not counting the stolen ones fading out
+    unsigned int peak;          // Most voices played at once
+    unsigned int stolen;        // Voices faded out because the polyphony was reached
+    unsigned int cut;           // Voices cut without fade because no slot was left to fade
+} MIXER_voiceStats_t;
 
 
 /*****************************************************************************
@@ -32,26 +68,22 @@ extern "C" {
  *****************************************************************************/
 void mixer_init(void);
 
+// Every function of the mixer works on the context of the calling thread
+MIXER_context_t *mixer_createContext(void);
+void mixer_destroyContext(MIXER_context_t *context);
+MIXER_context_t *mixer_setContext(MIXER_context_t *context);
+MIXER_context_t *mixer_getContext(void);
+
 void mixer_task(void);
 
-#if !(defined(__x86_64__) || defined(_M_X64))
-unsigned int mixer_addPCM16Stereo(unsigned int startAddress,
-#else
-unsigned int mixer_addPCM16Stereo(uint64_t  startAddress,
-#endif
-        unsigned int nSample,
-        unsigned int vol,
-        unsigned int nDelay,
-        unsigned int chokeID,
-        unsigned int noteID,
-        unsigned int fillChokeGroup,
-        unsigned int fillChokeDelay,
-        unsigned int fillChokeId);
+const MIXER_format_t *mixer_getFormat(unsigned int bitsPerSample, unsigned int nChannel);
 
 #if !(defined(__x86_64__) || defined(_M_X64))
-unsigned int mixer_addPCM24Stereo(unsigned int  startAddress,
+unsigned int mixer_addVoice(const MIXER_format_t *format,
+        unsigned int startAddress,
 #else
-unsigned int mixer_addPCM24Stereo(uint64_t  startAddress,
+unsigned int mixer_addVoice(const MIXER_format_t *format,
+        uint64_t startAddress,
 #endif
         unsigned int nSample,
         unsigned int vol,
@@ -62,33 +94,10 @@ unsigned int mixer_addPCM24Stereo(uint64_t  startAddress,
         unsigned int fillChokeDelay,
         unsigned int fillChokeId);
 
-#if !(defined(__x86_64__) || defined(_M_X64))
-unsigned int mixer_addPCM24Mono(unsigned int startAddress,
-#else
-unsigned int mixer_addPCM24Mono(uint64_t  startAddress,
-#endif
-        unsigned int nSample,
-        unsigned int vol,
-        unsigned int nDelay,
-        unsigned int chokeID,
-        unsigned int noteID,
-        unsigned int fillChokeGroup,
-        unsigned int fillChokeDelay,
-        unsigned int fillChokeId);
-
-#if !(defined(__x86_64__) || defined(_M_X64))
-unsigned int mixer_addPCM16Mono(unsigned int startAddress,
-#else
-unsigned int mixer_addPCM16Mono(uint64_t  startAddress,
-#endif
-        unsigned int nSample,
-        unsigned int vol,
-        unsigned int nDelay,
-        unsigned int chokeID,
-        unsigned int noteID,
-        unsigned int fillChokeGroup,
-        unsigned int fillChokeDelay,
-        unsigned int fillChokeId);
+void mixer_setPolyphony(unsigned int nVoice);
+unsigned int mixer_getPolyphony(void);
+void mixer_getVoiceStats(MIXER_voiceStats_t *stats);
+int mixer_isPlayingBefore(uint64_t frame);
 
 #if !(defined(__x86_64__) || defined(_M_X64))
 void mixer_removeSoundWithAddress(unsigned int addr, unsigned int range);
@@ -107,11 +116,21 @@ unsigned int mixer_shouldNoteBeExcluded(unsigned int fillChokeGroup, unsigned in
 void mixer_removeAll(void);
 
 void mixer_chokeChannel(unsigned int groupId,unsigned int array_offset);
-void mixer_chokeNote(unsigned int note);
+void mixer_chokeNote(unsigned int note, unsigned int nDelay);
+
+// Delays given to the mixer are in frames from the event origin, see mixer_setEventOrigin
+void mixer_setEventOrigin(uint64_t frame);
+uint64_t mixer_getClock(void);
 
 float mixer_getOutputLevel(void);
 void mixer_setOutputLevel(float level);
-void mixer_ReadOutputStream(signed short * buff, unsigned int length);
+void mixer_ReadOutputStream(void * buff, unsigned int length);
+float mixer_getOutputPeak(void);
+void mixer_setEngine(MIXER_engine_t engine);
+MIXER_engine_t mixer_getEngine(void);
+void mixer_setOutputFormat(MIXER_outputFormat_t format);
+MIXER_outputFormat_t mixer_getOutputFormat(void);
+unsigned int mixer_getBytesPerFrame(void);
 void mixer_setDitheringBits(int ditheringBits);
 
 void mixer_setLeftFreq(unsigned int freq);
@@ -0,0 +1,341 @@
+/*
+  	This software and the content provided for use with it is Copyright © 2014-2020 Singular Sound 
+ 	BeatBuddy Manager is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2 as published by
+    the Free Software Foundation.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "mixerKernels.h"
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#    define MIXER_KERNEL_SSE2
+#    include <emmintrin.h>
+#    if defined(_MSC_VER)
+#        include <intrin.h>
+#        include <immintrin.h>
+#        define MIXER_KERNEL_AVX2
+#        define AVX2_TARGET
+#    elif defined(__GNUC__) || defined(__clang__)
+#        include <immintrin.h>
+#        define MIXER_KERNEL_AVX2
+#        define AVX2_TARGET __attribute__((target("avx2")))
+#    endif
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ **                         INTERNAL MACROS
+ ******************************************************************************/
+
+// Sample is placed so that its MSB reaches bit 23 (same scale for 16 and 24 bits)
+#define READ_PCM16(p)   ((int32_t)(int16_t)((p)[0] | ((p)[1] << 8)) * 256)
+#define READ_PCM24(p)   (((int32_t)((uint32_t)((p)[0] | ((p)[1] << 8) | ((p)[2] << 16)) << 8)) >> 8)
+
+/******************************************************************************
+ **                     INTERNAL FUNCTION PROTOTYPE
+ ******************************************************************************/
+
+static void macScalar(int64_t *acc, const int32_t *src, int32_t gain, unsigned int nFrame);
+static void macFloatScalar(float *acc, const int32_t *src, float gain, unsigned int nFrame);
+static float dotFloatScalar(const float *a, const float *b, unsigned int n);
+#ifdef MIXER_KERNEL_SSE2
+static void macSse2(int64_t *acc, const int32_t *src, int32_t gain, unsigned int nFrame);
+static void macFloatSse2(float *acc, const int32_t *src, float gain, unsigned int nFrame);
+static float dotFloatSse2(const float *a, const float *b, unsigned int n);
+#endif
+#ifdef MIXER_KERNEL_AVX2
+static void macAvx2(int64_t *acc, const int32_t *src, int32_t gain, unsigned int nFrame);
+static void macFloatAvx2(float *acc, const int32_t *src, float gain, unsigned int nFrame);
+static float dotFloatAvx2(const float *a, const float *b, unsigned int n);
+#endif
+
+/******************************************************************************
+ **                     GLOBAL VARIABLE
+ ******************************************************************************/
+
+MIXER_macFunc_t mixerKernel_mac = macScalar;
+MIXER_macFloatFunc_t mixerKernel_macFloat = macFloatScalar;
+MIXER_dotFloatFunc_t mixerKernel_dotFloat = dotFloatScalar;
+
+/******************************************************************************
+ **              FUNCTION DEFINITIONS
+ ******************************************************************************/
+
+#ifdef MIXER_KERNEL_AVX2
+static int cpuHasAvx2(void)
+{
+#if defined(_MSC_VER)
+    int info[4];
+
+    __cpuid(info, 0);
+    if (info[0] < 7) return 0;
+
+    // AVX registers must be saved by the OS (OSXSAVE + AVX + XCR0)
+    __cpuid(info, 1);
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0) return 0;
+    if ((_xgetbv(0) & 6) != 6) return 0;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+/**
+ * \brief Select the best kernels for the CPU running the application.
+ *        The selection is the same for every mixer instance, the pointers are only
+ *        written the first time so that other threads can keep mixing meanwhile.
+ */
+void mixerKernel_init(void)
+{
+    MIXER_macFunc_t mac;
+    MIXER_macFloatFunc_t macFloat;
+    MIXER_dotFloatFunc_t dotFloat;
+
+#if defined(MIXER_KERNEL_AVX2)
+    int avx2 = cpuHasAvx2();
+    mac = avx2 ? macAvx2 : macSse2;
+    macFloat = avx2 ? macFloatAvx2 : macFloatSse2;
+    dotFloat = avx2 ? dotFloatAvx2 : dotFloatSse2;
+#elif defined(MIXER_KERNEL_SSE2)
+    mac = macSse2;
+    macFloat = macFloatSse2;
+    dotFloat = dotFloatSse2;
+#else
+    mac = macScalar;
+    macFloat = macFloatScalar;
+    dotFloat = dotFloatScalar;
+#endif
+
+    if (mixerKernel_mac != mac) mixerKernel_mac = mac;
+    if (mixerKernel_macFloat != macFloat) mixerKernel_macFloat = macFloat;
+    if (mixerKernel_dotFloat != dotFloat) mixerKernel_dotFloat = dotFloat;
+}
+
+void mixerKernel_decodePCM16Stereo(const unsigned char *src, int32_t *left, int32_t *right, unsigned int nFrame)
+{
+    unsigned int i = 0;
+
+#ifdef MIXER_KERNEL_SSE2
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; i + 4 <= nFrame; i += 4) {
+        // L0 R0 L1 R1 L2 R2 L3 R3
+        __m128i x  = _mm_loadu_si128((const __m128i *)(src + 4 * i));
+
+        // Put the 16 bits in the MSB then sign extend to 24 bits
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(zero, x), 8);    // L0 R0 L1 R1
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(zero, x), 8);    // L2 R2 L3 R3
+
+        lo = _mm_shuffle_epi32(lo, _MM_SHUFFLE(3, 1, 2, 0));            // L0 L1 R0 R1
+        hi = _mm_shuffle_epi32(hi, _MM_SHUFFLE(3, 1, 2, 0));            // L2 L3 R2 R3
+
+        _mm_storeu_si128((__m128i *)(left + i),  _mm_unpacklo_epi64(lo, hi));
+        _mm_storeu_si128((__m128i *)(right + i), _mm_unpackhi_epi64(lo, hi));
+    }
+#endif
+
+    for (; i < nFrame; i++) {
+        left[i]  = READ_PCM16(src + 4 * i);
+        right[i] = READ_PCM16(src + 4 * i + 2);
+    }
+}
+
+void mixerKernel_decodePCM16Mono(const unsigned char *src, int32_t *left, int32_t *right, unsigned int nFrame)
+{
+    unsigned int i = 0;
+    (void)right;
+
+#ifdef MIXER_KERNEL_SSE2
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; i + 8 <= nFrame; i += 8) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(src + 2 * i));
+
+        _mm_storeu_si128((__m128i *)(left + i),     _mm_srai_epi32(_mm_unpacklo_epi16(zero, x), 8));
+        _mm_storeu_si128((__m128i *)(left + i + 4), _mm_srai_epi32(_mm_unpackhi_epi16(zero, x), 8));
+    }
+#endif
+
+    for (; i < nFrame; i++) {
+        left[i] = READ_PCM16(src + 2 * i);
+    }
+}
+
+// Packed 24 bits samples do not map well on SIMD registers, the byte
+// gathering is left to the compiler. The accumulation is vectorized.
+void mixerKernel_decodePCM24Stereo(const unsigned char *src, int32_t *left, int32_t *right, unsigned int nFrame)
+{
+    unsigned int i;
+
+    for (i = 0; i < nFrame; i++) {
+        left[i]  = READ_PCM24(src + 6 * i);
+        right[i] = READ_PCM24(src + 6 * i + 3);
+    }
+}
+
+void mixerKernel_decodePCM24Mono(const unsigned char *src, int32_t *left, int32_t *right, unsigned int nFrame)
+{
+    unsigned int i;
+    (void)right;
+
+    for (i = 0; i < nFrame; i++) {
+        left[i] = READ_PCM24(src + 3 * i);
+    }
+}
+
+static void macScalar(int64_t *acc, const int32_t *src, int32_t gain, unsigned int nFrame)
+{
+    unsigned int i;
+
+    for (i = 0; i < nFrame; i++) {
+        acc[i] += (int64_t)gain * (int64_t)src[i];
+    }
+}
+
+static void macFloatScalar(float *acc, const int32_t *src, float gain, unsigned int nFrame)
+{
+    unsigned int i;
+
+    for (i = 0; i < nFrame; i++) {
+        acc[i] += gain * (float)src[i];
+    }
+}
+
+static float dotFloatScalar(const float *a, const float *b, unsigned int n)
+{
+    unsigned int i;
+    float sum = 0.0f;
+
+    for (i = 0; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+#ifdef MIXER_KERNEL_SSE2
+/*
+ * Signed 32 x 32 -> 64 bits multiplication of lanes 0 and 2.
+ * SSE2 only provides the unsigned one: a negative a is seen as a + 2^32,
+ * so gain << 32 is removed from those products (gain is always positive).
+ */
+static inline __m128i mulEvenSse2(__m128i a, __m128i gain)
+{
+    __m128i product = _mm_mul_epu32(a, gain);
+    __m128i fix = _mm_and_si128(_mm_and_si128(_mm_srai_epi32(a, 31), gain), _mm_set_epi32(0, -1, 0, -1));
+    return _mm_sub_epi64(product, _mm_slli_epi64(fix, 32));
+}
+
+static void macSse2(int64_t *acc, const int32_t *src, int32_t gain, unsigned int nFrame)
+{
+    unsigned int i = 0;
+    const __m128i g = _mm_set1_epi32(gain);
+
+    for (; i + 4 <= nFrame; i += 4) {
+        __m128i a   = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i p02 = mulEvenSse2(a, g);
+        __m128i p13 = mulEvenSse2(_mm_srli_epi64(a, 32), g);
+        __m128i *dst = (__m128i *)(acc + i);
+
+        _mm_storeu_si128(dst,     _mm_add_epi64(_mm_loadu_si128(dst),     _mm_unpacklo_epi64(p02, p13)));
+        _mm_storeu_si128(dst + 1, _mm_add_epi64(_mm_loadu_si128(dst + 1), _mm_unpackhi_epi64(p02, p13)));
+    }
+
+    macScalar(acc + i, src + i, gain, nFrame - i);
+}
+
+static void macFloatSse2(float *acc, const int32_t *src, float gain, unsigned int nFrame)
+{
+    unsigned int i = 0;
+    const __m128 g = _mm_set1_ps(gain);
+
+    for (; i + 4 <= nFrame; i += 4) {
+        __m128 a = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(src + i)));
+        _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(a, g)));
+    }
+
+    macFloatScalar(acc + i, src + i, gain, nFrame - i);
+}
+
+static float dotFloatSse2(const float *a, const float *b, unsigned int n)
+{
+    unsigned int i = 0;
+    __m128 sum = _mm_setzero_ps();
+    float lanes[4];
+
+    for (; i + 4 <= n; i += 4) {
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+    _mm_storeu_ps(lanes, sum);
+
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + dotFloatScalar(a + i, b + i, n - i);
+}
+#endif
+
+#ifdef MIXER_KERNEL_AVX2
+AVX2_TARGET static void macAvx2(int64_t *acc, const int32_t *src, int32_t gain, unsigned int nFrame)
+{
+    unsigned int i = 0;
+    const __m256i g = _mm256_set1_epi32(gain);
+
+    for (; i + 8 <= nFrame; i += 8) {
+        __m256i a    = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i even = _mm256_mul_epi32(a, g);                          // p0 p2 | p4 p6
+        __m256i odd  = _mm256_mul_epi32(_mm256_srli_epi64(a, 32), g);   // p1 p3 | p5 p7
+        __m256i lo   = _mm256_unpacklo_epi64(even, odd);                // p0 p1 | p4 p5
+        __m256i hi   = _mm256_unpackhi_epi64(even, odd);                // p2 p3 | p6 p7
+        __m256i *dst = (__m256i *)(acc + i);
+
+        _mm256_storeu_si256(dst,     _mm256_add_epi64(_mm256_loadu_si256(dst),     _mm256_permute2x128_si256(lo, hi, 0x20)));
+        _mm256_storeu_si256(dst + 1, _mm256_add_epi64(_mm256_loadu_si256(dst + 1), _mm256_permute2x128_si256(lo, hi, 0x31)));
+    }
+
+    macScalar(acc + i, src + i, gain, nFrame - i);
+}
+
+AVX2_TARGET static void macFloatAvx2(float *acc, const int32_t *src, float gain, unsigned int nFrame)
+{
+    unsigned int i = 0;
+    const __m256 g = _mm256_set1_ps(gain);
+
+    for (; i + 8 <= nFrame; i += 8) {
+        __m256 a = _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i *)(src + i)));
+        _mm256_storeu_ps(acc + i, _mm256_add_ps(_mm256_loadu_ps(acc + i), _mm256_mul_ps(a, g)));
+    }
+
+    macFloatScalar(acc + i, src + i, gain, nFrame - i);
+}
+
+AVX2_TARGET static float dotFloatAvx2(const float *a, const float *b, unsigned int n)
+{
+    unsigned int i = 0;
+    __m256 sum = _mm256_setzero_ps();
+    float lanes[8];
+
+    for (; i + 8 <= n; i += 8) {
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    }
+    _mm256_storeu_ps(lanes, sum);
+
+    return ((lanes[0] + lanes[4]) + (lanes[1] + lanes[5])) + ((lanes[2] + lanes[6]) + (lanes[3] + lanes[7]))
+           + dotFloatScalar(a + i, b + i, n - i);
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,62 @@
+#ifndef MIXERKERNELS_H_
+#define MIXERKERNELS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/*****************************************************************************
+ **                     DEFINES
+ *****************************************************************************/
+// Number of frames decoded at once for a channel. Keeps the temporary
+// buffers of the mixing loop small enough to stay in L1 cache.
+#    define MIXER_KERNEL_BLOCK_FRAMES                       (256u)
+
+/*****************************************************************************
+ **                     TYPEDEF
+ *****************************************************************************/
+
+/*
+ * Decode nFrame frames of packed PCM into 24 bits aligned integers.
+ * Mono decoders only fill the left array.
+ */
+typedef void (*MIXER_decodeFunc_t)(const unsigned char *src, int32_t *left, int32_t *right, unsigned int nFrame);
+
+/*
+ * Accumulate gain * src[i] into acc[i] for nFrame frames.
+ * gain must be positive and fit in 31 bits.
+ */
+typedef void (*MIXER_macFunc_t)(int64_t *acc, const int32_t *src, int32_t gain, unsigned int nFrame);
+
+/*
+ * Accumulate gain * src[i] into acc[i] for nFrame frames (float engine).
+ */
+typedef void (*MIXER_macFloatFunc_t)(float *acc, const int32_t *src, float gain, unsigned int nFrame);
+
+/*
+ * Sum of a[i] * b[i] for n values (filters of the resampler).
+ */
+typedef float (*MIXER_dotFloatFunc_t)(const float *a, const float *b, unsigned int n);
+
+/*****************************************************************************
+ **                     FUNCTION PROTOTYPES
+ *****************************************************************************/
+void mixerKernel_init(void);
+
+void mixerKernel_decodePCM16Stereo(const unsigned char *src, int32_t *left, int32_t *right, unsigned int nFrame);
+void mixerKernel_decodePCM16Mono(const unsigned char *src, int32_t *left, int32_t *right, unsigned int nFrame);
+void mixerKernel_decodePCM24Stereo(const unsigned char *src, int32_t *left, int32_t *right, unsigned int nFrame);
+void mixerKernel_decodePCM24Mono(const unsigned char *src, int32_t *left, int32_t *right, unsigned int nFrame);
+
+// Selected by mixerKernel_init() according to the instruction set of the CPU
+extern MIXER_macFunc_t mixerKernel_mac;
+extern MIXER_macFloatFunc_t mixerKernel_macFloat;
+extern MIXER_dotFloatFunc_t mixerKernel_dotFloat;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MIXERKERNELS_H_ */
@@ -0,0 +1,287 @@
+/*
+  	This software and the content provided for use with it is Copyright © 2014-2020 Singular Sound
+ 	BeatBuddy Manager is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2 as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include <QFile>
+#include <QDebug>
+#include <QtCore/qmath.h>
+
+#include "offlineRenderer.h"
+#include "player.h"
+#include "soundManager.h"
+#include "engineCache.h"
+#include "audioSink.h"
+#include "../../src/workspace/settings.h"
+
+// Longest render, in case the script never stops the song
+#define OFFLINE_RENDER_MAX_FRAMES       ((qint64)SAMPLE_PER_SECOND * 60 * 30)
+// Longest ring out of the sounds after the song stopped
+#define OFFLINE_RENDER_MAX_TAIL_FRAMES  ((qint64)SAMPLE_PER_SECOND * 10)
+
+OfflineRenderer::OfflineRenderer()
+    : m_tempo(120)
+    , m_bitsPerSample(16)
+    , m_floatMixEngine(Settings::getFloatMixEngine())
+    , m_renderedFrames(0)
+    , m_peak(0.0f)
+{
+}
+
+void OfflineRenderer::setDrumset(const QString &path)
+{
+    m_drumsetPath = path;
+}
+
+void OfflineRenderer::setSong(const QString &path)
+{
+    m_songPath = path;
+}
+
+void OfflineRenderer::setEffectsPath(const QString &path)
+{
+    m_effectsPath = path;
+}
+
+void OfflineRenderer::setTempo(int bpm)
+{
+    // The song position does not move without a tempo
+    if (bpm > 0) {
+        m_tempo = bpm;
+    }
+}
+
+void OfflineRenderer::setBitsPerSample(int bits)
+{
+    m_bitsPerSample = (bits == 24) ? 24 : 16;
+}
+
+void OfflineRenderer::setFloatMixEngine(bool enabled)
+{
+    m_floatMixEngine = enabled;
+}
+
+void OfflineRenderer::setScript(const QList<PedalEvent> &script)
+{
+    m_script = script;
+}
+
+/**
+ * @brief OfflineRenderer::defaultScript
+ *        Walks through a song the way it is used live: intro, 4 bars of the first part,
+ *        a drum fill, 4 bars, a transition to the next part, 4 bars then a double tap
+ *        for the outro. Presses are spaced like a foot on the pedal at 120 BPM.
+ * @param barLength Length of a bar in ticks
+ */
+QList<OfflineRenderer::PedalEvent> OfflineRenderer::defaultScript(int barLength)
+{
+    QList<PedalEvent> script;
+    const int tap = 60;         // ~60 ms between press and release
+    const int hold = 240;       // ~250 ms, detected as a long press by the playback panel
+
+    if (barLength <= 0) {
+        barLength = 4 * 480;
+    }
+
+    // Drum fill
+    script.append({ 4 * barLength,               BUTTON_EVENT_PEDAL_PRESS });
+    script.append({ 4 * barLength + tap,         BUTTON_EVENT_PEDAL_RELEASE });
+
+    // Transition to the next part
+    script.append({ 8 * barLength,               BUTTON_EVENT_PEDAL_PRESS });
+    script.append({ 8 * barLength + hold,        BUTTON_EVENT_PEDAL_LONG_PRESS });
+    script.append({ 9 * barLength,               BUTTON_EVENT_PEDAL_RELEASE });
+
+    // Double tap
+    script.append({ 13 * barLength,              BUTTON_EVENT_PEDAL_PRESS });
+    script.append({ 13 * barLength + tap,        BUTTON_EVENT_PEDAL_RELEASE });
+    script.append({ 13 * barLength + 2 * tap,    BUTTON_EVENT_PEDAL_MULTI_TAP });
+    script.append({ 13 * barLength + 3 * tap,    BUTTON_EVENT_PEDAL_RELEASE });
+
+    return script;
+}
+
+bool OfflineRenderer::readFile(const QString &filepath, QByteArray &data)
+{
+    if (!EngineCache::instance()->file(filepath, data)) {
+        m_errorString = tr("Unable to open %1").arg(filepath);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief OfflineRenderer::load
+ *        Same sequence as Player::run: mixer, drumset, song then its accent hits
+ */
+bool OfflineRenderer::load(void)
+{
+    mixer_init();
+    mixer_setEngine(m_floatMixEngine ? MIXER_ENGINE_FLOAT : MIXER_ENGINE_INT64);
+    mixer_setOutputFormat(m_bitsPerSample == 24 ? MIXER_OUTPUT_PCM24 : MIXER_OUTPUT_PCM16);
+    mixer_setOutputLevel(1.0f);
+
+    m_drumset = EngineCache::instance()->drumset(m_drumsetPath);
+    if (!m_drumset) {
+        m_errorString = tr("Unable to open %1").arg(m_drumsetPath);
+        return false;
+    }
+    SoundManager_init();
+    SoundManager_setDrumset(m_drumset->parsed());
+
+    if (!readFile(m_songPath, m_song)) {
+        return false;
+    }
+    SongPlayer_init();
+    if (SongPlayer_loadSong(m_song.constData(), m_song.size()) < 0) {
+        m_errorString = tr("Invalid song %1").arg(m_songPath);
+        return false;
+    }
+
+    for (uint i = 0; i < MAX_SONG_PARTS; i++) {
+        char *name = SongPlayer_getSoundEffectName(i);
+        m_effects[i].clear();
+        if (name && *name != '\0') {
+            if (!EngineCache::instance()->effect(m_effectsPath + "/" + name, m_effects[i])) {
+                m_errorString = tr("Unable to open %1").arg(m_effectsPath + "/" + name);
+                return false;
+            }
+            SoundManager_LoadEffect(m_effects[i].constData(), i);
+        } else {
+            SoundManager_LoadEffect(nullptr, i);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief OfflineRenderer::processRefresh
+ *        Apply the pedal events that are due and process TICKS_PER_REFRESH ticks of the song,
+ *        like Player::processTime does for one refresh
+ */
+void OfflineRenderer::processRefresh(const QList<PedalEvent> &script)
+{
+    SongPlayer_PlayerStatus status;
+    unsigned int partIndex;
+    unsigned int drumfillIndex;
+    while (m_scriptIndex < script.size() && script.at(m_scriptIndex).tick <= m_tick) {
+        SongPlayer_ButtonCallback(script.at(m_scriptIndex++).event, 0);
+    }
+
+    m_songPosition.setTempo(m_tempo);
+    mixer_setEventOrigin((uint64_t)m_songPosition.frame());
+    m_songPosition.advance(TICKS_PER_REFRESH);
+    SongPlayer_setTimelineTempo(m_tempo);
+    SongPlayer_processSong(TICK_TO_TIME_RATIO(m_tempo), TICKS_PER_REFRESH);
+    m_tick += TICKS_PER_REFRESH;
+
+    SongPlayer_getPlayerStatus(&status, &partIndex, &drumfillIndex);
+    if (status != m_lastPlayerStatus) {
+        switch (status) {
+        case NO_SONG_LOADED:
+        case STOPPED:
+            m_songEnded = true;
+            break;
+        case PLAYING_MAIN_TRACK:
+            // Like Player::updateTempo, the tempo of the song is applied when the main track starts
+            if (SongPlayer_getTempo() > 0) {
+                m_tempo = SongPlayer_getTempo();
+            }
+            break;
+        default:
+            break;
+        }
+        m_lastPlayerStatus = status;
+    }
+}
+
+/**
+ * @brief OfflineRenderer::render
+ *        Render the song until it stops and the sounds have rung out
+ * @param wavPath Output file, overwritten
+ * @return false on error, see errorString()
+ */
+bool OfflineRenderer::render(const QString &wavPath)
+{
+    qint64 tailFrames = 0;
+    int bytesPerFrame;
+
+    m_errorString.clear();
+    m_renderedFrames = 0;
+    m_peak = 0.0f;
+
+    m_engine.makeCurrent();
+    if (!load()) {
+        EngineContext::doneCurrent();
+        return false;
+    }
+
+    QFile file(wavPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        m_errorString = tr("Unable to write %1").arg(wavPath);
+        EngineContext::doneCurrent();
+        return false;
+    }
+    // Header is written once the length is known
+    file.write(QByteArray(AUDIO_SINK_WAV_HEADER_SIZE, '\0'));
+
+    const QList<PedalEvent> script = m_script.isEmpty() ? defaultScript(SongPlayer_getbarLength()) : m_script;
+
+    m_scriptIndex = 0;
+    m_tick = 0;
+    m_songPosition.reset(m_tempo);
+    m_songEnded = false;
+    m_lastPlayerStatus = STOPPED;
+    bytesPerFrame = mixer_getBytesPerFrame();
+
+    SongPlayer_externalStart();
+
+    while (m_renderedFrames < OFFLINE_RENDER_MAX_FRAMES && tailFrames < OFFLINE_RENDER_MAX_TAIL_FRAMES) {
+
+        // All the notes of the chunk must be posted before it is rendered
+        while (!m_songEnded && m_songPosition.frame() < (qint64)(mixer_getClock() + OFFLINE_RENDER_CHUNK_FRAMES)) {
+            processRefresh(script);
+        }
+
+        mixer_ReadOutputStream(m_buffer, OFFLINE_RENDER_CHUNK_FRAMES * 2);
+        if (file.write(m_buffer, OFFLINE_RENDER_CHUNK_FRAMES * bytesPerFrame) != OFFLINE_RENDER_CHUNK_FRAMES * bytesPerFrame) {
+            m_errorString = tr("Unable to write %1").arg(wavPath);
+            break;
+        }
+        m_renderedFrames += OFFLINE_RENDER_CHUNK_FRAMES;
+        m_peak = qMax(m_peak, mixer_getOutputPeak());
+
+        // Once stopped, the render ends when the sounds are not heard anymore
+        if (m_songEnded) {
+            if (mixer_getOutputPeak() * 32768.0f <= PREPARE_STOP_THREASHOLD) {
+                break;
+            }
+            tailFrames += OFFLINE_RENDER_CHUNK_FRAMES;
+        }
+    }
+
+    SongPlayer_externalStop();
+    mixer_removeAll();
+    EngineContext::doneCurrent();
+
+    file.seek(0);
+    FileAudioSink::writeWavHeader(&file, m_bitsPerSample, (quint32)(m_renderedFrames * bytesPerFrame));
+    file.close();
+
+    if (!m_errorString.isEmpty()) {
+        return false;
+    }
+
+    qDebug() << "OfflineRenderer::render -" << m_songPath << "rendered in" << wavPath
+             << m_renderedFrames << "frames, peak" << m_peak;
+    return true;
+}
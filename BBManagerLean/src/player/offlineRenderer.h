@@ -0,0 +1,88 @@
+#ifndef OFFLINERENDERER_H
+#define OFFLINERENDERER_H
+
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QList>
+#include <QString>
+
+#include "button.h"
+#include "songPlayer.h"
+#include "mixer.h"
+#include "engineContext.h"
+#include "engineCache.h"
+
+// Frames rendered at once, also the resolution of the end of the song detection
+#define OFFLINE_RENDER_CHUNK_FRAMES     (4096)
+
+/**
+ * @brief The OfflineRenderer class
+ *
+ * Plays a song with a drumset through SongPlayer and the mixer without any audio device,
+ * as fast as possible, and writes the result in a 44.1 kHz stereo WAV file.
+ * The pedal is driven by a script of events placed on the song ticks, so that two renders
+ * of the same song, drumset and script give the same file byte for byte.
+ *
+ * The render uses its own instance of the engine, it can run while Player is playing.
+ */
+class OfflineRenderer
+{
+    Q_DECLARE_TR_FUNCTIONS(OfflineRenderer)
+
+public:
+    struct PedalEvent {
+        int tick;               // Song ticks (480 per beat) from the start of the render
+        BUTTON_EVENT event;     // Sent to SongPlayer like the pedal of the playback panel
+    };
+
+    OfflineRenderer();
+
+    void setDrumset(const QString &path);
+    void setSong(const QString &path);
+    void setEffectsPath(const QString &path);
+    void setTempo(int bpm);
+    void setBitsPerSample(int bits);
+    void setFloatMixEngine(bool enabled);
+    void setScript(const QList<PedalEvent> &script);
+
+    static QList<PedalEvent> defaultScript(int barLength);
+
+    bool render(const QString &wavPath);
+
+    inline QString errorString() const { return m_errorString; }
+    inline qint64 renderedFrames() const { return m_renderedFrames; }
+    inline float peak() const { return m_peak; }
+
+private:
+    bool load(void);
+    bool readFile(const QString &filepath, QByteArray &data);
+    void processRefresh(const QList<PedalEvent> &script);
+
+    QString m_drumsetPath;
+    QString m_songPath;
+    QString m_effectsPath;
+    int m_tempo;
+    int m_bitsPerSample;
+    bool m_floatMixEngine;
+    QList<PedalEvent> m_script;
+
+    EngineContext m_engine;
+
+    // Kept alive during the render, the engine points in them
+    QSharedPointer<const EngineCache::Drumset> m_drumset;
+    QByteArray m_song;
+    QByteArray m_effects[MAX_SONG_PARTS];
+    char m_buffer[OFFLINE_RENDER_CHUNK_FRAMES * MIXER_MAX_BYTES_PER_FRAME];
+
+    int m_scriptIndex;
+    int m_tick;
+    SongPosition m_songPosition;
+    bool m_songEnded;
+    SongPlayer_PlayerStatus m_lastPlayerStatus;
+
+    QString m_errorString;
+    qint64 m_renderedFrames;
+    float m_peak;
+};
+
+#endif // OFFLINERENDERER_H
@@ -12,7 +12,6 @@
     You should have received a copy of the GNU General Public License
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
-#include <QAudioOutput>
 #include <QFile>
 #include <QDebug>
 #include <stdint.h>
@@ -24,23 +23,11 @@
 #include "songPlayer.h"
 #include "../model/filegraph/song.h"
 #include "soundManager.h"
+#include "engineCache.h"
 #include "../../src/workspace/settings.h"
 
-#define TICK_TO_TIME_RATIO(bpm)     ((60.0f / (double)bpm) / 480.0f)
-#define PREPARE_STOP_THREASHOLD     (5)
 #define MIXER_DEFAULT_LEVEL         (1.0)
 
-
-// NOTE: these defines can be used due to hardcoded initialization of m_format
-// Units: sample/s
-#define SAMPLE_PER_SECOND           44100.0f
-// Units: ticks/refresh
-#define TICKS_PER_REFRESH           5
-// Units: byte/sample
-#define SAMPLES_TO_BYTES_RATIO_I      (4)
-// Units: sample/refresh = ticks/refresh * s/tick * sample/s
-#define SAMPLES_PER_REFRESH(bpm)  (TICKS_PER_REFRESH * TICK_TO_TIME_RATIO(bpm) * SAMPLE_PER_SECOND)
-
 // The idea is to process a fixed amount of ticks per update
 // In order for player to behave properly (and transition to fit at proper time), the number of ticks needs to be fixed to a value that fits with bar length, etc..
 // It was originnaly set to TICKS_PER_EVENT = 20
@@ -61,25 +48,85 @@
 
 unsigned int lastPartIndex = -1;
 
+/**
+ * @brief The Player::AudioSource class
+ *        Device pulled by the audio output, every read renders the frames requested by the device
+ */
+class Player::AudioSource : public QIODevice
+{
+public:
+    explicit AudioSource(Player *p_player) : mp_player(p_player) {}
+
+    // The song never ends from the point of view of the device, the player stops it
+    bool isSequential() const { return true; }
+    qint64 bytesAvailable() const { return MIXER_BUFFER_LENGTH_BYTES_MAX + QIODevice::bytesAvailable(); }
+
+protected:
+    qint64 readData(char *data, qint64 maxlen) { return mp_player->renderAudio(data, maxlen); }
+    qint64 writeData(const char *data, qint64 len) { Q_UNUSED(data); Q_UNUSED(len); return -1; }
+
+private:
+    Player *mp_player;
+};
+
 Player::Player(QObject *parent)
     : QThread(parent)
-    , m_device(QAudioDeviceInfo::defaultOutputDevice())
-    , m_audioOutput(nullptr)
-    , m_ioDevice(nullptr)
+    , m_audioSinkType(AudioSink::Device)
+    , mp_audioSink(nullptr)
 {
     qDebug() << "Creating Player object";
     m_singleTrack = false;
     m_singleTrackOffset = 0;
 
     m_bufferTime_ms = Settings::getBufferingTime_ms();
-    m_bufferSize_bytes = MIXER_BUFFERRING_TIME_MS_TO_BYTES_STEREO(m_bufferTime_ms);
-
-
-    m_prevStarted = false;
-    m_prevSigNum = 4;
-    m_prevBeatInBar = 0;
-    m_prevTick = -1;
-    m_prevPart = stopped;
+    m_bytesPerFrame = MIXER_BYTES_PER_SAMPLE_STEREO;
+    m_outputFormat = MIXER_OUTPUT_PCM16;
+    m_bufferSize_bytes = MIXER_BUFFERRING_TIME_MS_TO_SMAPLES(m_bufferTime_ms) * m_bytesPerFrame;
+    m_periodTime_ms = 0;
+    m_floatMixEngine = Settings::getFloatMixEngine();
+
+    m_bufferTimeChanged = false;
+    m_targetBufferTime_ms = m_bufferTime_ms;
+    m_reopenAudio = false;
+    m_audioBufferSize_bytes = 0;
+    m_sinkUnderrunCount = 0;
+    m_pullCount = 0;
+    m_lastPull_ns = 0;
+    m_lastStatsPublish_ns = 0;
+    m_realTimeAudio = Settings::getRealTimeAudio();
+    m_nextSongRequested = false;
+    mp_pendingSong = nullptr;
+    m_ticksToSwitch = 0;
+    mp_previousSong = nullptr;
+    m_previousSongFrame = 0;
+    slotSetAdaptiveBuffering(Settings::getAdaptiveBuffering(), Settings::getBufferingMinTime_ms(), Settings::getBufferingMaxTime_ms());
+
+
+    m_status.started = false;
+    m_status.part = stopped;
+    m_status.sigNum = 4;
+    m_status.beatInBar = 0;
+    m_status.tick = -1;
+    m_status.tempo = 0;
+    m_status.tempoCount = 0;
+    m_status.playing = STOPPED;
+    m_status.partIndex = 0;
+    m_status.drumfillIndex = 0;
+    m_status.playingCount = 0;
+    m_status.underrunCount = 0;
+    m_status.bufferTime_ms = m_targetBufferTime_ms;
+    m_status.songSwitchCount = 0;
+    m_status.forceEmit = false;
+    m_published = m_status;
+    m_shown = m_status;
+
+    // The status of the audio thread is signaled from the thread of the player object
+    m_clock.start();
+    m_statusTimer.setInterval(PLAYER_STATUS_POLL_MS);
+    connect(&m_statusTimer, &QTimer::timeout, this, &Player::slotPollStatus);
+    connect(this, &QThread::finished, this, &Player::slotFinished);
+    connect(&m_songPreparer, &SongPreparer::sigPrepared, this, &Player::slotSongPrepared);
+    connect(&m_songPreparer, &SongPreparer::sigFailed, this, &Player::slotSongPreparationFailed);
 }
 
 Player::~Player()
@@ -88,44 +135,37 @@ Player::~Player()
         stop();
         wait();
     }
+    releaseSongs();
+    delete mp_audioSink;
     qDebug() << "Deleting Player object";
 }
 
-void Player::initAudio(void)
+bool Player::initAudio(void)
 {
+    // The sink negotiates the sample format, the mixer can write any of them
+    mp_audioSink = AudioSink::create(m_audioSinkType, m_audioSinkPath);
+    if (!mp_audioSink->open(m_targetBufferTime_ms)) {
+        return false;
+    }
 
-    // NOTE: There are defines related to setChannelCount(2) and setSampleSize(16).
+    // NOTE: There are defines related to setChannelCount(2) and setSampleRate(44100).
     //       Changing these hardcoded values would break these defines and all defines that use them:
     //       - SAMPLE_PER_SECOND
-    //       - SAMPLES_TO_BYTES_RATIO_I
     //       Other Mixer defines depend on this
-    m_format.setSampleRate(44100);
-    m_format.setChannelCount(2);
-    m_format.setSampleSize(16);
-    m_format.setCodec("audio/pcm");
-    m_format.setByteOrder(QAudioFormat::LittleEndian);
-    m_format.setSampleType(QAudioFormat::SignedInt);
-
-    m_audioOutput = new QAudioOutput(m_device, m_format, nullptr);
+    m_format = mp_audioSink->format();
+    m_outputFormat = mp_audioSink->outputFormat();
+    m_bytesPerFrame = m_format.bytesPerFrame();
 
     // NOTE: m_bufferSize_bytes is only computed at start of thread.
-    m_bufferSize_bytes = MIXER_BUFFERRING_TIME_MS_TO_BYTES_STEREO(m_bufferTime_ms);
-    m_audioOutput->setBufferSize(m_bufferSize_bytes);
-    m_ioDevice = m_audioOutput->start();
-
-    // Ajust the actual buffer size with real buffer size
-    // m_soundCardLimit is used to prevent buffering too much in case sound card
-    // creates a bigger buffer than m_bufferSize_bytes;
-    if(m_audioOutput->bufferSize() > m_bufferSize_bytes){
-        m_soundCardLimit = m_audioOutput->bufferSize() - m_bufferSize_bytes;
-    } else {
-        m_soundCardLimit = 0;
-    }
+    m_bufferSize_bytes = MIXER_BUFFERRING_TIME_MS_TO_SMAPLES(m_targetBufferTime_ms) * m_bytesPerFrame;
+    return true;
 }
 
 void Player::initMixer(void)
 {
     mixer_init();
+    mixer_setEngine(m_floatMixEngine ? MIXER_ENGINE_FLOAT : MIXER_ENGINE_INT64);
+    mixer_setOutputFormat(m_outputFormat);
     mixer_setOutputLevel(MIXER_DEFAULT_LEVEL);
 }
 
@@ -133,33 +173,26 @@ void Player::loadDrumset(const QString &filepath)
 {
     qDebug() << "Loading drumset " << filepath;
 
-    QFile file(filepath);
-    if (!file.open(QIODevice::ReadOnly))
+    // Mapped and parsed once, the samples are only read from the disk when they are played
+    m_drumset = EngineCache::instance()->drumset(filepath);
+    if (!m_drumset)
         return;
 
-    m_drumset = file.readAll();
-
-    file.close();
-
     SoundManager_init();
-    SoundManager_LoadDrumset(m_drumset.data(), m_drumset.size());
+    SoundManager_setDrumset(m_drumset->parsed());
 }
 
 bool Player::loadSong(const QString &filepath)
 {
     qDebug() << "Loading song " << filepath;
 
-    QFile file(filepath);
-    if (!file.open(QIODevice::ReadOnly)){
+    if (!EngineCache::instance()->file(filepath, m_song)){
         qWarning() << "Player::loadSong - ERROR 1 - unable to find " << filepath;
         return false;
     }
 
-    m_song = file.readAll();
-
-    file.close();
     SongPlayer_init();
-    SongPlayer_loadSong(m_song.data(), m_song.size());
+    SongPlayer_loadSong(m_song.constData(), m_song.size());
 
     qDebug() << "Loading effects from " << m_effectsPath;
     for (uint i=0; i<MAX_SONG_PARTS; i++) {
@@ -183,17 +216,12 @@ bool Player::loadSong(const QString &filepath)
 
 bool Player::loadEffect(int part, const QString &filepath)
 {
-    QFile file(filepath);
-    if (!file.open(QIODevice::ReadOnly)){
+    if (!EngineCache::instance()->effect(filepath, m_effects[part])){
         qWarning() << "Player::loadEffect - ERROR 1 - unable to find " << filepath;
         return false;
     }
 
-    m_effects[part] = file.readAll();
-
-    file.close();
-
-    SoundManager_LoadEffect(m_effects[part].data(), part);
+    SoundManager_LoadEffect(m_effects[part].constData(), part);
     return true;
 }
 
@@ -205,20 +233,60 @@ void Player::clearEffect(int part)
 
 int Player::processTime(int samplesToProcess)
 {
-    SongPlayer_PlayerStatus currentPlayerStatus;
-    unsigned int PartIndex;
-    unsigned int DrumfillIndex;
+    // The song is still processed by multiples of TICKS_PER_REFRESH, but it runs ahead of the
+    // mixer clock so that every sample that is about to be rendered is covered. The notes are
+    // posted to the mixer with a delay from the song position, so their timing is exact to the
+    // sample whatever the amount of audio rendered at once.
+    qint64 renderEnd = (qint64)mixer_getClock() + samplesToProcess;
+
+    // Data of the previous song, once no sound reads it anymore
+    if (mp_previousSong && !mixer_isPlayingBefore(m_previousSongFrame)) {
+        retirePreviousSong();
+    }
+
+    // Next song of the setlist, switched to on the next bar. One at a time, the sounds of
+    // the song before the one playing must be done.
+    if (!mp_pendingSong && !mp_previousSong && !m_singleTrack && m_nextSongs.pop(mp_pendingSong)) {
+        m_ticksToSwitch = ticksToSongSwitch();
+    }
 
-    // Process as many samples as possible, but always by multiples of TICKS_PER_REFRESH
-    int updateCount = (int)(samplesToProcess / SAMPLES_PER_REFRESH(m_tempo));
+    while (m_tempo > 0 && m_songPosition.frame() < renderEnd) {
+        m_songPosition.setTempo(m_tempo);
+        int updateCount = qCeil((renderEnd - m_songPosition.frame()) / SAMPLES_PER_REFRESH(m_tempo));
+        // The estimate may fall a frame short of the rounded position
+        while (m_songPosition.frame(updateCount * TICKS_PER_REFRESH) < renderEnd) {
+            updateCount++;
+        }
 
-    // Keep track of the actual amount of samples being processed (with fraction being summed until entire value reached)
-    m_processedSamples_real += SAMPLES_PER_REFRESH(m_tempo) * updateCount;
+        if (mp_pendingSong) {
+            if (m_ticksToSwitch <= 0) {
+                switchSong();
+                continue;
+            }
+            // Stop on the bar, the rest is processed with the next song
+            updateCount = qMin(updateCount, (m_ticksToSwitch + TICKS_PER_REFRESH - 1) / TICKS_PER_REFRESH);
+            m_ticksToSwitch -= updateCount * TICKS_PER_REFRESH;
+        }
+        processSong(updateCount);
+    }
 
-    int processedSamples = qFloor(m_processedSamples_real);
-    m_processedSamples_real -= (double)processedSamples;
+    return samplesToProcess;
+}
+
+/**
+ * @brief Player::processSong
+ *        Process updateCount refreshes of the song from the song position
+ */
+void Player::processSong(int updateCount)
+{
+    SongPlayer_PlayerStatus currentPlayerStatus;
+    unsigned int PartIndex;
+    unsigned int DrumfillIndex;
 
-    if(processedSamples > 0){
+    if (updateCount > 0){
+        mixer_setEventOrigin((uint64_t)m_songPosition.frame());
+        m_songPosition.advance(updateCount * TICKS_PER_REFRESH);
+        SongPlayer_setTimelineTempo(m_tempo);
 
         if (m_singleTrack){
             SongPlayer_ProcessSingleTrack(TICK_TO_TIME_RATIO(m_tempo), updateCount * TICKS_PER_REFRESH, m_singleTrackOffset);
@@ -247,16 +315,16 @@ int Player::processTime(int samplesToProcess)
                 switch (currentPlayerStatus) {
                 case NO_SONG_LOADED:            m_stop = 1;                                     break;
                 case STOPPED:                   m_prepareStop = 1;                              break;
-                case INTRO:                     emit sigPlayingIntro();                              break;
                 case PLAYING_MAIN_TRACK:
                     qDebug() << "whats going on here1" << currentPlayerStatus << m_lastPlayerStatus
                              << PartIndex << lastPartIndex;
                     updateTempo();
-                    emit sigPlayingMainTrack(PartIndex);
+                    notifyPlaying(currentPlayerStatus, PartIndex, DrumfillIndex);
                     break;
-                case OUTRO:                     emit sigPlayingOutro();                              break;
-                case TRANFILL_ACTIVE:           emit sigPlayingTranfill(PartIndex);                  break;
-                case DRUMFILL_ACTIVE:           emit sigPlayingDrumfill(PartIndex, DrumfillIndex);   break;
+                case INTRO:
+                case OUTRO:
+                case TRANFILL_ACTIVE:
+                case DRUMFILL_ACTIVE:           notifyPlaying(currentPlayerStatus, PartIndex, DrumfillIndex);   break;
                 default:
                     qWarning() << "Player::processTime unhandled status " << currentPlayerStatus;
                     break;
@@ -270,38 +338,28 @@ int Player::processTime(int samplesToProcess)
             }
         }
     }
-
-    return processedSamples;
-
 }
 
 /**
  * NOTE: should only be called if samplesToProcess > 0
  * @brief Player::processAudio
+ * @param data Written with samplesToProcess frames
  * @param samplesToProcess
  */
-void Player::processAudio(int samplesToProcess)
+void Player::processAudio(char *data, int samplesToProcess)
 {
 
 
-    mixer_ReadOutputStream((short int*)m_buffer,
+    mixer_ReadOutputStream(data,
                            samplesToProcess * m_format.channelCount()); // length is in absolute sample count (regardless of stereo/mono)
 
 
-    m_ioDevice->write(m_buffer, samplesToProcess * SAMPLES_TO_BYTES_RATIO_I);  // Number of bytes
-
     /* Stop audio thread if nothing is output after double tap */
     if (m_prepareStop) {
-        int i;
-
-        int byteCount = samplesToProcess * SAMPLES_TO_BYTES_RATIO_I;
 
-        // Scan the buffer untile one of the sample (16 bits) is bigger than the threashold,
-        for (i=0; i<byteCount; i+=2 ) {
-            if (abs(*((short int*)(m_buffer + i))) > PREPARE_STOP_THREASHOLD) break;
-        }
-        // if none found, stop
-        if (i == byteCount) {
+        // The mixer measures the peak while writing the buffer, whatever the output format.
+        // If no sample is bigger than the threashold, stop
+        if (mixer_getOutputPeak() * 32768.0f <= PREPARE_STOP_THREASHOLD) {
             m_stop = 1;
         }
 
@@ -312,40 +370,179 @@ void Player::processAudio(int samplesToProcess)
 
 }
 
-void Player::processEvent(void)
+/**
+ * @brief Player::renderAudio
+ *        Called by the audio output each time it needs data, in the audio thread.
+ *        Renders exactly the frames requested, the song is processed ahead of them.
+ * @return Number of bytes written, 0 once the player is stopping
+ */
+qint64 Player::renderAudio(char *data, qint64 maxlen)
 {
-    if (m_lock.tryLockForRead()) {
-        if (!m_queue.isEmpty()) {
-            BUTTON_EVENT event = m_queue.dequeue();
+    int framesToProcess = (int)(maxlen / m_bytesPerFrame);
+    int maxFrames = m_bufferSize_bytes / m_bytesPerFrame;
+    char *out = data;
+    qint64 pullStart_ns = m_clock.nsecsElapsed();
+
+    // The output may pull from a thread of its own, the engine must be the one of the player
+    m_engine.makeCurrent();
+
+    if (m_pullCount > 0) {
+        m_audioStats.add(PlayerStats::PullInterval, pullStart_ns - m_lastPull_ns);
+    }
+    m_lastPull_ns = pullStart_ns;
+
+    // The device asks for its whole buffer once it played everything it had, the first time
+    // it is only being filled
+    bool underrun = m_pullCount > 0 && maxlen >= m_audioBufferSize_bytes
+                    && m_audioBufferSize_bytes > mp_audioSink->periodSize();
+    if (mp_audioSink->underrunCount() != m_sinkUnderrunCount) {
+        m_sinkUnderrunCount = mp_audioSink->underrunCount();
+        underrun = true;
+    }
+    m_pullCount++;
+    if (underrun) {
+        processUnderrun();
+    }
+
+    // Long requests are split so that the song never runs more than a buffer ahead of the mixer
+    while (framesToProcess > 0 && !m_stop) {
+        qint64 start_ns = m_clock.nsecsElapsed();
+        int n = processTime(qMin(framesToProcess, maxFrames));
+        qint64 mix_ns = m_clock.nsecsElapsed();
+        processAudio(out, n);
+        m_audioStats.add(PlayerStats::SongTime, mix_ns - start_ns);
+        m_audioStats.add(PlayerStats::MixTime, m_clock.nsecsElapsed() - mix_ns);
+        m_audioStats.frames += n;
+        out += n * m_bytesPerFrame;
+        framesToProcess -= n;
+    }
+
+    // Verify if any pedal were pressed
+    processEvent();
 
-            SongPlayer_ButtonCallback(event, 0);
+    updateStatus(false);
+    updateStats(pullStart_ns);
+
+    if (m_stop) {
+        quit();
+    }
+    return out - data;
+}
+
+/**
+ * @brief Player::processUnderrun
+ *        Count the underrun. With adaptive buffering, the buffer grows up to the maximum
+ *        buffering time: the sink is opened again once back in run(), the frames it had
+ *        buffered are lost.
+ */
+void Player::processUnderrun(void)
+{
+    m_status.underrunCount++;
+    qWarning() << "Player::processUnderrun -" << m_status.underrunCount << "underruns with"
+               << m_targetBufferTime_ms << "ms of buffering";
+
+    if (m_adaptiveBuffering && !m_reopenAudio && m_targetBufferTime_ms < m_bufferMaxTime_ms) {
+        m_targetBufferTime_ms = qMin(m_bufferMaxTime_ms, m_targetBufferTime_ms * (100 + PLAYER_BUFFER_GROW_PERCENT) / 100);
+        m_status.bufferTime_ms = m_targetBufferTime_ms;
+        m_reopenAudio = true;
+        quit();
+    }
+}
+
+/**
+ * @brief Player::updateStats
+ *        Record the end of a pull, the statistics are queued for the GUI thread
+ *        every PLAYER_STATS_PUBLISH_MS
+ */
+void Player::updateStats(qint64 pullStart_ns)
+{
+    MIXER_voiceStats_t voices;
+    qint64 now_ns = m_clock.nsecsElapsed();
+
+    m_audioStats.add(PlayerStats::PullTime, now_ns - pullStart_ns);
+
+    mixer_getVoiceStats(&voices);
+    m_audioStats.activeVoices = (int)voices.active;
+    m_audioStats.peakVoices = (int)voices.peak;
+    m_audioStats.stolenVoices = (int)voices.stolen;
+    m_audioStats.cutVoices = (int)voices.cut;
+    m_audioStats.underrunCount = m_status.underrunCount;
+
+    // What the sink had left to play when it pulled, it is empty at the first pull
+    if (m_pullCount > 1) {
+        m_audioStats.bufferFill_bytes = qMax(0, m_audioBufferSize_bytes - mp_audioSink->bytesFree());
+        if (m_audioStats.minBufferFill_bytes < 0 || m_audioStats.bufferFill_bytes < m_audioStats.minBufferFill_bytes) {
+            m_audioStats.minBufferFill_bytes = m_audioStats.bufferFill_bytes;
         }
-        m_lock.unlock();
+    }
+
+    if (now_ns - m_lastStatsPublish_ns >= PLAYER_STATS_PUBLISH_MS * 1000000LL) {
+        // Dropped if the GUI thread is late, the next one is queued soon
+        if (m_statsQueue.push(m_audioStats)) {
+            m_lastStatsPublish_ns = now_ns;
+        }
+    }
+}
+
+void Player::processEvent(void)
+{
+    Command command;
+
+    if (m_commands.pop(command)) {
+        SongPlayer_ButtonCallback(command.event, (unsigned long long)command.time_ms);
+    }
+}
+
+void Player::queueCommand(BUTTON_EVENT event)
+{
+    Command command = { event, m_clock.elapsed() };
+
+    if (!m_commands.push(command)) {
+        qWarning() << "Player::queueCommand - queue full, event dropped" << event;
     }
 }
 
+/**
+ * @brief Player::updateTempo
+ *        Apply the tempo of the song, it is signaled by the GUI thread
+ */
 void Player::updateTempo()
 {
     int bpm = SongPlayer_getTempo();
     qDebug() << "new tempo" << bpm << getTempo();
     if (bpm>0) {
       setTempo(bpm);
-      qDebug() << "emiting tempo change signal";
-      emit sigTempoChangedBySong(bpm);
+      m_status.tempo = bpm;
+      m_status.tempoCount++;
     }
 }
 
+/**
+ * @brief Player::notifyPlaying
+ *        Memorize the part started by the song, it is signaled by the GUI thread
+ */
+void Player::notifyPlaying(SongPlayer_PlayerStatus status, unsigned int partIndex, unsigned int drumfillIndex)
+{
+    m_status.playing = status;
+    m_status.partIndex = partIndex;
+    m_status.drumfillIndex = drumfillIndex;
+    m_status.playingCount++;
+}
+
+/**
+ * @brief Player::updateStatus
+ *        Update the status of the audio thread and queue it for the GUI thread.
+ *        Nothing is signaled from the audio thread.
+ * @param forceEmit All the values are signaled, changed or not
+ */
 void Player::updateStatus(bool forceEmit)
 {
    //update started
-   if( forceEmit || (!m_stop && !m_prevStarted) || (m_stop && m_prevStarted) ){
-      m_prevStarted = !m_stop;
-      emit sigStartedChanged(m_prevStarted);
-   }
+   m_status.started = !m_stop;
 
    // update currentPart
-   partEnum currentPart = m_prevPart;
-   unsigned int partIndex;
+   partEnum currentPart = m_status.part;
+   unsigned int partIndex = 0;
 
    if(m_stop){
       currentPart = stopped;
@@ -420,53 +617,165 @@ void Player::updateStatus(bool forceEmit)
       }
    }
 
-   if(forceEmit || (currentPart != m_prevPart)){
-      qDebug() << "Part changed!!" << currentPart << m_prevPart << forceEmit;
-      m_prevPart = currentPart;
-      emit sigPartChanged(m_prevPart);
+   if(forceEmit || (currentPart != m_status.part)){
+      qDebug() << "Part changed!!" << currentPart << m_status.part << forceEmit;
+      m_status.part = currentPart;
       updateTempo();
    } else {
        if (lastPartIndex != partIndex && partIndex > 0) {
-           qDebug() << "whats going on here2" << lastPartIndex << partIndex << currentPart << m_prevPart;
+           qDebug() << "whats going on here2" << lastPartIndex << partIndex << currentPart << m_status.part;
            lastPartIndex = partIndex;
            updateTempo();
-           emit sigPlayingMainTrack(partIndex);
+           notifyPlaying(PLAYING_MAIN_TRACK, partIndex, 0);
        }
    }
 
    // update currentSigNum
-   int currentSigNum = m_prevSigNum;
    TimeSignature timeSignature;
    if(SongPlayer_getTimeSignature(&timeSignature)){
-      currentSigNum = (int) timeSignature.num;
-   }
-
-   if(forceEmit || (currentSigNum != m_prevSigNum)){
-
-      m_prevSigNum = currentSigNum;
-      emit sigSigNumChanged(m_prevSigNum);
+      m_status.sigNum = (int) timeSignature.num;
    }
 
    // update beatInBar
    int unusedStartBeat;
-   int currentBeatInBar = SongPlayer_getBeatInbar(&unusedStartBeat);
-   if(forceEmit || (currentBeatInBar != m_prevBeatInBar)){
-      m_prevBeatInBar = currentBeatInBar;
-      emit sigBeatInBarChanged(m_prevBeatInBar);
+   m_status.beatInBar = SongPlayer_getBeatInbar(&unusedStartBeat);
+
+   // update MasterTick
+   m_status.tick = SongPlayer_getMasterTick();
+
+   if (forceEmit) {
+      m_status.forceEmit = true;
    }
+   publishStatus();
+}
+
+/**
+ * @brief Player::publishStatus
+ *        Queue the status of the audio thread if it changed since the last one queued.
+ *        When the GUI thread is late and the queue is full, the next loop queues a newer one.
+ */
+void Player::publishStatus(void)
+{
+    if (m_status.forceEmit || m_status != m_published) {
+        if (m_statusQueue.push(m_status)) {
+            m_published = m_status;
+            m_status.forceEmit = false;
+        }
+    }
+}
 
-   // emit MasterTick
-   auto currentTick = SongPlayer_getMasterTick();
-   if (forceEmit || (currentTick != m_prevTick))
-       emit sigPlayerPosition(m_prevTick = currentTick);
+bool Player::Status::operator==(const Status &other) const
+{
+    return started == other.started
+        && part == other.part
+        && sigNum == other.sigNum
+        && beatInBar == other.beatInBar
+        && tick == other.tick
+        && tempo == other.tempo
+        && tempoCount == other.tempoCount
+        && playing == other.playing
+        && partIndex == other.partIndex
+        && drumfillIndex == other.drumfillIndex
+        && playingCount == other.playingCount
+        && underrunCount == other.underrunCount
+        && bufferTime_ms == other.bufferTime_ms
+        && songSwitchCount == other.songSwitchCount;
 }
 
-void Player::run(void)
+/**
+ * @brief Player::slotPollStatus
+ *        Signal every status queued by the audio thread, in the GUI thread
+ */
+void Player::slotPollStatus(void)
 {
-    initAudio();
-    initMixer();
-    emit sigPlayerStarted();
+    Status status;
 
+    while (m_statusQueue.pop(status)) {
+        // Getters already return the new status in the slots
+        Status prev = m_shown;
+        bool forceEmit = status.forceEmit;
+        m_shown = status;
+
+        if (forceEmit || status.started != prev.started) {
+            emit sigStartedChanged(status.started);
+        }
+        if (status.tempoCount != prev.tempoCount) {
+            emit sigTempoChangedBySong(status.tempo);
+        }
+        if (status.playingCount != prev.playingCount) {
+            switch (status.playing) {
+            case INTRO:                 emit sigPlayingIntro();                                             break;
+            case PLAYING_MAIN_TRACK:    emit sigPlayingMainTrack(status.partIndex);                         break;
+            case OUTRO:                 emit sigPlayingOutro();                                             break;
+            case TRANFILL_ACTIVE:       emit sigPlayingTranfill(status.partIndex);                          break;
+            case DRUMFILL_ACTIVE:       emit sigPlayingDrumfill(status.partIndex, status.drumfillIndex);    break;
+            default:                                                                                        break;
+            }
+        }
+        if (forceEmit || status.part != prev.part) {
+            emit sigPartChanged(status.part);
+        }
+        if (forceEmit || status.sigNum != prev.sigNum) {
+            emit sigSigNumChanged(status.sigNum);
+        }
+        if (forceEmit || status.beatInBar != prev.beatInBar) {
+            emit sigBeatInBarChanged(status.beatInBar);
+        }
+        if (forceEmit || status.tick != prev.tick) {
+            emit sigPlayerPosition(status.tick);
+        }
+        if (status.underrunCount != prev.underrunCount) {
+            emit sigAudioUnderrun(status.underrunCount, status.bufferTime_ms);
+        }
+        if (status.songSwitchCount != prev.songSwitchCount && m_switchingSong.isValid()) {
+            QString songPath = m_switchingSong.songPath;
+            m_switchingSong = PreparedSong();
+            m_songPath = songPath;
+            emit sigSongSwitched(songPath);
+        }
+    }
+
+    releaseSongs();
+
+    bool statsUpdated = false;
+    while (m_statsQueue.pop(m_stats)) {
+        statsUpdated = true;
+    }
+    if (statsUpdated) {
+        emit sigStatsUpdated();
+    }
+}
+
+/**
+ * @brief Player::slotFinished
+ *        The audio thread ended, signal its last status before signaling that it stopped
+ */
+void Player::slotFinished(void)
+{
+    slotPollStatus();
+    if (!isRunning()) {
+        // Otherwise it was already started again
+        m_statusTimer.stop();
+    }
+    // The setlist starts again from the song selected when played next
+    m_nextSongPath.clear();
+    dropPreparedSong();
+    m_nextSongRequested = false;
+    m_switchingSong = PreparedSong();
+
+    if (Settings::getPlayerStatsLog() && m_stats.frames > 0) {
+        qDebug().noquote() << "Player statistics of" << m_songPath << "with" << m_drumsetPath << "\n" << m_stats.toString();
+    }
+    emit sigPlayerStopped();
+}
+
+/**
+ * @brief Player::startSong
+ *        Load the drumset and the song or the single track to play, in the audio thread
+ * @return false if there is nothing to play
+ */
+bool Player::startSong(void)
+{
     loadDrumset(m_drumsetPath);
     if (m_singleTrack){
         SongPlayer_init();
@@ -478,70 +787,100 @@ void Player::run(void)
         m_prepareStop = 0;
         if (m_singleTrackOffset < 0) {
             qWarning() << "bad midi... stopping player!";
-            emit sigPlayerStopped();
-            return;
+            return false;
         }
     }else{
 
         if(!loadSong(m_songPath)){
            qWarning() << "Player::run - ERROR - Unable to load song " << m_songPath << " or its Accent Hit";
-           emit sigPlayerStopped();
            emit sigPlayerError(tr("Unable to load song %1 or its Accent Hit").arg(m_songPath));
-           return;
+           return false;
         }
         SongPlayer_externalStart();
     }
+    return true;
+}
 
-    updateStatus(true);
+/**
+ * @brief Player::playAudio
+ *        Let the sink pull the frames until the player is stopped, in the audio thread
+ */
+void Player::playAudio(void)
+{
+    if (m_realTimeAudio) {
+        lockData();
+    }
 
-    while (!m_stop) {
-        // The time is regulated by the amount of free bytes in the buffer
-        // The unbreakable unit is the sample = 4 bytes
-        int sampleToProcess = 0;
-        if (m_audioOutput && m_audioOutput->state() != QAudio::StoppedState) {
-            // Sound card limit is used to limit buffering time to smaller values than sound card buffer size.
-            int bytesToProcess = m_audioOutput->bytesFree() - m_soundCardLimit; // length in bytes;
-            // limit to the buffer size (due to bug on MAC)
-            if(bytesToProcess > m_bufferSize_bytes){
-                m_soundCardLimit += (bytesToProcess - m_bufferSize_bytes);
-                bytesToProcess = m_bufferSize_bytes;
-            }
+    updateStatus(true);
 
-            sampleToProcess = bytesToProcess / SAMPLES_TO_BYTES_RATIO_I;
+    // The audio output pulls the frames from renderAudio when it needs them, until stopped
+    AudioSource source(this);
+    source.open(QIODevice::ReadOnly);
+    for (;;) {
+        startAudio(&source);
+        if (!m_stop) {
+            exec();
         }
-        // At this point, the sampleToProcess corresponds to the ammount of free space in audio buffer
-        if (sampleToProcess > 0){
-            // Require player to create data in mixer
-            sampleToProcess = processTime(sampleToProcess);
+        mp_audioSink->stop();
+
+        if (m_stop || !m_reopenAudio) {
+            break;
         }
 
-        // At this point, the sampleToProcess corresponds to the actual ammount of samples ready
-        if (sampleToProcess > 0){
-            // Process data from mixer and send to audio card
-            processAudio(sampleToProcess);
+        // The buffer grew after an underrun
+        m_reopenAudio = false;
+        delete mp_audioSink;
+        mp_audioSink = nullptr;
+        if (!initAudio()) {
+            qWarning() << "Player::run - ERROR - Unable to open audio output" << mp_audioSink->errorString();
+            emit sigPlayerError(mp_audioSink->errorString());
+            break;
         }
+        mixer_setOutputFormat(m_outputFormat);
+    }
+
+    // A long enough play without underrun, the next one tries a smaller buffer
+    if (m_adaptiveBuffering && m_status.underrunCount == 0
+        && mixer_getClock() >= (uint64_t)(SAMPLE_PER_SECOND * PLAYER_BUFFER_SHRINK_AFTER_MS / 1000)) {
+        m_targetBufferTime_ms = qMax(m_bufferMinTime_ms, m_targetBufferTime_ms * (100 - PLAYER_BUFFER_SHRINK_PERCENT) / 100);
+    }
+}
 
-        // Verify if any pedal were pressed
-        processEvent();
-
-        updateStatus(false);
-
-        // NOTE: at 300 BPM, sound processing should be called every 2,083 msec.
-        //       On mac mini, buffer was seen to display new free space when there is at least 2048
-        //       free bytes. This corresponds to 11.2 ms
-        //
-        //       On a Windows 7 laptop, buffer was seen to display new free space when there is at
-        //       least 1/5 of the buffer free. This is 3528 bytes on a 100 ms buffer which corresponds exactly to 20 ms
-        //
-        //       5 ms was chosen arbitrarily to sleep long enough but not to exceed threshold too much
-        //
-        // Only sleep when there is nothing to do
-        if(sampleToProcess <= 0){
-            msleep(5);
+void Player::run(void)
+{
+    m_engine.makeCurrent();
+    m_audioStats.clear();
+    m_lastStatsPublish_ns = 0;
+    m_ticksToSwitch = 0;
+    if (m_realTimeAudio) {
+        QString scheduling;
+        if (RealTime::promoteCurrentThread(&scheduling)) {
+            qDebug() << "Player::run - audio thread scheduling:" << scheduling;
+        } else {
+            qWarning() << "Player::run - audio thread not promoted:" << scheduling;
         }
+    }
+    if (!initAudio()) {
+        qWarning() << "Player::run - ERROR - Unable to open audio output" << mp_audioSink->errorString();
+        emit sigPlayerError(mp_audioSink->errorString());
+    } else {
+        initMixer();
+        emit sigPlayerStarted();
+        if (startSong()) {
+            playAudio();
+        }
+    }
 
+    // Every play ends here, the sink is closed by the thread that created it
+    if (mp_audioSink) {
+        mp_audioSink->stop();
+        delete mp_audioSink;
+        mp_audioSink = nullptr;
     }
 
+    // Last statistics of the play, the GUI thread polls them once more when the thread finished
+    m_statsQueue.push(m_audioStats);
+
     // process status one last time to make sure VM is stopped by
     // playback panel stop button press
     updateStatus(false);
@@ -552,9 +891,288 @@ void Player::run(void)
         m_singleTrack = false;
     }
 
+    // Nothing must point in the drumset anymore, the cache keeps it for the next start
+    mixer_removeAll();
+    SoundManager_init();
+    unlockData();
+    m_drumset.clear();
+
+    // Nothing reads the songs left anymore, the GUI thread frees them
+    retireSong(mp_previousSong);
+    mp_previousSong = nullptr;
+    retireSong(mp_pendingSong);
+    mp_pendingSong = nullptr;
+    PreparedSong *p_song;
+    while (m_nextSongs.pop(p_song)) {
+        retireSong(p_song);
+    }
 
+    // sigPlayerStopped is emitted by slotFinished
+}
 
-    emit sigPlayerStopped();
+/**
+ * @brief Player::ticksToSongSwitch
+ *        Ticks left until the next bar of the song playing, 0 to switch right away
+ */
+int Player::ticksToSongSwitch(void)
+{
+    SongPlayer_PlayerStatus status;
+    unsigned int partIndex;
+    unsigned int drumfillIndex;
+
+    SongPlayer_getPlayerStatus(&status, &partIndex, &drumfillIndex);
+    if (status == NO_SONG_LOADED || status == STOPPED || status == PAUSED || m_prepareStop) {
+        return 0;
+    }
+
+    int barLength = SongPlayer_getbarLength();
+    if (barLength <= 0) {
+        return 0;
+    }
+    // Negative during the pick up notes
+    int tick = SongPlayer_getMasterTick() % barLength;
+    if (tick < 0) {
+        tick += barLength;
+    }
+    return tick ? barLength - tick : 0;
+}
+
+/**
+ * @brief Player::switchSong
+ *        Start the next song of the setlist in place of the one playing, in the audio thread.
+ *        Everything was read and parsed by SongPreparer, only buffers are exchanged here: the
+ *        pending song is left with the data of the previous one, kept while the sounds already
+ *        started still read it.
+ */
+void Player::switchSong(void)
+{
+    PreparedSong *p_song = mp_pendingSong;
+    mp_pendingSong = nullptr;
+
+    // The locks follow their data, the previous song leaves with those of the data it takes
+    if (p_song->drumset && p_song->drumset != m_drumset) {
+        m_drumset.swap(p_song->drumset);
+        m_lockedDrumset.swap(p_song->lockedDrumset);
+        SoundManager_init();
+        SoundManager_setDrumset(m_drumset->parsed());
+    }
+
+    m_song.swap(p_song->song);
+    m_lockedData.swap(p_song->lockedData);
+    SongPlayer_init();
+    if (SongPlayer_loadPreparedSong(m_song.constData(), m_song.size(), p_song->tracks.data()) <= 0) {
+        qWarning() << "Player::switchSong - ERROR - unable to load" << p_song->songPath;
+    }
+    for (int i = 0; i < MAX_SONG_PARTS; i++) {
+        m_effects[i].swap(p_song->effects[i]);
+        SoundManager_LoadEffect(m_effects[i].isEmpty() ? nullptr : m_effects[i].constData(), i);
+    }
+    if (p_song->tempo > 0) {
+        m_tempo = p_song->tempo;
+    }
+
+    m_prepareStop = 0;
+    m_lastPlayerStatus = STOPPED;
+    lastPartIndex = -1;
+    mixer_setOutputLevel(MIXER_DEFAULT_LEVEL);
+    SongPlayer_externalStart();
+
+    // The notes of the previous song were all posted before the position of the switch
+    mp_previousSong = p_song;
+    m_previousSongFrame = (quint64)m_songPosition.frame();
+
+    m_status.songSwitchCount++;
+    updateStatus(true);
+}
+
+/**
+ * @brief Player::retirePreviousSong
+ *        Give the data of the previous song back to the GUI thread, which unlocks and frees it
+ */
+void Player::retirePreviousSong(void)
+{
+    // Otherwise tried again on the next pull
+    if (m_retiredSongs.push(mp_previousSong)) {
+        mp_previousSong = nullptr;
+    }
+}
+
+/**
+ * @brief Player::retireSong
+ *        Give a song nothing reads anymore to the GUI thread, at the end of the play
+ */
+void Player::retireSong(PreparedSong *p_song)
+{
+    if (p_song && !m_retiredSongs.push(p_song)) {
+        p_song->unlockMemory();
+        delete p_song;
+    }
+}
+
+/**
+ * @brief Player::releaseSongs
+ *        Unlock and free the songs given back by the audio thread, in the GUI thread
+ */
+void Player::releaseSongs(void)
+{
+    PreparedSong *p_song;
+
+    // The locks are counted, the data still played by another song stays locked
+    while (m_retiredSongs.pop(p_song)) {
+        p_song->unlockMemory();
+        delete p_song;
+    }
+}
+
+/**
+ * @brief Player::lockData
+ *        Keep the drumset, the song and its effects in memory while playing, so that the
+ *        first hit of a sample never waits for the disk. Each one that does not fit in
+ *        RLIMIT_MEMLOCK is left pageable.
+ */
+void Player::lockData(void)
+{
+    PreparedSong playing;
+
+    playing.song = m_song;
+    playing.drumset = m_drumset;
+    for (int i = 0; i < MAX_SONG_PARTS; i++) {
+        playing.effects[i] = m_effects[i];
+    }
+
+    qint64 lockedSize = playing.lockMemory();
+    m_lockedData.swap(playing.lockedData);
+    m_lockedDrumset.swap(playing.lockedDrumset);
+    qDebug() << "Player::lockData -" << lockedSize << "bytes locked in memory";
+}
+
+void Player::unlockData(void)
+{
+    for (const auto &region : m_lockedData) {
+        RealTime::unlockMemory(region.first, region.second);
+    }
+    for (const auto &region : m_lockedDrumset) {
+        RealTime::unlockMemory(region.first, region.second);
+    }
+    m_lockedData.clear();
+    m_lockedDrumset.clear();
+}
+
+/**
+ * @brief Player::startAudio
+ *        Start the sink pulling from the source, in the audio thread
+ */
+void Player::startAudio(QIODevice *p_source)
+{
+    m_pullCount = 0;
+    m_sinkUnderrunCount = mp_audioSink->underrunCount();
+
+    mp_audioSink->start(p_source);
+
+    // The actual sizes are only known once started
+    m_audioBufferSize_bytes = mp_audioSink->bufferSize();
+    m_audioStats.bufferSize_bytes = m_audioBufferSize_bytes;
+    m_audioStats.bytesPerSecond = m_format.bytesForDuration(1000000);
+    m_periodTime_ms = m_format.durationForBytes(mp_audioSink->periodSize()) / 1000;
+    qDebug() << "Player::startAudio - buffer" << m_format.durationForBytes(m_audioBufferSize_bytes) / 1000 << "ms,"
+             << "period" << m_periodTime_ms << "ms";
+}
+
+/**
+ * @brief Player::prepareNextSong
+ *        Load the next song of the setlist in the background, it is switched to by playNextSong
+ * @param drumsetPath Drumset of the song, empty to keep the one playing
+ */
+void Player::prepareNextSong(const QString &songPath, const QString &drumsetPath, int tempo)
+{
+    if (songPath == m_nextSongPath) {
+        return;
+    }
+    m_nextSongPath = songPath;
+    dropPreparedSong();
+    m_nextSongRequested = false;
+    // The drumset playing is the same cache entry, it is not switched then
+    m_songPreparer.prepare(songPath, drumsetPath, m_effectsPath, tempo, m_realTimeAudio);
+}
+
+/**
+ * @brief Player::playNextSong
+ *        Switch to the next song on the next bar, as soon as it is prepared
+ * @return false if there is no next song, or if a single track is playing
+ */
+bool Player::playNextSong(void)
+{
+    if (!isRunning() || m_singleTrack || m_nextSongPath.isEmpty()) {
+        return false;
+    }
+    m_nextSongRequested = true;
+    pushNextSong();
+    return true;
+}
+
+/**
+ * @brief Player::cancelNextSong
+ *        Forget the next song unless it is already queued, a preparation in progress is ignored
+ */
+void Player::cancelNextSong(void)
+{
+    m_nextSongPath.clear();
+    dropPreparedSong();
+    m_nextSongRequested = false;
+}
+
+/**
+ * @brief Player::dropPreparedSong
+ *        Forget the prepared song that was not queued, it is unlocked here since nothing else owns it
+ */
+void Player::dropPreparedSong(void)
+{
+    m_preparedSong.unlockMemory();
+    m_preparedSong = PreparedSong();
+}
+
+/**
+ * @brief Player::pushNextSong
+ *        Queue the prepared song for the audio thread, one switch at a time
+ */
+void Player::pushNextSong(void)
+{
+    if (!m_nextSongRequested || !m_preparedSong.isValid() || m_switchingSong.isValid()) {
+        return;
+    }
+    // The queued song owns the data and its locks from now on
+    PreparedSong *p_song = new PreparedSong(m_preparedSong);
+    if (m_nextSongs.push(p_song)) {
+        m_switchingSong = m_preparedSong;
+        m_nextSongPath.clear();
+        m_preparedSong = PreparedSong();
+        m_nextSongRequested = false;
+    } else {
+        delete p_song;
+    }
+}
+
+void Player::slotSongPrepared(const PreparedSong &song)
+{
+    // Otherwise another song was selected since, the locks of the preparer are released
+    if (song.songPath != m_nextSongPath) {
+        PreparedSong stale = song;
+        stale.unlockMemory();
+        return;
+    }
+    dropPreparedSong();
+    m_preparedSong = song;
+    pushNextSong();
+}
+
+void Player::slotSongPreparationFailed(const QString &songPath)
+{
+    if (songPath != m_nextSongPath) {
+        return;
+    }
+    m_nextSongPath.clear();
+    m_nextSongRequested = false;
+    emit sigNextSongFailed(songPath);
 }
 
 /* DO NOT CALL THIS FUNCTION FROM AUDIO THREAD */
@@ -566,22 +1184,31 @@ void Player::play(void)
         m_stop = 0;
         m_prepareStop = 0;
 
-        if (m_audioOutput) {
-            delete m_audioOutput;
-            m_audioOutput = nullptr;
-        }
-
-        m_ioDevice = nullptr;
-
         m_drumset.clear();
         m_song.clear();
 
-        m_processedSamples_real = 0;
+        m_songPosition.reset(m_tempo);
 
-        m_queue.clear();
+        m_commands.clear();
+        releaseSongs();
+        m_statsQueue.clear();
+        m_stats.clear();
 
         m_lastPlayerStatus = STOPPED;
 
+        // Start from the buffering time adapted by the previous plays
+        if (!m_adaptiveBuffering || m_bufferTimeChanged) {
+            m_targetBufferTime_ms = m_bufferTime_ms;
+            m_bufferTimeChanged = false;
+        }
+        if (m_adaptiveBuffering) {
+            m_targetBufferTime_ms = qBound(m_bufferMinTime_ms, m_targetBufferTime_ms, m_bufferMaxTime_ms);
+        }
+        m_reopenAudio = false;
+        m_status.underrunCount = 0;
+        m_status.bufferTime_ms = m_targetBufferTime_ms;
+
+        m_statusTimer.start();
         start(QThread::TimeCriticalPriority);
     } else {
         stop();
@@ -595,6 +1222,8 @@ void Player::stop(void)
     if (isRunning()) {
         qDebug() << "Stopping audio thread";
         m_stop = 1;
+        // Leave the event loop of the audio thread if the output is not pulling anymore
+        quit();
     }
 }
 
@@ -631,6 +1260,17 @@ void Player::setEffectsPath(const QString &path)
     m_effectsPath = path;
 }
 
+/**
+ * @brief Player::setAudioSink
+ *        Select where the next play sends the audio, the default output device by default
+ * @param filepath WAV file written by the File sink
+ */
+void Player::setAudioSink(AudioSink::Type type, const QString &filepath)
+{
+    m_audioSinkType = type;
+    m_audioSinkPath = filepath;
+}
+
 void Player::setAutoPilot(bool autoPilot)
 {
     m_AutoPilot = autoPilot;
@@ -652,46 +1292,36 @@ int Player::getTempo(void){
 void Player::pedalPress(void)
 {
     if (!m_singleTrack){
-        m_lock.lockForWrite();
-        m_queue.enqueue(BUTTON_EVENT_PEDAL_PRESS);
-        m_lock.unlock();
+        queueCommand(BUTTON_EVENT_PEDAL_PRESS);
     }
 }
 
 void Player::pedalRelease(void)
 {
-   if (!m_singleTrack){
-        m_lock.lockForWrite();
-        m_queue.enqueue(BUTTON_EVENT_PEDAL_RELEASE);
-        m_lock.unlock();
-   }
+    if (!m_singleTrack){
+        queueCommand(BUTTON_EVENT_PEDAL_RELEASE);
+    }
 }
 
 
 void Player::pedalLongPress(void)
 {
     if (!m_singleTrack){
-        m_lock.lockForWrite();
-        m_queue.enqueue(BUTTON_EVENT_PEDAL_LONG_PRESS);
-        m_lock.unlock();
+        queueCommand(BUTTON_EVENT_PEDAL_LONG_PRESS);
     }
 }
 
 void Player::pedalDoubleTap(void)
 {
     if (!m_singleTrack){
-        m_lock.lockForWrite();
-        m_queue.enqueue(BUTTON_EVENT_PEDAL_MULTI_TAP);
-        m_lock.unlock();
+        queueCommand(BUTTON_EVENT_PEDAL_MULTI_TAP);
     }
 }
 
 void Player::effect(void)
 {
     if (!m_singleTrack){
-        m_lock.lockForWrite();
-        m_queue.enqueue(BUTTON_EVENT_FOOT_SECONDARY_PRESS);
-        m_lock.unlock();
+        queueCommand(BUTTON_EVENT_FOOT_SECONDARY_PRESS);
     }
 }
 
@@ -704,4 +1334,27 @@ void Player::slotSetBufferTime_ms(int time_ms){
    } else {
       m_bufferTime_ms = time_ms;
    }
+   m_bufferTimeChanged = true;
+}
+
+/**
+ * @brief Player::slotSetAdaptiveBuffering
+ *        Let the player grow the buffering time after underruns and shrink it after plays
+ *        without any, between the given bounds. Applies from the next play.
+ */
+void Player::slotSetAdaptiveBuffering(bool enabled, int minTime_ms, int maxTime_ms)
+{
+   m_bufferMinTime_ms = qBound(MIXER_MIN_BUFFERRING_TIME_MS, minTime_ms, MIXER_MAX_BUFFERRING_TIME_MS);
+   m_bufferMaxTime_ms = qBound(m_bufferMinTime_ms, maxTime_ms, MIXER_MAX_BUFFERRING_TIME_MS);
+   m_adaptiveBuffering = enabled;
+}
+
+/**
+ * @brief Player::slotSetRealTimeAudio
+ *        Run the audio thread with real-time priority and lock the data it plays in memory,
+ *        as far as the system allows. Applies from the next play.
+ */
+void Player::slotSetRealTimeAudio(bool enabled)
+{
+   m_realTimeAudio = enabled;
 }
@@ -2,17 +2,86 @@
 #define PLAYER_H
 
 #include <QThread>
-#include <QAudioOutput>
+#include <QAudioFormat>
 #include <QIODevice>
 #include <QTime>
+#include <QTimer>
+#include <QElapsedTimer>
 #include <QString>
-#include <QQueue>
-#include <QReadWriteLock>
+#include <QVector>
+#include <QPair>
 
 #include "button.h"
 #include "../model/filegraph/song.h"
 #include "songPlayer.h"
 #include "mixer.h"
+#include "engineContext.h"
+#include "engineCache.h"
+#include "spscQueue.h"
+#include "audioSink.h"
+#include "playerStats.h"
+#include "realTime.h"
+#include "songPreparer.h"
+
+#define TICK_TO_TIME_RATIO(bpm)     ((60.0f / (double)bpm) / 480.0f)
+#define PREPARE_STOP_THREASHOLD     (5)         // In 16 bits LSB, whatever the output format
+
+// NOTE: these defines can be used due to hardcoded initialization of m_format
+// Units: sample/s
+#define SAMPLE_PER_SECOND           44100.0f
+// Units: ticks/refresh
+#define TICKS_PER_REFRESH           5
+// Units: sample/refresh = ticks/refresh * s/tick * sample/s
+#define SAMPLES_PER_REFRESH(bpm)  (TICKS_PER_REFRESH * TICK_TO_TIME_RATIO(bpm) * SAMPLE_PER_SECOND)
+
+// Pedal events waiting for the audio thread
+#define PLAYER_COMMAND_QUEUE_SIZE   (64)
+// Status waiting for the GUI thread, more than a second of audio loop
+#define PLAYER_STATUS_QUEUE_SIZE    (256)
+// Units: ms, period at which the GUI thread signals the status of the audio thread
+#define PLAYER_STATUS_POLL_MS       (10)
+// Units: ms, period at which the audio thread publishes its statistics
+#define PLAYER_STATS_PUBLISH_MS     (250)
+
+// Adaptive buffering: the buffering time grows by half after an underrun and shrinks
+// by a fifth after a play of at least 30 s without any
+#define PLAYER_BUFFER_GROW_PERCENT      (50)
+#define PLAYER_BUFFER_SHRINK_PERCENT    (20)
+#define PLAYER_BUFFER_SHRINK_AFTER_MS   (30000)
+
+/**
+ * @brief The SongPosition class
+ *
+ * Frame of the song position, computed from the ticks processed instead of summing the
+ * samples of each refresh, so that long plays do not drift. A tempo change counts the
+ * following ticks from the position where it happened.
+ */
+class SongPosition
+{
+public:
+    SongPosition() { reset(120); }
+
+    inline void reset(int bpm) { m_tick = m_tempoTick = m_tempoFrame = 0; m_bpm = bpm; }
+    inline void setTempo(int bpm)
+    {
+        if (bpm > 0 && bpm != m_bpm) {
+            m_tempoFrame = frame();
+            m_tempoTick = m_tick;
+            m_bpm = bpm;
+        }
+    }
+    inline void advance(int ticks) { m_tick += ticks; }
+    inline qint64 frame(int ticksAhead = 0) const
+    {
+        return m_tempoFrame + SongPlayer_ticksToFrames(m_tick + ticksAhead - m_tempoTick, m_bpm);
+    }
+
+private:
+    qint64 m_tick;
+    qint64 m_tempoTick;
+    qint64 m_tempoFrame;
+    int m_bpm;
+};
 
 class Player : public QThread
 {
@@ -37,40 +106,120 @@ public:
 
     inline int tempo(){return m_tempo;}
 
-    inline bool started(){return m_prevStarted;}
-    inline int sigNum(){return m_prevSigNum;}
-    inline int beatInBar(){return m_prevBeatInBar;}
-    inline partEnum part(){return m_prevPart;}
+    inline bool started(){return m_shown.started;}
+    inline int sigNum(){return m_shown.sigNum;}
+    inline int beatInBar(){return m_shown.beatInBar;}
+    inline partEnum part(){return m_shown.part;}
     inline int bufferTime_ms(){return m_bufferTime_ms;}
+    inline int periodTime_ms(){return m_periodTime_ms;}
+    inline int underrunCount(){return m_shown.underrunCount;}
+    inline int adaptedBufferTime_ms(){return m_shown.bufferTime_ms;}
+    // Statistics of the current play, or of the last one once stopped
+    inline const PlayerStats &stats(){return m_stats;}
+
+    // Setlist: the next song is prepared while the current one plays, then switched to
+    // on a bar boundary without stopping the sound
+    void prepareNextSong(const QString &songPath, const QString &drumsetPath, int tempo);
+    bool playNextSong(void);
+    void cancelNextSong(void);
 
-    void updateTempo();
-    
 private:
-    void initAudio(void);
+    class AudioSource;
+
+    // Pedal event sent by the GUI thread to the audio thread
+    struct Command {
+        BUTTON_EVENT event;
+        qint64 time_ms;                     // From m_clock, when the pedal was used
+    };
+
+    // Snapshot of the audio thread, queued once per loop when something changed
+    struct Status {
+        bool started;
+        partEnum part;
+        int sigNum;
+        int beatInBar;
+        int tick;
+        int tempo;                          // Last tempo set by the song
+        quint32 tempoCount;                 // Incremented each time the song sets the tempo
+        SongPlayer_PlayerStatus playing;    // Last part started by the song
+        unsigned int partIndex;
+        unsigned int drumfillIndex;
+        quint32 playingCount;               // Incremented each time a part is started
+        int underrunCount;                  // Since the start of the play
+        int bufferTime_ms;                  // Buffering time in use
+        quint32 songSwitchCount;            // Incremented each time the next song is switched to
+        bool forceEmit;                     // Signal all the values, changed or not, not compared
+
+        bool operator==(const Status &other) const;
+        inline bool operator!=(const Status &other) const {return !(*this == other);}
+    };
+
+    void updateTempo();
+    void notifyPlaying(SongPlayer_PlayerStatus status, unsigned int partIndex, unsigned int drumfillIndex);
+    void queueCommand(BUTTON_EVENT event);
+    bool initAudio(void);
     void initMixer(void);
     void loadDrumset(const QString &filepath);
     bool loadSong(const QString &filepath);
     bool loadEffect(int part, const QString &filepath);
     void clearEffect(int part);
     int processTime(int samplesToProcess);
-    void processAudio(int samplesToProcess);
+    void processAudio(char *data, int samplesToProcess);
+    qint64 renderAudio(char *data, qint64 maxlen);
+    void startAudio(QIODevice *p_source);
+    void processUnderrun(void);
     void processEvent(void);
     void updateStatus(bool forceEmit);
+    void publishStatus(void);
+    void updateStats(qint64 pullStart_ns);
+    void lockData(void);
+    void unlockData(void);
+    void dropPreparedSong(void);
+    void pushNextSong(void);
+    int ticksToSongSwitch(void);
+    void switchSong(void);
+    void retirePreviousSong(void);
+    void retireSong(PreparedSong *p_song);
+    void releaseSongs(void);
+    void processSong(int updateCount);
+    bool startSong(void);
+    void playAudio(void);
     void run(void);
 
-    QAudioDeviceInfo m_device;
-    QAudioOutput *m_audioOutput;
-    QIODevice *m_ioDevice;
+    AudioSink::Type m_audioSinkType;
+    QString m_audioSinkPath;
+    AudioSink *mp_audioSink;    // Audio thread
     QAudioFormat m_format;
 
-    QByteArray m_drumset;
+    // Instance of the engine used by the thread of the player
+    EngineContext m_engine;
+
+    QSharedPointer<const EngineCache::Drumset> m_drumset;
     QByteArray m_song;
     QByteArray m_effects[MAX_SONG_PARTS];
 
-    unsigned int m_soundCardLimit;
-    char m_buffer[MIXER_BUFFER_LENGTH_BYTES_STEREO];
+    int m_bytesPerFrame;    // Depends on the output format negotiated with the device
+    MIXER_outputFormat_t m_outputFormat;
+    bool m_floatMixEngine;
     int m_bufferTime_ms;
     int m_bufferSize_bytes; // NOTE: m_bufferSize_bytes is only computed at start of thread.
+    int m_periodTime_ms;    // Negotiated with the device at start of thread
+
+    // Adaptive buffering
+    bool m_adaptiveBuffering;
+    int m_bufferMinTime_ms;
+    int m_bufferMaxTime_ms;
+    bool m_bufferTimeChanged;       // By the user, the adapted buffering time starts again from it
+    int m_targetBufferTime_ms;      // Buffering time in use, kept from one play to the next
+    bool m_reopenAudio;             // The sink is opened again with m_targetBufferTime_ms
+    int m_audioBufferSize_bytes;    // Actual size of the buffer of the sink
+    int m_sinkUnderrunCount;
+    int m_pullCount;
+
+    // Real-time priority of the audio thread and data kept in memory while playing
+    bool m_realTimeAudio;
+    QVector<QPair<const char *, qint64> > m_lockedData;      // Audio thread, song and effects
+    QVector<QPair<const char *, qint64> > m_lockedDrumset;   // Audio thread
     MIDIPARSER_MidiTrack mp_singleTrack;
     int m_singleTrackOffset;
     bool m_singleTrack;
@@ -89,19 +238,40 @@ private:
     int m_trailingSounds;
     int m_stop;
 
-    double m_processedSamples_real;
+    SongPosition m_songPosition;
 
-    QReadWriteLock m_lock;
-    QQueue<BUTTON_EVENT> m_queue;
+    // Setlist
+    SongPreparer m_songPreparer;
+    QString m_nextSongPath;                 // GUI thread, being prepared
+    PreparedSong m_preparedSong;            // GUI thread, ready to be queued
+    bool m_nextSongRequested;               // GUI thread, queued as soon as prepared
+    PreparedSong m_switchingSong;           // GUI thread, queued and not switched to yet
+    SpscQueue<PreparedSong *, 2> m_nextSongs;       // Owned by the audio thread once queued
+    SpscQueue<PreparedSong *, 8> m_retiredSongs;    // Back to the GUI thread to be freed
+    PreparedSong *mp_pendingSong;           // Audio thread, switched to at the next bar
+    int m_ticksToSwitch;
+    PreparedSong *mp_previousSong;          // Audio thread, kept while sounds still read it
+    quint64 m_previousSongFrame;            // Mixer clock of the switch
+
+    // Neither thread ever waits for the other one
+    SpscQueue<Command, PLAYER_COMMAND_QUEUE_SIZE> m_commands;
+    SpscQueue<Status, PLAYER_STATUS_QUEUE_SIZE> m_statusQueue;
+    QElapsedTimer m_clock;
+    QTimer m_statusTimer;
 
     SongPlayer_PlayerStatus m_lastPlayerStatus;
 
     // for status
-    bool m_prevStarted;
-    int m_prevSigNum;
-    int m_prevBeatInBar;
-    int m_prevTick;
-    partEnum m_prevPart;
+    Status m_status;        // Audio thread, being updated
+    Status m_published;     // Audio thread, last one queued
+    Status m_shown;         // GUI thread, last one signaled
+
+    // Instrumentation, timed with m_clock
+    PlayerStats m_audioStats;   // Audio thread, being recorded
+    PlayerStats m_stats;        // GUI thread, last one published
+    SpscQueue<PlayerStats, 4> m_statsQueue;
+    qint64 m_lastPull_ns;
+    qint64 m_lastStatsPublish_ns;
 
 
 signals:
@@ -121,6 +291,10 @@ signals:
     void sigBeatInBarChanged(int);
     void sigPartChanged(int);
     void sigTempoChangedBySong(int);
+    void sigAudioUnderrun(int count, int bufferTime_ms);
+    void sigStatsUpdated(void);
+    void sigSongSwitched(const QString &songPath);
+    void sigNextSongFailed(const QString &songPath);
 
 public slots:
     void play(void);
@@ -130,6 +304,7 @@ public slots:
     void setSong(const QString &path);
     void setSingleTrack(const QByteArray &trackData = QByteArray(), int trackIndex = -1, int typeId = -1, int partIndex = -1);
     void setEffectsPath(const QString &path);
+    void setAudioSink(AudioSink::Type type, const QString &filepath = QString());
     void setTempo(int bpm);
     int getTempo(void);
 
@@ -142,6 +317,14 @@ public slots:
 
     void effect(void);
     void slotSetBufferTime_ms(int time_ms);
+    void slotSetAdaptiveBuffering(bool enabled, int minTime_ms, int maxTime_ms);
+    void slotSetRealTimeAudio(bool enabled);
+
+private slots:
+    void slotPollStatus(void);
+    void slotFinished(void);
+    void slotSongPrepared(const PreparedSong &song);
+    void slotSongPreparationFailed(const QString &songPath);
 };
 
 #endif // PLAYER_H
@@ -0,0 +1,152 @@
+/*
+  	This software and the content provided for use with it is Copyright © 2014-2020 Singular Sound
+ 	BeatBuddy Manager is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2 as published by
+    the Free Software Foundation.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include <QCoreApplication>
+#include <QStringList>
+#include <string.h>
+
+#include "playerStats.h"
+
+void PlayerStats::Histogram::add(qint64 duration_ns)
+{
+    quint64 us;
+    int bucket = 0;
+
+    if (duration_ns < 0) {
+        duration_ns = 0;
+    }
+    count++;
+    total_ns += (quint64)duration_ns;
+    if ((quint64)duration_ns > max_ns) {
+        max_ns = (quint64)duration_ns;
+    }
+
+    for (us = (quint64)duration_ns / 1000; us != 0 && bucket < PLAYER_STATS_BUCKETS - 1; us >>= 1) {
+        bucket++;
+    }
+    buckets[bucket]++;
+}
+
+/**
+ * @brief PlayerStats::Histogram::percentile_ns
+ * @return Upper bound of the bucket that holds the percentile, at most the longest duration
+ */
+qint64 PlayerStats::Histogram::percentile_ns(int percent) const
+{
+    quint64 target = (count * (quint64)percent + 99) / 100;
+    quint64 sum = 0;
+
+    for (int i = 0; i < PLAYER_STATS_BUCKETS - 1; i++) {
+        sum += buckets[i];
+        if (sum >= target) {
+            return (qint64)qMin(((quint64)1 << i) * 1000, max_ns);
+        }
+    }
+    return (qint64)max_ns;
+}
+
+PlayerStats::PlayerStats()
+{
+    clear();
+}
+
+void PlayerStats::clear(void)
+{
+    memset(histograms, 0, sizeof(histograms));
+    activeVoices = 0;
+    peakVoices = 0;
+    stolenVoices = 0;
+    cutVoices = 0;
+    underrunCount = 0;
+    bufferSize_bytes = 0;
+    bufferFill_bytes = 0;
+    minBufferFill_bytes = -1;
+    bytesPerSecond = 0;
+    frames = 0;
+}
+
+QString PlayerStats::measureName(Measure measure)
+{
+    switch (measure) {
+    case SongTime:      return QCoreApplication::translate("PlayerStats", "Song");
+    case MixTime:       return QCoreApplication::translate("PlayerStats", "Mixer");
+    case PullTime:      return QCoreApplication::translate("PlayerStats", "Pull");
+    case PullInterval:  return QCoreApplication::translate("PlayerStats", "Pull interval");
+    default:            return QString();
+    }
+}
+
+static QString formatDuration(qint64 ns)
+{
+    if (ns >= 10000000) {
+        return QString("%1 ms").arg(ns / 1000000.0, 0, 'f', 1);
+    }
+    return QString("%1 us").arg(ns / 1000.0, 0, 'f', 1);
+}
+
+static int bytesToMs(int bytes, int bytesPerSecond)
+{
+    return bytesPerSecond > 0 ? (int)((qint64)bytes * 1000 / bytesPerSecond) : 0;
+}
+
+/**
+ * @brief PlayerStats::toString
+ *        Summary then one histogram per measure, for the log and the statistics dialog
+ */
+QString PlayerStats::toString(void) const
+{
+    QStringList lines;
+
+    lines << QString("Played %1 s, %2 underruns")
+             .arg(frames / 44100.0, 0, 'f', 1)
+             .arg(underrunCount);
+    lines << QString("Buffer %1 ms, filled with %2 ms at the last pull, %3 ms at the lowest")
+             .arg(bytesToMs(bufferSize_bytes, bytesPerSecond))
+             .arg(bytesToMs(bufferFill_bytes, bytesPerSecond))
+             .arg(bytesToMs(qMax(minBufferFill_bytes, 0), bytesPerSecond));
+    lines << QString("Voices %1 playing, %2 at the peak, %3 stolen, %4 cut")
+             .arg(activeVoices).arg(peakVoices).arg(stolenVoices).arg(cutVoices);
+    lines << QString();
+    lines << QString("%1 %2 %3 %4 %5 %6")
+             .arg("", -14).arg("count", 10).arg("mean", 12).arg("p50", 12).arg("p99", 12).arg("max", 12);
+
+    for (int m = 0; m < MeasureCount; m++) {
+        const Histogram &h = histograms[m];
+        lines << QString("%1 %2 %3 %4 %5 %6")
+                 .arg(measureName((Measure)m), -14)
+                 .arg(h.count, 10)
+                 .arg(formatDuration(h.count ? (qint64)(h.total_ns / h.count) : 0), 12)
+                 .arg(formatDuration(h.percentile_ns(50)), 12)
+                 .arg(formatDuration(h.percentile_ns(99)), 12)
+                 .arg(formatDuration((qint64)h.max_ns), 12);
+    }
+
+    for (int m = 0; m < MeasureCount; m++) {
+        const Histogram &h = histograms[m];
+        QStringList buckets;
+        for (int i = 0; i < PLAYER_STATS_BUCKETS; i++) {
+            if (h.buckets[i]) {
+                if (i < PLAYER_STATS_BUCKETS - 1) {
+                    buckets << QString("<%1:%2").arg(formatDuration(((qint64)1 << i) * 1000)).arg(h.buckets[i]);
+                } else {
+                    buckets << QString("more:%1").arg(h.buckets[i]);
+                }
+            }
+        }
+        lines << QString();
+        lines << measureName((Measure)m);
+        lines << "  " + buckets.join("  ");
+    }
+    return lines.join("\n");
+}
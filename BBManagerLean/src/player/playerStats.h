@@ -0,0 +1,60 @@
+#ifndef PLAYERSTATS_H
+#define PLAYERSTATS_H
+
+#include <QtGlobal>
+#include <QString>
+
+// Bucket i of a histogram counts the durations below 2^i us, the last one all the longer ones
+#define PLAYER_STATS_BUCKETS        (24)
+
+/**
+ * @brief The PlayerStats class
+ *
+ * Timings and counters of one play, recorded by the audio thread at every pull of the
+ * audio output. Recording a duration is a few additions, so it is always on.
+ * Plain data, copied as a whole to the GUI thread.
+ */
+class PlayerStats
+{
+public:
+    enum Measure {
+        SongTime,           // SongPlayer state machine, processTime
+        MixTime,            // mixer_ReadOutputStream
+        PullTime,           // Whole pull, what the audio output waits for
+        PullInterval,       // Between the start of two pulls
+        MeasureCount
+    };
+
+    struct Histogram {
+        quint64 count;
+        quint64 total_ns;
+        quint64 max_ns;
+        quint32 buckets[PLAYER_STATS_BUCKETS];
+
+        void add(qint64 duration_ns);
+        qint64 percentile_ns(int percent) const;
+    };
+
+    PlayerStats();
+
+    void clear(void);
+    inline void add(Measure measure, qint64 duration_ns) { histograms[measure].add(duration_ns); }
+
+    QString toString(void) const;
+    static QString measureName(Measure measure);
+
+    Histogram histograms[MeasureCount];
+
+    int activeVoices;
+    int peakVoices;
+    int stolenVoices;
+    int cutVoices;
+    int underrunCount;
+    int bufferSize_bytes;
+    int bufferFill_bytes;       // At the last pull
+    int minBufferFill_bytes;    // Lowest seen at a pull, -1 before the first one
+    int bytesPerSecond;
+    qint64 frames;              // Rendered since the start of the play
+};
+
+#endif // PLAYERSTATS_H
@@ -0,0 +1,168 @@
+/*
+  	This software and the content provided for use with it is Copyright © 2014-2020 Singular Sound 
+ 	BeatBuddy Manager is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2 as published by
+    the Free Software Foundation.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include <QDebug>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include "realTime.h"
+
+#if defined(Q_OS_LINUX)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(Q_OS_UNIX)
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Number of lockMemory() of each page, by page address. mlock() is not counted by the system.
+static QMutex LockMutex;
+static QHash<quintptr, int> LockCounts;
+
+/**
+ * @brief RealTime::promoteCurrentThread
+ *        Run the calling thread under SCHED_FIFO, at the priority allowed by RLIMIT_RTPRIO
+ *        if REALTIME_FIFO_PRIORITY is not. Otherwise lower its niceness if RLIMIT_NICE allows it.
+ *        The thread keeps its scheduling until it ends.
+ * @param p_description Set with what was obtained, for the log
+ * @return false if the thread is still scheduled like the others
+ */
+bool RealTime::promoteCurrentThread(QString *p_description)
+{
+    QString description;
+    bool promoted = false;
+
+#if defined(Q_OS_LINUX)
+    int policy = SCHED_FIFO;
+#if defined(SCHED_RESET_ON_FORK)
+    // Processes started from the audio thread are not real-time
+    policy |= SCHED_RESET_ON_FORK;
+#endif
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = qBound(sched_get_priority_min(SCHED_FIFO), REALTIME_FIFO_PRIORITY, sched_get_priority_max(SCHED_FIFO));
+
+    int err = pthread_setschedparam(pthread_self(), policy, &param);
+    if (err == EPERM) {
+        // Unprivileged users may still be allowed a lower priority
+        struct rlimit limit;
+        if (getrlimit(RLIMIT_RTPRIO, &limit) == 0 && limit.rlim_cur > 0
+            && limit.rlim_cur < (rlim_t)param.sched_priority) {
+            param.sched_priority = (int)limit.rlim_cur;
+            err = pthread_setschedparam(pthread_self(), policy, &param);
+        }
+    }
+
+    if (err == 0) {
+        description = QString("SCHED_FIFO priority %1").arg(param.sched_priority);
+        promoted = true;
+    } else if (setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), REALTIME_NICE_FALLBACK) == 0) {
+        description = QString("real-time scheduling refused (%1), niceness %2").arg(strerror(err)).arg(REALTIME_NICE_FALLBACK);
+        promoted = true;
+    } else {
+        description = QString("real-time scheduling refused (%1), niceness refused (%2)").arg(strerror(err)).arg(strerror(errno));
+    }
+#else
+    description = "not supported on this system";
+#endif
+
+    if (p_description) {
+        *p_description = description;
+    }
+    return promoted;
+}
+
+/**
+ * @brief RealTime::lockMemory
+ *        Keep the pages of a region in memory, they are read from the disk now if they were not yet.
+ *        A mapped file is locked as long as it is mapped. The locks are counted by page: a page
+ *        shared by several regions stays locked until each of them is unlocked.
+ * @return false if not allowed, usually because of RLIMIT_MEMLOCK (ulimit -l). The region must
+ *         not be unlocked then.
+ */
+bool RealTime::lockMemory(const void *data, qint64 size)
+{
+#if defined(Q_OS_UNIX)
+    if (!data || size <= 0) {
+        return false;
+    }
+    // Whole pages, as POSIX requires
+    quintptr pageSize = (quintptr)sysconf(_SC_PAGESIZE);
+    quintptr start = (quintptr)data & ~(pageSize - 1);
+    quintptr end = (quintptr)data + (quintptr)size;
+
+    QMutexLocker locker(&LockMutex);
+    // Even the pages already counted, they may belong to a new mapping since
+    if (mlock((const void *)start, (size_t)(end - start)) != 0) {
+        qWarning() << "RealTime::lockMemory - unable to lock" << size << "bytes -" << strerror(errno);
+        return false;
+    }
+    for (quintptr page = start; page < end; page += pageSize) {
+        LockCounts[page]++;
+    }
+    return true;
+#else
+    Q_UNUSED(data);
+    Q_UNUSED(size);
+    return false;
+#endif
+}
+
+/**
+ * @brief RealTime::unlockMemory
+ *        Release a region locked by lockMemory(), before it is freed. Only the pages no other
+ *        region keeps locked are unlocked.
+ */
+void RealTime::unlockMemory(const void *data, qint64 size)
+{
+#if defined(Q_OS_UNIX)
+    if (!data || size <= 0) {
+        return;
+    }
+    quintptr pageSize = (quintptr)sysconf(_SC_PAGESIZE);
+    quintptr start = (quintptr)data & ~(pageSize - 1);
+    quintptr end = (quintptr)data + (quintptr)size;
+    quintptr unlockStart = 0;
+
+    QMutexLocker locker(&LockMutex);
+    // By runs of consecutive pages left without lock
+    for (quintptr page = start; page < end; page += pageSize) {
+        auto it = LockCounts.find(page);
+        bool unlock = it == LockCounts.end() || --it.value() == 0;
+        if (unlock && it != LockCounts.end()) {
+            LockCounts.erase(it);
+        }
+        if (unlock && !unlockStart) {
+            unlockStart = page;
+        } else if (!unlock && unlockStart) {
+            munlock((const void *)unlockStart, (size_t)(page - unlockStart));
+            unlockStart = 0;
+        }
+    }
+    if (unlockStart) {
+        munlock((const void *)unlockStart, (size_t)(end - unlockStart));
+    }
+#else
+    Q_UNUSED(data);
+    Q_UNUSED(size);
+#endif
+}
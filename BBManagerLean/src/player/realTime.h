@@ -0,0 +1,29 @@
+#ifndef REALTIME_H
+#define REALTIME_H
+
+#include <QString>
+#include <QtGlobal>
+
+// Priority of the audio thread under SCHED_FIFO, below the threaded interrupt handlers (50)
+#define REALTIME_FIFO_PRIORITY      (40)
+// Niceness tried when real-time scheduling is not allowed
+#define REALTIME_NICE_FALLBACK      (-10)
+
+/**
+ * @brief The RealTime class
+ *
+ * Scheduling and memory locking for the audio thread, each call falls back gracefully
+ * when the system or the limits of the user do not allow it. Only does something on
+ * Linux for the scheduling and on Unix systems for the memory, elsewhere the calls fail
+ * and the priority given to QThread::start() applies.
+ */
+class RealTime
+{
+public:
+    static bool promoteCurrentThread(QString *p_description = nullptr);
+
+    static bool lockMemory(const void *data, qint64 size);
+    static void unlockMemory(const void *data, qint64 size);
+};
+
+#endif // REALTIME_H
@@ -0,0 +1,285 @@
+/*
+  	This software and the content provided for use with it is Copyright © 2014-2020 Singular Sound 
+ 	BeatBuddy Manager is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2 as published by
+    the Free Software Foundation.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QMutexLocker>
+#include <QtEndian>
+#include <QtMath>
+#include <QDebug>
+#include <string.h>
+
+#include "resampler.h"
+#include "mixerKernels.h"
+#include "audioSink.h"
+
+static int greatestCommonDivisor(int a, int b)
+{
+    while (b != 0) {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+static double besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+
+    for (int k = 1; k < 64 && term > 1e-12 * sum; k++) {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+/**
+ * @brief Resampler::Resampler
+ *        Build the filter of the conversion from inputRate to RESAMPLER_OUTPUT_RATE
+ */
+Resampler::Resampler(int inputRate)
+{
+    int divisor = greatestCommonDivisor(RESAMPLER_OUTPUT_RATE, inputRate);
+    m_up = RESAMPLER_OUTPUT_RATE / divisor;
+    m_down = inputRate / divisor;
+    m_phases = qMin(m_up, RESAMPLER_MAX_PHASES);
+
+    // Cutoff relative to the input rate, below the Nyquist frequency of the lowest rate.
+    // When downsampling the filter gets longer to keep the same steepness.
+    double cutoff = qMin(1.0, (double)m_up / m_down) * RESAMPLER_ROLLOFF;
+    int half = qCeil(RESAMPLER_ZERO_CROSSINGS / cutoff);
+    double windowScale = besselI0(RESAMPLER_KAISER_BETA);
+    m_taps = 2 * half;
+
+    m_filter.resize(m_phases * m_taps);
+    for (int p = 0; p < m_phases; p++) {
+        float *h = m_filter.data() + p * m_taps;
+        double sum = 0.0;
+
+        for (int k = 0; k < m_taps; k++) {
+            // Distance from the output sample to input sample k of the filter
+            double t = k - (half - 1) - (double)p / m_phases;
+            double x = t / half;
+            double window = (qAbs(x) <= 1.0) ? besselI0(RESAMPLER_KAISER_BETA * qSqrt(1.0 - x * x)) / windowScale : 0.0;
+            double sinc = (t == 0.0) ? 1.0 : qSin(M_PI * cutoff * t) / (M_PI * cutoff * t);
+            h[k] = (float)(cutoff * sinc * window);
+            sum += h[k];
+        }
+        // Unity gain at DC for every phase
+        for (int k = 0; k < m_taps; k++) {
+            h[k] = (float)(h[k] / sum);
+        }
+    }
+
+    mixerKernel_init();
+}
+
+/**
+ * @brief Resampler::isNeeded
+ * @return true if samples at this rate must be converted and can be
+ */
+bool Resampler::isNeeded(int rate)
+{
+    return rate != RESAMPLER_OUTPUT_RATE && rate >= RESAMPLER_MIN_RATE && rate <= RESAMPLER_MAX_RATE;
+}
+
+/**
+ * @brief Resampler::process
+ * @param data PCM samples, interleaved when stereo
+ * @param channels 1 or 2
+ * @param nSample Sum of the samples of all the channels
+ * @return 24 bits PCM samples at RESAMPLER_OUTPUT_RATE, with the same channels
+ */
+QByteArray Resampler::process(const char *data, int nSample, int bitsPerSample, int channels) const
+{
+    const unsigned char *src = (const unsigned char *)data;
+    int bytesPerSample = bitsPerSample / 8;
+    int inFrames = nSample / channels;
+    int outFrames = (int)(((qint64)inFrames * m_up + m_down - 1) / m_down);
+    int half = m_taps / 2;
+
+    // Each channel on its own, with silence before and after for the filter.
+    // Same scale as the mixer: the MSB of the sample on bit 23.
+    QVector<float> input[2];
+    for (int c = 0; c < channels; c++) {
+        input[c].fill(0.0f, inFrames + m_taps + 1);
+        float *x = input[c].data() + half;
+        for (int i = 0; i < inFrames; i++) {
+            const unsigned char *p = src + (i * channels + c) * bytesPerSample;
+            if (bitsPerSample == 16) {
+                x[i] = (float)((int32_t)(int16_t)(p[0] | (p[1] << 8)) * 256);
+            } else {
+                x[i] = (float)(((int32_t)((uint32_t)(p[0] | (p[1] << 8) | (p[2] << 16)) << 8)) >> 8);
+            }
+        }
+    }
+
+    QByteArray output(outFrames * channels * 3, '\0');
+    unsigned char *dst = (unsigned char *)output.data();
+    for (int n = 0; n < outFrames; n++) {
+        qint64 position = (qint64)n * m_down;
+        int i = (int)(position / m_up);
+        int phase = (int)((position % m_up) * m_phases / m_up);
+        const float *h = m_filter.constData() + phase * m_taps;
+
+        for (int c = 0; c < channels; c++) {
+            float y = mixerKernel_dotFloat(h, input[c].constData() + i + 1, (unsigned int)m_taps);
+            // The filter may overshoot full scale
+            int32_t v = qRound(qBound(-8388608.0f, y, 8388607.0f));
+            dst[0] = (unsigned char)v;
+            dst[1] = (unsigned char)(v >> 8);
+            dst[2] = (unsigned char)(v >> 16);
+            dst += 3;
+        }
+    }
+    return output;
+}
+
+ResampleCache::ResampleCache()
+    : m_useCount(0)
+    , m_size(0)
+{
+}
+
+ResampleCache *ResampleCache::instance()
+{
+    static ResampleCache cache;
+    return &cache;
+}
+
+QSharedPointer<const Resampler> ResampleCache::resampler(int rate)
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_resamplers.find(rate);
+    if (it == m_resamplers.end()) {
+        it = m_resamplers.insert(rate, QSharedPointer<const Resampler>(new Resampler(rate)));
+    }
+    return *it;
+}
+
+/**
+ * @brief ResampleCache::resample
+ *        Samples converted by Resampler::process, from the cache if they were already.
+ *        The data is shared with the cache, use constData() to read it.
+ * @return empty if the format is not supported
+ */
+QByteArray ResampleCache::resample(const char *data, int nSample, int bitsPerSample, int channels, int rate)
+{
+    if (!data || nSample <= 0 || (bitsPerSample != 16 && bitsPerSample != 24)
+        || (channels != 1 && channels != 2) || !Resampler::isNeeded(rate)) {
+        return QByteArray();
+    }
+
+    QByteArray source = QByteArray::fromRawData(data, nSample * (bitsPerSample / 8));
+    QByteArray key = QCryptographicHash::hash(source, QCryptographicHash::Sha1);
+    key.append(QString(" %1 %2 %3").arg(bitsPerSample).arg(channels).arg(rate).toLatin1());
+
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_entries.find(key);
+        if (it != m_entries.end()) {
+            it->lastUse = ++m_useCount;
+            return it->value;
+        }
+    }
+
+    // Converted without the lock, the other threads can use the cache meanwhile
+    QByteArray converted = resampler(rate)->process(data, nSample, bitsPerSample, channels);
+    if (converted.size() > RESAMPLER_CACHE_MAX_BYTES) {
+        return converted;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    auto it = m_entries.find(key);
+    if (it != m_entries.end()) {
+        m_size -= it->value.size();
+        m_entries.erase(it);
+    }
+    while (!m_entries.isEmpty() && m_size + converted.size() > RESAMPLER_CACHE_MAX_BYTES) {
+        auto oldest = m_entries.begin();
+        for (it = m_entries.begin(); it != m_entries.end(); ++it) {
+            if (it->lastUse < oldest->lastUse) {
+                oldest = it;
+            }
+        }
+        m_size -= oldest->value.size();
+        m_entries.erase(oldest);
+    }
+    m_entries.insert(key, Entry{ ++m_useCount, converted });
+    m_size += converted.size();
+    return converted;
+}
+
+/**
+ * @brief ResampleCache::convertWav
+ *        Convert a PCM WAV file at another rate than RESAMPLER_OUTPUT_RATE to a 24 bits one
+ * @param converted Set with the new file
+ * @return false if the file does not need a conversion or has an unsupported format
+ */
+bool ResampleCache::convertWav(const QByteArray &wav, QByteArray &converted)
+{
+    const char *file = wav.constData();
+    const char *fmt = nullptr;
+    const char *samples = nullptr;
+    qint64 samplesSize = 0;
+
+    if (wav.size() < 12 || memcmp(file, "RIFF", 4) != 0 || memcmp(file + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+
+    // Chunks are padded to an even size
+    for (qint64 pos = 12; pos + 8 <= wav.size(); ) {
+        qint64 size = qFromLittleEndian<quint32>((const uchar *)file + pos + 4);
+        qint64 available = qMin(size, wav.size() - pos - 8);
+        if (memcmp(file + pos, "fmt ", 4) == 0 && available >= 16) {
+            fmt = file + pos + 8;
+        } else if (memcmp(file + pos, "data", 4) == 0) {
+            samples = file + pos + 8;
+            samplesSize = available;
+            break;
+        }
+        pos += 8 + size + (size & 1);
+    }
+    if (!fmt || !samples) {
+        return false;
+    }
+
+    int audioFormat = qFromLittleEndian<quint16>((const uchar *)fmt);
+    int channels = qFromLittleEndian<quint16>((const uchar *)fmt + 2);
+    int rate = (int)qFromLittleEndian<quint32>((const uchar *)fmt + 4);
+    int bitsPerSample = qFromLittleEndian<quint16>((const uchar *)fmt + 14);
+    if (audioFormat != 1 || (bitsPerSample != 16 && bitsPerSample != 24) || !Resampler::isNeeded(rate)) {
+        return false;
+    }
+
+    QByteArray data = resample(samples, (int)(samplesSize / (bitsPerSample / 8)), bitsPerSample, channels, rate);
+    if (data.isEmpty()) {
+        return false;
+    }
+
+    QBuffer buffer(&converted);
+    buffer.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    FileAudioSink::writeWavHeader(&buffer, 24, (quint32)data.size(), channels);
+    buffer.write(data);
+    return true;
+}
+
+void ResampleCache::clear(void)
+{
+    QMutexLocker locker(&m_mutex);
+    m_entries.clear();
+    m_size = 0;
+}
@@ -0,0 +1,83 @@
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QVector>
+
+// Units: Hz, the only rate the mixer plays
+#define RESAMPLER_OUTPUT_RATE           (44100)
+#define RESAMPLER_MIN_RATE              (8000)
+#define RESAMPLER_MAX_RATE              (192000)
+// Windowed sinc: zero crossings on each side of the filter, bandwidth kept
+// below the lowest Nyquist frequency and shape of the Kaiser window
+#define RESAMPLER_ZERO_CROSSINGS        (48)
+#define RESAMPLER_ROLLOFF               (0.92)
+#define RESAMPLER_KAISER_BETA           (9.0)
+// Odd ratios use the nearest of this many filter phases
+#define RESAMPLER_MAX_PHASES            (4096)
+// Total size of the converted samples kept by ResampleCache
+#define RESAMPLER_CACHE_MAX_BYTES       (128 * 1024 * 1024)
+
+/**
+ * @brief The Resampler class
+ *
+ * Converts 16 or 24 bits PCM at any rate between RESAMPLER_MIN_RATE and RESAMPLER_MAX_RATE
+ * to 24 bits PCM at RESAMPLER_OUTPUT_RATE, with a polyphase windowed sinc filter.
+ * Done once when the samples are loaded, the mixer only plays RESAMPLER_OUTPUT_RATE.
+ * The filter is only read once built, a resampler can be used by several threads.
+ */
+class Resampler
+{
+    Q_DISABLE_COPY(Resampler)
+
+public:
+    explicit Resampler(int inputRate);
+
+    static bool isNeeded(int rate);
+
+    QByteArray process(const char *data, int nSample, int bitsPerSample, int channels) const;
+
+private:
+    int m_up;           // Output rate / input rate = m_up / m_down
+    int m_down;
+    int m_phases;
+    int m_taps;
+    QVector<float> m_filter;    // m_taps coefficients per phase
+};
+
+/**
+ * @brief The ResampleCache class
+ *
+ * Process wide cache of the converted samples, keyed by a hash of the source samples so
+ * that a sample is never converted twice, whatever the file it comes from.
+ * The least recently used conversions are dropped first. All the functions are thread safe.
+ */
+class ResampleCache
+{
+public:
+    static ResampleCache *instance();
+
+    QByteArray resample(const char *data, int nSample, int bitsPerSample, int channels, int rate);
+    bool convertWav(const QByteArray &wav, QByteArray &converted);
+    void clear(void);
+
+private:
+    struct Entry {
+        quint64 lastUse;
+        QByteArray value;
+    };
+
+    ResampleCache();
+    QSharedPointer<const Resampler> resampler(int rate);
+
+    QMutex m_mutex;
+    quint64 m_useCount;
+    QHash<int, QSharedPointer<const Resampler> > m_resamplers;
+    QHash<QByteArray, Entry> m_entries;
+    qint64 m_size;
+};
+
+#endif // RESAMPLER_H
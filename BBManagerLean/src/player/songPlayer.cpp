@@ -32,6 +32,7 @@
 #include "songPlayer.h"
 #include "soundManager.h"
 #include "settings.h"
+#include "threadLocal.h"
 
 
 /*****************************************************************************
@@ -89,12 +90,13 @@ typedef SONG_SongPartStruct SongPart_t;
  **                      	INTERNAL MACROS
  *****************************************************************************/
 #define POST_EVENT_MAX_TICK         (200)
+#define SONG_CACHE_SIZE             (8)         // Prepared songs kept by each instance
 
-#define MAIN_LOOP_PTR(partPtr)         (partPtr->mainLoopIndex+1        ? &Tracks[partPtr->mainLoopIndex] : 0)
-#define TRANS_FILL_PTR(partPtr)        (partPtr->transFillIndex+1       ? &Tracks[partPtr->transFillIndex] : 0)
-#define DRUM_FILL_PTR(partPtr, index)  (partPtr->drumFillIndex[index]+1 ? &Tracks[partPtr->drumFillIndex[index]] : 0)
-#define INTRO_TRACK_PTR(songPtr)       (songPtr->intro.mainLoopIndex+1  ? &Tracks[songPtr->intro.mainLoopIndex] : 0)
-#define OUTRO_TRACK_PTR(songPtr)       (songPtr->outro.mainLoopIndex+1  ? &Tracks[songPtr->outro.mainLoopIndex] : 0)
+#define MAIN_LOOP_PTR(partPtr)         (partPtr->mainLoopIndex+1        ? &Ctx->Tracks[partPtr->mainLoopIndex] : 0)
+#define TRANS_FILL_PTR(partPtr)        (partPtr->transFillIndex+1       ? &Ctx->Tracks[partPtr->transFillIndex] : 0)
+#define DRUM_FILL_PTR(partPtr, index)  (partPtr->drumFillIndex[index]+1 ? &Ctx->Tracks[partPtr->drumFillIndex[index]] : 0)
+#define INTRO_TRACK_PTR(songPtr)       (songPtr->intro.mainLoopIndex+1  ? &Ctx->Tracks[songPtr->intro.mainLoopIndex] : 0)
+#define OUTRO_TRACK_PTR(songPtr)       (songPtr->outro.mainLoopIndex+1  ? &Ctx->Tracks[songPtr->outro.mainLoopIndex] : 0)
 
 #ifndef FALSE
 #define FALSE false
@@ -118,7 +120,7 @@ typedef SONG_SongPartStruct SongPart_t;
  **                     INTERNAL FUNCTION PROTOTYPE
  *****************************************************************************/
 
-static bool isEndOfTrack(int pos, SONG_SongPartStruct *CurrPartPtr/*, int loop, int loopCount*/);
+static bool isEndOfTrack(int pos, SONG_SongPartStruct *partPtr/*, int loop, int loopCount*/);
 
 static void TrackPlay(MIDIPARSER_MidiTrack *track, int startTick, int endTick, float ratio,
         int manualOffset, unsigned int partID);
@@ -167,75 +169,107 @@ static void ResetBeatCounter(void);
  **                         INTERNAL GLOBAL VARIABLES
  *****************************************************************************/
 
-// Variable for the song and the track in the player
-static SONG_SongStruct *CurrSongPtr = nullptr;
-static SONG_SongPartStruct *CurrPartPtr;
-
-static volatile int MasterTick = 0;
-static int TmpMasterPartTick = 0;
-
-static volatile unsigned int PartIndex; // Current part index of the song
-static unsigned int DrumFillIndex;      // Current drumfill index of the current part
-
-AUTOPILOT_AutoPilotDataStruct * APPtr;
-uint32_t BeatCounter = 0;
-int32_t AutopilotAction = FALSE;
-int32_t AutopilotCueFill = FALSE;
-int32_t AutopilotTransitionCount;
-unsigned int currentLoopTick = -1; // Stores the current tick of the loop, start at infinity.
-int32_t newEnd = 0;
-int32_t addedTick = 0;//to fill the currentLoopon Pick up note cases
-bool playingPickUp = false;//to avoid counting a beat when is a pick up note
-
-QMap<int, int> idxs;//key playAt value real index
-
-static int PartStopSyncTick;
-static int PartStopPickUpSyncTickLength;
-
-static int DrumFillStartSyncTick;
-static int DrumFillPickUpSyncTickLength;
-
-static int TranFillStartSyncTick;
-static int TranFillStopSyncTick;
-static int TranFillPickUpSyncTickLength;
-
-static uint8_t PedalPressFlag; // Important to eliminate drumfill when quitting tap windows by the long pedal press
-static uint8_t PedalPresswDrumFillFlag = 0;
-static uint8_t TransPedalPressFlag = FALSE;
-static uint8_t WasPausedFlag;
-static uint8_t MultiTapCounter;
-static uint8_t WasLongPressed;
-
-static uint8_t DelayStartCmd = 0;
-static volatile SongPlayer_PlayerStatus PlayerStatus;
-static volatile SongPlayer_PlayerStatus LastPlayerStatus;
-static volatile SongPlayer_PlayerStatus UnPausedPlayerStatus;
-static volatile SongPlayer_PlayerStatus PausedPlayerStatus;
-static volatile SongFlags_t RequestFlag;
-
-static Player_FootswitchActions PrimaryFootSwitchPlayingAction;
-static Player_FootswitchActions PrimaryFootSwitchStoppedAction;
-static Player_FootswitchActions SecondaryFootSwitchPlayingAction;
-static Player_FootswitchActions SecondaryFootSwitchStoppedAction;
-static PLAYER_actions MainUnpauseModeTapToFill = START_FILL;
-static PLAYER_actions MainUnpauseModeHoldToTransition = START_TRANSITION;
-static int8_t ActivePauseEnable = DEFAULT_ACTIVE_PAUSE;
-static int8_t TrippleTapEnable  = DEFAULT_TRIPLE_TAP_STOP;
-static int8_t StartBeatOnPress;
-
-static uint32_t NextPartNumber;
-static int8_t SendStopOnPause = 0;
-static int8_t SendStopOnEnd = 0;
-
-static SONGFILE_FileStruct *CurrSongFilePtr = nullptr;
-static std::vector<MIDIPARSER_MidiTrack> Tracks;
-static MIDIPARSER_MidiTrack *SingleMidiTrackPtr = nullptr;
+// Frame of each event of a track from its tick 0, compiled at the tempo of the player
+typedef struct {
+    unsigned int bpm = 0;               // 0 until compiled
+    std::vector<int64_t> frame;
+} SongPlayer_timeline_t;
+
+// Tracks of a song already read and adjusted, see SwapPreparedSong() and SongPlayer_prepareSong()
+struct SongPlayer_preparedSong_s {
+    uint32_t crc = 0;                               // Of the song file
+    uint32_t length = 0;
+    std::vector<MIDIPARSER_MidiTrack> tracks;
+    std::vector<SongPlayer_timeline_t> timelines;
+};
 
+// Variable for the song and the track in the player, one set per instance (see SongPlayer_setContext)
+struct SongPlayer_context_s {
+    SONG_SongStruct *CurrSongPtr = nullptr;
+    SONG_SongPartStruct *CurrPartPtr = nullptr;
+
+    volatile int MasterTick = 0;
+    int TmpMasterPartTick = 0;
+
+    volatile unsigned int PartIndex = 0; // Current part index of the song
+    unsigned int DrumFillIndex = 0;      // Current drumfill index of the current part
+
+    AUTOPILOT_AutoPilotDataStruct * APPtr = nullptr;
+    uint32_t BeatCounter = 0;
+    int32_t AutopilotAction = FALSE;
+    int32_t AutopilotCueFill = FALSE;
+    int32_t AutopilotTransitionCount = 0;
+    unsigned int currentLoopTick = -1; // Stores the current tick of the loop, start at infinity.
+    int32_t newEnd = 0;
+    int32_t addedTick = 0;//to fill the currentLoopon Pick up note cases
+    bool playingPickUp = false;//to avoid counting a beat when is a pick up note
+
+    QMap<int, int> idxs;//key playAt value real index
+
+    int PartStopSyncTick = 0;
+    int PartStopPickUpSyncTickLength = 0;
+
+    int DrumFillStartSyncTick = 0;
+    int DrumFillPickUpSyncTickLength = 0;
+
+    int TranFillStartSyncTick = 0;
+    int TranFillStopSyncTick = 0;
+    int TranFillPickUpSyncTickLength = 0;
+
+    uint8_t PedalPressFlag = 0; // Important to eliminate drumfill when quitting tap windows by the long pedal press
+    uint8_t PedalPresswDrumFillFlag = 0;
+    uint8_t TransPedalPressFlag = FALSE;
+    uint8_t WasPausedFlag = 0;
+    uint8_t MultiTapCounter = 0;
+    uint8_t WasLongPressed = 0;
+    unsigned long long LastMultiTapTime = 0;
+
+    uint8_t DelayStartCmd = 0;
+    volatile SongPlayer_PlayerStatus PlayerStatus = NO_SONG_LOADED;
+    volatile SongPlayer_PlayerStatus LastPlayerStatus = NO_SONG_LOADED;
+    volatile SongPlayer_PlayerStatus UnPausedPlayerStatus = NO_SONG_LOADED;
+    volatile SongPlayer_PlayerStatus PausedPlayerStatus = NO_SONG_LOADED;
+    volatile SongFlags_t RequestFlag = REQUEST_DONE;
+
+    Player_FootswitchActions PrimaryFootSwitchPlayingAction = ACTION_NONE;
+    Player_FootswitchActions PrimaryFootSwitchStoppedAction = ACTION_NONE;
+    Player_FootswitchActions SecondaryFootSwitchPlayingAction = ACTION_NONE;
+    Player_FootswitchActions SecondaryFootSwitchStoppedAction = ACTION_NONE;
+    PLAYER_actions MainUnpauseModeTapToFill = START_FILL;
+    PLAYER_actions MainUnpauseModeHoldToTransition = START_TRANSITION;
+    int8_t ActivePauseEnable = DEFAULT_ACTIVE_PAUSE;
+    int8_t TrippleTapEnable  = DEFAULT_TRIPLE_TAP_STOP;
+    int8_t StartBeatOnPress = 0;
+
+    uint32_t NextPartNumber = 0;
+    int8_t SendStopOnPause = 0;
+    int8_t SendStopOnEnd = 0;
+
+    SONGFILE_FileStruct *CurrSongFilePtr = nullptr;
+    std::vector<MIDIPARSER_MidiTrack> Tracks;
+    MIDIPARSER_MidiTrack *SingleMidiTrackPtr = nullptr;
+
+    // Frame of the events of each track at TimelineTempo, see TrackTimeline()
+    std::vector<SongPlayer_timeline_t> Timelines;
+    SongPlayer_timeline_t SingleTimeline;
+    unsigned int TimelineTempo = 120;
+
+    // Song file of Tracks, 0 when they are not to be cached
+    uint32_t TracksCrc = 0;
+    uint32_t TracksLength = 0;
+    std::vector<SongPlayer_preparedSong_t> SongCache;  // Most recently played first
+
+
+    uint32_t SobrietyDrumTranFill = 0;
+    uint32_t SobriertySpecialEffectTickDelay = 0;
+
+    uint32_t Test = 0;
+};
 
-static uint32_t SobrietyDrumTranFill;
-static uint32_t SobriertySpecialEffectTickDelay;
+static SongPlayer_context_t DefaultContext;
 
-static uint32_t Test;
+// Context of the calling thread
+static THREAD_LOCAL SongPlayer_context_t *Ctx = &DefaultContext;
 
 
 /*****************************************************************************
@@ -248,29 +282,74 @@ static uint32_t Test;
  */
 void SongPlayer_init(void) {
 
-    PlayerStatus = NO_SONG_LOADED;
-    RequestFlag = REQUEST_DONE;
+    Ctx->PlayerStatus = NO_SONG_LOADED;
+    Ctx->RequestFlag = REQUEST_DONE;
 
-    PedalPressFlag = 0; // Important to eliminate drumfill when quitting tap windows by the long pedal press
-    WasPausedFlag = 0;
-    MultiTapCounter = 0;
-    WasLongPressed = 0;
-    Test = 0;
+    Ctx->PedalPressFlag = 0; // Important to eliminate drumfill when quitting tap windows by the long pedal press
+    Ctx->WasPausedFlag = 0;
+    Ctx->MultiTapCounter = 0;
+    Ctx->WasLongPressed = 0;
+    Ctx->Test = 0;
 
-    PrimaryFootSwitchPlayingAction = ACTION_SPECIAL_EFFECT;
-    PrimaryFootSwitchStoppedAction = ACTION_SPECIAL_EFFECT;
-    SecondaryFootSwitchPlayingAction = ACTION_SPECIAL_EFFECT;
-    SecondaryFootSwitchStoppedAction = ACTION_SPECIAL_EFFECT;
+    Ctx->PrimaryFootSwitchPlayingAction = ACTION_SPECIAL_EFFECT;
+    Ctx->PrimaryFootSwitchStoppedAction = ACTION_SPECIAL_EFFECT;
+    Ctx->SecondaryFootSwitchPlayingAction = ACTION_SPECIAL_EFFECT;
+    Ctx->SecondaryFootSwitchStoppedAction = ACTION_SPECIAL_EFFECT;
 
    // AutopilotFeature = DEFAULT_AUTOPILOT_FEATURE;
-    SobrietyDrumTranFill = 0;
-    SobriertySpecialEffectTickDelay = 0;
+    Ctx->SobrietyDrumTranFill = 0;
+    Ctx->SobriertySpecialEffectTickDelay = 0;
 
 
-    CurrSongPtr = nullptr;
-    APPtr = nullptr;
+    Ctx->CurrSongPtr = nullptr;
+    Ctx->APPtr = nullptr;
 
-    NextPartNumber = 0;
+    Ctx->NextPartNumber = 0;
+}
+
+/**
+ * @brief SongPlayer_createContext
+ *    Allocate an initialised song player instance, independent of the others
+ * @return the new context, free it with SongPlayer_destroyContext
+ */
+SongPlayer_context_t *SongPlayer_createContext(void) {
+    SongPlayer_context_t *context = new SongPlayer_context_t();
+    SongPlayer_context_t *previous = SongPlayer_setContext(context);
+
+    SongPlayer_init();
+    SongPlayer_setContext(previous);
+
+    return context;
+}
+
+/**
+ * @brief SongPlayer_destroyContext
+ *    Free a context created by SongPlayer_createContext. It must not be the context of another thread.
+ */
+void SongPlayer_destroyContext(SongPlayer_context_t *context) {
+    if (context == nullptr || context == &DefaultContext) {
+        return;
+    }
+    if (Ctx == context) {
+        Ctx = &DefaultContext;
+    }
+    delete context;
+}
+
+/**
+ * @brief SongPlayer_setContext
+ *    Select the instance the song player functions work on in the calling thread
+ * @param context to use, nullptr for the default context shared by the threads that never select one
+ * @return the previous context of the thread
+ */
+SongPlayer_context_t *SongPlayer_setContext(SongPlayer_context_t *context) {
+    SongPlayer_context_t *previous = Ctx;
+    Ctx = (context != nullptr) ? context : &DefaultContext;
+    return previous;
+}
+
+SongPlayer_context_t *SongPlayer_getContext(void) {
+    return Ctx;
 }
 
 
@@ -281,37 +360,37 @@ int32_t SongPlayer_getBeatInbar(int32_t *startBeat) {
     *startBeat = 0;
 
 
-        if (CurrPartPtr != nullptr ) {
-            switch (PlayerStatus) {
+        if (Ctx->CurrPartPtr != nullptr ) {
+            switch (Ctx->PlayerStatus) {
 
             case NO_SONG_LOADED:
             case STOPPED:
                 return_value = -2;
                 break;
           case INTRO:
-                if (CurrPartPtr != nullptr ) {
+                if (Ctx->CurrPartPtr != nullptr ) {
                     // Calculate the offset for not complete intro ( 2 beat in 4/4) ( 6 beat in 4/4)
-                    offset = MAIN_LOOP_PTR(CurrPartPtr)->barLength
-                            - (MAIN_LOOP_PTR(CurrPartPtr)->nTick
-                                    % MAIN_LOOP_PTR(CurrPartPtr)->barLength);
-                    return_value = (((MasterTick + offset)
-                            / (MAIN_LOOP_PTR(CurrPartPtr)->barLength
-                                    / MAIN_LOOP_PTR(CurrPartPtr)->timeSigNum))
-                            % MAIN_LOOP_PTR(CurrPartPtr)->timeSigNum);
+                    offset = MAIN_LOOP_PTR(Ctx->CurrPartPtr)->barLength
+                            - (MAIN_LOOP_PTR(Ctx->CurrPartPtr)->nTick
+                                    % MAIN_LOOP_PTR(Ctx->CurrPartPtr)->barLength);
+                    return_value = (((Ctx->MasterTick + offset)
+                            / (MAIN_LOOP_PTR(Ctx->CurrPartPtr)->barLength
+                                    / MAIN_LOOP_PTR(Ctx->CurrPartPtr)->timeSigNum))
+                            % MAIN_LOOP_PTR(Ctx->CurrPartPtr)->timeSigNum);
                 } else {
                     return_value = 0;
                 }
 
                 break;
             case PAUSED:
-                if (CurrPartPtr != nullptr ) {
-                    if (!ActivePauseEnable) {
+                if (Ctx->CurrPartPtr != nullptr ) {
+                    if (!Ctx->ActivePauseEnable) {
                         return_value = -2;
                     } else {
-                        return_value = ((MasterTick
-                                / (MAIN_LOOP_PTR(CurrPartPtr)->barLength
-                                        / MAIN_LOOP_PTR(CurrPartPtr)->timeSigNum))
-                                % MAIN_LOOP_PTR(CurrPartPtr)->timeSigNum);
+                        return_value = ((Ctx->MasterTick
+                                / (MAIN_LOOP_PTR(Ctx->CurrPartPtr)->barLength
+                                        / MAIN_LOOP_PTR(Ctx->CurrPartPtr)->timeSigNum))
+                                % MAIN_LOOP_PTR(Ctx->CurrPartPtr)->timeSigNum);
                     }
                 }
                 break;
@@ -326,30 +405,30 @@ int32_t SongPlayer_getBeatInbar(int32_t *startBeat) {
             case OUTRO:
             case OUTRO_CANCELED:
             case OUTRO_WAITING_TRIG:
-            if (CurrPartPtr != nullptr ) {
-                return_value = ((MasterTick
-                        / (MAIN_LOOP_PTR(CurrPartPtr)->barLength
-                                / MAIN_LOOP_PTR(CurrPartPtr)->timeSigNum))
-                        % MAIN_LOOP_PTR(CurrPartPtr)->timeSigNum);
+            if (Ctx->CurrPartPtr != nullptr ) {
+                return_value = ((Ctx->MasterTick
+                        / (MAIN_LOOP_PTR(Ctx->CurrPartPtr)->barLength
+                                / MAIN_LOOP_PTR(Ctx->CurrPartPtr)->timeSigNum))
+                        % MAIN_LOOP_PTR(Ctx->CurrPartPtr)->timeSigNum);
             }
                 break;
             case TRANFILL_ACTIVE:
             case TRANFILL_QUITING:
             case TRANFILL_CANCEL:
-                if (CurrPartPtr != nullptr ) {
-                    return_value = (MasterTick
-                            / (TRANS_FILL_PTR(CurrPartPtr)->barLength
-                                    / TRANS_FILL_PTR(CurrPartPtr)->timeSigNum)
-                                    % TRANS_FILL_PTR(CurrPartPtr)->timeSigNum);
+                if (Ctx->CurrPartPtr != nullptr ) {
+                    return_value = (Ctx->MasterTick
+                            / (TRANS_FILL_PTR(Ctx->CurrPartPtr)->barLength
+                                    / TRANS_FILL_PTR(Ctx->CurrPartPtr)->timeSigNum)
+                                    % TRANS_FILL_PTR(Ctx->CurrPartPtr)->timeSigNum);
                 }
                 break;
             case DRUMFILL_ACTIVE:
-                if (CurrPartPtr != nullptr ) {
+                if (Ctx->CurrPartPtr != nullptr ) {
                 return_value =
-                        (MasterTick
-                                / (DRUM_FILL_PTR(CurrPartPtr, DrumFillIndex)->barLength
-                                        / DRUM_FILL_PTR(CurrPartPtr, DrumFillIndex)->timeSigNum)
-                                        % DRUM_FILL_PTR(CurrPartPtr, DrumFillIndex)->timeSigNum);
+                        (Ctx->MasterTick
+                                / (DRUM_FILL_PTR(Ctx->CurrPartPtr, Ctx->DrumFillIndex)->barLength
+                                        / DRUM_FILL_PTR(Ctx->CurrPartPtr, Ctx->DrumFillIndex)->timeSigNum)
+                                        % DRUM_FILL_PTR(Ctx->CurrPartPtr, Ctx->DrumFillIndex)->timeSigNum);
                 }
                 break;
             default:
@@ -357,12 +436,12 @@ int32_t SongPlayer_getBeatInbar(int32_t *startBeat) {
             break;
         }
 
-    } else if (PlayerStatus == SINGLE_TRACK_PLAYER && SingleMidiTrackPtr != nullptr ){
+    } else if (Ctx->PlayerStatus == SINGLE_TRACK_PLAYER && Ctx->SingleMidiTrackPtr != nullptr ){
         return_value =
-                (MasterTick
-                        / (SingleMidiTrackPtr->barLength
-                                / SingleMidiTrackPtr->timeSigNum)
-                                % SingleMidiTrackPtr->timeSigNum);
+                (Ctx->MasterTick
+                        / (Ctx->SingleMidiTrackPtr->barLength
+                                / Ctx->SingleMidiTrackPtr->timeSigNum)
+                                % Ctx->SingleMidiTrackPtr->timeSigNum);
 
     } else {
         return_value = -2;
@@ -373,35 +452,35 @@ int32_t SongPlayer_getBeatInbar(int32_t *startBeat) {
 }
 
 int SongPlayer_getMasterTick(void) {
-    if (CurrSongPtr && CurrPartPtr && PlayerStatus == INTRO) {
+    if (Ctx->CurrSongPtr && Ctx->CurrPartPtr && Ctx->PlayerStatus == INTRO) {
         // Calculate the offset for not complete intro ( 2 beat in 4/4) ( 6 beat in 4/4)
-        return MasterTick + MAIN_LOOP_PTR(CurrPartPtr)->barLength
-                            - (MAIN_LOOP_PTR(CurrPartPtr)->nTick
-                                    % MAIN_LOOP_PTR(CurrPartPtr)->barLength);
+        return Ctx->MasterTick + MAIN_LOOP_PTR(Ctx->CurrPartPtr)->barLength
+                            - (MAIN_LOOP_PTR(Ctx->CurrPartPtr)->nTick
+                                    % MAIN_LOOP_PTR(Ctx->CurrPartPtr)->barLength);
     }
-    return MasterTick;
+    return Ctx->MasterTick;
 }
 
 int SongPlayer_getbarLength(){
     unsigned char status = IntDisable();
     int result;
-    if (CurrSongPtr != nullptr) {
-        if (CurrPartPtr != nullptr) {
-            if (MAIN_LOOP_PTR(CurrPartPtr)) {
-                result = MAIN_LOOP_PTR(CurrPartPtr)->barLength;
+    if (Ctx->CurrSongPtr != nullptr) {
+        if (Ctx->CurrPartPtr != nullptr) {
+            if (MAIN_LOOP_PTR(Ctx->CurrPartPtr)) {
+                result = MAIN_LOOP_PTR(Ctx->CurrPartPtr)->barLength;
                 IntEnable(status);
             }
-        } else if (INTRO_TRACK_PTR(CurrSongPtr)) {
-            result = INTRO_TRACK_PTR(CurrSongPtr)->barLength;
+        } else if (INTRO_TRACK_PTR(Ctx->CurrSongPtr)) {
+            result = INTRO_TRACK_PTR(Ctx->CurrSongPtr)->barLength;
             IntEnable(status);
         } else {
-            result = MAIN_LOOP_PTR( ((SONG_SongPartStruct *)&(CurrSongPtr->part[0])) )->barLength;
+            result = MAIN_LOOP_PTR( ((SONG_SongPartStruct *)&(Ctx->CurrSongPtr->part[0])) )->barLength;
             IntEnable(status);
         }
     }
 
-    else if (PlayerStatus == SINGLE_TRACK_PLAYER && SingleMidiTrackPtr != NULL ){
-        result = SingleMidiTrackPtr->barLength;
+    else if (Ctx->PlayerStatus == SINGLE_TRACK_PLAYER && Ctx->SingleMidiTrackPtr != NULL ){
+        result = Ctx->SingleMidiTrackPtr->barLength;
         IntEnable(status);
     }
 
@@ -414,30 +493,30 @@ int SongPlayer_getbarLength(){
 int SongPlayer_getTimeSignature(TimeSignature * timeSig) {
 
     unsigned char status = IntDisable();
-    if (CurrSongPtr != nullptr) {
-        if (CurrPartPtr != nullptr) {
-            if (MAIN_LOOP_PTR(CurrPartPtr)) {
-                timeSig->num = MAIN_LOOP_PTR(CurrPartPtr)->timeSigNum;
-                timeSig->den = MAIN_LOOP_PTR(CurrPartPtr)->timeSigDen;
+    if (Ctx->CurrSongPtr != nullptr) {
+        if (Ctx->CurrPartPtr != nullptr) {
+            if (MAIN_LOOP_PTR(Ctx->CurrPartPtr)) {
+                timeSig->num = MAIN_LOOP_PTR(Ctx->CurrPartPtr)->timeSigNum;
+                timeSig->den = MAIN_LOOP_PTR(Ctx->CurrPartPtr)->timeSigDen;
                 IntEnable(status);
                 return 1;
             }
-        } else if (INTRO_TRACK_PTR(CurrSongPtr)) {
-            timeSig->num = INTRO_TRACK_PTR(CurrSongPtr)->timeSigNum;
-            timeSig->den = INTRO_TRACK_PTR(CurrSongPtr)->timeSigDen;
+        } else if (INTRO_TRACK_PTR(Ctx->CurrSongPtr)) {
+            timeSig->num = INTRO_TRACK_PTR(Ctx->CurrSongPtr)->timeSigNum;
+            timeSig->den = INTRO_TRACK_PTR(Ctx->CurrSongPtr)->timeSigDen;
             IntEnable(status);
             return 1;
         } else {
-            timeSig->num = MAIN_LOOP_PTR( ((SONG_SongPartStruct *)&(CurrSongPtr->part[0])) )->timeSigNum;
-            timeSig->den = MAIN_LOOP_PTR( ((SONG_SongPartStruct *)&(CurrSongPtr->part[0])) )->timeSigDen;
+            timeSig->num = MAIN_LOOP_PTR( ((SONG_SongPartStruct *)&(Ctx->CurrSongPtr->part[0])) )->timeSigNum;
+            timeSig->den = MAIN_LOOP_PTR( ((SONG_SongPartStruct *)&(Ctx->CurrSongPtr->part[0])) )->timeSigDen;
             IntEnable(status);
             return 1;
         }
     }
 
-    else if (PlayerStatus == SINGLE_TRACK_PLAYER && SingleMidiTrackPtr != NULL ){
-        timeSig->num = SingleMidiTrackPtr->timeSigNum;
-        timeSig->den = SingleMidiTrackPtr->timeSigDen;
+    else if (Ctx->PlayerStatus == SINGLE_TRACK_PLAYER && Ctx->SingleMidiTrackPtr != NULL ){
+        timeSig->num = Ctx->SingleMidiTrackPtr->timeSigNum;
+        timeSig->den = Ctx->SingleMidiTrackPtr->timeSigDen;
         IntEnable(status);
         return 1;
     }
@@ -448,8 +527,8 @@ int SongPlayer_getTimeSignature(TimeSignature * timeSig) {
 
 int SongPlayer_getTempo() {
     unsigned char status = IntDisable();
-    if (CurrSongPtr != nullptr && CurrPartPtr != nullptr) {
-       return CurrSongPtr->bpm;
+    if (Ctx->CurrSongPtr != nullptr && Ctx->CurrPartPtr != nullptr) {
+       return Ctx->CurrSongPtr->bpm;
     }
     IntEnable(status);
     return 0;
@@ -463,10 +542,10 @@ void SongPlayer_forceStop(void) {
 
 char* SongPlayer_getSoundEffectName(uint32_t part) {
 
-    if (CurrSongPtr == nullptr) return nullptr;
-    if (part >= CurrSongPtr->nPart) return nullptr;
+    if (Ctx->CurrSongPtr == nullptr) return nullptr;
+    if (part >= Ctx->CurrSongPtr->nPart) return nullptr;
 
-    return (char*)CurrSongPtr->part[part].effectName;
+    return (char*)Ctx->CurrSongPtr->part[part].effectName;
 }
 
 
@@ -481,9 +560,9 @@ void SongPlayer_externalStop(void) {
 void SongPlayer_externalStart(void) {
 
     uint8_t status = IntDisable();
-    if (PlayerStatus == STOPPED) {
-        if (CurrSongPtr != nullptr) {
-            RequestFlag = EXTERNAL_START_REQUEST;
+    if (Ctx->PlayerStatus == STOPPED) {
+        if (Ctx->CurrSongPtr != nullptr) {
+            Ctx->RequestFlag = EXTERNAL_START_REQUEST;
             TEMPO_startWithInt();
         }
     }
@@ -493,8 +572,8 @@ void SongPlayer_externalStart(void) {
 void SongPlayer_externalDrumfill(void) {
     uint8_t status = IntDisable();
     // Trigger a drumfil only if the Main track is playing and there is no pending request
-    if (PlayerStatus == PLAYING_MAIN_TRACK && RequestFlag == REQUEST_DONE) {
-        RequestFlag = DRUMFILL_REQUEST;
+    if (Ctx->PlayerStatus == PLAYING_MAIN_TRACK && Ctx->RequestFlag == REQUEST_DONE) {
+        Ctx->RequestFlag = DRUMFILL_REQUEST;
     }
     IntEnable(status);
 }
@@ -502,19 +581,19 @@ void SongPlayer_externalDrumfill(void) {
 void SongPlayer_externalOutro(void) {
     uint8_t status = IntDisable();
 
-    if (RequestFlag == REQUEST_DONE) {
-        if (PlayerStatus == INTRO || (
-                WasPausedFlag && PlayerStatus == PLAYING_MAIN_TRACK)) {
-            RequestFlag = SWAP_TO_OUTRO_REQUEST;
-        } else if ((PlayerStatus == PLAYING_MAIN_TRACK) ||
-                (PlayerStatus == NO_FILL_TRAN) ||
-                (PlayerStatus == NO_FILL_TRAN_QUITTING) ||
-                (PlayerStatus == TRANFILL_WAITING_TRIG) ||
-                (PlayerStatus == TRANFILL_ACTIVE) ||
-                (PlayerStatus == TRANFILL_QUITING) ||
-                (PlayerStatus == DRUMFILL_WAITING_TRIG) ||
-                (PlayerStatus == DRUMFILL_ACTIVE)) {
-            RequestFlag = STOP_REQUEST;
+    if (Ctx->RequestFlag == REQUEST_DONE) {
+        if (Ctx->PlayerStatus == INTRO || (
+                Ctx->WasPausedFlag && Ctx->PlayerStatus == PLAYING_MAIN_TRACK)) {
+            Ctx->RequestFlag = SWAP_TO_OUTRO_REQUEST;
+        } else if ((Ctx->PlayerStatus == PLAYING_MAIN_TRACK) ||
+                (Ctx->PlayerStatus == NO_FILL_TRAN) ||
+                (Ctx->PlayerStatus == NO_FILL_TRAN_QUITTING) ||
+                (Ctx->PlayerStatus == TRANFILL_WAITING_TRIG) ||
+                (Ctx->PlayerStatus == TRANFILL_ACTIVE) ||
+                (Ctx->PlayerStatus == TRANFILL_QUITING) ||
+                (Ctx->PlayerStatus == DRUMFILL_WAITING_TRIG) ||
+                (Ctx->PlayerStatus == DRUMFILL_ACTIVE)) {
+            Ctx->RequestFlag = STOP_REQUEST;
         }
     }
 
@@ -536,20 +615,20 @@ void SongPlayer_externalOutro(void) {
 void SongPlayer_externalTransition(uint32_t part_number) {
     uint8_t status = IntDisable();
 
-    if (RequestFlag == REQUEST_DONE) {
+    if (Ctx->RequestFlag == REQUEST_DONE) {
         if (part_number == 0 &&
-                ((PlayerStatus == NO_FILL_TRAN) || (PlayerStatus == TRANFILL_WAITING_TRIG) || (PlayerStatus == TRANFILL_ACTIVE))) {
-            RequestFlag = TRANFILL_QUIT_REQUEST;
+                ((Ctx->PlayerStatus == NO_FILL_TRAN) || (Ctx->PlayerStatus == TRANFILL_WAITING_TRIG) || (Ctx->PlayerStatus == TRANFILL_ACTIVE))) {
+            Ctx->RequestFlag = TRANFILL_QUIT_REQUEST;
         } else if (part_number > 0) {
-            if ((PlayerStatus == PAUSED) ||
-                    (PlayerStatus == DRUMFILL_WAITING_TRIG) ||
-                    (PlayerStatus == DRUMFILL_ACTIVE) ||
-                    (PlayerStatus == PLAYING_MAIN_TRACK)) {
-                NextPartNumber = part_number;
-                RequestFlag = TRANFILL_REQUEST;
+            if ((Ctx->PlayerStatus == PAUSED) ||
+                    (Ctx->PlayerStatus == DRUMFILL_WAITING_TRIG) ||
+                    (Ctx->PlayerStatus == DRUMFILL_ACTIVE) ||
+                    (Ctx->PlayerStatus == PLAYING_MAIN_TRACK)) {
+                Ctx->NextPartNumber = part_number;
+                Ctx->RequestFlag = TRANFILL_REQUEST;
                 // Start song on external transition request if the song if stopped
-            } else if (PlayerStatus == STOPPED) {
-                NextPartNumber = part_number;
+            } else if (Ctx->PlayerStatus == STOPPED) {
+                Ctx->NextPartNumber = part_number;
                 SongPlayer_externalStart();
             }
         }
@@ -561,34 +640,70 @@ void SongPlayer_externalTransition(uint32_t part_number) {
 static void ResetSongPosition(void) {
     unsigned char status = IntDisable();
     fillAPIndex();
-    DrumFillIndex = (APPtr)?getNextAPIndex():0;
-    PartIndex = 0;
-    MasterTick = 0;
-    CurrPartPtr = nullptr;
-    if (CurrSongPtr != nullptr) {
-        PlayerStatus = STOPPED;
+    Ctx->DrumFillIndex = (Ctx->APPtr)?getNextAPIndex():0;
+    Ctx->PartIndex = 0;
+    Ctx->MasterTick = 0;
+    Ctx->CurrPartPtr = nullptr;
+    if (Ctx->CurrSongPtr != nullptr) {
+        Ctx->PlayerStatus = STOPPED;
     } else {
-        PlayerStatus = NO_SONG_LOADED;
+        Ctx->PlayerStatus = NO_SONG_LOADED;
     }
     IntEnable(status);
 }
 
 static void ResetBeatCounter(void) {
     unsigned char status = IntDisable();
-    BeatCounter = 0;
+    Ctx->BeatCounter = 0;
     IntEnable(status);
 }
 
 void SongPlayer_getPlayerStatus(SongPlayer_PlayerStatus *playerStatus,
         unsigned int *partIndex, unsigned int *drumfillIndex) {
-    *playerStatus = PlayerStatus;
-    *partIndex = PartIndex;
-    *drumfillIndex = DrumFillIndex;
+    *playerStatus = Ctx->PlayerStatus;
+    *partIndex = Ctx->PartIndex;
+    *drumfillIndex = Ctx->DrumFillIndex;
+}
+
+static bool eventTickLess(const MIDIPARSER_MidiEvent &a, const MIDIPARSER_MidiEvent &b){
+    return a.tick < b.tick;
+}
+
+// Events are sorted by tick once when the track is loaded, TrackPlay seeks them by binary search
+static void sortTrackEvents(MIDIPARSER_MidiTrack *track){
+    if (!std::is_sorted(track->event.begin(), track->event.end(), eventTickLess)) {
+        // Stable, the notes of a same tick keep their order
+        std::stable_sort(track->event.begin(), track->event.end(), eventTickLess);
+    }
+    track->index = 0u;
+}
+
+/**
+ * @brief TrackTimeline
+ *        Frames of the events of a track, compiled again when the tempo changed
+ */
+static const int64_t *TrackTimeline(const MIDIPARSER_MidiTrack *track){
+    SongPlayer_timeline_t *timeline;
+
+    if (track == Ctx->SingleMidiTrackPtr) {
+        timeline = &Ctx->SingleTimeline;
+    } else {
+        timeline = &Ctx->Timelines[track - Ctx->Tracks.data()];
+    }
+
+    if (timeline->bpm != Ctx->TimelineTempo || timeline->frame.size() != track->event.size()) {
+        timeline->frame.resize(track->event.size());
+        for (size_t i = 0; i < track->event.size(); i++) {
+            timeline->frame[i] = SongPlayer_ticksToFrames(track->event[i].tick, Ctx->TimelineTempo);
+        }
+        timeline->bpm = Ctx->TimelineTempo;
+    }
+    return timeline->frame.data();
 }
 
 static void adjust_length(int ix){
     if (ix == -1) return;
-    auto& t = Tracks[ix];
+    auto& t = Ctx->Tracks[ix];
     if ((t.nTick  / (4 * 480 / t.timeSigDen)) % t.timeSigNum){
         int nBeatMissing = t.timeSigNum - ((t.nTick  / (4 * 480 / t.timeSigDen)) % t.timeSigNum);
         t.nTick += nBeatMissing * (4 * 480 / t.timeSigDen);
@@ -598,57 +713,43 @@ static void adjust_length(int ix){
 // Preparse the pick up note legth to be a multiple of the player tick to simplify shits.
 static void adjust_trig_length(int ix) {
     if (ix == -1) return;
-    auto& t = Tracks[ix];
+    auto& t = Ctx->Tracks[ix];
     t.trigPos = (int)(0.70f * (float)t.barLength);
 }
 
 
+/**
+ * @brief ReadTracks
+ *        Read every track of the song file in Tracks, sorted
+ */
+static void ReadTracks(const char* file, const SONG_SongStruct *SongPtr) {
+    auto sz = 0; // find track count
+    if (auto s = SongPtr->outro.mainLoopIndex+1) if (sz < s) sz = s;
+    if (auto s = SongPtr->intro.mainLoopIndex+1) if (sz < s) sz = s;
+    for (int i = SongPtr->nPart-1; i >= 0; --i) {
+        auto p = SongPtr->part[i];
+        if (auto s = p.transFillIndex+1) if (sz < s) sz = s;
+        for (int j = p.nDrumFill-1; j >= 0; --j)
+            if (auto s = p.drumFillIndex[j]+1) if (sz < s) sz = s;
+        if (auto s = p.mainLoopIndex+1) if (sz < s) sz = s;
+    }
+    Ctx->Tracks.resize(sz--);
+    for (auto p = file + Ctx->CurrSongFilePtr->offsets.tracksDataOffset; sz >= 0; --sz) {
+        Ctx->Tracks[sz].read(p + Ctx->CurrSongFilePtr->trackIndexes[sz].dataOffset);
+        sortTrackEvents(&Ctx->Tracks[sz]);
+    }
+    Ctx->Timelines.clear();
+    Ctx->Timelines.resize(Ctx->Tracks.size());
+}
 
 /**
- * @brief SongPlayer_loadSong
- * @param file
- * @param length
- * @return
+ * @brief AdjustTracks
+ *        Adjust the lengths of the tracks read
+ * @return 0 if a part misses its main loop or a drum fill
  */
-int SongPlayer_loadSong(char* file, uint32_t length)
-{
+static int AdjustTracks(const SONG_SongStruct *SongPtr) {
     unsigned int i;
     unsigned int j;
-    SONG_SongStruct *SongPtr;
-
-    (void)length;
-
-    CurrSongFilePtr = (SONGFILE_FileStruct*) file;
-
-    // Verify the file type
-    if (strncmp(CurrSongFilePtr->header.fileType,"BBSF",4)) {
-        return -1;
-    }
-
-    // Verify the version, revision & build number
-
-    // if invalid flag is set (e.g. No main part, etc...)
-    if (CurrSongFilePtr->header.flags & SONGFILE_INVALID_FILE_FLAG_MASK) return -1;
-
-
-    SongPtr = &CurrSongFilePtr->song;
-
-    if (CurrSongPtr != SongPtr)
-    { // cache all tracks
-        auto sz = 0; // find track count
-        if (auto s = SongPtr->outro.mainLoopIndex+1) if (sz < s) sz = s;
-        if (auto s = SongPtr->intro.mainLoopIndex+1) if (sz < s) sz = s;
-        for (int i = SongPtr->nPart-1; i >= 0; --i) {
-            auto p = SongPtr->part[i];
-            if (auto s = p.transFillIndex+1) if (sz < s) sz = s;
-            for (int j = p.nDrumFill-1; j >= 0; --j)
-                if (auto s = p.drumFillIndex[j]+1) if (sz < s) sz = s;
-            if (auto s = p.mainLoopIndex+1) if (sz < s) sz = s;
-        }
-        Tracks.resize(sz--);
-        for (auto p = file + CurrSongFilePtr->offsets.tracksDataOffset; sz >= 0; --sz)
-            Tracks[sz].read(p + CurrSongFilePtr->trackIndexes[sz].dataOffset);
-    }
 
     /* Intro */
     adjust_trig_length(SongPtr->intro.mainLoopIndex);
@@ -676,50 +777,226 @@ int SongPlayer_loadSong(char* file, uint32_t length)
     /* Outro */
     adjust_trig_length(SongPtr->outro.mainLoopIndex);
 
+    return 1;
+}
+
+/**
+ * @brief SwapPreparedSong
+ *        Keep the tracks of the current song in the cache and take the ones of the song
+ *        file, if they were prepared before. The least recently played song is dropped
+ *        when the cache is full.
+ * @return true if Tracks hold the song, false if they must be read
+ */
+static bool SwapPreparedSong(uint32_t crc, uint32_t length) {
+    SongPlayer_preparedSong_t current;
+    bool found = false;
+
+    // Same song played again
+    if (crc != 0 && Ctx->TracksCrc == crc && Ctx->TracksLength == length) {
+        return true;
+    }
+
+    if (Ctx->TracksCrc != 0) {
+        current.crc = Ctx->TracksCrc;
+        current.length = Ctx->TracksLength;
+        current.tracks.swap(Ctx->Tracks);
+        current.timelines.swap(Ctx->Timelines);
+    }
+    Ctx->Tracks.clear();
+    Ctx->Timelines.clear();
+    Ctx->TracksCrc = 0;
+
+    for (auto it = Ctx->SongCache.begin(); crc != 0 && it != Ctx->SongCache.end(); ++it) {
+        if (it->crc == crc && it->length == length) {
+            Ctx->Tracks.swap(it->tracks);
+            Ctx->Timelines.swap(it->timelines);
+            Ctx->TracksCrc = crc;
+            Ctx->TracksLength = length;
+            Ctx->SongCache.erase(it);
+            found = true;
+            break;
+        }
+    }
+
+    if (current.crc != 0) {
+        Ctx->SongCache.insert(Ctx->SongCache.begin(), std::move(current));
+        if (Ctx->SongCache.size() > SONG_CACHE_SIZE) {
+            Ctx->SongCache.pop_back();
+        }
+    }
+    return found;
+}
+
+/**
+ * @brief LoadSong
+ *        Load the song file, with its tracks taken from prepared when given
+ */
+static int LoadSong(const char* file, uint32_t length, SongPlayer_preparedSong_t *prepared)
+{
+    SONG_SongStruct *SongPtr;
+
+    Ctx->CurrSongFilePtr = (SONGFILE_FileStruct*) file;
+
+    // Verify the file type
+    if (strncmp(Ctx->CurrSongFilePtr->header.fileType,"BBSF",4)) {
+        return -1;
+    }
+
+    // Verify the version, revision & build number
+
+    // if invalid flag is set (e.g. No main part, etc...)
+    if (Ctx->CurrSongFilePtr->header.flags & SONGFILE_INVALID_FILE_FLAG_MASK) return -1;
+
+
+    SongPtr = &Ctx->CurrSongFilePtr->song;
+
+    if (Ctx->CurrSongPtr != SongPtr)
+    {
+        uint32_t crc = Ctx->CurrSongFilePtr->header.crc;
+
+        if (prepared != nullptr && prepared->crc == crc && prepared->length == length) {
+            // Only the buffers are exchanged, prepared is left with the tracks of the previous song
+            std::swap(Ctx->TracksCrc, prepared->crc);
+            std::swap(Ctx->TracksLength, prepared->length);
+            Ctx->Tracks.swap(prepared->tracks);
+            Ctx->Timelines.swap(prepared->timelines);
+        } else if (!SwapPreparedSong(crc, length)) {
+            ReadTracks(file, SongPtr);
+            if (!AdjustTracks(SongPtr)) {
+                return 0;
+            }
+            // Songs without CRC are read at every load
+            Ctx->TracksCrc = crc;
+            Ctx->TracksLength = length;
+        }
+    }
 
     /* Retreive the autopilot strucutre */
-    if (CurrSongFilePtr->offsets.autoPilotDataOffset != 0) {
-        APPtr = (AUTOPILOT_AutoPilotDataStruct *)(file + CurrSongFilePtr->offsets.autoPilotDataOffset);
+    if (Ctx->CurrSongFilePtr->offsets.autoPilotDataOffset != 0) {
+        Ctx->APPtr = (AUTOPILOT_AutoPilotDataStruct *)(file + Ctx->CurrSongFilePtr->offsets.autoPilotDataOffset);
 
         /* Validate Autopilot Flags */
-        if (APPtr->internalData.autoPilotFlags == 2) {
-            APPtr = nullptr;
+        if (Ctx->APPtr->internalData.autoPilotFlags == 2) {
+            Ctx->APPtr = nullptr;
         }
     }
 
-    CurrSongPtr = SongPtr;
+    Ctx->CurrSongPtr = SongPtr;
 
     ResetSongPosition();
     return 1;
 }
 
+/**
+ * @brief SongPlayer_loadSong
+ * @param file
+ * @param length
+ * @return
+ */
+int SongPlayer_loadSong(const char* file, uint32_t length)
+{
+    return LoadSong(file, length, nullptr);
+}
+
+/**
+ * @brief SongPlayer_prepareSong
+ *        Read and adjust the tracks of a song and compile their frames at bpm, in a context of
+ *        its own so that any thread can do it while another one plays
+ * @return nullptr if the song can't be loaded, free it with SongPlayer_destroyPreparedSong
+ */
+SongPlayer_preparedSong_t *SongPlayer_prepareSong(const char* file, uint32_t length, unsigned int bpm)
+{
+    SongPlayer_preparedSong_t *prepared = nullptr;
+    SongPlayer_context_t *context = SongPlayer_createContext();
+    SongPlayer_context_t *previous = SongPlayer_setContext(context);
+
+    if (bpm > 0) {
+        Ctx->TimelineTempo = bpm;
+    }
+    if (LoadSong(file, length, nullptr) > 0) {
+        for (auto &track : Ctx->Tracks) {
+            TrackTimeline(&track);
+        }
+        prepared = new SongPlayer_preparedSong_t();
+        prepared->crc = Ctx->CurrSongFilePtr->header.crc;
+        prepared->length = length;
+        prepared->tracks.swap(Ctx->Tracks);
+        prepared->timelines.swap(Ctx->Timelines);
+    }
+
+    SongPlayer_setContext(previous);
+    SongPlayer_destroyContext(context);
+    return prepared;
+}
+
+void SongPlayer_destroyPreparedSong(SongPlayer_preparedSong_t *prepared)
+{
+    delete prepared;
+}
+
+/**
+ * @brief SongPlayer_loadPreparedSong
+ *        Load a song with the tracks of SongPlayer_prepareSong(), without reading or allocating
+ *        anything. prepared is left with the tracks of the previous song, to be freed by the caller.
+ */
+int SongPlayer_loadPreparedSong(const char* file, uint32_t length, SongPlayer_preparedSong_t *prepared)
+{
+    return LoadSong(file, length, prepared);
+}
+
 void SongPlayer_SetSingleTrack(MIDIPARSER_MidiTrack *track) {
 
-    SingleMidiTrackPtr = track;
-    MasterTick = 0;
-    PlayerStatus = SINGLE_TRACK_PLAYER;
+    if (track) sortTrackEvents(track);
+    Ctx->SingleMidiTrackPtr = track;
+    Ctx->SingleTimeline.bpm = 0;
+    Ctx->MasterTick = 0;
+    Ctx->PlayerStatus = SINGLE_TRACK_PLAYER;
+}
+
+/**
+ * @brief SongPlayer_ticksToFrames
+ *        Frame of a tick, rounded to the nearest. Exact whatever the number of ticks, positions
+ *        computed from it do not drift.
+ */
+int64_t SongPlayer_ticksToFrames(int64_t ticks, unsigned int bpm) {
+    if (bpm == 0) return 0;
+
+    int64_t num = 2 * ticks * SONGPLAYER_FRAMES_PER_MINUTE + (int64_t)bpm * SONGPLAYER_TICKS_PER_BEAT;
+    int64_t den = 2 * (int64_t)bpm * SONGPLAYER_TICKS_PER_BEAT;
+
+    // Division rounded down, the ticks of the pick up notes are negative
+    return (num >= 0) ? num / den : -((-num + den - 1) / den);
+}
+
+/**
+ * @brief SongPlayer_setTimelineTempo
+ *        Tempo the notes are posted at, set before processing. The timelines of the tracks
+ *        are compiled again the next time they are played.
+ */
+void SongPlayer_setTimelineTempo(unsigned int bpm) {
+    if (bpm > 0) Ctx->TimelineTempo = bpm;
 }
 
 void SongPlayer_ProcessSingleTrack(float ratio, int32_t nTick, int32_t offset) {
-    TmpMasterPartTick = MasterTick + nTick;
+    Ctx->TmpMasterPartTick = Ctx->MasterTick + nTick;
     int pickuplength = 0;//pick up notes
-    if (PlayerStatus == NO_SONG_LOADED) {
+    if (Ctx->PlayerStatus == NO_SONG_LOADED) {
         return;
     }
 
-    if (PlayerStatus == SINGLE_TRACK_PLAYER) {
-        pickuplength = (SingleMidiTrackPtr->event[0].tick < 0 && MasterTick == 0)? SingleMidiTrackPtr->event[0].tick: pickuplength;
+    if (Ctx->PlayerStatus == SINGLE_TRACK_PLAYER) {
+        pickuplength = (Ctx->SingleMidiTrackPtr->event[0].tick < 0 && Ctx->MasterTick == 0)? Ctx->SingleMidiTrackPtr->event[0].tick: pickuplength;
 
-        TrackPlay(SingleMidiTrackPtr,MasterTick - offset + pickuplength ,TmpMasterPartTick - offset + pickuplength,ratio,0,MAIN_PART_ID);
+        TrackPlay(Ctx->SingleMidiTrackPtr,Ctx->MasterTick - offset + pickuplength ,Ctx->TmpMasterPartTick - offset + pickuplength,ratio,0,MAIN_PART_ID);
 
         // If its the end of the track
-        if (TmpMasterPartTick >= SingleMidiTrackPtr->nTick + offset) {
-            TrackPlay(SingleMidiTrackPtr,SingleMidiTrackPtr->nTick,SingleMidiTrackPtr->nTick+ 200,ratio,nTick,MAIN_PART_ID);
-            PlayerStatus = STOPPED;
+        if (Ctx->TmpMasterPartTick >= Ctx->SingleMidiTrackPtr->nTick + offset) {
+            TrackPlay(Ctx->SingleMidiTrackPtr,Ctx->SingleMidiTrackPtr->nTick,Ctx->SingleMidiTrackPtr->nTick+ 200,ratio,nTick,MAIN_PART_ID);
+            Ctx->PlayerStatus = STOPPED;
         }
 
     }
-    MasterTick = TmpMasterPartTick + pickuplength;
+    Ctx->MasterTick = Ctx->TmpMasterPartTick + pickuplength;
 }
 
 int32_t SongPlayer_calculateSingleTrackOffset(uint32_t nTicks, uint32_t tickPerBar) {
@@ -741,73 +1018,73 @@ int32_t SongPlayer_calculateSingleTrackOffset(uint32_t nTicks, uint32_t tickPerB
 void SongPlayer_processSong(float ratio, int32_t nTick) {
 
     // When no songs are loaded, no need to go through the song processing
-    if (PlayerStatus == NO_SONG_LOADED) {
-        MasterTick += nTick;
+    if (Ctx->PlayerStatus == NO_SONG_LOADED) {
+        Ctx->MasterTick += nTick;
         return;
     }
 
     // Clear previous flag
-    AutopilotCueFill = FALSE;
+    Ctx->AutopilotCueFill = FALSE;
 
-    if (APPtr != nullptr && CurrPartPtr != nullptr) {
+    if (Ctx->APPtr != nullptr && Ctx->CurrPartPtr != nullptr) {
         int extra = 0;
         CheckAndCountBeat();
         //for tran fills longer than 1 bar
-        if(PlayerStatus == TRANFILL_ACTIVE && TRANS_FILL_PTR(CurrPartPtr)){
-            extra = (TRANS_FILL_PTR(CurrPartPtr)->nTick /TRANS_FILL_PTR(CurrPartPtr)->barLength > 1)?APPtr->part[PartIndex].transitionFill.playFor: extra;
-        }
-
-		if (PlayerStatus == PLAYING_MAIN_TRACK) {
-            uint32_t tmpBeatCounter = APPtr->part[PartIndex].mainLoop.playFor > 0 ? BeatCounter % APPtr->part[PartIndex].mainLoop.playFor : BeatCounter;
-            if (APPtr->part[PartIndex].drumFill[DrumFillIndex].playAt > 0 && APPtr->part[PartIndex].drumFill[DrumFillIndex].playAt == tmpBeatCounter && CurrPartPtr->nDrumFill > 0) {
-				RequestFlag = DRUMFILL_REQUEST;
-				AutopilotCueFill = TRUE;
-            } else if (APPtr->part[PartIndex].mainLoop.playAt > 0 && APPtr->part[PartIndex].mainLoop.playAt <= BeatCounter) {
-               RequestFlag = TRANFILL_REQUEST;
-               AutopilotCueFill = TRUE;
-               AutopilotAction = TRUE;
+        if(Ctx->PlayerStatus == TRANFILL_ACTIVE && TRANS_FILL_PTR(Ctx->CurrPartPtr)){
+            extra = (TRANS_FILL_PTR(Ctx->CurrPartPtr)->nTick /TRANS_FILL_PTR(Ctx->CurrPartPtr)->barLength > 1)?Ctx->APPtr->part[Ctx->PartIndex].transitionFill.playFor: extra;
+        }
+
+		if (Ctx->PlayerStatus == PLAYING_MAIN_TRACK) {
+            uint32_t tmpBeatCounter = Ctx->APPtr->part[Ctx->PartIndex].mainLoop.playFor > 0 ? Ctx->BeatCounter % Ctx->APPtr->part[Ctx->PartIndex].mainLoop.playFor : Ctx->BeatCounter;
+            if (Ctx->APPtr->part[Ctx->PartIndex].drumFill[Ctx->DrumFillIndex].playAt > 0 && Ctx->APPtr->part[Ctx->PartIndex].drumFill[Ctx->DrumFillIndex].playAt == tmpBeatCounter && Ctx->CurrPartPtr->nDrumFill > 0) {
+				Ctx->RequestFlag = DRUMFILL_REQUEST;
+				Ctx->AutopilotCueFill = TRUE;
+            } else if (Ctx->APPtr->part[Ctx->PartIndex].mainLoop.playAt > 0 && Ctx->APPtr->part[Ctx->PartIndex].mainLoop.playAt <= Ctx->BeatCounter) {
+               Ctx->RequestFlag = TRANFILL_REQUEST;
+               Ctx->AutopilotCueFill = TRUE;
+               Ctx->AutopilotAction = TRUE;
             }
-        } else if ((AutopilotAction == TRUE) &&
-                (PlayerStatus == NO_FILL_TRAN || (PlayerStatus == TRANFILL_ACTIVE && BeatCounter >= (AutopilotTransitionCount + extra)))) {
-				RequestFlag = TRANFILL_QUIT_REQUEST;
-				AutopilotCueFill = TRUE;
-				AutopilotAction = FALSE;
-        }else if(PlayerStatus == NO_FILL_TRAN_QUITTING && PartIndex == CurrSongPtr->nPart - 1)//if there is no trans fill and is the last song part must go to outro
+        } else if ((Ctx->AutopilotAction == TRUE) &&
+                (Ctx->PlayerStatus == NO_FILL_TRAN || (Ctx->PlayerStatus == TRANFILL_ACTIVE && Ctx->BeatCounter >= (Ctx->AutopilotTransitionCount + extra)))) {
+				Ctx->RequestFlag = TRANFILL_QUIT_REQUEST;
+				Ctx->AutopilotCueFill = TRUE;
+				Ctx->AutopilotAction = FALSE;
+        }else if(Ctx->PlayerStatus == NO_FILL_TRAN_QUITTING && Ctx->PartIndex == Ctx->CurrSongPtr->nPart - 1)//if there is no trans fill and is the last song part must go to outro
         {
-            RequestFlag = STOP_REQUEST;
-            AutopilotCueFill = TRUE;
+            Ctx->RequestFlag = STOP_REQUEST;
+            Ctx->AutopilotCueFill = TRUE;
         }
 
     }
 
 
-    if (PlayerStatus == PAUSED) {
+    if (Ctx->PlayerStatus == PAUSED) {
 
-        switch (RequestFlag) {
+        switch (Ctx->RequestFlag) {
         case START_REQUEST:
-            if (MainUnpauseModeTapToFill == START_FILL) {
-                if (PausedPlayerStatus == PLAYING_MAIN_TRACK
-                        || PausedPlayerStatus == DRUMFILL_ACTIVE
-                        || PausedPlayerStatus == DRUMFILL_WAITING_TRIG
-                        || PausedPlayerStatus == TRANFILL_WAITING_TRIG
-                        || PausedPlayerStatus == TRANFILL_ACTIVE
-                        || PausedPlayerStatus == TRANFILL_CANCEL
-                        || PausedPlayerStatus == TRANFILL_QUITING
-                        || PausedPlayerStatus == NO_FILL_TRAN
-                        || PausedPlayerStatus == NO_FILL_TRAN_CANCEL
-                        || PausedPlayerStatus == NO_FILL_TRAN_QUITTING) {
+            if (Ctx->MainUnpauseModeTapToFill == START_FILL) {
+                if (Ctx->PausedPlayerStatus == PLAYING_MAIN_TRACK
+                        || Ctx->PausedPlayerStatus == DRUMFILL_ACTIVE
+                        || Ctx->PausedPlayerStatus == DRUMFILL_WAITING_TRIG
+                        || Ctx->PausedPlayerStatus == TRANFILL_WAITING_TRIG
+                        || Ctx->PausedPlayerStatus == TRANFILL_ACTIVE
+                        || Ctx->PausedPlayerStatus == TRANFILL_CANCEL
+                        || Ctx->PausedPlayerStatus == TRANFILL_QUITING
+                        || Ctx->PausedPlayerStatus == NO_FILL_TRAN
+                        || Ctx->PausedPlayerStatus == NO_FILL_TRAN_CANCEL
+                        || Ctx->PausedPlayerStatus == NO_FILL_TRAN_QUITTING) {
                     // If there is are drumfills in the current part
-                    if (CurrPartPtr->nDrumFill != 0) {
+                    if (Ctx->CurrPartPtr->nDrumFill != 0) {
 
                         // If the Active Pause mode is enable
-                        if (ActivePauseEnable) {
+                        if (Ctx->ActivePauseEnable) {
                             // the track will continue where it is supposed to be
-                            MasterTick %= MAIN_LOOP_PTR(CurrPartPtr)->nTick;
+                            Ctx->MasterTick %= MAIN_LOOP_PTR(Ctx->CurrPartPtr)->nTick;
                         } else {
                             // The track will restart a the begining
-                            MasterTick = 0;
+                            Ctx->MasterTick = 0;
                         }
-                        RequestFlag = DRUMFILL_REQUEST;
+                        Ctx->RequestFlag = DRUMFILL_REQUEST;
                     } else {
                         SamePart(FALSE);
                     }
@@ -822,22 +1099,22 @@ void SongPlayer_processSong(float ratio, int32_t nTick) {
             break;
 
         case PAUSE_REQUEST:
-            PlayerStatus = UnPausedPlayerStatus;
+            Ctx->PlayerStatus = Ctx->UnPausedPlayerStatus;
 
             // If the Active Pause mode is enable
-            if (ActivePauseEnable) {
+            if (Ctx->ActivePauseEnable) {
                 // the track will continue where it is supposed to be
-                MasterTick %= MAIN_LOOP_PTR(CurrPartPtr)->nTick;
+                Ctx->MasterTick %= MAIN_LOOP_PTR(Ctx->CurrPartPtr)->nTick;
             } else {
                 // The track will restart a the begining
-                MasterTick = 0;
+                Ctx->MasterTick = 0;
             }
 
             SpecialEffectManager(); // Change the special effect on UNPAUSED
             // Send continue message when UNPAUSED
-            WasPausedFlag = 1;
+            Ctx->WasPausedFlag = 1;
 
-            RequestFlag = REQUEST_DONE;
+            Ctx->RequestFlag = REQUEST_DONE;
             break;
 
         default:
@@ -846,39 +1123,39 @@ void SongPlayer_processSong(float ratio, int32_t nTick) {
     }
 
 
-    if ((RequestFlag == START_REQUEST ||RequestFlag == EXTERNAL_START_REQUEST) && PlayerStatus == STOPPED) {
+    if ((Ctx->RequestFlag == START_REQUEST ||Ctx->RequestFlag == EXTERNAL_START_REQUEST) && Ctx->PlayerStatus == STOPPED) {
             IntroPart();
     }
 
 
-    if (RequestFlag == PAUSE_REQUEST) {
+    if (Ctx->RequestFlag == PAUSE_REQUEST) {
 
-        int32_t testMasterTick = MasterTick;
-        int32_t testTmpTick = TmpMasterPartTick;
-        PausedPlayerStatus = PlayerStatus;
+        int32_t testMasterTick = Ctx->MasterTick;
+        int32_t testTmpTick = Ctx->TmpMasterPartTick;
+        Ctx->PausedPlayerStatus = Ctx->PlayerStatus;
 
-        switch (PlayerStatus) {
+        switch (Ctx->PlayerStatus) {
         case PLAYING_MAIN_TRACK:
             SamePart(FALSE);
-            UnPausedPlayerStatus = PLAYING_MAIN_TRACK;
-            PlayerStatus = PAUSED;
-            if (!ActivePauseEnable && SendStopOnPause) UartMidi_SendStop();
+            Ctx->UnPausedPlayerStatus = PLAYING_MAIN_TRACK;
+            Ctx->PlayerStatus = PAUSED;
+            if (!Ctx->ActivePauseEnable && Ctx->SendStopOnPause) UartMidi_SendStop();
             break;
 
         case DRUMFILL_ACTIVE:
         case DRUMFILL_WAITING_TRIG:
             SamePart(TRUE);
-            UnPausedPlayerStatus = PLAYING_MAIN_TRACK;
-            PlayerStatus = PAUSED;
-            if (!ActivePauseEnable && SendStopOnPause) UartMidi_SendStop();
+            Ctx->UnPausedPlayerStatus = PLAYING_MAIN_TRACK;
+            Ctx->PlayerStatus = PAUSED;
+            if (!Ctx->ActivePauseEnable && Ctx->SendStopOnPause) UartMidi_SendStop();
             break;
 
         case TRANFILL_CANCEL:
         case NO_FILL_TRAN_CANCEL:
             SamePart(FALSE);
-            UnPausedPlayerStatus = PLAYING_MAIN_TRACK;
-            PlayerStatus = PAUSED;
-            if (!ActivePauseEnable && SendStopOnPause) UartMidi_SendStop();
+            Ctx->UnPausedPlayerStatus = PLAYING_MAIN_TRACK;
+            Ctx->PlayerStatus = PAUSED;
+            if (!Ctx->ActivePauseEnable && Ctx->SendStopOnPause) UartMidi_SendStop();
             break;
 
         case TRANFILL_WAITING_TRIG:
@@ -889,9 +1166,9 @@ void SongPlayer_processSong(float ratio, int32_t nTick) {
 
             NextPart();
 
-            UnPausedPlayerStatus = PLAYING_MAIN_TRACK;
-            PlayerStatus = PAUSED;
-            if (!ActivePauseEnable && SendStopOnPause) UartMidi_SendStop();
+            Ctx->UnPausedPlayerStatus = PLAYING_MAIN_TRACK;
+            Ctx->PlayerStatus = PAUSED;
+            if (!Ctx->ActivePauseEnable && Ctx->SendStopOnPause) UartMidi_SendStop();
             break;
 
         case PLAYING_MAIN_TRACK_TO_END:
@@ -902,33 +1179,33 @@ void SongPlayer_processSong(float ratio, int32_t nTick) {
         case OUTRO_WAITING_TRIG:
             // Stop and restart in the outro
             OutroPart();
-            UnPausedPlayerStatus = OUTRO;
-            PlayerStatus = PAUSED;
+            Ctx->UnPausedPlayerStatus = OUTRO;
+            Ctx->PlayerStatus = PAUSED;
             // We need to reset the flag since it wont be usefull on unpaused
-            PartStopSyncTick = 0;
-            if (!ActivePauseEnable && SendStopOnPause) UartMidi_SendStop();
+            Ctx->PartStopSyncTick = 0;
+            if (!Ctx->ActivePauseEnable && Ctx->SendStopOnPause) UartMidi_SendStop();
             break;
 
         case INTRO:
             FirstPart();
-            UnPausedPlayerStatus = PlayerStatus;
-            PlayerStatus = PAUSED;
-            if (!ActivePauseEnable && SendStopOnPause) UartMidi_SendStop();
+            Ctx->UnPausedPlayerStatus = Ctx->PlayerStatus;
+            Ctx->PlayerStatus = PAUSED;
+            if (!Ctx->ActivePauseEnable && Ctx->SendStopOnPause) UartMidi_SendStop();
             break;
 
         case OUTRO:
-            DrumFillIndex = 0;
+            Ctx->DrumFillIndex = 0;
             SamePart(FALSE);
-            UnPausedPlayerStatus = PlayerStatus;
-            PlayerStatus = PAUSED;
-            if (!ActivePauseEnable && SendStopOnPause) UartMidi_SendStop();
+            Ctx->UnPausedPlayerStatus = Ctx->PlayerStatus;
+            Ctx->PlayerStatus = PAUSED;
+            if (!Ctx->ActivePauseEnable && Ctx->SendStopOnPause) UartMidi_SendStop();
             break;
 
         case OUTRO_CANCELED:
             SamePart(FALSE);
-            UnPausedPlayerStatus = PLAYING_MAIN_TRACK;
-            PlayerStatus = PAUSED;
-            if (!ActivePauseEnable && SendStopOnPause) UartMidi_SendStop();
+            Ctx->UnPausedPlayerStatus = PLAYING_MAIN_TRACK;
+            Ctx->PlayerStatus = PAUSED;
+            if (!Ctx->ActivePauseEnable && Ctx->SendStopOnPause) UartMidi_SendStop();
             break;
 
         case STOPPED:
@@ -939,10 +1216,10 @@ void SongPlayer_processSong(float ratio, int32_t nTick) {
             break;
         }
 
-        if (ActivePauseEnable) {
-            if (PlayerStatus == PAUSED) {
-                MasterTick = testMasterTick;
-                TmpMasterPartTick = testTmpTick;
+        if (Ctx->ActivePauseEnable) {
+            if (Ctx->PlayerStatus == PAUSED) {
+                Ctx->MasterTick = testMasterTick;
+                Ctx->TmpMasterPartTick = testTmpTick;
             }
         }
         // Make sure the gui follows the
@@ -950,47 +1227,47 @@ void SongPlayer_processSong(float ratio, int32_t nTick) {
 
     } else {
 
-        switch (RequestFlag) {
+        switch (Ctx->RequestFlag) {
 
         case DRUMFILL_REQUEST:
             // If there is drum fills in the current part
-            if (CurrPartPtr->nDrumFill > 0) {
-                DrumFillStartSyncTick = CalculateStartBarSyncTick(MasterTick,
-                        MAIN_LOOP_PTR(CurrPartPtr)->barLength,
-                        AutopilotCueFill ? MAIN_LOOP_PTR(CurrPartPtr)->barLength : MAIN_LOOP_PTR(CurrPartPtr)->trigPos);
+            if (Ctx->CurrPartPtr->nDrumFill > 0) {
+                Ctx->DrumFillStartSyncTick = CalculateStartBarSyncTick(Ctx->MasterTick,
+                        MAIN_LOOP_PTR(Ctx->CurrPartPtr)->barLength,
+                        Ctx->AutopilotCueFill ? MAIN_LOOP_PTR(Ctx->CurrPartPtr)->barLength : MAIN_LOOP_PTR(Ctx->CurrPartPtr)->trigPos);
 
 
                 // Adjust offset if drumfill is smaller than one bar
-                if (DRUM_FILL_PTR(CurrPartPtr, DrumFillIndex)->nTick < MAIN_LOOP_PTR(CurrPartPtr)->barLength) {
+                if (DRUM_FILL_PTR(Ctx->CurrPartPtr, Ctx->DrumFillIndex)->nTick < MAIN_LOOP_PTR(Ctx->CurrPartPtr)->barLength) {
 
-                    DrumFillStartSyncTick += MAIN_LOOP_PTR(CurrPartPtr)->barLength -
-                            (DRUM_FILL_PTR(CurrPartPtr, DrumFillIndex)->nTick % MAIN_LOOP_PTR(CurrPartPtr)->barLength);
+                    Ctx->DrumFillStartSyncTick += MAIN_LOOP_PTR(Ctx->CurrPartPtr)->barLength -
+                            (DRUM_FILL_PTR(Ctx->CurrPartPtr, Ctx->DrumFillIndex)->nTick % MAIN_LOOP_PTR(Ctx->CurrPartPtr)->barLength);
                 }
 
-                if (DRUM_FILL_PTR(CurrPartPtr, DrumFillIndex)->event[0].tick <0){//pick up notes
-                    DrumFillPickUpSyncTickLength = DRUM_FILL_PTR(CurrPartPtr, DrumFillIndex)->event[0].tick * -1;
+                if (DRUM_FILL_PTR(Ctx->CurrPartPtr, Ctx->DrumFillIndex)->event[0].tick <0){//pick up notes
+                    Ctx->DrumFillPickUpSyncTickLength = DRUM_FILL_PTR(Ctx->CurrPartPtr, Ctx->DrumFillIndex)->event[0].tick * -1;
                 } else {
-                    DrumFillPickUpSyncTickLength = 0;
+                    Ctx->DrumFillPickUpSyncTickLength = 0;
                 }
                 //Extends the section on autopilot if pedal pressed
-                if(AutopilotAction == 0 && AutopilotCueFill == 0 && APPtr){
+                if(Ctx->AutopilotAction == 0 && Ctx->AutopilotCueFill == 0 && Ctx->APPtr){
                     //the beat will be restarted at the end of the drumfill
-                    if (CurrPartPtr->shuffleFlag) {
-                        if (CurrPartPtr->nDrumFill != 0) {
-                            DrumFillIndex = rand() % CurrPartPtr->nDrumFill;
+                    if (Ctx->CurrPartPtr->shuffleFlag) {
+                        if (Ctx->CurrPartPtr->nDrumFill != 0) {
+                            Ctx->DrumFillIndex = rand() % Ctx->CurrPartPtr->nDrumFill;
                         }
                     } else {
                         fillAPIndex();
                     }
 
                     //Check if previous drum fill was off the AP but should play manually
-                    if(DrumFillIndex != 0 && APPtr->part[PartIndex].drumFill[DrumFillIndex-1].playAt == 0)
+                    if(Ctx->DrumFillIndex != 0 && Ctx->APPtr->part[Ctx->PartIndex].drumFill[Ctx->DrumFillIndex-1].playAt == 0)
                     {
-                        DrumFillIndex --;
+                        Ctx->DrumFillIndex --;
                     }
 
                 }
-                PlayerStatus = DRUMFILL_WAITING_TRIG;
+                Ctx->PlayerStatus = DRUMFILL_WAITING_TRIG;
             }
 
             break;
@@ -999,152 +1276,152 @@ void SongPlayer_processSong(float ratio, int32_t nTick) {
 
 
             // If there is drum fills in the current part and they are turned on
-              if (TRANS_FILL_PTR(CurrPartPtr) && APPtr && APPtr->part[PartIndex].transitionFill.playFor >= 1 ) {
-                if (TRANS_FILL_PTR(CurrPartPtr)->pickupNotesLength){
-                    if (TRANS_FILL_PTR(CurrPartPtr)->pickupNotesLength % nTick){
-                        TranFillPickUpSyncTickLength = (( 1 + TRANS_FILL_PTR(CurrPartPtr)->pickupNotesLength/ nTick) * nTick);
+              if (TRANS_FILL_PTR(Ctx->CurrPartPtr) && Ctx->APPtr && Ctx->APPtr->part[Ctx->PartIndex].transitionFill.playFor >= 1 ) {
+                if (TRANS_FILL_PTR(Ctx->CurrPartPtr)->pickupNotesLength){
+                    if (TRANS_FILL_PTR(Ctx->CurrPartPtr)->pickupNotesLength % nTick){
+                        Ctx->TranFillPickUpSyncTickLength = (( 1 + TRANS_FILL_PTR(Ctx->CurrPartPtr)->pickupNotesLength/ nTick) * nTick);
                     } else {
-                        TranFillPickUpSyncTickLength = (( 0 + TRANS_FILL_PTR(CurrPartPtr)->pickupNotesLength/ nTick) * nTick);
+                        Ctx->TranFillPickUpSyncTickLength = (( 0 + TRANS_FILL_PTR(Ctx->CurrPartPtr)->pickupNotesLength/ nTick) * nTick);
                     }
                 } else {
-                    TranFillPickUpSyncTickLength = 0;
+                    Ctx->TranFillPickUpSyncTickLength = 0;
                 }
-                if (PlayerStatus == PAUSED){
-                    if (!ActivePauseEnable){
+                if (Ctx->PlayerStatus == PAUSED){
+                    if (!Ctx->ActivePauseEnable){
                         // Use nTick instead of 0 to avoid negative number for master ticks
-                        MasterTick = TRANS_FILL_PTR(CurrPartPtr)->nTick - TranFillPickUpSyncTickLength;
-                        TranFillStartSyncTick = MasterTick;
+                        Ctx->MasterTick = TRANS_FILL_PTR(Ctx->CurrPartPtr)->nTick - Ctx->TranFillPickUpSyncTickLength;
+                        Ctx->TranFillStartSyncTick = Ctx->MasterTick;
 
                     } else {
-                        TranFillStartSyncTick = CalculateStartBarSyncTick(MasterTick,
-                                MAIN_LOOP_PTR(CurrPartPtr)->barLength,
-                                AutopilotCueFill ? MAIN_LOOP_PTR(CurrPartPtr)->barLength : MAIN_LOOP_PTR(CurrPartPtr)->trigPos);
-                        TranFillStartSyncTick -= TranFillPickUpSyncTickLength;
+                        Ctx->TranFillStartSyncTick = CalculateStartBarSyncTick(Ctx->MasterTick,
+                                MAIN_LOOP_PTR(Ctx->CurrPartPtr)->barLength,
+                                Ctx->AutopilotCueFill ? MAIN_LOOP_PTR(Ctx->CurrPartPtr)->barLength : MAIN_LOOP_PTR(Ctx->CurrPartPtr)->trigPos);
+                        Ctx->TranFillStartSyncTick -= Ctx->TranFillPickUpSyncTickLength;
 
                     }
                 } else {
-                    TranFillStartSyncTick = CalculateStartBarSyncTick(MasterTick,
-                            MAIN_LOOP_PTR(CurrPartPtr)->barLength,
-                            AutopilotCueFill ? MAIN_LOOP_PTR(CurrPartPtr)->barLength : MAIN_LOOP_PTR(CurrPartPtr)->trigPos);
-                    TranFillStartSyncTick -= TranFillPickUpSyncTickLength;
+                    Ctx->TranFillStartSyncTick = CalculateStartBarSyncTick(Ctx->MasterTick,
+                            MAIN_LOOP_PTR(Ctx->CurrPartPtr)->barLength,
+                            Ctx->AutopilotCueFill ? MAIN_LOOP_PTR(Ctx->CurrPartPtr)->barLength : MAIN_LOOP_PTR(Ctx->CurrPartPtr)->trigPos);
+                    Ctx->TranFillStartSyncTick -= Ctx->TranFillPickUpSyncTickLength;
 
                 }
 
                 // Adjust offset of tran fil if it is smaller than one bar
-                if (TRANS_FILL_PTR(CurrPartPtr)->nTick < TRANS_FILL_PTR(CurrPartPtr)->barLength) {
+                if (TRANS_FILL_PTR(Ctx->CurrPartPtr)->nTick < TRANS_FILL_PTR(Ctx->CurrPartPtr)->barLength) {
 
-                    TranFillStartSyncTick += MAIN_LOOP_PTR(CurrPartPtr)->barLength -
-                            (TRANS_FILL_PTR(CurrPartPtr)->nTick % TRANS_FILL_PTR(CurrPartPtr)->barLength);
+                    Ctx->TranFillStartSyncTick += MAIN_LOOP_PTR(Ctx->CurrPartPtr)->barLength -
+                            (TRANS_FILL_PTR(Ctx->CurrPartPtr)->nTick % TRANS_FILL_PTR(Ctx->CurrPartPtr)->barLength);
                 }
                 //if there is a Transition fill but the fill AP is off
-                if(APPtr && AutopilotAction == 1 && AutopilotCueFill == 1){
-                     PlayerStatus = (APPtr->part[PartIndex].transitionFill.playAt == 0)?NO_FILL_TRAN:PlayerStatus;
+                if(Ctx->APPtr && Ctx->AutopilotAction == 1 && Ctx->AutopilotCueFill == 1){
+                     Ctx->PlayerStatus = (Ctx->APPtr->part[Ctx->PartIndex].transitionFill.playAt == 0)?NO_FILL_TRAN:Ctx->PlayerStatus;
                 }
-                PlayerStatus = TRANFILL_WAITING_TRIG;
-            } else if(TRANS_FILL_PTR(CurrPartPtr)){
-                  if (TRANS_FILL_PTR(CurrPartPtr)->pickupNotesLength){
-                      if (TRANS_FILL_PTR(CurrPartPtr)->pickupNotesLength % nTick){
-                          TranFillPickUpSyncTickLength = (( 1 + TRANS_FILL_PTR(CurrPartPtr)->pickupNotesLength/ nTick) * nTick);
+                Ctx->PlayerStatus = TRANFILL_WAITING_TRIG;
+            } else if(TRANS_FILL_PTR(Ctx->CurrPartPtr)){
+                  if (TRANS_FILL_PTR(Ctx->CurrPartPtr)->pickupNotesLength){
+                      if (TRANS_FILL_PTR(Ctx->CurrPartPtr)->pickupNotesLength % nTick){
+                          Ctx->TranFillPickUpSyncTickLength = (( 1 + TRANS_FILL_PTR(Ctx->CurrPartPtr)->pickupNotesLength/ nTick) * nTick);
                       } else {
-                          TranFillPickUpSyncTickLength = (( 0 + TRANS_FILL_PTR(CurrPartPtr)->pickupNotesLength/ nTick) * nTick);
+                          Ctx->TranFillPickUpSyncTickLength = (( 0 + TRANS_FILL_PTR(Ctx->CurrPartPtr)->pickupNotesLength/ nTick) * nTick);
                       }
                   } else {
-                      TranFillPickUpSyncTickLength = 0;
+                      Ctx->TranFillPickUpSyncTickLength = 0;
                   }
-                  if (PlayerStatus == PAUSED){
-                      if (!ActivePauseEnable){
+                  if (Ctx->PlayerStatus == PAUSED){
+                      if (!Ctx->ActivePauseEnable){
                           // Use nTick instead of 0 to avoid negative number for master ticks
-                          MasterTick = TRANS_FILL_PTR(CurrPartPtr)->nTick - TranFillPickUpSyncTickLength;
-                          TranFillStartSyncTick = MasterTick;
+                          Ctx->MasterTick = TRANS_FILL_PTR(Ctx->CurrPartPtr)->nTick - Ctx->TranFillPickUpSyncTickLength;
+                          Ctx->TranFillStartSyncTick = Ctx->MasterTick;
 
                       } else {
-                          TranFillStartSyncTick = CalculateStartBarSyncTick(MasterTick,
-                                  MAIN_LOOP_PTR(CurrPartPtr)->barLength,
-                                  AutopilotCueFill ? MAIN_LOOP_PTR(CurrPartPtr)->barLength : MAIN_LOOP_PTR(CurrPartPtr)->trigPos);
-                          TranFillStartSyncTick -= TranFillPickUpSyncTickLength;
+                          Ctx->TranFillStartSyncTick = CalculateStartBarSyncTick(Ctx->MasterTick,
+                                  MAIN_LOOP_PTR(Ctx->CurrPartPtr)->barLength,
+                                  Ctx->AutopilotCueFill ? MAIN_LOOP_PTR(Ctx->CurrPartPtr)->barLength : MAIN_LOOP_PTR(Ctx->CurrPartPtr)->trigPos);
+                          Ctx->TranFillStartSyncTick -= Ctx->TranFillPickUpSyncTickLength;
 
                       }
                   } else {
-                      TranFillStartSyncTick = CalculateStartBarSyncTick(MasterTick,
-                              MAIN_LOOP_PTR(CurrPartPtr)->barLength,
-                              AutopilotCueFill ? MAIN_LOOP_PTR(CurrPartPtr)->barLength : MAIN_LOOP_PTR(CurrPartPtr)->trigPos);
-                      TranFillStartSyncTick -= TranFillPickUpSyncTickLength;
+                      Ctx->TranFillStartSyncTick = CalculateStartBarSyncTick(Ctx->MasterTick,
+                              MAIN_LOOP_PTR(Ctx->CurrPartPtr)->barLength,
+                              Ctx->AutopilotCueFill ? MAIN_LOOP_PTR(Ctx->CurrPartPtr)->barLength : MAIN_LOOP_PTR(Ctx->CurrPartPtr)->trigPos);
+                      Ctx->TranFillStartSyncTick -= Ctx->TranFillPickUpSyncTickLength;
 
                   }
                   // Adjust offset of tran fil if it is smaller than one bar
-                  if (TRANS_FILL_PTR(CurrPartPtr)->nTick < TRANS_FILL_PTR(CurrPartPtr)->barLength) {
+                  if (TRANS_FILL_PTR(Ctx->CurrPartPtr)->nTick < TRANS_FILL_PTR(Ctx->CurrPartPtr)->barLength) {
 
-                      TranFillStartSyncTick += MAIN_LOOP_PTR(CurrPartPtr)->barLength -
-                              (TRANS_FILL_PTR(CurrPartPtr)->nTick % TRANS_FILL_PTR(CurrPartPtr)->barLength);
+                      Ctx->TranFillStartSyncTick += MAIN_LOOP_PTR(Ctx->CurrPartPtr)->barLength -
+                              (TRANS_FILL_PTR(Ctx->CurrPartPtr)->nTick % TRANS_FILL_PTR(Ctx->CurrPartPtr)->barLength);
                   }
-                  if(APPtr && AutopilotAction == 1 && AutopilotCueFill == 1){
-                       PlayerStatus = (APPtr->part[PartIndex].transitionFill.playAt == 0)?NO_FILL_TRAN:PlayerStatus;
+                  if(Ctx->APPtr && Ctx->AutopilotAction == 1 && Ctx->AutopilotCueFill == 1){
+                       Ctx->PlayerStatus = (Ctx->APPtr->part[Ctx->PartIndex].transitionFill.playAt == 0)?NO_FILL_TRAN:Ctx->PlayerStatus;
                   }
-                   PlayerStatus = TRANFILL_WAITING_TRIG;
+                   Ctx->PlayerStatus = TRANFILL_WAITING_TRIG;
             }else{
                // Cancel the transition fill request
-               PlayerStatus = NO_FILL_TRAN;
+               Ctx->PlayerStatus = NO_FILL_TRAN;
             }
             break;
 
         case TRANFILL_QUIT_REQUEST:
-            if ((PlayerStatus == TRANFILL_WAITING_TRIG) || (PlayerStatus == TRANFILL_ACTIVE)) {
-                TranFillStopSyncTick = CalculateTranFillQuitSyncTick(MasterTick,
-                        MAIN_LOOP_PTR(CurrPartPtr)->barLength);
+            if ((Ctx->PlayerStatus == TRANFILL_WAITING_TRIG) || (Ctx->PlayerStatus == TRANFILL_ACTIVE)) {
+                Ctx->TranFillStopSyncTick = CalculateTranFillQuitSyncTick(Ctx->MasterTick,
+                        MAIN_LOOP_PTR(Ctx->CurrPartPtr)->barLength);
 
-                if(TRANS_FILL_PTR(CurrPartPtr)->nTick > TRANS_FILL_PTR(CurrPartPtr)->barLength &&
-                   !(MasterTick/(SongPlayer_getbarLength() / TRANS_FILL_PTR(CurrPartPtr)->timeSigNum) >= TRANS_FILL_PTR(CurrPartPtr)->timeSigNum) && AutopilotCueFill){
+                if(TRANS_FILL_PTR(Ctx->CurrPartPtr)->nTick > TRANS_FILL_PTR(Ctx->CurrPartPtr)->barLength &&
+                   !(Ctx->MasterTick/(SongPlayer_getbarLength() / TRANS_FILL_PTR(Ctx->CurrPartPtr)->timeSigNum) >= TRANS_FILL_PTR(Ctx->CurrPartPtr)->timeSigNum) && Ctx->AutopilotCueFill){
                     //longer than 1 bar trans fill when main loop is on the first bar
-                   TranFillStopSyncTick *= TRANS_FILL_PTR(CurrPartPtr)->nTick / TRANS_FILL_PTR(CurrPartPtr)->barLength;
+                   Ctx->TranFillStopSyncTick *= TRANS_FILL_PTR(Ctx->CurrPartPtr)->nTick / TRANS_FILL_PTR(Ctx->CurrPartPtr)->barLength;
                 }
-                if(APPtr && AutopilotAction == 0 && AutopilotCueFill == 1 && APPtr->part[PartIndex].transitionFill.playFor > 1){
-                    TranFillStopSyncTick = CalculateTranFillQuitSyncTick(MasterTick, MAIN_LOOP_PTR(CurrPartPtr)->barLength, APPtr->part[PartIndex].transitionFill.playFor);
+                if(Ctx->APPtr && Ctx->AutopilotAction == 0 && Ctx->AutopilotCueFill == 1 && Ctx->APPtr->part[Ctx->PartIndex].transitionFill.playFor > 1){
+                    Ctx->TranFillStopSyncTick = CalculateTranFillQuitSyncTick(Ctx->MasterTick, MAIN_LOOP_PTR(Ctx->CurrPartPtr)->barLength, Ctx->APPtr->part[Ctx->PartIndex].transitionFill.playFor);
                 }
-                PlayerStatus = TRANFILL_QUITING;
+                Ctx->PlayerStatus = TRANFILL_QUITING;
             } else {
-                PartStopSyncTick = CalculateTranFillQuitSyncTick(MasterTick,
-                        MAIN_LOOP_PTR(CurrPartPtr)->barLength);
-                PlayerStatus = NO_FILL_TRAN_QUITTING;
+                Ctx->PartStopSyncTick = CalculateTranFillQuitSyncTick(Ctx->MasterTick,
+                        MAIN_LOOP_PTR(Ctx->CurrPartPtr)->barLength);
+                Ctx->PlayerStatus = NO_FILL_TRAN_QUITTING;
             }
             break;
 
         case TRANFILL_CANCEL_REQUEST:
-            if (PlayerStatus == TRANFILL_QUITING){
-                PlayerStatus = TRANFILL_CANCEL;
-            } else if (PlayerStatus == NO_FILL_TRAN_QUITTING){
-                PlayerStatus = NO_FILL_TRAN_CANCEL;
+            if (Ctx->PlayerStatus == TRANFILL_QUITING){
+                Ctx->PlayerStatus = TRANFILL_CANCEL;
+            } else if (Ctx->PlayerStatus == NO_FILL_TRAN_QUITTING){
+                Ctx->PlayerStatus = NO_FILL_TRAN_CANCEL;
             }
             break;
 
         case STOP_REQUEST:
-            if (OUTRO_TRACK_PTR(CurrSongPtr) != NULL ) {
-                PartStopSyncTick = CalculateStartBarSyncTick(MasterTick,
-                        MAIN_LOOP_PTR(CurrPartPtr)->barLength,
-                        AutopilotCueFill ? MAIN_LOOP_PTR(CurrPartPtr)->barLength : MAIN_LOOP_PTR(CurrPartPtr)->trigPos);
+            if (OUTRO_TRACK_PTR(Ctx->CurrSongPtr) != NULL ) {
+                Ctx->PartStopSyncTick = CalculateStartBarSyncTick(Ctx->MasterTick,
+                        MAIN_LOOP_PTR(Ctx->CurrPartPtr)->barLength,
+                        Ctx->AutopilotCueFill ? MAIN_LOOP_PTR(Ctx->CurrPartPtr)->barLength : MAIN_LOOP_PTR(Ctx->CurrPartPtr)->trigPos);
 
                 // Adjust offset of tran fil if it is smaller than one bar
-                if (OUTRO_TRACK_PTR(CurrSongPtr)->nTick < MAIN_LOOP_PTR(CurrPartPtr)->barLength) {
-                    PartStopSyncTick += MAIN_LOOP_PTR(CurrPartPtr)->barLength - (OUTRO_TRACK_PTR(CurrSongPtr)->nTick % MAIN_LOOP_PTR(CurrPartPtr)->barLength);
+                if (OUTRO_TRACK_PTR(Ctx->CurrSongPtr)->nTick < MAIN_LOOP_PTR(Ctx->CurrPartPtr)->barLength) {
+                    Ctx->PartStopSyncTick += MAIN_LOOP_PTR(Ctx->CurrPartPtr)->barLength - (OUTRO_TRACK_PTR(Ctx->CurrSongPtr)->nTick % MAIN_LOOP_PTR(Ctx->CurrPartPtr)->barLength);
                 }
 
 
                 // Adjust delay for pick-up notes
-                if (OUTRO_TRACK_PTR(CurrSongPtr)->pickupNotesLength){
-                    if (OUTRO_TRACK_PTR(CurrSongPtr)->pickupNotesLength% nTick){
-                        PartStopPickUpSyncTickLength = (( 1 + OUTRO_TRACK_PTR(CurrSongPtr)->pickupNotesLength/ nTick) * nTick);
+                if (OUTRO_TRACK_PTR(Ctx->CurrSongPtr)->pickupNotesLength){
+                    if (OUTRO_TRACK_PTR(Ctx->CurrSongPtr)->pickupNotesLength% nTick){
+                        Ctx->PartStopPickUpSyncTickLength = (( 1 + OUTRO_TRACK_PTR(Ctx->CurrSongPtr)->pickupNotesLength/ nTick) * nTick);
                     } else {
-                        PartStopPickUpSyncTickLength = (( 0 + OUTRO_TRACK_PTR(CurrSongPtr)->pickupNotesLength/ nTick) * nTick);
+                        Ctx->PartStopPickUpSyncTickLength = (( 0 + OUTRO_TRACK_PTR(Ctx->CurrSongPtr)->pickupNotesLength/ nTick) * nTick);
                     }
                 } else {
-                    PartStopPickUpSyncTickLength = 0;
+                    Ctx->PartStopPickUpSyncTickLength = 0;
                 }
-                PartStopSyncTick -= PartStopPickUpSyncTickLength;
+                Ctx->PartStopSyncTick -= Ctx->PartStopPickUpSyncTickLength;
 
-                PlayerStatus = OUTRO_WAITING_TRIG;
+                Ctx->PlayerStatus = OUTRO_WAITING_TRIG;
             } else {
-                PartStopSyncTick = CalculateTranFillQuitSyncTick(MasterTick,
-                        MAIN_LOOP_PTR(CurrPartPtr)->barLength);
-                PlayerStatus = PLAYING_MAIN_TRACK_TO_END;
+                Ctx->PartStopSyncTick = CalculateTranFillQuitSyncTick(Ctx->MasterTick,
+                        MAIN_LOOP_PTR(Ctx->CurrPartPtr)->barLength);
+                Ctx->PlayerStatus = PLAYING_MAIN_TRACK_TO_END;
             }
             break;
 
@@ -1154,18 +1431,18 @@ void SongPlayer_processSong(float ratio, int32_t nTick) {
 
         case OUTRO_CANCEL_REQUEST:
 
-            if (PlayerStatus == PLAYING_MAIN_TRACK_TO_END) {
-                PlayerStatus = PLAYING_MAIN_TRACK;
+            if (Ctx->PlayerStatus == PLAYING_MAIN_TRACK_TO_END) {
+                Ctx->PlayerStatus = PLAYING_MAIN_TRACK;
                 break;
             }
             // Switch the player to OUTRO cancelled state if there is a cancel request during the outro
-            if (PlayerStatus == OUTRO) {
-                PlayerStatus = OUTRO_CANCELED;
+            if (Ctx->PlayerStatus == OUTRO) {
+                Ctx->PlayerStatus = OUTRO_CANCELED;
                 break;
             }
             // Switch back the player to the main track if the outro is cancelled before started
-            if (PlayerStatus == OUTRO_WAITING_TRIG) {
-                PlayerStatus = PLAYING_MAIN_TRACK;
+            if (Ctx->PlayerStatus == OUTRO_WAITING_TRIG) {
+                Ctx->PlayerStatus = PLAYING_MAIN_TRACK;
                 break;
             }
             break;
@@ -1174,64 +1451,64 @@ void SongPlayer_processSong(float ratio, int32_t nTick) {
             break;
         }
     }
-    RequestFlag = REQUEST_DONE;
-    TmpMasterPartTick = MasterTick + nTick;
+    Ctx->RequestFlag = REQUEST_DONE;
+    Ctx->TmpMasterPartTick = Ctx->MasterTick + nTick;
 
     // Trigger Manager
-    switch (PlayerStatus) {
+    switch (Ctx->PlayerStatus) {
 
     case DRUMFILL_WAITING_TRIG:
 
 
         // If still waiting for trigger
-        if (TmpMasterPartTick <= DrumFillStartSyncTick) {
-            TrackPlay(MAIN_LOOP_PTR(CurrPartPtr), MasterTick, TmpMasterPartTick, ratio, 0, MAIN_PART_ID);
+        if (Ctx->TmpMasterPartTick <= Ctx->DrumFillStartSyncTick) {
+            TrackPlay(MAIN_LOOP_PTR(Ctx->CurrPartPtr), Ctx->MasterTick, Ctx->TmpMasterPartTick, ratio, 0, MAIN_PART_ID);
 
             // If its the end of the track
-            if (TmpMasterPartTick >= MAIN_LOOP_PTR(CurrPartPtr)->nTick) {
-                DrumFillStartSyncTick -= MAIN_LOOP_PTR(CurrPartPtr)->nTick;
-                TmpMasterPartTick = 0u;
+            if (Ctx->TmpMasterPartTick >= MAIN_LOOP_PTR(Ctx->CurrPartPtr)->nTick) {
+                Ctx->DrumFillStartSyncTick -= MAIN_LOOP_PTR(Ctx->CurrPartPtr)->nTick;
+                Ctx->TmpMasterPartTick = 0u;
             }
         } else {
             // if trigger has happen, go in pending mode
-            PlayerStatus = DRUMFILL_ACTIVE;
+            Ctx->PlayerStatus = DRUMFILL_ACTIVE;
         }
 
         break;
 
     case TRANFILL_WAITING_TRIG:
 
-        if (TmpMasterPartTick <= TranFillStartSyncTick) {
+        if (Ctx->TmpMasterPartTick <= Ctx->TranFillStartSyncTick) {
 
             // Play the standard track
-            TrackPlay(MAIN_LOOP_PTR(CurrPartPtr), MasterTick, TmpMasterPartTick, ratio, 0, MAIN_PART_ID);
+            TrackPlay(MAIN_LOOP_PTR(Ctx->CurrPartPtr), Ctx->MasterTick, Ctx->TmpMasterPartTick, ratio, 0, MAIN_PART_ID);
 
             // If its the end of the track
-            if (TmpMasterPartTick >= MAIN_LOOP_PTR(CurrPartPtr)->nTick) {
-                TranFillStartSyncTick -= MAIN_LOOP_PTR(CurrPartPtr)->nTick;
-                TmpMasterPartTick = 0u;
+            if (Ctx->TmpMasterPartTick >= MAIN_LOOP_PTR(Ctx->CurrPartPtr)->nTick) {
+                Ctx->TranFillStartSyncTick -= MAIN_LOOP_PTR(Ctx->CurrPartPtr)->nTick;
+                Ctx->TmpMasterPartTick = 0u;
             }
         } else {
             // Change the state to pending
-            PlayerStatus = TRANFILL_ACTIVE;
+            Ctx->PlayerStatus = TRANFILL_ACTIVE;
         }
         break;
 
     case OUTRO_WAITING_TRIG:
 
         // If still waiting for trigger
-        if (TmpMasterPartTick <= PartStopSyncTick) {
-            TrackPlay(MAIN_LOOP_PTR(CurrPartPtr), MasterTick, TmpMasterPartTick, ratio, 0, MAIN_PART_ID);
+        if (Ctx->TmpMasterPartTick <= Ctx->PartStopSyncTick) {
+            TrackPlay(MAIN_LOOP_PTR(Ctx->CurrPartPtr), Ctx->MasterTick, Ctx->TmpMasterPartTick, ratio, 0, MAIN_PART_ID);
 
             // If its the end of the track
-            if (TmpMasterPartTick >= MAIN_LOOP_PTR(CurrPartPtr)->nTick) {
-                PartStopSyncTick -= MAIN_LOOP_PTR(CurrPartPtr)->nTick;
-                TmpMasterPartTick = 0u;
+            if (Ctx->TmpMasterPartTick >= MAIN_LOOP_PTR(Ctx->CurrPartPtr)->nTick) {
+                Ctx->PartStopSyncTick -= MAIN_LOOP_PTR(Ctx->CurrPartPtr)->nTick;
+                Ctx->TmpMasterPartTick = 0u;
             }
         } else {
             // if trigger has happen, go in pending mode
-            PlayerStatus = OUTRO;
-            CurrPartPtr = &CurrSongPtr->outro;
+            Ctx->PlayerStatus = OUTRO;
+            Ctx->CurrPartPtr = &Ctx->CurrSongPtr->outro;
         }
 
         break;
@@ -1240,55 +1517,55 @@ void SongPlayer_processSong(float ratio, int32_t nTick) {
         break;
     }
 
-    switch (PlayerStatus) {
+    switch (Ctx->PlayerStatus) {
     case INTRO:
-        TrackPlay(MAIN_LOOP_PTR(CurrPartPtr), MasterTick, TmpMasterPartTick, ratio, 0, INTR_FILL_ID);
+        TrackPlay(MAIN_LOOP_PTR(Ctx->CurrPartPtr), Ctx->MasterTick, Ctx->TmpMasterPartTick, ratio, 0, INTR_FILL_ID);
 
 
-        if (TmpMasterPartTick >= (int)MAIN_LOOP_PTR(CurrPartPtr)->nTick) {
+        if (Ctx->TmpMasterPartTick >= (int)MAIN_LOOP_PTR(Ctx->CurrPartPtr)->nTick) {
             // Play the extra note at the end
-            TrackPlay(MAIN_LOOP_PTR(CurrPartPtr), MAIN_LOOP_PTR(CurrPartPtr)->nTick,
-                    MAIN_LOOP_PTR(CurrPartPtr)->nTick + POST_EVENT_MAX_TICK, ratio,
+            TrackPlay(MAIN_LOOP_PTR(Ctx->CurrPartPtr), MAIN_LOOP_PTR(Ctx->CurrPartPtr)->nTick,
+                    MAIN_LOOP_PTR(Ctx->CurrPartPtr)->nTick + POST_EVENT_MAX_TICK, ratio,
                     nTick, INTR_FILL_ID);
 
-            TmpMasterPartTick = 0u;
+            Ctx->TmpMasterPartTick = 0u;
             fillAPIndex();
-            DrumFillIndex = (APPtr)?getNextAPIndex():0;
+            Ctx->DrumFillIndex = (Ctx->APPtr)?getNextAPIndex():0;
 
-            if (NextPartNumber > 0 && NextPartNumber <= CurrSongPtr->nPart) {
-                PartIndex = NextPartNumber - 1;
+            if (Ctx->NextPartNumber > 0 && Ctx->NextPartNumber <= Ctx->CurrSongPtr->nPart) {
+                Ctx->PartIndex = Ctx->NextPartNumber - 1;
             } else {
-                PartIndex = 0;
+                Ctx->PartIndex = 0;
             }
-            NextPartNumber = 0;
-            CurrPartPtr = &CurrSongPtr->part[PartIndex];
+            Ctx->NextPartNumber = 0;
+            Ctx->CurrPartPtr = &Ctx->CurrSongPtr->part[Ctx->PartIndex];
 
-            PlayerStatus = PLAYING_MAIN_TRACK;
-            BeatCounter = 0;
+            Ctx->PlayerStatus = PLAYING_MAIN_TRACK;
+            Ctx->BeatCounter = 0;
             SpecialEffectManager();
         }
 
         break;
 
     case DRUMFILL_ACTIVE:
-        TrackPlay(DRUM_FILL_PTR(CurrPartPtr, DrumFillIndex),
-                MasterTick - DrumFillStartSyncTick - DrumFillPickUpSyncTickLength,
-                TmpMasterPartTick - DrumFillStartSyncTick - DrumFillPickUpSyncTickLength , ratio, 0,
+        TrackPlay(DRUM_FILL_PTR(Ctx->CurrPartPtr, Ctx->DrumFillIndex),
+                Ctx->MasterTick - Ctx->DrumFillStartSyncTick - Ctx->DrumFillPickUpSyncTickLength,
+                Ctx->TmpMasterPartTick - Ctx->DrumFillStartSyncTick - Ctx->DrumFillPickUpSyncTickLength , ratio, 0,
                 DRUM_FILL_ID);
 
         // Drumfill end detector
-        if (TmpMasterPartTick - DrumFillStartSyncTick - DrumFillPickUpSyncTickLength
-                >= (int)(DRUM_FILL_PTR(CurrPartPtr, DrumFillIndex)->nTick)) {
+        if (Ctx->TmpMasterPartTick - Ctx->DrumFillStartSyncTick - Ctx->DrumFillPickUpSyncTickLength
+                >= (int)(DRUM_FILL_PTR(Ctx->CurrPartPtr, Ctx->DrumFillIndex)->nTick)) {
 
             // Play the extra notes at the end
-            TrackPlay(DRUM_FILL_PTR(CurrPartPtr, DrumFillIndex),
-                    DRUM_FILL_PTR(CurrPartPtr, DrumFillIndex)->nTick,
-                    DRUM_FILL_PTR(CurrPartPtr, DrumFillIndex)->nTick
+            TrackPlay(DRUM_FILL_PTR(Ctx->CurrPartPtr, Ctx->DrumFillIndex),
+                    DRUM_FILL_PTR(Ctx->CurrPartPtr, Ctx->DrumFillIndex)->nTick,
+                    DRUM_FILL_PTR(Ctx->CurrPartPtr, Ctx->DrumFillIndex)->nTick
                     + POST_EVENT_MAX_TICK, ratio, nTick, DRUM_FILL_ID);
-            if(PedalPresswDrumFillFlag != 0){
+            if(Ctx->PedalPresswDrumFillFlag != 0){
                 //if the pedal was pressed the section must restart
                 ResetBeatCounter();
-                PedalPresswDrumFillFlag = 0;
+                Ctx->PedalPresswDrumFillFlag = 0;
             }
             SamePart(TRUE);
             SpecialEffectManager();
@@ -1296,16 +1573,16 @@ void SongPlayer_processSong(float ratio, int32_t nTick) {
         break;
 
     case TRANFILL_ACTIVE:
-        TrackPlay(TRANS_FILL_PTR(CurrPartPtr),
-                MasterTick - TranFillStartSyncTick - TranFillPickUpSyncTickLength,
-                TmpMasterPartTick - TranFillStartSyncTick - TranFillPickUpSyncTickLength,
+        TrackPlay(TRANS_FILL_PTR(Ctx->CurrPartPtr),
+                Ctx->MasterTick - Ctx->TranFillStartSyncTick - Ctx->TranFillPickUpSyncTickLength,
+                Ctx->TmpMasterPartTick - Ctx->TranFillStartSyncTick - Ctx->TranFillPickUpSyncTickLength,
                 ratio,
                 0,
                 TRAN_FILL_ID);
 
-        if (TmpMasterPartTick
-                >= TRANS_FILL_PTR(CurrPartPtr)->nTick + TranFillStartSyncTick) {
-            TranFillStartSyncTick += TRANS_FILL_PTR(CurrPartPtr)->nTick;
+        if (Ctx->TmpMasterPartTick
+                >= TRANS_FILL_PTR(Ctx->CurrPartPtr)->nTick + Ctx->TranFillStartSyncTick) {
+            Ctx->TranFillStartSyncTick += TRANS_FILL_PTR(Ctx->CurrPartPtr)->nTick;
         }
 
         break;
@@ -1314,39 +1591,39 @@ void SongPlayer_processSong(float ratio, int32_t nTick) {
     case TRANFILL_QUITING:
 
         // It is possible to be in a tranfill quiting state before the tranfill active (eg 2 tranf fill in a 4/4)
-        if (TmpMasterPartTick <= TranFillStartSyncTick) {
-           TrackPlay(MAIN_LOOP_PTR(CurrPartPtr),
-                    MasterTick,
-                    TmpMasterPartTick,
+        if (Ctx->TmpMasterPartTick <= Ctx->TranFillStartSyncTick) {
+           TrackPlay(MAIN_LOOP_PTR(Ctx->CurrPartPtr),
+                    Ctx->MasterTick,
+                    Ctx->TmpMasterPartTick,
                     ratio,
                     0,
                     MAIN_PART_ID);
         } else {
-            TrackPlay(TRANS_FILL_PTR(CurrPartPtr),
-                    MasterTick - TranFillStartSyncTick - TranFillPickUpSyncTickLength,
-                    TmpMasterPartTick - TranFillStartSyncTick - TranFillPickUpSyncTickLength,
+            TrackPlay(TRANS_FILL_PTR(Ctx->CurrPartPtr),
+                    Ctx->MasterTick - Ctx->TranFillStartSyncTick - Ctx->TranFillPickUpSyncTickLength,
+                    Ctx->TmpMasterPartTick - Ctx->TranFillStartSyncTick - Ctx->TranFillPickUpSyncTickLength,
                     ratio,
                     0,
                     TRAN_FILL_ID);
         }
-        if (TmpMasterPartTick >= TRANS_FILL_PTR(CurrPartPtr)->nTick + TranFillStartSyncTick + TranFillPickUpSyncTickLength) {
-            TranFillStartSyncTick += TRANS_FILL_PTR(CurrPartPtr)->nTick;
+        if (Ctx->TmpMasterPartTick >= TRANS_FILL_PTR(Ctx->CurrPartPtr)->nTick + Ctx->TranFillStartSyncTick + Ctx->TranFillPickUpSyncTickLength) {
+            Ctx->TranFillStartSyncTick += TRANS_FILL_PTR(Ctx->CurrPartPtr)->nTick;
         }
 
 
         // Tranfill end detector
-        if (TmpMasterPartTick >= TranFillStopSyncTick) {
+        if (Ctx->TmpMasterPartTick >= Ctx->TranFillStopSyncTick) {
             // Play the extra notes at the end
-            TrackPlay(TRANS_FILL_PTR(CurrPartPtr), TRANS_FILL_PTR(CurrPartPtr)->nTick,
-                    TRANS_FILL_PTR(CurrPartPtr)->nTick + POST_EVENT_MAX_TICK,
+            TrackPlay(TRANS_FILL_PTR(Ctx->CurrPartPtr), TRANS_FILL_PTR(Ctx->CurrPartPtr)->nTick,
+                    TRANS_FILL_PTR(Ctx->CurrPartPtr)->nTick + POST_EVENT_MAX_TICK,
                     ratio, nTick, TRAN_FILL_ID);
 
-            if (PlayerStatus == TRANFILL_CANCEL){
+            if (Ctx->PlayerStatus == TRANFILL_CANCEL){
                 SamePart(0);
             } else {
 
                     NextPart();
-                    PedalPresswDrumFillFlag = 0;
+                    Ctx->PedalPresswDrumFillFlag = 0;
             }
             SpecialEffectManager();
         }
@@ -1354,50 +1631,50 @@ void SongPlayer_processSong(float ratio, int32_t nTick) {
         break;
 
     case NO_FILL_TRAN:
-        TrackPlay(MAIN_LOOP_PTR(CurrPartPtr), MasterTick, TmpMasterPartTick, ratio,
+        TrackPlay(MAIN_LOOP_PTR(Ctx->CurrPartPtr), Ctx->MasterTick, Ctx->TmpMasterPartTick, ratio,
                 0, MAIN_PART_ID);
         // If its the end of the track
-        if (TmpMasterPartTick >= MAIN_LOOP_PTR(CurrPartPtr)->nTick) {
+        if (Ctx->TmpMasterPartTick >= MAIN_LOOP_PTR(Ctx->CurrPartPtr)->nTick) {
             // Restart the main groove as usual
-            TmpMasterPartTick = 0;
+            Ctx->TmpMasterPartTick = 0;
         }
         break;
 
     case PLAYING_MAIN_TRACK:
 
-        if (DelayStartCmd){
+        if (Ctx->DelayStartCmd){
             UartMidi_SendStart();
-            DelayStartCmd = 0;
+            Ctx->DelayStartCmd = 0;
         }
 
-        TrackPlay(MAIN_LOOP_PTR(CurrPartPtr), MasterTick, TmpMasterPartTick, ratio,
+        TrackPlay(MAIN_LOOP_PTR(Ctx->CurrPartPtr), Ctx->MasterTick, Ctx->TmpMasterPartTick, ratio,
                 0, MAIN_PART_ID);
-        if(PedalPresswDrumFillFlag == 1 && BeatCounter > 1 && (BeatCounter-1)%MAIN_LOOP_PTR(CurrPartPtr)->timeSigNum ==0){
+        if(Ctx->PedalPresswDrumFillFlag == 1 && Ctx->BeatCounter > 1 && (Ctx->BeatCounter-1)%MAIN_LOOP_PTR(Ctx->CurrPartPtr)->timeSigNum ==0){
             //if the pedal was pressed the section must restart
-            MasterTick = 0;
+            Ctx->MasterTick = 0;
             ResetBeatCounter();
-            PedalPresswDrumFillFlag = 0;
-            PlayerStatus = PLAYING_MAIN_TRACK;
+            Ctx->PedalPresswDrumFillFlag = 0;
+            Ctx->PlayerStatus = PLAYING_MAIN_TRACK;
         }
         // If its the end of the track
-        if (TmpMasterPartTick >= MAIN_LOOP_PTR(CurrPartPtr)->nTick /*|| TmpMasterPartTick > DRUM_FILL_PTR(CurrPartPtr, DrumFillIndex)->event[0].tick*-1*/) {
+        if (Ctx->TmpMasterPartTick >= MAIN_LOOP_PTR(Ctx->CurrPartPtr)->nTick /*|| TmpMasterPartTick > DRUM_FILL_PTR(CurrPartPtr, DrumFillIndex)->event[0].tick*-1*/) {
             SamePart(0);
             SpecialEffectManager();
-        } else if (isEndOfTrack(TmpMasterPartTick, CurrPartPtr/*, loop, loopCount)*/)) {
+        } else if (isEndOfTrack(Ctx->TmpMasterPartTick, Ctx->CurrPartPtr/*, loop, loopCount)*/)) {
 
             SamePart(2); // do a drumfill, if it exists, and loop again
             SpecialEffectManager();
         }
-        if(idxs.size() == 0 && APPtr)
+        if(Ctx->idxs.size() == 0 && Ctx->APPtr)
         {
             fillAPIndex();
         }
         break;
 
     case NO_FILL_TRAN_CANCEL:
-        TrackPlay(MAIN_LOOP_PTR(CurrPartPtr), MasterTick, TmpMasterPartTick, ratio,
+        TrackPlay(MAIN_LOOP_PTR(Ctx->CurrPartPtr), Ctx->MasterTick, Ctx->TmpMasterPartTick, ratio,
                 0, MAIN_PART_ID);
-        if (TmpMasterPartTick >= PartStopSyncTick) {
+        if (Ctx->TmpMasterPartTick >= Ctx->PartStopSyncTick) {
             SamePart(FALSE);
             SpecialEffectManager();
         }
@@ -1406,19 +1683,19 @@ void SongPlayer_processSong(float ratio, int32_t nTick) {
         break;
     case NO_FILL_TRAN_QUITTING:
 
-        TrackPlay(MAIN_LOOP_PTR(CurrPartPtr), MasterTick, TmpMasterPartTick, ratio,
+        TrackPlay(MAIN_LOOP_PTR(Ctx->CurrPartPtr), Ctx->MasterTick, Ctx->TmpMasterPartTick, ratio,
                 0, MAIN_PART_ID);
-        if(PedalPresswDrumFillFlag != 0 && BeatCounter > 1 && (BeatCounter-1)%MAIN_LOOP_PTR(CurrPartPtr)->timeSigNum == 0){
+        if(Ctx->PedalPresswDrumFillFlag != 0 && Ctx->BeatCounter > 1 && (Ctx->BeatCounter-1)%MAIN_LOOP_PTR(Ctx->CurrPartPtr)->timeSigNum == 0){
             //if the pedal was pressed the section must restart
-            MasterTick = 0;
+            Ctx->MasterTick = 0;
             ResetBeatCounter();
-            PedalPresswDrumFillFlag = 0;
-            PlayerStatus = PLAYING_MAIN_TRACK;
-        }else if (PartIndex < CurrSongPtr->nPart - 1) {
-            if (TmpMasterPartTick >= PartStopSyncTick) {
+            Ctx->PedalPresswDrumFillFlag = 0;
+            Ctx->PlayerStatus = PLAYING_MAIN_TRACK;
+        }else if (Ctx->PartIndex < Ctx->CurrSongPtr->nPart - 1) {
+            if (Ctx->TmpMasterPartTick >= Ctx->PartStopSyncTick) {
 
                 NextPart();
-                PedalPresswDrumFillFlag = 0;
+                Ctx->PedalPresswDrumFillFlag = 0;
                 SpecialEffectManager();
 
             }
@@ -1427,12 +1704,12 @@ void SongPlayer_processSong(float ratio, int32_t nTick) {
 
     case PLAYING_MAIN_TRACK_TO_END:
 
-        TrackPlay(MAIN_LOOP_PTR(CurrPartPtr), MasterTick, TmpMasterPartTick, ratio, 0, MAIN_PART_ID);
+        TrackPlay(MAIN_LOOP_PTR(Ctx->CurrPartPtr), Ctx->MasterTick, Ctx->TmpMasterPartTick, ratio, 0, MAIN_PART_ID);
 
-        if (TmpMasterPartTick >= PartStopSyncTick) {
-            if(TransPedalPressFlag){
+        if (Ctx->TmpMasterPartTick >= Ctx->PartStopSyncTick) {
+            if(Ctx->TransPedalPressFlag){
                 NextPart();
-                TransPedalPressFlag = FALSE;
+                Ctx->TransPedalPressFlag = FALSE;
             }else{
                 StopSong();
             }
@@ -1442,23 +1719,23 @@ void SongPlayer_processSong(float ratio, int32_t nTick) {
         break;
 
     case OUTRO:
-        TrackPlay(MAIN_LOOP_PTR(CurrPartPtr),
-                MasterTick - PartStopSyncTick - PartStopPickUpSyncTickLength,
-                TmpMasterPartTick - PartStopSyncTick - PartStopPickUpSyncTickLength,
+        TrackPlay(MAIN_LOOP_PTR(Ctx->CurrPartPtr),
+                Ctx->MasterTick - Ctx->PartStopSyncTick - Ctx->PartStopPickUpSyncTickLength,
+                Ctx->TmpMasterPartTick - Ctx->PartStopSyncTick - Ctx->PartStopPickUpSyncTickLength,
                 ratio,
                 0,
                 OUTR_FILL_ID);
 
         // If its the end of the track
-        if (TmpMasterPartTick >= MAIN_LOOP_PTR(CurrPartPtr)->nTick + PartStopSyncTick + PartStopPickUpSyncTickLength) {
+        if (Ctx->TmpMasterPartTick >= MAIN_LOOP_PTR(Ctx->CurrPartPtr)->nTick + Ctx->PartStopSyncTick + Ctx->PartStopPickUpSyncTickLength) {
 
             // Play the extra note at the end
-            TrackPlay(MAIN_LOOP_PTR(CurrPartPtr), MAIN_LOOP_PTR(CurrPartPtr)->nTick,
-                    MAIN_LOOP_PTR(CurrPartPtr)->nTick + POST_EVENT_MAX_TICK, ratio,
+            TrackPlay(MAIN_LOOP_PTR(Ctx->CurrPartPtr), MAIN_LOOP_PTR(Ctx->CurrPartPtr)->nTick,
+                    MAIN_LOOP_PTR(Ctx->CurrPartPtr)->nTick + POST_EVENT_MAX_TICK, ratio,
                     nTick, OUTR_FILL_ID);
 
             // Stop the song after the last sounds have been launched
-            PedalPresswDrumFillFlag = 0;
+            Ctx->PedalPresswDrumFillFlag = 0;
             StopSong();
         }
 
@@ -1466,18 +1743,18 @@ void SongPlayer_processSong(float ratio, int32_t nTick) {
 
     case OUTRO_CANCELED:
 
-        TrackPlay(MAIN_LOOP_PTR(CurrPartPtr),
-                MasterTick - PartStopSyncTick- PartStopPickUpSyncTickLength,
-                TmpMasterPartTick - PartStopSyncTick - PartStopPickUpSyncTickLength,
+        TrackPlay(MAIN_LOOP_PTR(Ctx->CurrPartPtr),
+                Ctx->MasterTick - Ctx->PartStopSyncTick- Ctx->PartStopPickUpSyncTickLength,
+                Ctx->TmpMasterPartTick - Ctx->PartStopSyncTick - Ctx->PartStopPickUpSyncTickLength,
                 ratio,
                 0,
                 OUTR_FILL_ID);
 
         // If it's the end of the track
-        if (TmpMasterPartTick >= MAIN_LOOP_PTR(CurrPartPtr)->nTick + PartStopSyncTick + PartStopPickUpSyncTickLength) {
+        if (Ctx->TmpMasterPartTick >= MAIN_LOOP_PTR(Ctx->CurrPartPtr)->nTick + Ctx->PartStopSyncTick + Ctx->PartStopPickUpSyncTickLength) {
             // Play the extra note at the end
-            TrackPlay(MAIN_LOOP_PTR(CurrPartPtr), MAIN_LOOP_PTR(CurrPartPtr)->nTick,
-                    MAIN_LOOP_PTR(CurrPartPtr)->nTick + POST_EVENT_MAX_TICK,
+            TrackPlay(MAIN_LOOP_PTR(Ctx->CurrPartPtr), MAIN_LOOP_PTR(Ctx->CurrPartPtr)->nTick,
+                    MAIN_LOOP_PTR(Ctx->CurrPartPtr)->nTick + POST_EVENT_MAX_TICK,
                     ratio,
                     nTick,
                     OUTR_FILL_ID);
@@ -1499,83 +1776,83 @@ void SongPlayer_processSong(float ratio, int32_t nTick) {
 
 
     // Advance the master tick counter
-    MasterTick = TmpMasterPartTick;
-    LastPlayerStatus = PlayerStatus;
+    Ctx->MasterTick = Ctx->TmpMasterPartTick;
+    Ctx->LastPlayerStatus = Ctx->PlayerStatus;
     GUI_ForceRefresh();
 }
 
 void SongPlayer_IngoreNextRelease(void){
-    PedalPressFlag = 0;
+    Ctx->PedalPressFlag = 0;
 }
 
 
 uint32_t SongPlayer_isPlaying(void) {
-    return PlayerStatus != NO_SONG_LOADED && PlayerStatus != STOPPED;
+    return Ctx->PlayerStatus != NO_SONG_LOADED && Ctx->PlayerStatus != STOPPED;
 }
 
 static void PauseUnpauseHandler(void) {
     uint8_t status;
 
     status = IntDisable();
-    if ((PlayerStatus != STOPPED) && (PlayerStatus != NO_SONG_LOADED)) {
-        RequestFlag = PAUSE_REQUEST;
+    if ((Ctx->PlayerStatus != STOPPED) && (Ctx->PlayerStatus != NO_SONG_LOADED)) {
+        Ctx->RequestFlag = PAUSE_REQUEST;
     }
     IntEnable(status);
 }
 
 
 static void NextPart(void) {
-    TmpMasterPartTick = 0;
-    MasterTick = 0;
-    BeatCounter = 0;
-    WasPausedFlag = 0;
-    SobrietyDrumTranFill = 0;
-    Test = 0;
+    Ctx->TmpMasterPartTick = 0;
+    Ctx->MasterTick = 0;
+    Ctx->BeatCounter = 0;
+    Ctx->WasPausedFlag = 0;
+    Ctx->SobrietyDrumTranFill = 0;
+    Ctx->Test = 0;
     
-    if (CurrSongPtr->nPart > 0) {
-        if (NextPartNumber > 0 && NextPartNumber <= CurrSongPtr->nPart && PedalPresswDrumFillFlag != 1) {
-            PartIndex = NextPartNumber - 1;
-        } else if(PedalPresswDrumFillFlag != 1){
-            PartIndex = (PartIndex + 1) % CurrSongPtr->nPart;
+    if (Ctx->CurrSongPtr->nPart > 0) {
+        if (Ctx->NextPartNumber > 0 && Ctx->NextPartNumber <= Ctx->CurrSongPtr->nPart && Ctx->PedalPresswDrumFillFlag != 1) {
+            Ctx->PartIndex = Ctx->NextPartNumber - 1;
+        } else if(Ctx->PedalPresswDrumFillFlag != 1){
+            Ctx->PartIndex = (Ctx->PartIndex + 1) % Ctx->CurrSongPtr->nPart;
         }
 
-        NextPartNumber = 0;
-        CurrPartPtr = &CurrSongPtr->part[PartIndex];
-        PlayerStatus = PLAYING_MAIN_TRACK;
-        BeatCounter = 0;
+        Ctx->NextPartNumber = 0;
+        Ctx->CurrPartPtr = &Ctx->CurrSongPtr->part[Ctx->PartIndex];
+        Ctx->PlayerStatus = PLAYING_MAIN_TRACK;
+        Ctx->BeatCounter = 0;
 
     } else {
         StopSong();
     }
 
     // Suffle drumsets if enabled in song
-    if (CurrPartPtr->shuffleFlag) {
-        if (CurrPartPtr->nDrumFill != 0) {
-            DrumFillIndex = rand() % CurrPartPtr->nDrumFill;
+    if (Ctx->CurrPartPtr->shuffleFlag) {
+        if (Ctx->CurrPartPtr->nDrumFill != 0) {
+            Ctx->DrumFillIndex = rand() % Ctx->CurrPartPtr->nDrumFill;
         }
     } else {
         fillAPIndex();
-        DrumFillIndex = (APPtr)?getNextAPIndex():0;
+        Ctx->DrumFillIndex = (Ctx->APPtr)?getNextAPIndex():0;
     }
 
     // Send next part message on Uart Port
-    UartMidi_sendNextPartMessage(PartIndex + 1);
+    UartMidi_sendNextPartMessage(Ctx->PartIndex + 1);
 }
 
 static void OutroPart(void) {
-    TmpMasterPartTick = 0;
-    MasterTick = 0;
-    BeatCounter = 0;
+    Ctx->TmpMasterPartTick = 0;
+    Ctx->MasterTick = 0;
+    Ctx->BeatCounter = 0;
 }
 
 static void SwapToOutro(void){
-    DrumFillIndex = 0;
-    PartStopSyncTick = 0;
+    Ctx->DrumFillIndex = 0;
+    Ctx->PartStopSyncTick = 0;
 
-    if (OUTRO_TRACK_PTR(CurrSongPtr)) {
-        CurrPartPtr = &CurrSongPtr->outro;
-        MasterTick %= MAIN_LOOP_PTR(CurrPartPtr)->barLength;
-        PlayerStatus = OUTRO;
+    if (OUTRO_TRACK_PTR(Ctx->CurrSongPtr)) {
+        Ctx->CurrPartPtr = &Ctx->CurrSongPtr->outro;
+        Ctx->MasterTick %= MAIN_LOOP_PTR(Ctx->CurrPartPtr)->barLength;
+        Ctx->PlayerStatus = OUTRO;
     } else {
         StopSong();
     }
@@ -1586,38 +1863,38 @@ static void SwapToOutro(void){
  * @brief FirstPart
  */
 static void FirstPart(void) {
-    TmpMasterPartTick = 0;
-    MasterTick = 0;
-    WasPausedFlag = 0;
-    BeatCounter = 0;
+    Ctx->TmpMasterPartTick = 0;
+    Ctx->MasterTick = 0;
+    Ctx->WasPausedFlag = 0;
+    Ctx->BeatCounter = 0;
 
-    if (CurrSongPtr->nPart > 0) {
+    if (Ctx->CurrSongPtr->nPart > 0) {
 
-        if (NextPartNumber > 0 && NextPartNumber <= CurrSongPtr->nPart) {
-            PartIndex = NextPartNumber - 1;
+        if (Ctx->NextPartNumber > 0 && Ctx->NextPartNumber <= Ctx->CurrSongPtr->nPart) {
+            Ctx->PartIndex = Ctx->NextPartNumber - 1;
         } else {
-            PartIndex = 0;
+            Ctx->PartIndex = 0;
         }
 
-        NextPartNumber = 0;
-        CurrPartPtr = &CurrSongPtr->part[PartIndex];
+        Ctx->NextPartNumber = 0;
+        Ctx->CurrPartPtr = &Ctx->CurrSongPtr->part[Ctx->PartIndex];
     } else {
         StopSong();
         return;
     }
 
-    if (CurrPartPtr != NULL ) {
-        if (CurrPartPtr->nDrumFill != 0) {
-            if (CurrPartPtr->shuffleFlag) {
-                DrumFillIndex = rand() % CurrPartPtr->nDrumFill;
+    if (Ctx->CurrPartPtr != NULL ) {
+        if (Ctx->CurrPartPtr->nDrumFill != 0) {
+            if (Ctx->CurrPartPtr->shuffleFlag) {
+                Ctx->DrumFillIndex = rand() % Ctx->CurrPartPtr->nDrumFill;
             } else {
-                DrumFillIndex = (APPtr)?getNextAPIndex():0; // First Drumfill always
+                Ctx->DrumFillIndex = (Ctx->APPtr)?getNextAPIndex():0; // First Drumfill always
             }
         }
     }
 
-    PlayerStatus = PLAYING_MAIN_TRACK;
-    BeatCounter = 0;
+    Ctx->PlayerStatus = PLAYING_MAIN_TRACK;
+    Ctx->BeatCounter = 0;
 
 }
 
@@ -1625,52 +1902,52 @@ static void FirstPart(void) {
  * @brief IntroPart
  */
 static void IntroPart(void) {
-    DrumFillIndex = 0;
-    MasterTick = 0;
-    WasPausedFlag = 0;
-    PartIndex = 0;
+    Ctx->DrumFillIndex = 0;
+    Ctx->MasterTick = 0;
+    Ctx->WasPausedFlag = 0;
+    Ctx->PartIndex = 0;
 
-    if (INTRO_TRACK_PTR(CurrSongPtr) != NULL) {
-        PlayerStatus = INTRO;
-        CurrPartPtr = &CurrSongPtr->intro;
+    if (INTRO_TRACK_PTR(Ctx->CurrSongPtr) != NULL) {
+        Ctx->PlayerStatus = INTRO;
+        Ctx->CurrPartPtr = &Ctx->CurrSongPtr->intro;
 
         // If the intro have pickup notes
-        if (MAIN_LOOP_PTR(CurrPartPtr)->pickupNotesLength){
+        if (MAIN_LOOP_PTR(Ctx->CurrPartPtr)->pickupNotesLength){
 
             // If the length is not a multiple of nTick
-            if (MAIN_LOOP_PTR(CurrPartPtr)->pickupNotesLength % 20){
-                MasterTick =  0 - (( 1 + MAIN_LOOP_PTR(CurrPartPtr)->pickupNotesLength / 20) * 20);
+            if (MAIN_LOOP_PTR(Ctx->CurrPartPtr)->pickupNotesLength % 20){
+                Ctx->MasterTick =  0 - (( 1 + MAIN_LOOP_PTR(Ctx->CurrPartPtr)->pickupNotesLength / 20) * 20);
             } else {
-                MasterTick =  0 - (( 0 + MAIN_LOOP_PTR(CurrPartPtr)->pickupNotesLength/ 20) * 20);
+                Ctx->MasterTick =  0 - (( 0 + MAIN_LOOP_PTR(Ctx->CurrPartPtr)->pickupNotesLength/ 20) * 20);
             }
         } else {
-            MasterTick = 0;
+            Ctx->MasterTick = 0;
         }
 
     } else {
-        if (NextPartNumber > 0 && NextPartNumber <= CurrSongPtr->nPart) {
-            PartIndex = NextPartNumber - 1;
+        if (Ctx->NextPartNumber > 0 && Ctx->NextPartNumber <= Ctx->CurrSongPtr->nPart) {
+            Ctx->PartIndex = Ctx->NextPartNumber - 1;
         } else {
-            PartIndex = 0;
+            Ctx->PartIndex = 0;
         }
 
-        NextPartNumber = 0;
-        CurrPartPtr = &CurrSongPtr->part[PartIndex];
+        Ctx->NextPartNumber = 0;
+        Ctx->CurrPartPtr = &Ctx->CurrSongPtr->part[Ctx->PartIndex];
 
 
-        if (CurrPartPtr->shuffleFlag) {
-            if (CurrPartPtr->nDrumFill != 0) {
-                DrumFillIndex = rand() % CurrPartPtr->nDrumFill;
+        if (Ctx->CurrPartPtr->shuffleFlag) {
+            if (Ctx->CurrPartPtr->nDrumFill != 0) {
+                Ctx->DrumFillIndex = rand() % Ctx->CurrPartPtr->nDrumFill;
             }
         } else {
             fillAPIndex();
-            DrumFillIndex = (APPtr)?getNextAPIndex():0;
+            Ctx->DrumFillIndex = (Ctx->APPtr)?getNextAPIndex():0;
         }
         SpecialEffectManager();
 
-        PlayerStatus = PLAYING_MAIN_TRACK;
+        Ctx->PlayerStatus = PLAYING_MAIN_TRACK;
     }
-    MAIN_LOOP_PTR(CurrPartPtr)->index = 0;
+    MAIN_LOOP_PTR(Ctx->CurrPartPtr)->index = 0;
 }
 
 /**
@@ -1678,21 +1955,21 @@ static void IntroPart(void) {
  * Check the current state of the loop and adds a beat to the beat counter if needed
  */
 static void CheckAndCountBeat(void) {
-    if(!playingPickUp)
+    if(!Ctx->playingPickUp)
     {
         TimeSignature timeSignature;
         SongPlayer_getTimeSignature(&timeSignature);
         unsigned int ticksPerCount = (SongPlayer_getbarLength() / timeSignature.num);
-        unsigned int newTickPosition = (MasterTick % ticksPerCount);
+        unsigned int newTickPosition = (Ctx->MasterTick % ticksPerCount);
         CalculateMainTrim(ticksPerCount, newTickPosition);
-        bool shouldcount =  newTickPosition <= currentLoopTick || BeatCounter == 0;
+        bool shouldcount =  newTickPosition <= Ctx->currentLoopTick || Ctx->BeatCounter == 0;
 
         if (shouldcount) {
-            BeatCounter++;
-              qDebug() << MasterTick << "CBeat" << BeatCounter << timeSignature.num;
+            Ctx->BeatCounter++;
+              qDebug() << Ctx->MasterTick << "CBeat" << Ctx->BeatCounter << timeSignature.num;
         }
-        currentLoopTick = (newEnd != 0)? newTickPosition + addedTick: newTickPosition;
-        addedTick = 0;
+        Ctx->currentLoopTick = (Ctx->newEnd != 0)? newTickPosition + Ctx->addedTick: newTickPosition;
+        Ctx->addedTick = 0;
     }
 };
 /**
@@ -1700,23 +1977,23 @@ static void CheckAndCountBeat(void) {
  * Check the current state of the beat to see if is bigger than next drum fill have pick up notes
  */
 static void CalculateMainTrim(unsigned int ticksPerCount, unsigned int newTickPosition){
-    auto Drumpart = DRUM_FILL_PTR(CurrPartPtr, DrumFillIndex);//if there is a drumfill
+    auto Drumpart = DRUM_FILL_PTR(Ctx->CurrPartPtr, Ctx->DrumFillIndex);//if there is a drumfill
     if(Drumpart){
-        bool hasPickUpNotes= DRUM_FILL_PTR(CurrPartPtr, DrumFillIndex)->event[0].tick < 0 && APPtr->part[PartIndex].drumFill[DrumFillIndex].playAt > 0;
+        bool hasPickUpNotes= DRUM_FILL_PTR(Ctx->CurrPartPtr, Ctx->DrumFillIndex)->event[0].tick < 0 && Ctx->APPtr->part[Ctx->PartIndex].drumFill[Ctx->DrumFillIndex].playAt > 0;
         bool isLastBeat = false;
-        if(DRUM_FILL_PTR(CurrPartPtr, DrumFillIndex)->nTick < MAIN_LOOP_PTR(CurrPartPtr)->barLength){
+        if(DRUM_FILL_PTR(Ctx->CurrPartPtr, Ctx->DrumFillIndex)->nTick < MAIN_LOOP_PTR(Ctx->CurrPartPtr)->barLength){
             //if the fill is shorter and is already waiting for trig
-            isLastBeat = (PlayerStatus == DRUMFILL_WAITING_TRIG && TmpMasterPartTick+DrumFillPickUpSyncTickLength > DrumFillStartSyncTick)?true:false;
+            isLastBeat = (Ctx->PlayerStatus == DRUMFILL_WAITING_TRIG && Ctx->TmpMasterPartTick+Ctx->DrumFillPickUpSyncTickLength > Ctx->DrumFillStartSyncTick)?true:false;
         }else{
-            isLastBeat = BeatCounter == APPtr->part[PartIndex].drumFill[DrumFillIndex].playAt-1 && CurrPartPtr->nDrumFill > 0;
+            isLastBeat = Ctx->BeatCounter == Ctx->APPtr->part[Ctx->PartIndex].drumFill[Ctx->DrumFillIndex].playAt-1 && Ctx->CurrPartPtr->nDrumFill > 0;
         }
-        addedTick = ticksPerCount - newTickPosition;
+        Ctx->addedTick = ticksPerCount - newTickPosition;
 
-        if(addedTick < std::abs(DRUM_FILL_PTR(CurrPartPtr, DrumFillIndex)->event[0].tick) && isLastBeat && hasPickUpNotes){
-            newEnd = DRUM_FILL_PTR(CurrPartPtr, DrumFillIndex)->event[0].tick;//send a message to start next beat but take master tick to the next one
-            MasterTick += addedTick;
+        if(Ctx->addedTick < std::abs(DRUM_FILL_PTR(Ctx->CurrPartPtr, Ctx->DrumFillIndex)->event[0].tick) && isLastBeat && hasPickUpNotes){
+            Ctx->newEnd = DRUM_FILL_PTR(Ctx->CurrPartPtr, Ctx->DrumFillIndex)->event[0].tick;//send a message to start next beat but take master tick to the next one
+            Ctx->MasterTick += Ctx->addedTick;
         }else {
-            newEnd = 0;
+            Ctx->newEnd = 0;
         }
     }
 }
@@ -1726,71 +2003,71 @@ static void CalculateMainTrim(unsigned int ticksPerCount, unsigned int newTickPo
  * @param nextDrumfill
  */
 static void SamePart(unsigned int nextDrumfill) {
-    TmpMasterPartTick = 0;
-    MasterTick = 0;
-    WasPausedFlag = 0;
-    if(PedalPresswDrumFillFlag == 1){
-        MasterTick = 0;
+    Ctx->TmpMasterPartTick = 0;
+    Ctx->MasterTick = 0;
+    Ctx->WasPausedFlag = 0;
+    if(Ctx->PedalPresswDrumFillFlag == 1){
+        Ctx->MasterTick = 0;
         ResetBeatCounter();
-        PedalPresswDrumFillFlag = 0;
-        PlayerStatus = PLAYING_MAIN_TRACK;
+        Ctx->PedalPresswDrumFillFlag = 0;
+        Ctx->PlayerStatus = PLAYING_MAIN_TRACK;
     }else{
         if (nextDrumfill) {
-            if (CurrPartPtr != NULL ) {
-                if (CurrPartPtr->nDrumFill != 0) {
-                    if (CurrPartPtr->shuffleFlag) {
-                        DrumFillIndex = rand() % CurrPartPtr->nDrumFill;
+            if (Ctx->CurrPartPtr != NULL ) {
+                if (Ctx->CurrPartPtr->nDrumFill != 0) {
+                    if (Ctx->CurrPartPtr->shuffleFlag) {
+                        Ctx->DrumFillIndex = rand() % Ctx->CurrPartPtr->nDrumFill;
                     } else {
-                        DrumFillIndex = (APPtr)?getNextAPIndex():(DrumFillIndex + 1) % CurrPartPtr->nDrumFill;
+                        Ctx->DrumFillIndex = (Ctx->APPtr)?getNextAPIndex():(Ctx->DrumFillIndex + 1) % Ctx->CurrPartPtr->nDrumFill;
                     }
                 }
             }
         }
 
-        CurrPartPtr = &CurrSongPtr->part[PartIndex];
+        Ctx->CurrPartPtr = &Ctx->CurrSongPtr->part[Ctx->PartIndex];
 
-        PlayerStatus = PLAYING_MAIN_TRACK;
+        Ctx->PlayerStatus = PLAYING_MAIN_TRACK;
     }
 }
 
 static unsigned int getNextAPIndex()
 {
     unsigned int index;
-    if(idxs.size() <= 0)
+    if(Ctx->idxs.size() <= 0)
     {
       return 0; //if that was the last drumfill
     }else{
-        index = idxs.first();
-        idxs.remove(idxs.firstKey());
+        index = Ctx->idxs.first();
+        Ctx->idxs.remove(Ctx->idxs.firstKey());
        return index;
     }
 }
 
 static void fillAPIndex()
 {
-    if(APPtr)
+    if(Ctx->APPtr)
     {
-        if(CurrPartPtr){
-            idxs.clear();//avoid pedal press in the middle of sequence
-            int counter = CurrSongPtr->part[PartIndex].nDrumFill;
+        if(Ctx->CurrPartPtr){
+            Ctx->idxs.clear();//avoid pedal press in the middle of sequence
+            int counter = Ctx->CurrSongPtr->part[Ctx->PartIndex].nDrumFill;
             for(int i = 0;i < counter; i++)
             {
-                if(APPtr->part[PartIndex].drumFill[i].playAt > 0){
-                  idxs.insert(APPtr->part[PartIndex].drumFill[i].playAt,i);
+                if(Ctx->APPtr->part[Ctx->PartIndex].drumFill[i].playAt > 0){
+                  Ctx->idxs.insert(Ctx->APPtr->part[Ctx->PartIndex].drumFill[i].playAt,i);
                 }
             }
         }
     }
 }
 
-static bool isEndOfTrack(int pos, SONG_SongPartStruct *CurrPartPtr/*, int loop, int loopCount*/) {
+static bool isEndOfTrack(int pos, SONG_SongPartStruct *partPtr/*, int loop, int loopCount*/) {
     // the issue here is to decide when to make decision.  Last measure, or end of loop
     // 1) if no fills or transitions, then end of loop
     // 2) no fills, but a trans, then end of loop unless it's last, then use last measure.
     // 3) if fills, but no trans, then last measure, unless it's last, then end of loop.
     // 4) if fills and transtions, then always last measure.
 
-    int endOfTrack = MAIN_LOOP_PTR(CurrPartPtr)->nTick;
+    int endOfTrack = MAIN_LOOP_PTR(partPtr)->nTick;
 
     return pos>endOfTrack;
 }
@@ -1806,8 +2083,10 @@ static bool isEndOfTrack(int pos, SONG_SongPartStruct *CurrPartPtr/*, int loop,
  */
 static void TrackPlay(MIDIPARSER_MidiTrack *track, int32_t startTick, int32_t endTick, float ratio,
         int32_t manualOffset, uint32_t partID) {
-    float delay;
-     playingPickUp = (startTick < 0)? true : false;
+    int64_t delay;
+    int64_t originFrame;
+    const int64_t *frame;
+     Ctx->playingPickUp = (startTick < 0)? true : false;
 
     // if the index of the song is outside the array of event, put it to the last value
     if (track->index >= track->event.size())
@@ -1817,32 +2096,43 @@ static void TrackPlay(MIDIPARSER_MidiTrack *track, int32_t startTick, int32_t en
     if (track->event.empty() || startTick > track->event.back().tick)
         return;
 
-    // if the play position is before the current track position
-    if (startTick < track->event[track->index].tick)
-        track->index = 0u;
-
-    // Advance the track to the right position
-    while (track->event[track->index].tick < startTick) {
+    // Move the track to the first event at or after the play position. The events are
+    // sorted, search before the current position on loop wraps, fills and transitions,
+    // after it otherwise.
+    {
+        auto first = track->event.begin();
+        auto last = track->event.end();
+        auto current = first + track->index;
+        MIDIPARSER_MidiEvent start(startTick);
 
-        track->index++;
+        if (startTick < current->tick) {
+            last = current;
+        } else {
+            first = current;
+        }
+        track->index = (uint32_t)(std::lower_bound(first, last, start, eventTickLess) - track->event.begin());
 
         // If no event is found exit the function
         if (track->index >= track->event.size())
             return;
     }
 
+    // Frame of the origin of the mixer events in the timeline of the track
+    frame = TrackTimeline(track);
+    originFrame = SongPlayer_ticksToFrames(startTick - manualOffset, Ctx->TimelineTempo);
+
     // Play all the sound between start tick and end tick
     while (track->event[track->index].tick < endTick) {
 
-        delay = ratio * (float) (manualOffset + track->event[track->index].tick - startTick);
+        delay = frame[track->index] - originFrame;
 
         // Play the event
         SoundManager_playDrumsetNote(track->event[track->index].note,
                 track->event[track->index].vel,
-                delay,
+                (delay > 0) ? (unsigned int)delay : 0u,
                 ratio,
                 partID,
-                playingPickUp);
+                Ctx->playingPickUp);
 
         track->index++;
 
@@ -1851,12 +2141,12 @@ static void TrackPlay(MIDIPARSER_MidiTrack *track, int32_t startTick, int32_t en
             return;
     }
     //check if done playing pick up notes to adjust beat counter
-    if(DrumFillPickUpSyncTickLength > 0 && track->event[track->index].tick >= 0 && PlayerStatus != DRUMFILL_WAITING_TRIG){
-        TmpMasterPartTick -=DrumFillPickUpSyncTickLength;//This avoids displacing the beat
-        DrumFillPickUpSyncTickLength = 0;
-        if(playingPickUp){//if it played pick up notes, on pedal press pick up notes might not play
-             qDebug() <<"The pick up notes were played and next tick is " << track->event[track->index].tick <<"The current beta is "<<BeatCounter;
-             currentLoopTick= 0;
+    if(Ctx->DrumFillPickUpSyncTickLength > 0 && track->event[track->index].tick >= 0 && Ctx->PlayerStatus != DRUMFILL_WAITING_TRIG){
+        Ctx->TmpMasterPartTick -=Ctx->DrumFillPickUpSyncTickLength;//This avoids displacing the beat
+        Ctx->DrumFillPickUpSyncTickLength = 0;
+        if(Ctx->playingPickUp){//if it played pick up notes, on pedal press pick up notes might not play
+             qDebug() <<"The pick up notes were played and next tick is " << track->event[track->index].tick <<"The current beta is "<<Ctx->BeatCounter;
+             Ctx->currentLoopTick= 0;
         }
     }
 }
@@ -1876,32 +2166,32 @@ static int32_t CalculateStartBarSyncTick(uint32_t tickPos,
 }
 
 static void StopSong(void) {
-    if(PedalPresswDrumFillFlag == 1 && MultiTapCounter == 0){
-        MasterTick = 0;
+    if(Ctx->PedalPresswDrumFillFlag == 1 && Ctx->MultiTapCounter == 0){
+        Ctx->MasterTick = 0;
         ResetBeatCounter();
-        PedalPresswDrumFillFlag = 0;
-        PlayerStatus = PLAYING_MAIN_TRACK;
+        Ctx->PedalPresswDrumFillFlag = 0;
+        Ctx->PlayerStatus = PLAYING_MAIN_TRACK;
     }else{
         uint8_t status = IntDisable();
-        DrumFillIndex = 0;
-        PartIndex = 0;
-        MasterTick = 0;
-        BeatCounter = 0;
-        NextPartNumber = 0;
-        SobrietyDrumTranFill = 0;
+        Ctx->DrumFillIndex = 0;
+        Ctx->PartIndex = 0;
+        Ctx->MasterTick = 0;
+        Ctx->BeatCounter = 0;
+        Ctx->NextPartNumber = 0;
+        Ctx->SobrietyDrumTranFill = 0;
 
         // Cancel any pending action
-        RequestFlag = REQUEST_DONE;
-        if (CurrSongPtr != NULL ) {
-            PlayerStatus = STOPPED;
+        Ctx->RequestFlag = REQUEST_DONE;
+        if (Ctx->CurrSongPtr != NULL ) {
+            Ctx->PlayerStatus = STOPPED;
         } else {
-            PlayerStatus = NO_SONG_LOADED;
+            Ctx->PlayerStatus = NO_SONG_LOADED;
         }
-        CurrPartPtr = NULL;
+        Ctx->CurrPartPtr = NULL;
         IntEnable(status);
 
         SpecialEffectManager();
-        if (SendStopOnEnd) UartMidi_SendStop();
+        if (Ctx->SendStopOnEnd) UartMidi_SendStop();
         GUI_ForceRefresh();
     }
 
@@ -1925,16 +2215,16 @@ static void  STOPPED_ButtonHandler(BUTTON_EVENT event){
 
     switch(event){
     case BUTTON_EVENT_PEDAL_PRESS:
-        if (StartBeatOnPress && PedalPressFlag) {
-            RequestFlag = START_REQUEST;
-            PedalPressFlag = 0;
+        if (Ctx->StartBeatOnPress && Ctx->PedalPressFlag) {
+            Ctx->RequestFlag = START_REQUEST;
+            Ctx->PedalPressFlag = 0;
             SpecialEffectManager();
             TEMPO_startWithInt();
         }
         break;
     case BUTTON_EVENT_PEDAL_RELEASE:
-        if (!StartBeatOnPress && PedalPressFlag) {
-            RequestFlag = START_REQUEST;
+        if (!Ctx->StartBeatOnPress && Ctx->PedalPressFlag) {
+            Ctx->RequestFlag = START_REQUEST;
             SpecialEffectManager();
             TEMPO_startWithInt();
         }
@@ -1950,17 +2240,17 @@ static void  PAUSED_ButtonHandler(BUTTON_EVENT event){
     switch(event){
 
     case BUTTON_EVENT_PEDAL_PRESS:
-        if (StartBeatOnPress) {
-            RequestFlag = START_REQUEST;
+        if (Ctx->StartBeatOnPress) {
+            Ctx->RequestFlag = START_REQUEST;
             SpecialEffectManager();
             TEMPO_startWithInt();
-            PedalPressFlag = 0;
+            Ctx->PedalPressFlag = 0;
         }
         break;
 
     case BUTTON_EVENT_PEDAL_RELEASE:
-        if (!StartBeatOnPress) {
-            RequestFlag = START_REQUEST;
+        if (!Ctx->StartBeatOnPress) {
+            Ctx->RequestFlag = START_REQUEST;
             SpecialEffectManager();
             TEMPO_startWithInt();
         }
@@ -1968,11 +2258,11 @@ static void  PAUSED_ButtonHandler(BUTTON_EVENT event){
 
     case BUTTON_EVENT_PEDAL_LONG_PRESS:
 
-        if (MainUnpauseModeHoldToTransition == START_TRANSITION) {
-            NextPartNumber = 0; // Means no specific next part
-            RequestFlag = TRANFILL_REQUEST;
+        if (Ctx->MainUnpauseModeHoldToTransition == START_TRANSITION) {
+            Ctx->NextPartNumber = 0; // Means no specific next part
+            Ctx->RequestFlag = TRANFILL_REQUEST;
         } else {
-            PedalPressFlag = 0; // Force a 0 to make sure the next release doesn't start the song again
+            Ctx->PedalPressFlag = 0; // Force a 0 to make sure the next release doesn't start the song again
             StopSong();
         }
         break;
@@ -1990,9 +2280,9 @@ static void  INTRO_ButtonHandler(BUTTON_EVENT event){
 
     switch(event){
     case BUTTON_EVENT_PEDAL_MULTI_TAP:
-        RequestFlag = SWAP_TO_OUTRO_REQUEST;
-        if (!TrippleTapEnable) {
-            MultiTapCounter = 0;
+        Ctx->RequestFlag = SWAP_TO_OUTRO_REQUEST;
+        if (!Ctx->TrippleTapEnable) {
+            Ctx->MultiTapCounter = 0;
         }
         break;
     default:
@@ -2004,23 +2294,23 @@ static void  PLAYING_MAIN_TRACK_ButtonHandler(BUTTON_EVENT event){
 
     switch(event){
     case BUTTON_EVENT_PEDAL_RELEASE:
-        RequestFlag = DRUMFILL_REQUEST;
-        PedalPresswDrumFillFlag = 1;
+        Ctx->RequestFlag = DRUMFILL_REQUEST;
+        Ctx->PedalPresswDrumFillFlag = 1;
         break;
     case BUTTON_EVENT_PEDAL_LONG_PRESS:
-        NextPartNumber = 0; // Means no specific next part
-        RequestFlag = TRANFILL_REQUEST;
-        TransPedalPressFlag = TRUE;
+        Ctx->NextPartNumber = 0; // Means no specific next part
+        Ctx->RequestFlag = TRANFILL_REQUEST;
+        Ctx->TransPedalPressFlag = TRUE;
         break;
     case BUTTON_EVENT_PEDAL_MULTI_TAP:
-        if (WasPausedFlag) {
-            RequestFlag = SWAP_TO_OUTRO_REQUEST;
+        if (Ctx->WasPausedFlag) {
+            Ctx->RequestFlag = SWAP_TO_OUTRO_REQUEST;
         } else {
-            RequestFlag = STOP_REQUEST;
+            Ctx->RequestFlag = STOP_REQUEST;
             // will allow future multi tap
-            PedalPressFlag = 0;
-            if (!TrippleTapEnable) {
-                MultiTapCounter = 0;
+            Ctx->PedalPressFlag = 0;
+            if (!Ctx->TrippleTapEnable) {
+                Ctx->MultiTapCounter = 0;
             }
         }
         break;
@@ -2033,8 +2323,8 @@ static void  PLAYING_MAIN_TRACK_TO_END_ButtonHandler(BUTTON_EVENT event){
 
     switch (event){
     case BUTTON_EVENT_PEDAL_RELEASE:
-        RequestFlag = OUTRO_CANCEL_REQUEST;
-        PedalPresswDrumFillFlag = 1;
+        Ctx->RequestFlag = OUTRO_CANCEL_REQUEST;
+        Ctx->PedalPresswDrumFillFlag = 1;
         break;
     default:
         break;
@@ -2046,13 +2336,13 @@ static void  NO_FILL_TRAN_ButtonHandler(BUTTON_EVENT event){
 
     switch(event){
     case BUTTON_EVENT_PEDAL_RELEASE:
-        RequestFlag = TRANFILL_QUIT_REQUEST;
+        Ctx->RequestFlag = TRANFILL_QUIT_REQUEST;
         break;
     case BUTTON_EVENT_PEDAL_MULTI_TAP:
-        RequestFlag = STOP_REQUEST;
-        PedalPressFlag = 0;
-        if (!TrippleTapEnable) {
-            MultiTapCounter = 0;
+        Ctx->RequestFlag = STOP_REQUEST;
+        Ctx->PedalPressFlag = 0;
+        if (!Ctx->TrippleTapEnable) {
+            Ctx->MultiTapCounter = 0;
         }
         break;
     default:
@@ -2065,18 +2355,18 @@ static void  NO_FILL_TRAN_QUITTING_ButtonHandler(BUTTON_EVENT event){
     switch (event) {
 
     case BUTTON_EVENT_PEDAL_RELEASE:
-        if(!WasLongPressed && MultiTapCounter == 0){
+        if(!Ctx->WasLongPressed && Ctx->MultiTapCounter == 0){
             //if the pedal was pressed during the last bar of AP the user wanted a drumfill
             PLAYING_MAIN_TRACK_ButtonHandler(event);
         }else{
-            RequestFlag = TRANFILL_CANCEL_REQUEST;
+            Ctx->RequestFlag = TRANFILL_CANCEL_REQUEST;
         }
         break;
     case BUTTON_EVENT_PEDAL_MULTI_TAP:
-        RequestFlag = STOP_REQUEST;
-        PedalPressFlag = 0;
-        if (!TrippleTapEnable) {
-            MultiTapCounter = 0;
+        Ctx->RequestFlag = STOP_REQUEST;
+        Ctx->PedalPressFlag = 0;
+        if (!Ctx->TrippleTapEnable) {
+            Ctx->MultiTapCounter = 0;
         }
         break;
     default:
@@ -2093,13 +2383,13 @@ static void  TRANFILL_WAITING_TRIG_ButtonHandler(BUTTON_EVENT event){
 
     switch (event){
     case BUTTON_EVENT_PEDAL_RELEASE:
-        RequestFlag = TRANFILL_QUIT_REQUEST;
+        Ctx->RequestFlag = TRANFILL_QUIT_REQUEST;
         break;
     case BUTTON_EVENT_PEDAL_MULTI_TAP:
-        RequestFlag = STOP_REQUEST;
-        PedalPressFlag = 0;
-        if (!TrippleTapEnable) {
-            MultiTapCounter = 0;
+        Ctx->RequestFlag = STOP_REQUEST;
+        Ctx->PedalPressFlag = 0;
+        if (!Ctx->TrippleTapEnable) {
+            Ctx->MultiTapCounter = 0;
         }
         break;
     default:
@@ -2111,13 +2401,13 @@ static void  TRANFILL_ACTIVE_ButtonHandler(BUTTON_EVENT event){
 
     switch (event) {
     case BUTTON_EVENT_PEDAL_RELEASE:
-        RequestFlag = TRANFILL_QUIT_REQUEST;
+        Ctx->RequestFlag = TRANFILL_QUIT_REQUEST;
         break;
     case BUTTON_EVENT_PEDAL_MULTI_TAP:
-        RequestFlag = STOP_REQUEST;
-        PedalPressFlag = 0;
-        if (!TrippleTapEnable) {
-            MultiTapCounter = 0;
+        Ctx->RequestFlag = STOP_REQUEST;
+        Ctx->PedalPressFlag = 0;
+        if (!Ctx->TrippleTapEnable) {
+            Ctx->MultiTapCounter = 0;
         }
         break;
     default:
@@ -2130,12 +2420,12 @@ static void  TRANFILL_QUITING_ButtonHandler(BUTTON_EVENT event){
     switch (event) {
     case BUTTON_EVENT_PEDAL_MULTI_TAP:
     case BUTTON_EVENT_PEDAL_RELEASE:
-        if(!WasLongPressed && MultiTapCounter == 0){
+        if(!Ctx->WasLongPressed && Ctx->MultiTapCounter == 0){
             //if the pedal was pressed during the last bar of AP the user wanted a drumfill
             PLAYING_MAIN_TRACK_ButtonHandler(event);
         }else{
-            RequestFlag = TRANFILL_CANCEL_REQUEST;
-            WasLongPressed = true;
+            Ctx->RequestFlag = TRANFILL_CANCEL_REQUEST;
+            Ctx->WasLongPressed = true;
         }
         break;
     default:
@@ -2150,14 +2440,14 @@ static void  TRANFILL_CANCEL_ButtonHandler(BUTTON_EVENT event){
 static void  DRUMFILL_WAITING_TRIG_ButtonHandler(BUTTON_EVENT event){
     switch (event) {
     case BUTTON_EVENT_PEDAL_LONG_PRESS:
-        NextPartNumber = 0; // Means no specefic next part
-        RequestFlag = TRANFILL_REQUEST;
+        Ctx->NextPartNumber = 0; // Means no specefic next part
+        Ctx->RequestFlag = TRANFILL_REQUEST;
         break;
     case BUTTON_EVENT_PEDAL_MULTI_TAP:
-        RequestFlag = STOP_REQUEST;
-        PedalPressFlag = 0;
-        if (!TrippleTapEnable) {
-            MultiTapCounter = 0;
+        Ctx->RequestFlag = STOP_REQUEST;
+        Ctx->PedalPressFlag = 0;
+        if (!Ctx->TrippleTapEnable) {
+            Ctx->MultiTapCounter = 0;
         }
         break;
     default:
@@ -2167,18 +2457,18 @@ static void  DRUMFILL_WAITING_TRIG_ButtonHandler(BUTTON_EVENT event){
 static void  DRUMFILL_ACTIVE_ButtonHandler(BUTTON_EVENT event){
     switch (event) {
     case BUTTON_EVENT_PEDAL_LONG_PRESS:
-        RequestFlag = TRANFILL_REQUEST;
+        Ctx->RequestFlag = TRANFILL_REQUEST;
         break;
     case BUTTON_EVENT_PEDAL_MULTI_TAP:
-        RequestFlag = STOP_REQUEST;
-        PedalPressFlag = 0;
-        if (!TrippleTapEnable) {
-            MultiTapCounter = 0;
+        Ctx->RequestFlag = STOP_REQUEST;
+        Ctx->PedalPressFlag = 0;
+        if (!Ctx->TrippleTapEnable) {
+            Ctx->MultiTapCounter = 0;
         }
         break;
     case BUTTON_EVENT_PEDAL_RELEASE:
-        RequestFlag = DRUMFILL_REQUEST;
-        PedalPresswDrumFillFlag = 1;
+        Ctx->RequestFlag = DRUMFILL_REQUEST;
+        Ctx->PedalPresswDrumFillFlag = 1;
         break;
     default:
         break;
@@ -2190,9 +2480,9 @@ static void  OUTRO_ButtonHandler(BUTTON_EVENT event){
 
     case BUTTON_EVENT_PEDAL_PRESS:
     case BUTTON_EVENT_PEDAL_MULTI_TAP:
-        RequestFlag = OUTRO_CANCEL_REQUEST;
-        PedalPressFlag = false;
-        WasLongPressed = true;
+        Ctx->RequestFlag = OUTRO_CANCEL_REQUEST;
+        Ctx->PedalPressFlag = false;
+        Ctx->WasLongPressed = true;
         break;
     default:
         break;
@@ -2203,11 +2493,11 @@ static void  OUTRO_WAITING_TRIG_ButtonHandler(BUTTON_EVENT event){
     case BUTTON_EVENT_PEDAL_PRESS:
     case BUTTON_EVENT_PEDAL_MULTI_TAP:
         // ingnore next release
-        PedalPressFlag = false;
-        WasLongPressed = true;
-        RequestFlag = OUTRO_CANCEL_REQUEST;
-        if (!TrippleTapEnable) {
-            MultiTapCounter = 0;
+        Ctx->PedalPressFlag = false;
+        Ctx->WasLongPressed = true;
+        Ctx->RequestFlag = OUTRO_CANCEL_REQUEST;
+        if (!Ctx->TrippleTapEnable) {
+            Ctx->MultiTapCounter = 0;
         }
         break;
     default:
@@ -2219,67 +2509,65 @@ static void  OUTRO_CANCELED_ButtonHandler(BUTTON_EVENT event){
     (void)event;
 }
 
-static unsigned long long LastMultiTapTime = 0;
-
 void SongPlayer_ButtonCallback(BUTTON_EVENT event, unsigned long long time)
 {
     uint8_t status = IntDisable();
 
     switch (event) {
     case BUTTON_EVENT_PEDAL_PRESS:
-        MultiTapCounter = 0;
-        WasPausedFlag = FALSE;
-        PedalPressFlag = TRUE;
-        WasLongPressed = FALSE;
+        Ctx->MultiTapCounter = 0;
+        Ctx->WasPausedFlag = FALSE;
+        Ctx->PedalPressFlag = TRUE;
+        Ctx->WasLongPressed = FALSE;
         break;
 
     case BUTTON_EVENT_PEDAL_RELEASE:
-        if (!PedalPressFlag) goto end_handler;
+        if (!Ctx->PedalPressFlag) goto end_handler;
         break;
 
     case BUTTON_EVENT_PEDAL_LONG_PRESS:
-        WasLongPressed = true;
-        if (!PedalPressFlag)  goto end_handler;
+        Ctx->WasLongPressed = true;
+        if (!Ctx->PedalPressFlag)  goto end_handler;
         break;
 
     case BUTTON_EVENT_PEDAL_MULTI_TAP:
 
-        if (MultiTapCounter){
-            if ((time - LastMultiTapTime) < 350) {
+        if (Ctx->MultiTapCounter){
+            if ((time - Ctx->LastMultiTapTime) < 350) {
 
                 // if tripple tap is enable
-                if (TrippleTapEnable){
+                if (Ctx->TrippleTapEnable){
                     StopSong();
                 }
             }
         } else {
-            if (WasLongPressed){
+            if (Ctx->WasLongPressed){
                 event = BUTTON_EVENT_PEDAL_PRESS;
-                MultiTapCounter = 0;
-                WasPausedFlag = false;
-                PedalPressFlag = true;
-                WasLongPressed = false;
+                Ctx->MultiTapCounter = 0;
+                Ctx->WasPausedFlag = false;
+                Ctx->PedalPressFlag = true;
+                Ctx->WasLongPressed = false;
             }
         }
 
-        LastMultiTapTime = time;
-        MultiTapCounter++;
+        Ctx->LastMultiTapTime = time;
+        Ctx->MultiTapCounter++;
         break;
 
     case BUTTON_EVENT_FOOT_SECONDARY_PRESS:
 
-        if (PlayerStatus != NO_SONG_LOADED) {
-            if (PlayerStatus != STOPPED) {
-                if (SecondaryFootSwitchPlayingAction == ACTION_PAUSE_UNPAUSE) {
-                    PedalPressFlag = 0;
+        if (Ctx->PlayerStatus != NO_SONG_LOADED) {
+            if (Ctx->PlayerStatus != STOPPED) {
+                if (Ctx->SecondaryFootSwitchPlayingAction == ACTION_PAUSE_UNPAUSE) {
+                    Ctx->PedalPressFlag = 0;
                     PauseUnpauseHandler();
-                } else if (SecondaryFootSwitchPlayingAction == ACTION_SPECIAL_EFFECT) {
+                } else if (Ctx->SecondaryFootSwitchPlayingAction == ACTION_SPECIAL_EFFECT) {
                     SoundManager_playSpecialEffect(100, FALSE);
-                } else if (SecondaryFootSwitchPlayingAction == ACTION_OUTRO) {
+                } else if (Ctx->SecondaryFootSwitchPlayingAction == ACTION_OUTRO) {
                     event = BUTTON_EVENT_PEDAL_MULTI_TAP;
                 }
             } else {
-                if (SecondaryFootSwitchStoppedAction == ACTION_SPECIAL_EFFECT) {
+                if (Ctx->SecondaryFootSwitchStoppedAction == ACTION_SPECIAL_EFFECT) {
                     SoundManager_playSpecialEffect(100, FALSE);
                 }
             }
@@ -2288,18 +2576,18 @@ void SongPlayer_ButtonCallback(BUTTON_EVENT event, unsigned long long time)
 
     case BUTTON_EVENT_FOOT_PRIMARY_PRESS:
 
-        if (PlayerStatus != NO_SONG_LOADED) {
-            if (PlayerStatus != STOPPED) {
-                if (PrimaryFootSwitchPlayingAction == ACTION_PAUSE_UNPAUSE) {
-                    PedalPressFlag = 0;
+        if (Ctx->PlayerStatus != NO_SONG_LOADED) {
+            if (Ctx->PlayerStatus != STOPPED) {
+                if (Ctx->PrimaryFootSwitchPlayingAction == ACTION_PAUSE_UNPAUSE) {
+                    Ctx->PedalPressFlag = 0;
                     PauseUnpauseHandler();
-                } else if (PrimaryFootSwitchPlayingAction == ACTION_SPECIAL_EFFECT) {
+                } else if (Ctx->PrimaryFootSwitchPlayingAction == ACTION_SPECIAL_EFFECT) {
                     SoundManager_playSpecialEffect(100, FALSE);
-                } else if (PrimaryFootSwitchPlayingAction == ACTION_OUTRO) {
+                } else if (Ctx->PrimaryFootSwitchPlayingAction == ACTION_OUTRO) {
                     event = BUTTON_EVENT_PEDAL_MULTI_TAP;
                 }
             } else {
-                if (PrimaryFootSwitchStoppedAction == ACTION_SPECIAL_EFFECT) {
+                if (Ctx->PrimaryFootSwitchStoppedAction == ACTION_SPECIAL_EFFECT) {
                     SoundManager_playSpecialEffect(100, FALSE);
                 }
             }
@@ -2309,11 +2597,11 @@ void SongPlayer_ButtonCallback(BUTTON_EVENT event, unsigned long long time)
         break;
     }
 
-    if (MultiTapCounter > 1) {
+    if (Ctx->MultiTapCounter > 1) {
         goto end_handler;
     }
 
-    switch(PlayerStatus) {
+    switch(Ctx->PlayerStatus) {
     case NO_SONG_LOADED:            { NO_SONG_LOADED_ButtonHandler(event);              break;}
     case STOPPED:                   { STOPPED_ButtonHandler(event);                     break;}
     case PAUSED:                    { PAUSED_ButtonHandler(event);                      break;}
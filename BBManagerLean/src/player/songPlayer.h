@@ -15,6 +15,10 @@
 #define INTR_FILL_ID            (4)
 #define OUTR_FILL_ID            (5)
 
+// Units: the notes are posted to the mixer in frames at 44.1 kHz, the tracks are in ticks
+#define SONGPLAYER_FRAMES_PER_MINUTE    (44100 * 60)
+#define SONGPLAYER_TICKS_PER_BEAT       (480)
+
 PACK typedef struct {
   unsigned char num;
   unsigned char den;
@@ -52,15 +56,27 @@ typedef enum{
     N_PLAYER_STATUS                     =   19,
 }SongPlayer_PlayerStatus;
 
+// State of a song player instance, see SongPlayer_setContext()
+typedef struct SongPlayer_context_s SongPlayer_context_t;
+
+// Tracks of a song read and adjusted ahead of its load, see SongPlayer_prepareSong()
+typedef struct SongPlayer_preparedSong_s SongPlayer_preparedSong_t;
 
 
 /*****************************************************************************
 **                     FUNCTION PROTOYPE
 *****************************************************************************/
 void SongPlayer_init(void); // <--
+SongPlayer_context_t *SongPlayer_createContext(void);
+void SongPlayer_destroyContext(SongPlayer_context_t *context);
+SongPlayer_context_t *SongPlayer_setContext(SongPlayer_context_t *context);
+SongPlayer_context_t *SongPlayer_getContext(void);
 void SongPlayer_deInit(void);
 void SongPlayer_reInit(void);
-int SongPlayer_loadSong(char* file, uint32_t length);
+int SongPlayer_loadSong(const char* file, uint32_t length);
+SongPlayer_preparedSong_t *SongPlayer_prepareSong(const char* file, uint32_t length, unsigned int bpm);
+void SongPlayer_destroyPreparedSong(SongPlayer_preparedSong_t *prepared);
+int SongPlayer_loadPreparedSong(const char* file, uint32_t length, SongPlayer_preparedSong_t *prepared);
 void SongPlayer_forceStop(void);   // <--
 void SongPlayer_processSong(float ratio, int nEvent); // <--
 void SongPlayer_ProcessSingleTrack(float ratio, int nTick, int offset);
@@ -71,6 +87,8 @@ void SongPlayer_externalStart(void);
 void SongPlayer_externalStop(void);
 int SongPlayer_getBeatInbar(int32_t *startBeat);
 int SongPlayer_getMasterTick(void);
+int64_t SongPlayer_ticksToFrames(int64_t ticks, unsigned int bpm);
+void SongPlayer_setTimelineTempo(unsigned int bpm);
 
 int SongPlayer_getTimeSignature(TimeSignature * timeSignature);
 int SongPlayer_getbarLength();
@@ -0,0 +1,196 @@
+/*
+  	This software and the content provided for use with it is Copyright © 2014-2020 Singular Sound 
+ 	BeatBuddy Manager is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License version 2 as published by
+    the Free Software Foundation.
+    
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+    
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#include <QRunnable>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <string.h>
+
+#include "songPreparer.h"
+#include "realTime.h"
+#include "../model/filegraph/songfile.h"
+
+static qint64 lockRegion(const char *data, qint64 size, QVector<QPair<const char *, qint64> > &locked)
+{
+    if (size <= 0 || !RealTime::lockMemory(data, size)) {
+        return 0;
+    }
+    locked.append(qMakePair(data, size));
+    return size;
+}
+
+/**
+ * @brief PreparedSong::lockMemory
+ *        Keep the data read by the audio thread in memory, each region that does not fit in
+ *        RLIMIT_MEMLOCK is left pageable
+ * @return Number of bytes locked
+ */
+qint64 PreparedSong::lockMemory(void)
+{
+    qint64 lockedSize = 0;
+
+    if (drumset) {
+        lockedSize += lockRegion(drumset->data(), drumset->size(), lockedDrumset);
+        for (const QByteArray &layer : drumset->resampled()) {
+            lockedSize += lockRegion(layer.constData(), layer.size(), lockedDrumset);
+        }
+    }
+    lockedSize += lockRegion(song.constData(), song.size(), lockedData);
+    for (int i = 0; i < MAX_SONG_PARTS; i++) {
+        lockedSize += lockRegion(effects[i].constData(), effects[i].size(), lockedData);
+    }
+    return lockedSize;
+}
+
+/**
+ * @brief PreparedSong::unlockMemory
+ *        Release the regions locked by lockMemory(), before the data is freed
+ */
+void PreparedSong::unlockMemory(void)
+{
+    for (const auto &region : lockedData) {
+        RealTime::unlockMemory(region.first, region.second);
+    }
+    for (const auto &region : lockedDrumset) {
+        RealTime::unlockMemory(region.first, region.second);
+    }
+    lockedData.clear();
+    lockedDrumset.clear();
+}
+
+class SongPreparer::Task : public QRunnable
+{
+public:
+    Task(SongPreparer *p_preparer, const PreparedSong &request, const QString &drumsetPath, const QString &effectsPath, bool lockMemory, int generation)
+        : mp_preparer(p_preparer), m_request(request), m_drumsetPath(drumsetPath), m_effectsPath(effectsPath), m_lockMemory(lockMemory), m_generation(generation) {}
+    void run() { mp_preparer->run(m_request, m_drumsetPath, m_effectsPath, m_lockMemory, m_generation); }
+
+private:
+    SongPreparer *mp_preparer;
+    PreparedSong m_request;
+    QString m_drumsetPath;
+    QString m_effectsPath;
+    bool m_lockMemory;
+    int m_generation;
+};
+
+SongPreparer::SongPreparer(QObject *parent)
+    : QObject(parent)
+{
+    qRegisterMetaType<PreparedSong>();
+    // One at a time, a new preparation only starts once the previous one noticed it is outdated
+    m_pool.setMaxThreadCount(1);
+}
+
+SongPreparer::~SongPreparer()
+{
+    cancel();
+}
+
+/**
+ * @brief SongPreparer::prepare
+ * @param drumsetPath Drumset of the song, empty to keep the one playing
+ * @param tempo Tempo the song starts at
+ * @param lockMemory Lock the data in memory for the real-time audio thread
+ */
+void SongPreparer::prepare(const QString &songPath, const QString &drumsetPath, const QString &effectsPath, int tempo, bool lockMemory)
+{
+    PreparedSong request;
+    request.songPath = songPath;
+    request.tempo = tempo;
+
+    int generation = m_generation.fetchAndAddOrdered(1) + 1;
+    m_pool.start(new Task(this, request, drumsetPath, effectsPath, lockMemory, generation));
+}
+
+/**
+ * @brief SongPreparer::cancel
+ *        Stop the preparation and wait for the worker, the files may still have been added to EngineCache
+ */
+void SongPreparer::cancel(void)
+{
+    m_generation.fetchAndAddOrdered(1);
+    m_pool.waitForDone();
+}
+
+void SongPreparer::run(const PreparedSong &request, const QString &drumsetPath, const QString &effectsPath, bool lockMemory, int generation)
+{
+    QElapsedTimer timer;
+    PreparedSong song = request;
+
+    if (m_generation.loadAcquire() != generation) {
+        return;
+    }
+    timer.start();
+
+    // Same checks as SongPlayer_loadSong, the audio thread must not find out the song is unusable
+    if (!EngineCache::instance()->file(song.songPath, song.song)
+        || song.song.size() < (int)sizeof(SONGFILE_FileStruct)) {
+        qWarning() << "SongPreparer::run - unable to load" << song.songPath;
+        emit sigFailed(song.songPath);
+        return;
+    }
+    const SONGFILE_FileStruct *file = (const SONGFILE_FileStruct *)song.song.constData();
+    if (strncmp(file->header.fileType, "BBSF", 4) || (file->header.flags & SONGFILE_FLAG_SONG_FILE_INVALID_MASK)) {
+        qWarning() << "SongPreparer::run - invalid song" << song.songPath;
+        emit sigFailed(song.songPath);
+        return;
+    }
+
+    // Tracks read, sorted and compiled here, the audio thread only takes them
+    song.tracks = QSharedPointer<SongPlayer_preparedSong_t>(
+                SongPlayer_prepareSong(song.song.constData(), song.song.size(), song.tempo),
+                SongPlayer_destroyPreparedSong);
+    if (!song.tracks) {
+        qWarning() << "SongPreparer::run - invalid tracks in" << song.songPath;
+        emit sigFailed(song.songPath);
+        return;
+    }
+
+    for (uint i = 0; i < MAX_SONG_PARTS && i < file->song.nPart; i++) {
+        QString name = QString::fromLatin1((const char *)file->song.part[i].effectName,
+                                           (int)strnlen((const char *)file->song.part[i].effectName, MAX_EFFECT_NAME));
+        if (!name.isEmpty() && !EngineCache::instance()->effect(effectsPath + "/" + name, song.effects[i])) {
+            qWarning() << "SongPreparer::run - unable to find effect" << name << "of" << song.songPath;
+            emit sigFailed(song.songPath);
+            return;
+        }
+    }
+
+    if (m_generation.loadAcquire() != generation) {
+        return;
+    }
+
+    // Mapping, validation, instruments table and resampling, the longest part
+    if (!drumsetPath.isEmpty()) {
+        song.drumset = EngineCache::instance()->drumset(drumsetPath);
+        if (!song.drumset) {
+            qWarning() << "SongPreparer::run - unable to load" << drumsetPath;
+            emit sigFailed(song.songPath);
+            return;
+        }
+    }
+
+    if (m_generation.loadAcquire() != generation) {
+        qDebug() << "SongPreparer::run -" << song.songPath << "preparation stopped by a newer one";
+        return;
+    }
+
+    // Faulted in now rather than by the audio thread at the switch
+    if (lockMemory) {
+        song.lockMemory();
+    }
+    qDebug() << "SongPreparer::run -" << song.songPath << "ready in" << timer.elapsed() << "ms";
+    emit sigPrepared(song);
+}
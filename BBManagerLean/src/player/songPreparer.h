@@ -0,0 +1,76 @@
+#ifndef SONGPREPARER_H
+#define SONGPREPARER_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QMetaType>
+#include <QPair>
+#include <QSharedPointer>
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+
+#include "../model/filegraph/song.h"
+#include "engineCache.h"
+#include "songPlayer.h"
+
+/**
+ * @brief The PreparedSong struct
+ *
+ * Everything the audio thread needs to switch to a song without reading a file or parsing
+ * anything: the song and its tracks, its effects and its drumset, loaded through EngineCache.
+ * Shared data, cheap to copy.
+ */
+struct PreparedSong {
+    QString songPath;
+    int tempo;
+    QByteArray song;
+    QSharedPointer<SongPlayer_preparedSong_t> tracks;      // For SongPlayer_loadPreparedSong()
+    QSharedPointer<const EngineCache::Drumset> drumset;    // Null to keep the one playing
+    QByteArray effects[MAX_SONG_PARTS];
+
+    // Regions locked by lockMemory(), the drumset apart since a switch may keep the one playing.
+    // Only the last owner of the data unlocks them, the other copies leave them.
+    QVector<QPair<const char *, qint64> > lockedData;
+    QVector<QPair<const char *, qint64> > lockedDrumset;
+
+    PreparedSong() : tempo(0) {}
+    inline bool isValid(void) const { return !song.isEmpty() && tracks; }
+    qint64 lockMemory(void);
+    void unlockMemory(void);
+};
+
+Q_DECLARE_METATYPE(PreparedSong)
+
+/**
+ * @brief The SongPreparer class
+ *
+ * Loads the next song of a setlist on a worker thread while the current one plays, so that
+ * the player switches to it without waiting for the disk.
+ * A new preparation stops the previous one, the result is signaled queued.
+ */
+class SongPreparer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SongPreparer(QObject *parent = nullptr);
+    ~SongPreparer();
+
+    void prepare(const QString &songPath, const QString &drumsetPath, const QString &effectsPath, int tempo, bool lockMemory);
+    void cancel(void);
+
+signals:
+    void sigPrepared(const PreparedSong &song);
+    void sigFailed(const QString &songPath);
+
+private:
+    class Task;
+    void run(const PreparedSong &request, const QString &drumsetPath, const QString &effectsPath, bool lockMemory, int generation);
+
+    QThreadPool m_pool;
+    QAtomicInt m_generation;
+};
+
+#endif // SONGPREPARER_H
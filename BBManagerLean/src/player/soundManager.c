@@ -16,6 +16,7 @@
 #include "mixer.h"
 #include "math.h"
 #include "pragmapack.h"
+#include "threadLocal.h"
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
@@ -55,6 +56,9 @@ extern "C" {
 #define SAMPLING_RATE				(44100)
 #define NEXT_NOTE_SEEK_NUMBER       (128)
 
+#define MIDI_VELOCITY_COUNT         (128)
+#define RANDOM_SEED                 (0x9E3779B9u)               // Any value but 0
+
 
 
 #define MEMORY_SIZE                 (101 * 1024 * 1024)
@@ -67,7 +71,8 @@ extern "C" {
  *****************************************************************************/
 static const unsigned int Divider[3] = { 4, 8, 16 };
 static const unsigned long gLinearGainFactor = 10000;
-static unsigned int gGain[128][128];
+static unsigned int gGain[128][128];   // Shared by all the instances, filled once
+static int gGainReady = 0;
 
 unsigned long long gStartTime;
 unsigned long long gStopTime;
@@ -92,19 +97,37 @@ PACK typedef struct {
     unsigned char* addr;
 } PACKED Effect_t;
 
+// Layers a velocity plays, see compileInstrument()
 typedef struct {
-    Instrument_t *inst;
-    MALLOC_RESULT_t status[MIDIPARSER_NUMBER_OF_INSTRUMENTS];
-    unsigned char ChokeChan[MIDIPARSER_NUMBER_OF_CHOKE];
-} DrumsetStruct_t;
+    unsigned char first;    // First layer of the velocity group
+    unsigned char count;    // Layers of the group, one is picked at random
+    unsigned int volume;    // Gain of the velocity in its group times the volume of the instrument
+} VelocityEntry_t;
 
+typedef struct {
+    VelocityEntry_t velocity[MIDI_VELOCITY_COUNT];
+    const MIXER_format_t *format[MIDIPARSER_MAX_NUMBER_VELOCITY];  // Of each layer
+} InstrumentTable_t;
 
+// Drumset ready to be played, only read once parsed so it can be shared by several instances
+struct SoundManager_drumset_s {
+    MALLOC_RESULT_t status[MIDIPARSER_NUMBER_OF_INSTRUMENTS];
+    Instrument_t inst[MIDIPARSER_NUMBER_OF_INSTRUMENTS];        // Copy of the table of the file
 #if (defined(__x86_64__) || defined(_M_X64))
-// Need to keep address in a separate structure since it takes 8 bytes
-typedef struct {
-    Instrument64_t inst[MIDIPARSER_NUMBER_OF_INSTRUMENTS];
-} DrumsetStruct64_t;
+    // Need to keep address in a separate structure since it takes 8 bytes
+    Instrument64_t inst64[MIDIPARSER_NUMBER_OF_INSTRUMENTS];
 #endif
+    InstrumentTable_t table[MIDIPARSER_NUMBER_OF_INSTRUMENTS];  // Compiled when parsed
+};
+
+// State of a sound manager instance, see SoundManager_setContext()
+struct SoundManager_context_s {
+    const SoundManager_drumset_t *Drumset;                      // NULL when no drumset is loaded
+    SoundManager_drumset_t OwnDrumset;                          // Used by SoundManager_LoadDrumset()
+    unsigned char ChokeChan[MIDIPARSER_NUMBER_OF_CHOKE];
+    Effect_t EffectTable[32];
+    uint32_t Random;                                            // State of nextRandom()
+};
 
 PACK typedef struct HeaderStruct {
     char     fileType[4];
@@ -113,7 +136,6 @@ PACK typedef struct HeaderStruct {
     uint16_t build;
     uint32_t fileCRC;
 } PACKED DRUMSETFILE_HeaderStruct;
-Effect_t EffectTable[32];
 
 
 PACK typedef struct chunk {
@@ -137,11 +159,10 @@ PACK typedef struct header {
 /*****************************************************************************
  **                     INTERNAL GLOBAL VARIABLE
  *****************************************************************************/
-/* Drumset Variable */
-static DrumsetStruct_t Drumset;
-#    if (defined(__x86_64__) || defined(_M_X64))
-static DrumsetStruct64_t Drumset64;
-#    endif
+static SoundManager_context_t DefaultContext;
+
+// Context of the calling thread
+static THREAD_LOCAL SoundManager_context_t *Ctx = &DefaultContext;
 
 /*****************************************************************************
  **                     INTERNAL FUNCTION PROTOTYPE
@@ -157,6 +178,9 @@ static void fillGainTable(){
     float req_db;
     float dif_db;
     int i,j;
+
+    if (gGainReady) return;
+
     // i = top velocity of the group
     // j = requested veolicity IN the group ( <= )
     for (i = 1; i < 128 ; i++){
@@ -171,28 +195,91 @@ static void fillGainTable(){
             gGain[i][j] = (unsigned int)(10000.0f * powf(10.0f,dif_db / 20.0f));
         }
     }
+    gGainReady = 1;
 }
 
 void SoundManager_init(void){
+    SoundManager_context_t *ctx = Ctx;
     unsigned int i;
 
     // Invalidate all the drumset channels
-    for (i = 0; i < MIDIPARSER_NUMBER_OF_INSTRUMENTS; i++){
-        Drumset.status[i] = FREE;
-    }
+    ctx->Drumset = NULL;
     // Reset all the choke channel
     for (i = 0; i < MIDIPARSER_NUMBER_OF_CHOKE; i++){
-        Drumset.ChokeChan[i] = 0u;
+        ctx->ChokeChan[i] = 0u;
     }
 
     for (i = 0; i < 32 ; i++){
-        EffectTable[i].status = FREE;
+        ctx->EffectTable[i].status = FREE;
     }
 
+    // Same variations at every start, renders are reproducible
+    ctx->Random = RANDOM_SEED;
+
     fillGainTable();
 }
 
-void SoundManager_LoadEffect(char* file, uint32_t part){
+/**
+ *  \brief Xorshift generator of the context, picks the layers of a velocity group
+ *
+ *  \return a random number in [0, range)
+ **/
+static inline unsigned int nextRandom(SoundManager_context_t *ctx, unsigned int range){
+    uint32_t x = ctx->Random;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    ctx->Random = x;
+    return (unsigned int)(((uint64_t)x * range) >> 32);
+}
+
+/**
+ *  \brief Create an instance of the sound manager, initialized like SoundManager_init()
+ *
+ *  \return the new context, NULL if there is not enough memory
+ */
+SoundManager_context_t *SoundManager_createContext(void){
+    SoundManager_context_t *context = (SoundManager_context_t *)calloc(1, sizeof(SoundManager_context_t));
+    SoundManager_context_t *previous;
+
+    if (context == NULL) return NULL;
+
+    previous = SoundManager_setContext(context);
+    SoundManager_init();
+    SoundManager_setContext(previous);
+
+    return context;
+}
+
+/**
+ *  \brief Free a context created by SoundManager_createContext().
+ *         It must not be the context of another thread.
+ */
+void SoundManager_destroyContext(SoundManager_context_t *context){
+    if (context == NULL || context == &DefaultContext) return;
+    if (Ctx == context) Ctx = &DefaultContext;
+    free(context);
+}
+
+/**
+ *  \brief Select the instance the sound manager functions work on in the calling thread
+ *
+ *  \param context to use, NULL for the default context shared by the threads that never select one
+ *
+ *  \return the previous context of the thread
+ */
+SoundManager_context_t *SoundManager_setContext(SoundManager_context_t *context){
+    SoundManager_context_t *previous = Ctx;
+    Ctx = (context != NULL) ? context : &DefaultContext;
+    return previous;
+}
+
+SoundManager_context_t *SoundManager_getContext(void){
+    return Ctx;
+}
+
+void SoundManager_LoadEffect(const char* file, uint32_t part){
+    SoundManager_context_t *ctx = Ctx;
     WavHeader_t *wavHeader;
 #if !(defined(__x86_64__) || defined(_M_X64))
     uint32_t dataOffset;
@@ -202,7 +289,7 @@ void SoundManager_LoadEffect(char* file, uint32_t part){
     Chunk_t *chunkPtr;
 
     if (file == NULL) {
-        EffectTable[part].status = FREE;
+        ctx->EffectTable[part].status = FREE;
         return;
     }
 
@@ -240,141 +327,242 @@ void SoundManager_LoadEffect(char* file, uint32_t part){
 
     // If there is wav data to read
     if (chunkPtr->size > 0){
-        EffectTable[part].addr = (unsigned char *) dataOffset;
+        ctx->EffectTable[part].addr = (unsigned char *) dataOffset;
 
         // Bit rate check
         if (wavHeader->bits_per_sample == 16){
-            EffectTable[part].nSample = chunkPtr->size / 2;
-            EffectTable[part].bps = wavHeader->bits_per_sample;
+            ctx->EffectTable[part].nSample = chunkPtr->size / 2;
+            ctx->EffectTable[part].bps = wavHeader->bits_per_sample;
         } else if (wavHeader->bits_per_sample == 24){
-            EffectTable[part].nSample = chunkPtr->size / 3;
-            EffectTable[part].bps = wavHeader->bits_per_sample;
+            ctx->EffectTable[part].nSample = chunkPtr->size / 3;
+            ctx->EffectTable[part].bps = wavHeader->bits_per_sample;
         } else {
             return;
         }
 
         if (wavHeader->num_channels == 1) {
-            EffectTable[part].nChannel = 1;
+            ctx->EffectTable[part].nChannel = 1;
         } else if (wavHeader->num_channels == 2) {
-            EffectTable[part].nChannel = 2;
+            ctx->EffectTable[part].nChannel = 2;
         } else {
             return;
         }
 
-        EffectTable[part].status = ACTIVE;
+        ctx->EffectTable[part].status = ACTIVE;
     }
 }
 
 
-void SoundManager_LoadDrumset(char* file, uint32_t size)
+/**
+ *  \brief Compile the velocity table of an instrument: for each velocity, its group of layers
+ *         and its gain, so that playing a note is a lookup. The layers are sorted by velocity,
+ *         a group is the layers with the highest lower bound not above the velocity.
+ **/
+static void compileInstrument(SoundManager_drumset_t *drumset, unsigned int note)
 {
-    unsigned int i, j;
+    const Instrument_t *inst = &drumset->inst[note];
+    InstrumentTable_t *table = &drumset->table[note];
+    int nVel = (int)inst->nVel;
+    int high, low;
+    unsigned int v, j;
+
+    for (j = 0; j < inst->nVel; j++){
+        table->format[j] = mixer_getFormat(inst->vel[j].bps, (inst->vel[j].nChannel == 2) ? 2 : 1);
+    }
 
-    (void)size; // remove warning
+    for (v = 0; v < MIDI_VELOCITY_COUNT; v++){
+        // Last layer whose lower bound is not above the velocity
+        high = nVel - 1;
+        while (high > 0 && inst->vel[high].vel > v) {
+            high--;
+        }
+
+        if (high < nVel - 1){
+            table->velocity[v].volume = gGain[inst->vel[high + 1].vel - 1][v] * inst->volume;
+        } else {
+            table->velocity[v].volume = gGain[127][v] * inst->volume;
+        }
+
+        // Every layer with the same lower bound
+        low = high;
+        while (low >= 0 && inst->vel[low].vel == inst->vel[high].vel) {
+            low--;
+        }
+        table->velocity[v].first = (unsigned char)(low + 1);
+        table->velocity[v].count = (unsigned char)(high - low);
+    }
+}
+
+/**
+ *  \brief Fill a drumset from the content of a .drm file. The file is only read, the instruments table
+ *         is copied and the samples are played from the file, so it can be a read-only mapping.
+ *         The file must stay valid as long as the drumset is used.
+ *
+ *  \return RETURN_FAILURE if the file is too short to hold the instruments table
+ */
+static int parseDrumset(SoundManager_drumset_t *drumset, const char* file, uint32_t size)
+{
+    unsigned int i, j;
 
-    // TODO make sure old sound stop playing
     for (i = 0; i < MIDIPARSER_NUMBER_OF_INSTRUMENTS; i++){
-        Drumset.status[i] = FREE;
+        drumset->status[i] = FREE;
     }
 
-    // Set the address of the instruments array
-    Drumset.inst = (Instrument_t*)(file + sizeof(DRUMSETFILE_HeaderStruct));
+    if (file == NULL || size < sizeof(DRUMSETFILE_HeaderStruct) + sizeof(drumset->inst)) return RETURN_FAILURE;
 
+    // Copy the instruments array
+    memcpy(drumset->inst, file + sizeof(DRUMSETFILE_HeaderStruct), sizeof(drumset->inst));
 
+    fillGainTable();
 
     // Complete for all the instruments
     for (i = 0; i < MIDIPARSER_NUMBER_OF_INSTRUMENTS; i++){
-        if (Drumset.inst[i].nVel){
-            if (Drumset.inst[i].volume == 0)Drumset.inst[i].volume = 100;
-            if (Drumset.inst[i].volume > 100) Drumset.inst[i].volume = 100;
+        if (drumset->inst[i].nVel){
+            if (drumset->inst[i].nVel > MIDIPARSER_MAX_NUMBER_VELOCITY) drumset->inst[i].nVel = MIDIPARSER_MAX_NUMBER_VELOCITY;
+            if (drumset->inst[i].volume == 0) drumset->inst[i].volume = 100;
+            if (drumset->inst[i].volume > 100) drumset->inst[i].volume = 100;
+            if (drumset->inst[i].fillChokeDelay > 2) drumset->inst[i].fillChokeDelay = 2;
 
-            for (j=0; j < Drumset.inst[i].nVel; j++){
+            for (j=0; j < drumset->inst[i].nVel; j++){
 #if !(defined(__x86_64__) || defined(_M_X64))
-                Drumset.inst[i].vel[j].addr += (unsigned int)file;
+                drumset->inst[i].vel[j].addr += (unsigned int)file;
 #else
-                // Need to keep address in a separate structure since it takes 8 bytes
-                Drumset64.inst[i].vel[j].addr = (uint64_t)file + Drumset.inst[i].vel[j].offset;
+                drumset->inst64[i].vel[j].addr = (uint64_t)file + drumset->inst[i].vel[j].offset;
 #endif
             }
-            Drumset.status[i] = ACTIVE;
+            compileInstrument(drumset, i);
+            drumset->status[i] = ACTIVE;
         }
     }
+    return RETURN_SUCCESS;
 }
 
+/**
+ *  \brief Load a drumset file in the context, see parseDrumset()
+ *
+ *  \param file content of the .drm file
+ *  \param size of the file in bytes
+ */
+void SoundManager_LoadDrumset(const char* file, uint32_t size)
+{
+    SoundManager_context_t *ctx = Ctx;
 
-void SoundManager_playSpecialEffect(unsigned char vel, uint32_t part){
-    unsigned int volume = vel * gLinearGainFactor;
-    if (part >= 32) return;
+    // TODO make sure old sound stop playing
+    parseDrumset(&ctx->OwnDrumset, file, size);
+    ctx->Drumset = &ctx->OwnDrumset;
+}
 
-    if (EffectTable[part].status == ACTIVE){
-        switch (EffectTable[part].bps){
-        case 16:
-            if (EffectTable[part].nChannel == 2){
-#if !(defined(__x86_64__) || defined(_M_X64))
-                mixer_addPCM16Stereo((unsigned int)EffectTable[part].addr,
-#else
-                mixer_addPCM16Stereo((uint64_t)EffectTable[part].addr,
-#endif
-                        EffectTable[part].nSample,
-                        volume,
-                        0,
-                        0,
-                        128,
-                        0,
-                        0,
-                        0);
-            } else if (EffectTable[part].nChannel == 1){
+/**
+ *  \brief Parse a drumset once, to be played by several contexts with SoundManager_setDrumset()
+ *
+ *  \param file content of the .drm file, must stay valid until SoundManager_freeDrumset()
+ *  \param size of the file in bytes
+ *
+ *  \return NULL if the file is invalid or there is not enough memory
+ */
+SoundManager_drumset_t *SoundManager_parseDrumset(const char* file, uint32_t size)
+{
+    SoundManager_drumset_t *drumset = (SoundManager_drumset_t *)malloc(sizeof(SoundManager_drumset_t));
+
+    if (drumset == NULL) return NULL;
+    if (parseDrumset(drumset, file, size) != RETURN_SUCCESS){
+        free(drumset);
+        return NULL;
+    }
+    return drumset;
+}
+
+void SoundManager_freeDrumset(SoundManager_drumset_t *drumset){
+    free(drumset);
+}
+
+/**
+ *  \brief Play a drumset parsed by SoundManager_parseDrumset() in the context of the calling thread.
+ *         It is only read, it must not be freed while it is used.
+ *         The voices already started keep reading the samples of the previous drumset: the caller
+ *         keeps it alive until they have ended.
+ */
+void SoundManager_setDrumset(const SoundManager_drumset_t *drumset){
+    SoundManager_context_t *ctx = Ctx;
+
+    ctx->Drumset = drumset;
+}
+
+
+/**
+ *  \brief Number of velocity layers of an instrument, 0 if the note has no sound
+ **/
+unsigned int SoundManager_getLayerCount(const SoundManager_drumset_t *drumset, unsigned char note){
+    if (note >= MIDIPARSER_NUMBER_OF_INSTRUMENTS || drumset->status[note] == FREE) return 0;
+    return drumset->inst[note].nVel;
+}
+
+/**
+ *  \brief Read a velocity layer of an instrument
+ *
+ *  \return RETURN_FAILURE if the note has no sound or no such layer
+ **/
+int SoundManager_getSample(const SoundManager_drumset_t *drumset, unsigned char note, unsigned int layer, SoundManager_sample_t *sample){
+    const Vel_t *vel;
+
+    if (layer >= SoundManager_getLayerCount(drumset, note)) return RETURN_FAILURE;
+
+    vel = &drumset->inst[note].vel[layer];
 #if !(defined(__x86_64__) || defined(_M_X64))
-                mixer_addPCM16Mono((unsigned int)EffectTable[part].addr,
+    sample->data = (const unsigned char *)vel->addr;
 #else
-                mixer_addPCM16Mono((uint64_t)EffectTable[part].addr,
+    sample->data = (const unsigned char *)drumset->inst64[note].vel[layer].addr;
 #endif
+    sample->nSample = vel->nSample;
+    sample->bps = vel->bps;
+    sample->nChannel = vel->nChannel;
+    sample->fs = vel->fs;
+    return RETURN_SUCCESS;
+}
 
-                        EffectTable[part].nSample,
-                        volume,
-                        0,
-                        0,
-                        128,
-                        0,
-                        0,
-                        0);
-            }
-            break;
+/**
+ *  \brief Replace the PCM data of a velocity layer, the velocity range is kept.
+ *         Only before the drumset is played, the data must stay valid as long as the drumset.
+ **/
+void SoundManager_setSample(SoundManager_drumset_t *drumset, unsigned char note, unsigned int layer, const SoundManager_sample_t *sample){
+    Vel_t *vel;
+
+    if (layer >= SoundManager_getLayerCount(drumset, note)) return;
 
-        case 24:
-            if (EffectTable[part].nChannel == 2){
+    vel = &drumset->inst[note].vel[layer];
 #if !(defined(__x86_64__) || defined(_M_X64))
-                mixer_addPCM24Stereo((unsigned int)EffectTable[part].addr,
+    vel->addr = (unsigned int)sample->data;
 #else
-                mixer_addPCM24Stereo((uint64_t)EffectTable[part].addr,
+    drumset->inst64[note].vel[layer].addr = (uint64_t)sample->data;
 #endif
-                        EffectTable[part].nSample,
-                        volume,
-                        0,
-                        0,
-                        128,
-                        0,
-                        0,
-                        0);
-            } else if (EffectTable[part].nChannel == 1){
+    vel->nSample = sample->nSample;
+    vel->bps = sample->bps;
+    vel->nChannel = sample->nChannel;
+    vel->fs = sample->fs;
+    drumset->table[note].format[layer] = mixer_getFormat(vel->bps, (vel->nChannel == 2) ? 2 : 1);
+}
+
+
+void SoundManager_playSpecialEffect(unsigned char vel, uint32_t part){
+    SoundManager_context_t *ctx = Ctx;
+    unsigned int volume = vel * gLinearGainFactor;
+    if (part >= 32) return;
+
+    if (ctx->EffectTable[part].status == ACTIVE){
+        mixer_addVoice(mixer_getFormat(ctx->EffectTable[part].bps, ctx->EffectTable[part].nChannel),
 #if !(defined(__x86_64__) || defined(_M_X64))
-                mixer_addPCM24Mono((unsigned int)EffectTable[part].addr,
+                (unsigned int)ctx->EffectTable[part].addr,
 #else
-                mixer_addPCM24Mono((uint64_t)EffectTable[part].addr,
+                (uint64_t)ctx->EffectTable[part].addr,
 #endif
-                        EffectTable[part].nSample,
-                        volume,
-                        0,
-                        0,
-                        128,
-                        0,
-                        0,
-                        0);
-            }
-            break;
-        default :
-            break;
-        }
+                ctx->EffectTable[part].nSample,
+                volume,
+                0,
+                0,
+                128,
+                0,
+                0,
+                0);
     }
 }
 
@@ -384,7 +572,7 @@ void SoundManager_playSpecialEffect(unsigned char vel, uint32_t part){
  *
  *  \param Midi note of the instrument
  *  \param Velocity of the note to be played
- *  \param delay in second before the note should be played
+ *  \param delay in samples before the note should be played
  *  \param ratio to convert ticks into time for the fill choke group
  *  \param fill choke group flag that determine is the 2 parts of one on the other
  *
@@ -392,71 +580,40 @@ void SoundManager_playSpecialEffect(unsigned char vel, uint32_t part){
  *
  */
 void SoundManager_playDrumsetNote(unsigned char note, unsigned char velocity,
-        float delay_seconde, float ratio, unsigned int partID, int pickUp) {
+        unsigned int delay_nsample, float ratio, unsigned int partID, int pickUp) {
+    SoundManager_context_t *ctx = Ctx;
 
     unsigned int fillChokeGroup;
     unsigned int fillChokeDelay_nsample;
-    unsigned int volume;
-    unsigned int groupVelocity = 0;
-    int high_index = 0;
-    int low_index = 0;
-    int delta;
-    DrumsetStruct_t *drum = NULL;
-    unsigned int nDelay = (pickUp == 0)?((unsigned int) (delay_seconde * SAMPLING_RATE)):0;
+    const VelocityEntry_t *entry;
+    unsigned int layer;
+    const SoundManager_drumset_t *drum = ctx->Drumset;
+    unsigned int nDelay = (pickUp == 0)?delay_nsample:0;
 
     // If there is no sound for the note
-
-#if (defined(__x86_64__) || defined(_M_X64))
-    DrumsetStruct64_t *drum64 = &Drumset64;
-#endif
-    if (Drumset.status[note] == FREE) return;
-    drum = &Drumset;
+    if (drum == NULL || drum->status[note] == FREE) return;
 
     if (velocity < 1 && drum->inst[note].nonPercussion>0) {
         // Choke note when velocity is zero, and non percussion
-        mixer_chokeNote(note);
+        mixer_chokeNote(note, nDelay);
     } else {
-        // Start the iteration with the end of the velocity array
-        high_index = drum->inst[note].nVel - 1;
-
-
-        // Loop until the velocity is lower or equal to the requested velocity
-        while (drum->inst[note].vel[high_index].vel > velocity) {
-            high_index--;
-        }
+        if (velocity >= MIDI_VELOCITY_COUNT) velocity = MIDI_VELOCITY_COUNT - 1;
 
-        if (high_index < drum->inst[note].nVel - 1){
-            volume = gGain[drum->inst[note].vel[high_index + 1].vel - 1][velocity] * drum->inst[note].volume;
-        } else {
-            volume = gGain[127][velocity] * drum->inst[note].volume;
-        }
+        // Group of layers and gain of the velocity, compiled with the drumset
+        entry = &drum->table[note].velocity[velocity];
 
-        // Save the index and the top velocity of the group
-        low_index = high_index;
-        groupVelocity = drum->inst[note].vel[high_index].vel;
-
-        // Look up every that have the same velocity of the group
-        while (groupVelocity == drum->inst[note].vel[low_index].vel) {
-            low_index--;
-            if (low_index < 0)
-                break;
-        }
-
-        // Number of possible velocity
-        delta = high_index - low_index;
-
-        // Get a random index to add some variations in the sounds of the player
-        high_index = 1 + low_index + (rand() % delta);
+        // Get a random layer of the group to add some variations in the sounds of the player
+        layer = entry->first + nextRandom(ctx, entry->count);
 
         // If a choke group is activated for the instrument
         if (drum->inst[note].chokeGroup) {
 
             // If the last note in the choke channel is different of the current note
-            if (drum->ChokeChan[drum->inst[note].chokeGroup] != note) {
+            if (ctx->ChokeChan[drum->inst[note].chokeGroup] != note) {
                 // Choke the channel
                 mixer_chokeChannel(drum->inst[note].chokeGroup, nDelay);
                 // Save the new note in the choke channel array
-                drum->ChokeChan[drum->inst[note].chokeGroup] = note;
+                ctx->ChokeChan[drum->inst[note].chokeGroup] = note;
             }
         }
 
@@ -465,10 +622,9 @@ void SoundManager_playDrumsetNote(unsigned char note, unsigned char velocity,
 
         if (fillChokeGroup != 0){
             // Fill choke note excluder
-            if(mixer_shouldNoteBeExcluded(fillChokeGroup,partID) && delay_seconde != 0.0) return;
+            if(mixer_shouldNoteBeExcluded(fillChokeGroup,partID) && delay_nsample != 0) return;
 
             // calculate the delay in sample
-            if (drum->inst[note].fillChokeDelay > 2) drum->inst[note].fillChokeDelay = 2;
             fillChokeDelay_nsample = (SAMPLING_RATE * (480 / (Divider[drum->inst[note].fillChokeDelay]))) * ratio;
         } else {
             fillChokeDelay_nsample = 0;
@@ -476,76 +632,20 @@ void SoundManager_playDrumsetNote(unsigned char note, unsigned char velocity,
 
 
         // Play the sound (support Mono/Stero 16 & 24 bits)
-        switch (drum->inst[note].vel[high_index].bps) {
-        case 16:
-            // if channel is stereo
-            if (drum->inst[note].vel[high_index].nChannel == 2) {
-#if !(defined(__x86_64__) || defined(_M_X64))
-                mixer_addPCM16Stereo(drum->inst[note].vel[high_index].addr,
-#else
-                mixer_addPCM16Stereo(drum64->inst[note].vel[high_index].addr,
-#endif
-                        drum->inst[note].vel[high_index].nSample,
-                        volume,
-                        nDelay,
-                        drum->inst[note].chokeGroup,
-                        note,
-                        fillChokeGroup,
-                        fillChokeDelay_nsample,
-                        partID);
-            } else {
-#if !(defined(__x86_64__) || defined(_M_X64))
-                mixer_addPCM16Mono(drum->inst[note].vel[high_index].addr,
-#else
-                mixer_addPCM16Mono(drum64->inst[note].vel[high_index].addr,
-#endif
-                        drum->inst[note].vel[high_index].nSample,
-                        volume,
-                        nDelay,
-                        drum->inst[note].chokeGroup,
-                        note,
-                        fillChokeGroup,
-                        fillChokeDelay_nsample,
-                        partID);
-            }
-            break;
-
-        case 24:
-            // if channel is stereo
-            if (drum->inst[note].vel[high_index].nChannel == 2) {
-#if !(defined(__x86_64__) || defined(_M_X64))
-                mixer_addPCM24Stereo(drum->inst[note].vel[high_index].addr,
-#else
-                mixer_addPCM24Stereo(drum64->inst[note].vel[high_index].addr,
-#endif
-                        drum->inst[note].vel[high_index].nSample,
-                        volume,
-                        nDelay,
-                        drum->inst[note].chokeGroup,
-                        note,
-                        fillChokeGroup,
-                        fillChokeDelay_nsample,
-                        partID);
-            } else {
+        mixer_addVoice(drum->table[note].format[layer],
 #if !(defined(__x86_64__) || defined(_M_X64))
-                mixer_addPCM24Mono(drum->inst[note].vel[high_index].addr,
+                drum->inst[note].vel[layer].addr,
 #else
-                mixer_addPCM24Mono(drum64->inst[note].vel[high_index].addr,
+                drum->inst64[note].vel[layer].addr,
 #endif
-                        drum->inst[note].vel[high_index].nSample,
-                        volume,
-                        nDelay,
-                        drum->inst[note].chokeGroup,
-                        note,
-                        fillChokeGroup,
-                        fillChokeDelay_nsample,
-                        partID);
-            }
-
-            break;
-        default:
-            break;
-        }
+                drum->inst[note].vel[layer].nSample,
+                entry->volume,
+                nDelay,
+                drum->inst[note].chokeGroup,
+                note,
+                fillChokeGroup,
+                fillChokeDelay_nsample,
+                partID);
 
         // Polyphony manager
         mixer_polyphonyRemove(note, drum->inst[note].poly, nDelay);
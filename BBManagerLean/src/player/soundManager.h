@@ -63,11 +63,40 @@ typedef struct {
 #endif
 
 
+// Instance of the sound manager. Every function works on the context of the calling thread
+// and plays the notes in the mixer context of the same thread.
+typedef struct SoundManager_context_s SoundManager_context_t;
+
 extern void SoundManager_init(void);
-extern void SoundManager_LoadDrumset(char* file, uint32_t size);
-extern void SoundManager_playDrumsetNote(unsigned char note, unsigned char velocity, float delay_seconde,float ratio, unsigned int isExclusive, int pickUp);
+extern SoundManager_context_t *SoundManager_createContext(void);
+extern void SoundManager_destroyContext(SoundManager_context_t *context);
+extern SoundManager_context_t *SoundManager_setContext(SoundManager_context_t *context);
+extern SoundManager_context_t *SoundManager_getContext(void);
+extern void SoundManager_LoadDrumset(const char* file, uint32_t size);
+
+// Drumset parsed once and played by several contexts, the file must stay valid while it is used
+typedef struct SoundManager_drumset_s SoundManager_drumset_t;
+
+extern SoundManager_drumset_t *SoundManager_parseDrumset(const char* file, uint32_t size);
+extern void SoundManager_freeDrumset(SoundManager_drumset_t *drumset);
+extern void SoundManager_setDrumset(const SoundManager_drumset_t *drumset);
+
+// Velocity layer of an instrument of a parsed drumset
+typedef struct {
+    const unsigned char *data;  // PCM samples, interleaved when stereo
+    unsigned int nSample;       // Sum of the samples of all the channels
+    unsigned short bps;         // Bits per sample
+    unsigned short nChannel;
+    unsigned int fs;            // Sampling frequency
+} SoundManager_sample_t;
+
+extern unsigned int SoundManager_getLayerCount(const SoundManager_drumset_t *drumset, unsigned char note);
+extern int SoundManager_getSample(const SoundManager_drumset_t *drumset, unsigned char note, unsigned int layer, SoundManager_sample_t *sample);
+extern void SoundManager_setSample(SoundManager_drumset_t *drumset, unsigned char note, unsigned int layer, const SoundManager_sample_t *sample);
+
+extern void SoundManager_playDrumsetNote(unsigned char note, unsigned char velocity, unsigned int delay_nsample, float ratio, unsigned int isExclusive, int pickUp);
 extern void SoundManager_playSpecialEffect(unsigned char vel, uint32_t part);
-extern void SoundManager_LoadEffect(char* file, uint32_t part);
+extern void SoundManager_LoadEffect(const char* file, uint32_t part);
 extern char* SongPlayer_getSoundEffectName(uint32_t part);
 
 
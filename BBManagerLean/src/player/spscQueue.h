@@ -0,0 +1,72 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <QAtomicInteger>
+#include <QtGlobal>
+
+/**
+ * @brief The SpscQueue class
+ *
+ * Fixed size queue between exactly one producer thread and one consumer thread.
+ * push() and pop() never lock, never allocate and never wait: when the queue is full or
+ * empty they return false right away, so it can be used from the audio thread.
+ * Size must be a power of 2.
+ */
+template <typename T, quint32 Size>
+class SpscQueue
+{
+    Q_DISABLE_COPY(SpscQueue)
+    Q_STATIC_ASSERT_X(Size >= 2 && (Size & (Size - 1)) == 0, "SpscQueue size must be a power of 2");
+
+public:
+    SpscQueue() : m_head(0), m_tail(0) {}
+
+    /**
+     * @brief push
+     *        Producer side
+     * @return false if the queue is full, the item is not queued
+     */
+    bool push(const T &item)
+    {
+        quint32 tail = m_tail.loadAcquire();
+        if (tail - m_head.loadAcquire() >= Size) {
+            return false;
+        }
+        m_items[tail & (Size - 1)] = item;
+        m_tail.storeRelease(tail + 1);
+        return true;
+    }
+
+    /**
+     * @brief pop
+     *        Consumer side
+     * @return false if the queue is empty
+     */
+    bool pop(T &item)
+    {
+        quint32 head = m_head.loadAcquire();
+        if (head == m_tail.loadAcquire()) {
+            return false;
+        }
+        item = m_items[head & (Size - 1)];
+        m_head.storeRelease(head + 1);
+        return true;
+    }
+
+    /**
+     * @brief clear
+     *        Consumer side, drops everything queued so far
+     */
+    void clear(void)
+    {
+        m_head.storeRelease(m_tail.loadAcquire());
+    }
+
+private:
+    // Head and tail are written by different threads, keep them on different cache lines
+    alignas(64) QAtomicInteger<quint32> m_head;
+    alignas(64) QAtomicInteger<quint32> m_tail;
+    alignas(64) T m_items[Size];
+};
+
+#endif // SPSCQUEUE_H
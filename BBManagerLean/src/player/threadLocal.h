@@ -0,0 +1,13 @@
+#ifndef THREADLOCAL_H
+#define THREADLOCAL_H
+
+// Storage of a variable that has its own instance in every thread
+#if defined(__cplusplus)
+#   define THREAD_LOCAL thread_local
+#elif defined(_MSC_VER)
+#   define THREAD_LOCAL __declspec(thread)
+#else
+#   define THREAD_LOCAL __thread
+#endif
+
+#endif // THREADLOCAL_H
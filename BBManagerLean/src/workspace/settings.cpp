@@ -157,6 +157,149 @@ void Settings::setBufferingTime_ms(int bufferingTime_ms)
    QSettings().setValue(KEY_BUFFERING_TIME, QVariant(bufferingTime_ms)); // Keep released key...
 }
 
+bool Settings::floatMixEngineExists()
+{
+   return QSettings().contains(KEY_FLOAT_MIX_ENGINE);
+}
+
+bool Settings::getFloatMixEngine()
+{
+   QSettings settings;
+   if(!settings.contains(KEY_FLOAT_MIX_ENGINE)){
+      return true; // Float engine by default
+   }
+   return settings.value(KEY_FLOAT_MIX_ENGINE).toBool();
+}
+
+void Settings::setFloatMixEngine(bool value)
+{
+   QSettings().setValue(KEY_FLOAT_MIX_ENGINE, QVariant(value));
+}
+
+bool Settings::drumsetPrefaultExists()
+{
+   return QSettings().contains(KEY_DRUMSET_PREFAULT);
+}
+
+bool Settings::getDrumsetPrefault()
+{
+   QSettings settings;
+   if(!settings.contains(KEY_DRUMSET_PREFAULT)){
+      return true; // Whole drumset read in memory when selected by default
+   }
+   return settings.value(KEY_DRUMSET_PREFAULT).toBool();
+}
+
+void Settings::setDrumsetPrefault(bool value)
+{
+   QSettings().setValue(KEY_DRUMSET_PREFAULT, QVariant(value));
+}
+
+bool Settings::adaptiveBufferingExists()
+{
+   return QSettings().contains(KEY_ADAPTIVE_BUFFERING);
+}
+
+bool Settings::getAdaptiveBuffering()
+{
+   QSettings settings;
+   if(!settings.contains(KEY_ADAPTIVE_BUFFERING)){
+      return false; // Buffering time set by the user by default
+   }
+   return settings.value(KEY_ADAPTIVE_BUFFERING).toBool();
+}
+
+void Settings::setAdaptiveBuffering(bool value)
+{
+   QSettings().setValue(KEY_ADAPTIVE_BUFFERING, QVariant(value));
+}
+
+int Settings::getBufferingMinTime_ms()
+{
+   bool ok = false;
+   int bufferingTime_ms = QSettings().value(KEY_BUFFERING_MIN_TIME).toInt(&ok);
+   if(!ok){
+      return MIXER_MIN_BUFFERRING_TIME_MS;
+   }
+   return bufferingTime_ms;
+}
+
+void Settings::setBufferingMinTime_ms(int bufferingTime_ms)
+{
+   QSettings().setValue(KEY_BUFFERING_MIN_TIME, QVariant(bufferingTime_ms));
+}
+
+int Settings::getBufferingMaxTime_ms()
+{
+   bool ok = false;
+   int bufferingTime_ms = QSettings().value(KEY_BUFFERING_MAX_TIME).toInt(&ok);
+   if(!ok){
+      return MIXER_MAX_BUFFERRING_TIME_MS;
+   }
+   return bufferingTime_ms;
+}
+
+void Settings::setBufferingMaxTime_ms(int bufferingTime_ms)
+{
+   QSettings().setValue(KEY_BUFFERING_MAX_TIME, QVariant(bufferingTime_ms));
+}
+
+bool Settings::getPlayerStatsLog()
+{
+   QSettings settings;
+   if(!settings.contains(KEY_PLAYER_STATS_LOG)){
+      return false; // Statistics of the player only shown on demand by default
+   }
+   return settings.value(KEY_PLAYER_STATS_LOG).toBool();
+}
+
+void Settings::setPlayerStatsLog(bool value)
+{
+   QSettings().setValue(KEY_PLAYER_STATS_LOG, QVariant(value));
+}
+
+bool Settings::getRealTimeAudio()
+{
+   QSettings settings;
+   if(!settings.contains(KEY_REALTIME_AUDIO)){
+      return false; // Audio thread scheduled like the others by default
+   }
+   return settings.value(KEY_REALTIME_AUDIO).toBool();
+}
+
+void Settings::setRealTimeAudio(bool value)
+{
+   QSettings().setValue(KEY_REALTIME_AUDIO, QVariant(value));
+}
+
+bool Settings::getSetlistMode()
+{
+   QSettings settings;
+   if(!settings.contains(KEY_SETLIST_MODE)){
+      return false; // Selecting another song while playing stops the player by default
+   }
+   return settings.value(KEY_SETLIST_MODE).toBool();
+}
+
+void Settings::setSetlistMode(bool value)
+{
+   QSettings().setValue(KEY_SETLIST_MODE, QVariant(value));
+}
+
+int Settings::getRenderBitsPerSample()
+{
+   int bits = QSettings().value(KEY_RENDER_BITS_PER_SAMPLE).toInt();
+   if(bits != 24){
+      return 16; // Songs rendered to 16 bits WAV by default
+   }
+   return bits;
+}
+
+void Settings::setRenderBitsPerSample(int bits)
+{
+   QSettings().setValue(KEY_RENDER_BITS_PER_SAMPLE, QVariant(bits));
+}
+
 
 bool Settings::helpIndexExists()
 {
@@ -15,6 +15,15 @@
 #define KEY_H "window/h"
 
 #define KEY_BUFFERING_TIME "player_buffering_time"
+#define KEY_FLOAT_MIX_ENGINE "player_float_mix_engine"
+#define KEY_DRUMSET_PREFAULT "player_drumset_prefault"
+#define KEY_ADAPTIVE_BUFFERING "player_adaptive_buffering"
+#define KEY_BUFFERING_MIN_TIME "player_buffering_min_time"
+#define KEY_BUFFERING_MAX_TIME "player_buffering_max_time"
+#define KEY_PLAYER_STATS_LOG "player_stats_log"
+#define KEY_REALTIME_AUDIO "player_realtime_audio"
+#define KEY_SETLIST_MODE "player_setlist_mode"
+#define KEY_RENDER_BITS_PER_SAMPLE "render_bits_per_sample"
 
 #define KEY_DND_W "color_dnd_withdraw"
 #define KEY_DND_C "color_dnd_copy"
@@ -92,6 +101,35 @@ public:
    static int getBufferingTime_ms();
    static void setBufferingTime_ms(int bufferingTime_ms);
 
+   static bool floatMixEngineExists();
+   static bool getFloatMixEngine();
+   static void setFloatMixEngine(bool value);
+
+   static bool drumsetPrefaultExists();
+   static bool getDrumsetPrefault();
+   static void setDrumsetPrefault(bool value);
+
+   static bool adaptiveBufferingExists();
+   static bool getAdaptiveBuffering();
+   static void setAdaptiveBuffering(bool value);
+
+   static int getBufferingMinTime_ms();
+   static void setBufferingMinTime_ms(int bufferingTime_ms);
+   static int getBufferingMaxTime_ms();
+   static void setBufferingMaxTime_ms(int bufferingTime_ms);
+
+   static bool getPlayerStatsLog();
+   static void setPlayerStatsLog(bool value);
+
+   static bool getRealTimeAudio();
+   static void setRealTimeAudio(bool value);
+
+   static bool getSetlistMode();
+   static void setSetlistMode(bool value);
+
+   static int getRenderBitsPerSample();
+   static void setRenderBitsPerSample(int bits);
+
    static bool helpIndexExists();
    static QString getHelpIndexDir();
 
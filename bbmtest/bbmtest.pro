@@ -1,7 +1,51 @@
 QT += testlib
-QT += gui
-CONFIG += qt warn_on depend_includepath testcase
+QT += gui multimedia
+CONFIG += qt warn_on depend_includepath testcase c++11
 
 TEMPLATE = app
 
-SOURCES +=  tst_smoketest.cpp
+# The player and its engine, built from the sources of the application
+BBM_SRC = $$PWD/../BBManagerLean/src
+
+INCLUDEPATH += $$BBM_SRC
+
+SOURCES +=  tst_smoketest.cpp \
+    $$BBM_SRC/workspace/settings.cpp \
+    $$BBM_SRC/model/filegraph/midiparser.cpp \
+    $$BBM_SRC/player/player.cpp \
+    $$BBM_SRC/player/offlineRenderer.cpp \
+    $$BBM_SRC/player/audioSink.cpp \
+    $$BBM_SRC/player/playerStats.cpp \
+    $$BBM_SRC/player/realTime.cpp \
+    $$BBM_SRC/player/resampler.cpp \
+    $$BBM_SRC/player/engineContext.cpp \
+    $$BBM_SRC/player/mappedFile.cpp \
+    $$BBM_SRC/player/engineCache.cpp \
+    $$BBM_SRC/player/drumsetPreloader.cpp \
+    $$BBM_SRC/player/songPreparer.cpp \
+    $$BBM_SRC/player/batchRenderer.cpp \
+    $$BBM_SRC/player/soundManager.c \
+    $$BBM_SRC/player/mixer.c \
+    $$BBM_SRC/player/mixerKernels.c \
+    $$BBM_SRC/player/songPlayer.cpp
+
+HEADERS += \
+    $$BBM_SRC/workspace/settings.h \
+    $$BBM_SRC/player/player.h \
+    $$BBM_SRC/player/offlineRenderer.h \
+    $$BBM_SRC/player/audioSink.h \
+    $$BBM_SRC/player/playerStats.h \
+    $$BBM_SRC/player/realTime.h \
+    $$BBM_SRC/player/resampler.h \
+    $$BBM_SRC/player/engineContext.h \
+    $$BBM_SRC/player/mappedFile.h \
+    $$BBM_SRC/player/engineCache.h \
+    $$BBM_SRC/player/drumsetPreloader.h \
+    $$BBM_SRC/player/songPreparer.h \
+    $$BBM_SRC/player/spscQueue.h \
+    $$BBM_SRC/player/batchRenderer.h \
+    $$BBM_SRC/player/threadLocal.h \
+    $$BBM_SRC/player/mixer.h \
+    $$BBM_SRC/player/mixerKernels.h \
+    $$BBM_SRC/player/songPlayer.h \
+    $$BBM_SRC/player/soundManager.h
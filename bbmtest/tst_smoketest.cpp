@@ -1,7 +1,28 @@
 #include <QtTest>
 #include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QtEndian>
+#include <string.h>
 
-// add necessary includes here
+#include "player/player.h"
+#include "player/soundManager.h"
+#include "model/filegraph/songfile.h"
+
+// Fixture: one bar at 120 BPM with a kick on every beat, the kick is 100 ms of a square wave
+#define FIXTURE_NOTE            (36)
+#define FIXTURE_SAMPLE_FRAMES   (4410)
+#define FIXTURE_BAR_TICKS       (4 * 480)
+
+// Same layout as DRUMSETFILE_HeaderStruct of soundManager.c
+PACK typedef struct {
+    char     fileType[4];
+    uint8_t  version;
+    uint8_t  revision;
+    uint16_t build;
+    uint32_t fileCRC;
+} PACKED FixtureDrumsetHeader;
 
 class SmokeTest : public QObject
 {
@@ -15,7 +36,18 @@ private slots:
     void initTestCase();
     void cleanupTestCase();
     void test_case1();
+    void test_playNullSink();
+    void test_playFileSink();
+
+private:
+    static QByteArray fixtureDrumset(void);
+    static QByteArray fixtureSong(void);
+    static bool writeFile(const QString &filepath, const QByteArray &data);
+    static qint64 play(Player &player, int playTime_ms);
 
+    QTemporaryDir m_dir;
+    QString m_drumsetPath;
+    QString m_songPath;
 };
 
 SmokeTest::SmokeTest()
@@ -30,7 +62,14 @@ SmokeTest::~SmokeTest()
 
 void SmokeTest::initTestCase()
 {
+    // The player reads its options from the settings, not the ones of the user
+    QStandardPaths::setTestModeEnabled(true);
 
+    QVERIFY(m_dir.isValid());
+    m_drumsetPath = m_dir.filePath("fixture.drm");
+    m_songPath = m_dir.filePath("fixture.bbs");
+    QVERIFY(writeFile(m_drumsetPath, fixtureDrumset()));
+    QVERIFY(writeFile(m_songPath, fixtureSong()));
 }
 
 void SmokeTest::cleanupTestCase()
@@ -43,6 +82,196 @@ void SmokeTest::test_case1()
     QVERIFY(true);
 }
 
+/**
+ * @brief SmokeTest::test_playNullSink
+ *        The frames are pulled at the pace of a device without one
+ */
+void SmokeTest::test_playNullSink()
+{
+    Player player;
+    player.setDrumset(m_drumsetPath);
+    player.setSong(m_songPath);
+    player.setAudioSink(AudioSink::Null);
+
+    qint64 elapsed_ms = play(player, 500);
+    if (QTest::currentTestFailed()) {
+        return;
+    }
+
+    // Everything played since the start and at most one buffer ahead of the simulated clock
+    qint64 frames = player.stats().frames;
+    int bufferTime_ms = qMax(player.bufferTime_ms(), player.adaptedBufferTime_ms());
+    QVERIFY2(frames >= 44100LL * 400 / 1000, qPrintable(QString("%1 frames in %2 ms").arg(frames).arg(elapsed_ms)));
+    QVERIFY2(frames <= 44100LL * (elapsed_ms + bufferTime_ms + AUDIO_SINK_PERIOD_MS) / 1000,
+             qPrintable(QString("%1 frames in %2 ms").arg(frames).arg(elapsed_ms)));
+}
+
+/**
+ * @brief SmokeTest::test_playFileSink
+ *        The frames are written as fast as they are rendered, the file is a complete WAV
+ */
+void SmokeTest::test_playFileSink()
+{
+    QString wavPath = m_dir.filePath("fixture.wav");
+
+    Player player;
+    player.setDrumset(m_drumsetPath);
+    player.setSong(m_songPath);
+    player.setAudioSink(AudioSink::File, wavPath);
+
+    play(player, 200);
+    if (QTest::currentTestFailed()) {
+        return;
+    }
+
+    QFile file(wavPath);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QByteArray wav = file.readAll();
+    QVERIFY(wav.size() > AUDIO_SINK_WAV_HEADER_SIZE);
+    const uchar *header = (const uchar *)wav.constData();
+
+    QCOMPARE(wav.left(4), QByteArray("RIFF"));
+    QCOMPARE(qFromLittleEndian<quint32>(header + 4), (quint32)(wav.size() - 8));
+    QCOMPARE(wav.mid(8, 8), QByteArray("WAVEfmt "));
+    QCOMPARE(qFromLittleEndian<quint32>(header + 16), (quint32)16);
+    QCOMPARE(qFromLittleEndian<quint16>(header + 20), (quint16)1);         // PCM
+    QCOMPARE(qFromLittleEndian<quint16>(header + 22), (quint16)2);         // Stereo
+    QCOMPARE(qFromLittleEndian<quint32>(header + 24), (quint32)44100);
+    QCOMPARE(qFromLittleEndian<quint32>(header + 28), (quint32)(44100 * 4));
+    QCOMPARE(qFromLittleEndian<quint16>(header + 32), (quint16)4);
+    QCOMPARE(qFromLittleEndian<quint16>(header + 34), (quint16)16);
+    QCOMPARE(wav.mid(36, 4), QByteArray("data"));
+
+    // Every frame rendered by the player is in the file
+    quint32 dataSize = qFromLittleEndian<quint32>(header + 40);
+    QCOMPARE(dataSize, (quint32)(wav.size() - AUDIO_SINK_WAV_HEADER_SIZE));
+    QCOMPARE((qint64)dataSize / 4, player.stats().frames);
+    QVERIFY((qint64)dataSize / 4 >= FIXTURE_SAMPLE_FRAMES);
+
+    // The kicks were heard
+    const qint16 *samples = (const qint16 *)(wav.constData() + AUDIO_SINK_WAV_HEADER_SIZE);
+    int peak = 0;
+    for (quint32 i = 0; i < dataSize / 2; i++) {
+        peak = qMax(peak, qAbs((int)qFromLittleEndian<qint16>((const uchar *)&samples[i])));
+    }
+    QVERIFY(peak > 0);
+}
+
+/**
+ * @brief SmokeTest::play
+ *        Play the song for a while, then stop it with a double tap and wait for the player to stop
+ * @return Time between the start and the stop of the player
+ */
+qint64 SmokeTest::play(Player &player, int playTime_ms)
+{
+    QSignalSpy started(&player, &Player::sigPlayerStarted);
+    QSignalSpy stopped(&player, &Player::sigPlayerStopped);
+    QSignalSpy errors(&player, &Player::sigPlayerError);
+    QElapsedTimer timer;
+
+    timer.start();
+    player.play();
+    [&]() { QTRY_COMPARE_WITH_TIMEOUT(started.count(), 1, 5000); }();
+    if (QTest::currentTestFailed()) {
+        player.stop();
+        player.wait();
+        return 0;
+    }
+    QTest::qWait(playTime_ms);
+
+    // Stops by itself once the sound faded out
+    player.pedalDoubleTap();
+    [&]() { QTRY_COMPARE_WITH_TIMEOUT(stopped.count(), 1, 5000); }();
+    qint64 elapsed_ms = timer.elapsed();
+    if (QTest::currentTestFailed()) {
+        player.stop();
+    }
+    player.wait();
+
+    [&]() { QVERIFY(!player.isRunning()); QCOMPARE(errors.count(), 0); }();
+    return elapsed_ms;
+}
+
+/**
+ * @brief SmokeTest::fixtureDrumset
+ *        Drumset with a single mono 16 bits kick, laid out like the ones of DrumSetMaker
+ */
+QByteArray SmokeTest::fixtureDrumset(void)
+{
+    FixtureDrumsetHeader header;
+    Instrument_t inst[MIDIPARSER_NUMBER_OF_INSTRUMENTS];
+    int dataOffset = (int)(sizeof(header) + sizeof(inst));
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.fileType, "BBds", 4);
+    memset(inst, 0, sizeof(inst));
+    inst[FIXTURE_NOTE].poly = 1;
+    inst[FIXTURE_NOTE].nVel = 1;
+    inst[FIXTURE_NOTE].dataSize = FIXTURE_SAMPLE_FRAMES * 2;
+    inst[FIXTURE_NOTE].volume = 100;
+    inst[FIXTURE_NOTE].vel[0].bps = 16;
+    inst[FIXTURE_NOTE].vel[0].nChannel = 1;
+    inst[FIXTURE_NOTE].vel[0].fs = 44100;
+    inst[FIXTURE_NOTE].vel[0].nSample = FIXTURE_SAMPLE_FRAMES;
+#if !(defined(__x86_64__) || defined(_M_X64))
+    inst[FIXTURE_NOTE].vel[0].addr = dataOffset;
+#else
+    inst[FIXTURE_NOTE].vel[0].offset = dataOffset;
+#endif
+
+    QByteArray drumset;
+    drumset.append((const char *)&header, sizeof(header));
+    drumset.append((const char *)inst, sizeof(inst));
+    for (int i = 0; i < FIXTURE_SAMPLE_FRAMES; i++) {
+        qint16 sample = qToLittleEndian<qint16>((i / 50) % 2 ? 16000 : -16000);
+        drumset.append((const char *)&sample, sizeof(sample));
+    }
+    return drumset;
+}
+
+/**
+ * @brief SmokeTest::fixtureSong
+ *        Song of a single part, its main loop is the only track
+ */
+QByteArray SmokeTest::fixtureSong(void)
+{
+    MIDIPARSER_MidiTrack track;
+    track.format = 0;
+    track.nTrack = 1;
+    track.nTick = FIXTURE_BAR_TICKS;
+    track.timeSigNum = 4;
+    track.timeSigDen = 4;
+    track.n32ndNotesPerMIDIQuarterNote = 8;
+    track.midiClocksPerMetronomeClick = 24;
+    track.tpqn = 480;
+    track.barLength = FIXTURE_BAR_TICKS;
+    track.bpm = 120;
+    for (int tick = 0; tick < FIXTURE_BAR_TICKS; tick += 480) {
+        track.event.push_back(MIDIPARSER_MidiEvent(tick, FIXTURE_NOTE, 100));
+    }
+    QByteArray trackData = track;
+
+    QScopedPointer<SONGFILE_FileStruct> file(new SONGFILE_FileStruct());
+    file->song.bpm = 120;
+    file->song.nPart = 1;
+    file->song.part[0].mainLoopIndex = 0;
+    file->trackIndexes[0].dataOffset = 0;
+    file->offsets.tracksDataOffset = sizeof(SONGFILE_FileStruct);
+    file->offsets.tracksDataSize = trackData.size();
+    file->offsets.autoPilotDataOffset = 0;
+    file->offsets.autoPilotDataSize = 0;
+
+    QByteArray song((const char *)file.data(), sizeof(SONGFILE_FileStruct));
+    song.append(trackData);
+    return song;
+}
+
+bool SmokeTest::writeFile(const QString &filepath, const QByteArray &data)
+{
+    QFile file(filepath);
+    return file.open(QIODevice::WriteOnly) && file.write(data) == data.size();
+}
+
 QTEST_MAIN(SmokeTest)
 
 #include "tst_smoketest.moc"